@@ -42,6 +42,12 @@ let package = Package(
             dependencies: ["CGraphvizSDK"],
             path: "Sources/GraphvizSDK"
         ),
+        // Замеры производительности: swift run -c release GraphvizBenchmarks [имя ...]
+        .executableTarget(
+            name: "GraphvizBenchmarks",
+            dependencies: ["CGraphvizSDK"],
+            path: "Sources/GraphvizBenchmarks"
+        ),
         .testTarget(
             name: "GraphvizSDKTests",
             dependencies: [
@@ -39,6 +39,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdint.h>
+#include <util/agxbuf.h>
 #include <util/list.h>
 
 #define	SUCCESS				0
@@ -54,13 +55,10 @@ CGHDR_API int agapply(Agraph_t * g, Agobj_t * obj, agobjfn_t fn, void *arg,
 	    int preorder);
 
 	/* global variables */
-extern Agraph_t *Ag_G_global;
+extern _Thread_local Agraph_t *Ag_G_global;
 extern char *AgDataRecName;
 
 	/* set ordering disciplines */
-extern Dtdisc_t Ag_subnode_seq_disc;
-extern Dtdisc_t Ag_mainedge_id_disc;
-extern Dtdisc_t Ag_subedge_id_disc;
 extern Dtdisc_t Ag_mainedge_seq_disc;
 extern Dtdisc_t Ag_subedge_seq_disc;
 extern Dtdisc_t Ag_subgraph_id_disc;
@@ -70,6 +68,13 @@ extern Dtdisc_t Ag_subgraph_seq_disc;
 Agraph_t *agopen1(Agraph_t * g);
 int agstrclose(Agraph_t * g);
 
+	/* canonical (written) forms of refstrs, cached per output line length */
+char *agstrcanon_cached(const char *s, int linelength);
+char *agstrcanon_cache(char *s, int linelength, const char *canon);
+
+	/* write a graph as DOT, appending to a buffer */
+int agwrite_xb(Agraph_t * g, agxbuf * xb);
+
 /// Mask of `Agtag_s.seq` width
 enum { SEQ_MASK = (1 << (sizeof(unsigned) * 8 - 4)) - 1 };
 
@@ -109,6 +114,8 @@ typedef struct aagextra_s aagextra_t;
 
 int aagparse(void);
 void aglexinit(Agdisc_t * disc, void *ifile);
+void *aglexmem(const char *data, size_t len);
+void aglexmemend(void *previous);
 int aaglex(void);
 void aglexeof(void);
 void aglexbad(void);
@@ -126,6 +133,12 @@ int aginternalmapdelete(Agraph_t * g, int objtype, IDTYPE id);
 void aginternalmapclose(Agraph_t * g);
 void agregister(Agraph_t * g, int objtype, void *obj);
 
+	/* storage for objects created in bulk, released with the root graph */
+typedef struct agarena_s agarena_t;
+void *agarena_alloc(Agraph_t *g, size_t size);
+bool agarena_owns(Agraph_t *g, const void *p);
+void agarena_close(Agraph_t *g);
+
 	/* internal set operations */
 void agedgesetop(Agraph_t * g, Agedge_t * e, int insertion);
 void agdelnodeimage(Agraph_t * g, Agnode_t * node, void *ignored);
@@ -95,6 +95,8 @@ typedef struct Agedgepair_s Agedgepair_t; ///< the edge object
 /// @{
 typedef struct Agiddisc_s Agiddisc_t; ///< object ID allocator
 typedef struct Agiodisc_s Agiodisc_t; ///< IO services
+typedef struct Agmemdisc_s Agmemdisc_t; ///< memory allocator
+typedef struct Agmemstats_s Agmemstats_t; ///< allocation counters
 typedef struct Agdisc_s Agdisc_t;     ///< union of client discipline methods
 /// @}
 /// @addtogroup cgraph_callback
@@ -240,16 +242,14 @@ struct Agobj_s {
 
 /** @brief This is the node struct allocated per graph (or subgraph).
 
-It resides in the n_dict of the graph.
-The node set is maintained by libcdt, but transparently to libgraph callers.
+It resides in the node sets of the graph, which are maintained transparently
+to libgraph callers.
 Every node may be given an optional string name at its time of creation,
 or it is permissible to pass NULL for the name. */
 
 struct Agsubnode_s { /* the node-per-graph-or-subgraph record */
-  Dtlink_t seq_link; /* must be first */
-  Dtlink_t id_link;
   Agnode_t *node;             /* the object */
-  Dtlink_t *in_id, *out_id;   /* by node/ID for random access */
+  size_t seq_index;           /* position in the graph's node sequence */
   Dtlink_t *in_seq, *out_seq; /* by node/sequence for serial access */
 };
 
@@ -264,7 +264,6 @@ struct Agnode_s {
 /// @{
 struct Agedge_s {
   Agobj_t base;
-  Dtlink_t id_link; /* main graph only */
   Dtlink_t seq_link;
   Agnode_t *node; /* the endpoint node */
 };
@@ -327,18 +326,43 @@ struct Agiodisc_s {
                             /* error messages? */
 };
 
+/// @brief memory allocator
+///
+/// Storage of nodes, edges, subgraphs, records and attribute tables of a root
+/// graph and its subgraphs is obtained here. `alloc` and `resize` return
+/// zeroed memory.
+struct Agmemdisc_s {
+  void *(*open)(Agdisc_t *); /* independent of other resources */
+  void *(*alloc)(void *state, size_t req);
+  void *(*resize)(void *state, void *ptr, size_t old, size_t req);
+  void (*free)(void *state, void *ptr);
+  void (*close)(void *state);
+  /// fill in the byte counts of @ref Agmemstats_s; may be NULL
+  void (*stats)(void *state, Agmemstats_t *stats);
+};
+
 /// @brief user's discipline
 ///
 /// A default discipline is supplied when NULL is given for any of these fields.
 struct Agdisc_s {
   Agiddisc_t *id;
   Agiodisc_t *io;
+  Agmemdisc_t *mem;
 };
 
 /* default resource disciplines */
 
 CGRAPH_API extern Agiddisc_t AgIdDisc;
 CGRAPH_API extern Agiodisc_t AgIoDisc;
+CGRAPH_API extern Agmemdisc_t AgMemDisc;
+
+/// @brief allocator that carves objects out of chunks owned by the root graph
+///
+/// Freed objects are reused by later allocations of the same size, and the
+/// chunks are released together when the root graph is closed, which then
+/// skips deleting its nodes and edges one at a time. Suits graphs that are
+/// built, laid out and discarded in one go.
+CGRAPH_API extern Agmemdisc_t AgArenaDisc;
 
 CGRAPH_API extern Agdisc_t AgDefaultDisc;
 /// @}
@@ -357,6 +381,7 @@ CGRAPH_API extern Agdisc_t AgDefaultDisc;
 
 /// client state (closures)
 struct Agdstate_s {
+  void *mem;
   void *id;
   /* IO must be initialized and finalized outside Cgraph,
    * and channels (FILES) are passed as void* arguments. */
@@ -412,10 +437,14 @@ struct Agclos_s {
   Agcbstack_t *cb;  /* user and system callback function stacks */
   Dict_t *lookup_by_name[3];
   Dict_t *lookup_by_id[3];
+  struct agarena_s *arena; ///< storage of objects created in bulk
+  size_t allocations;      ///< calls to @ref agalloc, see @ref agmemstats
 };
 
-/// opaque type; the definition of this is internal to Graphviz
+/// opaque types; the definitions of these are internal to Graphviz
+struct graphviz_node_seq;
 struct graphviz_node_set;
+struct graphviz_edge_set;
 
 /// graph or subgraph
 struct Agraph_s {
@@ -423,12 +452,13 @@ struct Agraph_s {
   Agdesc_t desc;
   Dtlink_t seq_link;
   Dtlink_t id_link;
-  Dict_t *n_seq;                  ///< the node set in sequence
-  struct graphviz_node_set *n_id; ///< the node set indexed by ID
-  Dict_t *e_seq, *e_id;           ///< holders for edge sets
-  Dict_t *g_seq, *g_id;           ///< subgraphs - descendants
-  Agraph_t *parent, *root;        ///< subgraphs - ancestors
-  Agclos_t *clos;                 ///< shared resources
+  struct graphviz_node_seq *n_seq; ///< the node set in sequence
+  struct graphviz_node_set *n_id;  ///< the node set indexed by ID
+  Dict_t *e_seq;                   ///< holders for edge sets in sequence
+  struct graphviz_edge_set *e_id;  ///< the edge set indexed by ends and ID
+  Dict_t *g_seq, *g_id;            ///< subgraphs - descendants
+  Agraph_t *parent, *root;         ///< subgraphs - ancestors
+  Agclos_t *clos;                  ///< shared resources
 };
 
 /* graphs */
@@ -453,6 +483,10 @@ CGRAPH_API Agraph_t *agread(void *chan, Agdisc_t *disc);
 CGRAPH_API Agraph_t *agmemread(const char *cp);
 ///< reads a graph from the input string
 
+CGRAPH_API Agraph_t *agmemread_len(const char *cp, size_t len);
+///< reads a graph from the first @p len bytes at @p cp, which need not be
+///< NUL-terminated
+
 CGRAPH_API Agraph_t *agmemconcat(Agraph_t *g, const char *cp);
 
 CGRAPH_API void agsetfile(const char *);
@@ -468,17 +502,64 @@ CGRAPH_API Agraph_t *agconcat(Agraph_t *g, void *chan, Agdisc_t *disc);
  */
 
 CGRAPH_API int agwrite(Agraph_t *g, void *chan);
+CGRAPH_API char *agwritemem(Agraph_t *g, size_t *len);
+///< writes a graph as DOT into a new NUL-terminated string, without going
+///< through the graph's I/O discipline
+///<
+///< @param len [out] If non-null, the length of the string
+///< @return The string, to be freed with `free`, or NULL on failure
 CGRAPH_API int agisdirected(Agraph_t *g);
 CGRAPH_API int agisundirected(Agraph_t *g);
 CGRAPH_API int agisstrict(Agraph_t *g);
 CGRAPH_API int agissimple(Agraph_t *g);
 /// @}
 
+/** @defgroup cgraph_memory memory
+ *  @ingroup cgraph_graph
+ *  @brief storage obtained through the memory discipline of a graph
+ *  @{
+ */
+
+/// allocation counters of a root graph, see @ref agmemstats
+struct Agmemstats_s {
+  size_t allocations; ///< objects allocated through @ref agalloc so far
+  size_t bytes;       ///< bytes of objects currently allocated
+  size_t peak_bytes;  ///< most bytes of objects allocated at once
+  size_t chunks;      ///< blocks obtained from the system to hold them
+  size_t chunk_bytes; ///< total size of those blocks
+};
+
+CGRAPH_API void *agalloc(Agraph_t *g, size_t size);
+///< zeroed storage from the memory discipline of @p g
+
+CGRAPH_API void *agrealloc(Agraph_t *g, void *ptr, size_t oldsize,
+                           size_t size);
+///< resize storage from @ref agalloc, zeroing any bytes past @p oldsize
+
+CGRAPH_API void agfree(Agraph_t *g, void *ptr);
+///< give back storage from @ref agalloc
+
+CGRAPH_API Agmemstats_t agmemstats(Agraph_t *g);
+/**< @brief allocation counters of the root graph of @p g
+ *
+ * `allocations` is always counted. The byte and chunk counts are left at 0
+ * by disciplines without a `stats` method, such as @ref AgMemDisc.
+ */
+/// @}
+
 /// @addtogroup cgraph_node
 /// @{
 CGRAPH_API Agnode_t *agnode(Agraph_t *g, char *name, int createflag);
 CGRAPH_API Agnode_t *agidnode(Agraph_t *g, IDTYPE id, int createflag);
 CGRAPH_API Agnode_t *agsubnode(Agraph_t *g, Agnode_t *n, int createflag);
+CGRAPH_API size_t agnodes_bulk(Agraph_t *g, size_t n, char **names,
+                               Agnode_t **nodes);
+///< @brief @ref agnode (g, names[i], 1) for each of the @p n names in turn
+///
+/// New nodes share storage that is released when the root graph is closed.
+/// @param names Node names; a NULL array or name makes anonymous nodes
+/// @param nodes If not NULL, receives the node for each name
+/// @return Number of nodes created
 CGRAPH_API Agnode_t *agfstnode(Agraph_t *g);
 CGRAPH_API Agnode_t *agnxtnode(Agraph_t *g, Agnode_t *n);
 CGRAPH_API Agnode_t *aglstnode(Agraph_t *g);
@@ -517,6 +598,18 @@ CGRAPH_API Agedge_t *agedge(Agraph_t *g, Agnode_t *t, Agnode_t *h, char *name,
 CGRAPH_API Agedge_t *agidedge(Agraph_t *g, Agnode_t *t, Agnode_t *h, IDTYPE id,
                               int createflag);
 CGRAPH_API Agedge_t *agsubedge(Agraph_t *g, Agedge_t *e, int createflag);
+CGRAPH_API size_t agedges_bulk(Agraph_t *g, size_t n_nodes, Agnode_t **nodes,
+                               size_t n, const size_t *tails,
+                               const size_t *heads, Agedge_t **edges);
+///< @brief @ref agedge (g, nodes[tails[i]], nodes[heads[i]], NULL, 1) for each
+///  of the @p n index pairs in turn
+///
+/// In a root graph that is not strict, new edges share storage that is
+/// released when the graph is closed, and each node's edge sets are built
+/// sorted in one go.
+/// @param n_nodes Length of @p nodes; pairs with an index past it are skipped
+/// @param edges If not NULL, receives each edge, or NULL if none was made
+/// @return Number of edges created
 CGRAPH_API Agedge_t *agfstin(Agraph_t *g, Agnode_t *n);
 CGRAPH_API Agedge_t *agnxtin(Agraph_t *g, Agedge_t *e);
 CGRAPH_API Agedge_t *agfstout(Agraph_t *g, Agnode_t *n);
@@ -721,6 +814,13 @@ CGRAPH_API int agsafeset(void *obj, char *name, const char *value,
 ///< @brief ensures the given attribute is declared
 ///  before setting it locally on an object
 
+CGRAPH_API int agsafeset_bulk(Agraph_t *g, int kind, char *name,
+                              const char *def, size_t n, void **objs,
+                              char **values);
+///< @brief @ref agsafeset (objs[i], name, values[i], def) for each of the
+///  @p n objects of kind @p kind, looking the attribute up once.
+///  Objects with a NULL value are left alone.
+
 /// @}
 
 /** @defgroup cgraph_subgraph subgraphs
@@ -0,0 +1,86 @@
+/// @file
+/// @brief unordered set of `Agedge_t *`, indexed by their ends and ID
+
+#pragma once
+
+#include <assert.h>
+#include <cgraph/cgraph.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// an unordered set
+///
+/// Edges are looked up by tail, head and ID, or by tail and head alone. For
+/// the latter, the set answers with the edge between the two nodes that has
+/// the lowest sequence number.
+typedef struct graphviz_edge_set edge_set_t;
+
+/// construct a new set
+///
+/// Calls `exit` on failure (out-of-memory).
+///
+/// @return A constructed set
+edge_set_t *edge_set_new(void);
+
+/// add an item to the set
+///
+/// If the backing store is not large enough, it is expanded on demand. On
+/// allocation failure, `exit` is called. If the item is already in the set,
+/// this is a no-op.
+///
+/// @param self Set to add to
+/// @param item Out-edge of the element to add
+/// @return True if the item was added, false if it was already there
+bool edge_set_add(edge_set_t *self, Agedge_t *item);
+
+/// lookup an existing item in a set
+///
+/// @param self Set to search
+/// @param tail Tail of the edge to look for
+/// @param head Head of the edge to look for
+/// @param id Identifier of the edge to look for
+/// @return The found out-edge or `NULL` if it was not in the set
+Agedge_t *edge_set_find(const edge_set_t *self, const Agnode_t *tail,
+                        const Agnode_t *head, IDTYPE id);
+
+/// lookup the earliest item between two nodes
+///
+/// @param self Set to search
+/// @param tail Tail of the edge to look for
+/// @param head Head of the edge to look for
+/// @return The out-edge from `tail` to `head` with the lowest sequence number,
+///   or `NULL` if there is none in the set
+Agedge_t *edge_set_find_any(const edge_set_t *self, const Agnode_t *tail,
+                            const Agnode_t *head);
+
+/// remove an item from a set
+///
+/// If the given item was not in the set, this is a no-op.
+///
+/// @param self Set to remove from
+/// @param item Out-edge of the element to remove
+/// @param next The edge from the same tail to the same head that follows
+///   `item` in sequence, or `NULL` if there is none
+void edge_set_remove(edge_set_t *self, Agedge_t *item, Agedge_t *next);
+
+/// get the number of items in a set
+///
+/// @param self Set to query
+/// @return Number of elements in the set
+size_t edge_set_size(const edge_set_t *self);
+
+/// is this set empty?
+///
+/// @param self Set to query
+/// @return True if this set contains nothing
+static inline bool edge_set_is_empty(const edge_set_t *self) {
+  assert(self != NULL);
+  return edge_set_size(self) == 0;
+}
+
+/// destruct a set
+///
+/// `*self` is `NULL` on return.
+///
+/// @param self Set to destroy
+void edge_set_free(edge_set_t **self);
@@ -0,0 +1,84 @@
+/// @file
+/// @brief `Agsubnode_t *` in order of their nodes' sequence numbers
+
+#pragma once
+
+#include <assert.h>
+#include <cgraph/cgraph.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// an ordered sequence
+///
+/// Elements are kept in an array, each knowing its own position in it, so
+/// stepping to the next or previous one does not search. The array is put back
+/// in order when it is next read after an element was added out of order or
+/// had its sequence number changed.
+typedef struct graphviz_node_seq node_seq_t;
+
+/// construct a new sequence
+///
+/// Calls `exit` on failure (out-of-memory).
+///
+/// @return A constructed sequence
+node_seq_t *node_seq_new(void);
+
+/// add an item to the sequence
+///
+/// If the backing store is not large enough, it is expanded on demand. On
+/// allocation failure, `exit` is called.
+///
+/// @param self Sequence to add to
+/// @param item Element to add
+void node_seq_add(node_seq_t *self, Agsubnode_t *item);
+
+/// remove an item from the sequence
+///
+/// @param self Sequence to remove from
+/// @param item Element to remove, which must be in the sequence
+void node_seq_remove(node_seq_t *self, Agsubnode_t *item);
+
+/// note that the sequence number of an item's node has changed
+///
+/// @param self Sequence containing the item
+/// @param item Element whose node was renumbered
+void node_seq_renumbered(node_seq_t *self, const Agsubnode_t *item);
+
+/// get the first item of the sequence
+///
+/// @param self Sequence to query
+/// @return The item with the lowest sequence number or `NULL` if empty
+Agsubnode_t *node_seq_first(node_seq_t *self);
+
+/// get the last item of the sequence
+///
+/// @param self Sequence to query
+/// @return The item with the highest sequence number or `NULL` if empty
+Agsubnode_t *node_seq_last(node_seq_t *self);
+
+/// get the item following another
+///
+/// @param self Sequence to query
+/// @param item An element of the sequence
+/// @return The next item or `NULL` if `item` is the last
+Agsubnode_t *node_seq_next(node_seq_t *self, const Agsubnode_t *item);
+
+/// get the item preceding another
+///
+/// @param self Sequence to query
+/// @param item An element of the sequence
+/// @return The previous item or `NULL` if `item` is the first
+Agsubnode_t *node_seq_prev(node_seq_t *self, const Agsubnode_t *item);
+
+/// get the number of items in a sequence
+///
+/// @param self Sequence to query
+/// @return Number of elements in the sequence
+size_t node_seq_size(const node_seq_t *self);
+
+/// destruct a sequence
+///
+/// The items are not freed. `*self` is `NULL` on return.
+///
+/// @param self Sequence to destroy
+void node_seq_free(node_seq_t **self);
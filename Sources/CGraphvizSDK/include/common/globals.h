@@ -44,33 +44,38 @@ extern "C" {
 
 DEFINE_LIST_WITH_DTOR(show_boxes, char*, free)
 
-    GLOBALS_API EXTERN const char **Lib;		/* from command line */
+    GLOBALS_API EXTERN _Thread_local const char **Lib;	/* from command line, per thread like its count in use_library */
     GLOBALS_API EXTERN char *Gvfilepath;  /* Per-process path of files allowed in image attributes (also ps libs) */
-    GLOBALS_API EXTERN char *Gvimagepath; /* Per-graph path of files allowed in image attributes  (also ps libs) */
 
     GLOBALS_API EXTERN unsigned char Verbose;
     GLOBALS_API EXTERN bool Reduce;
     GLOBALS_API EXTERN char *HTTPServerEnVar;
     GLOBALS_API EXTERN int graphviz_errors;
-    GLOBALS_API EXTERN int Nop;
-    GLOBALS_API EXTERN double PSinputscale;
-    GLOBALS_API EXTERN show_boxes_t Show_boxes; // emit code for correct box coordinates
-    GLOBALS_API EXTERN int CL_type;		/* NONE, LOCAL, GLOBAL */
-    GLOBALS_API EXTERN bool Concentrate; /// if parallel edges should be merged
-    GLOBALS_API EXTERN double Epsilon;	/* defined in input_graph */
-    GLOBALS_API EXTERN int MaxIter;
-    GLOBALS_API EXTERN unsigned short Ndim;
-    GLOBALS_API EXTERN int State;		/* last finished phase */
-    GLOBALS_API EXTERN int EdgeLabelsDone;	/* true if edge labels have been positioned */
-    GLOBALS_API EXTERN double Initial_dist;
-    GLOBALS_API EXTERN double Damping;
     GLOBALS_API EXTERN bool Y_invert; ///< invert y in dot & plain output
     GLOBALS_API EXTERN int GvExitOnUsage;   /* gvParseArgs() should exit on usage or error */
 
-    GLOBALS_API EXTERN Agsym_t
+/* The following are (re)set from the graph being laid out. They are
+ * thread-local so that layouts of different graphs can run on different
+ * threads at the same time.
+ */
+    GLOBALS_API EXTERN _Thread_local char *Gvimagepath; /* Per-graph path of files allowed in image attributes  (also ps libs) */
+    GLOBALS_API EXTERN _Thread_local int Nop;
+    GLOBALS_API EXTERN _Thread_local double PSinputscale;
+    GLOBALS_API EXTERN _Thread_local show_boxes_t Show_boxes; // emit code for correct box coordinates
+    GLOBALS_API EXTERN _Thread_local int CL_type;		/* NONE, LOCAL, GLOBAL */
+    GLOBALS_API EXTERN _Thread_local bool Concentrate; /// if parallel edges should be merged
+    GLOBALS_API EXTERN _Thread_local double Epsilon;	/* defined in input_graph */
+    GLOBALS_API EXTERN _Thread_local int MaxIter;
+    GLOBALS_API EXTERN _Thread_local unsigned short Ndim;
+    GLOBALS_API EXTERN _Thread_local int State;		/* last finished phase */
+    GLOBALS_API EXTERN _Thread_local int EdgeLabelsDone;	/* true if edge labels have been positioned */
+    GLOBALS_API EXTERN _Thread_local double Initial_dist;
+    GLOBALS_API EXTERN _Thread_local double Damping;
+
+    GLOBALS_API EXTERN _Thread_local Agsym_t
 	*G_ordering, *G_peripheries, *G_penwidth,
 	*G_gradientangle, *G_margin;
-    GLOBALS_API EXTERN Agsym_t
+    GLOBALS_API EXTERN _Thread_local Agsym_t
 	*N_height, *N_width, *N_shape, *N_color, *N_fillcolor,
 	*N_fontsize, *N_fontname, *N_fontcolor,
 	*N_label, *N_xlabel, *N_nojustify, *N_style, *N_showboxes,
@@ -78,7 +83,7 @@ DEFINE_LIST_WITH_DTOR(show_boxes, char*, free)
 	*N_skew, *N_distortion, *N_fixed, *N_imagescale, *N_imagepos, *N_layer,
 	*N_group, *N_comment, *N_vertices, *N_z,
 	*N_penwidth, *N_gradientangle;
-    GLOBALS_API EXTERN Agsym_t
+    GLOBALS_API EXTERN _Thread_local Agsym_t
 	*E_weight, *E_minlen, *E_color, *E_fillcolor,
 	*E_fontsize, *E_fontname, *E_fontcolor,
 	*E_label, *E_xlabel, *E_dir, *E_style, *E_decorate,
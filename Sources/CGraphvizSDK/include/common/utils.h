@@ -84,6 +84,7 @@ UTILS_API char *late_nnstring(void *obj, Agsym_t *attr, char *defaultValue);
 UTILS_API char *late_string(void *obj, Agsym_t *attr, char *defaultValue);
 UTILS_API bool late_bool(void *obj, Agsym_t *attr, bool defaultValue);
 UTILS_API double get_inputscale(graph_t *g);
+UTILS_API int get_threads(graph_t *g);
 
 // routines for supporting “union-find”, a.k.a. “disjoint-set forest”
 // https://en.wikipedia.org/wiki/Disjoint-set_data_structure
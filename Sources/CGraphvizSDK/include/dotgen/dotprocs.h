@@ -16,6 +16,7 @@ extern "C" {
 
 #include <dotgen/aspect.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <util/list.h>
 
 DEFINE_LIST(ints, int)
@@ -70,6 +71,42 @@ DEFINE_LIST(node_queue, Agnode_t *)
     extern void virtual_weight(Agedge_t *);
     extern void zapinlist(elist *, Agedge_t *);
 
+    /// edges of a `fast_csr_t`, one array per attribute
+    typedef struct {
+	int *node;     ///< ID of the other end: head of an out-edge, tail of an in-edge
+	int *xpenalty; ///< `ED_xpenalty`
+	int *port;     ///< `order` of the port at the other end
+	double *tail_x; ///< `ED_tail_port(e).p.x`
+	double *head_x; ///< `ED_head_port(e).p.x`
+    } fast_csr_edges_t;
+
+    /// compact copy of the fast graph on the ranks of a root graph
+    ///
+    /// Nodes get dense IDs, stored in `ND_lim` while the copy is in use, and
+    /// their `ND_out` and `ND_in` lists become compressed rows of the edge
+    /// attributes mincross reads. The edges are fixed for the life of the copy;
+    /// orders are not, and whoever moves a node updates `order` too.
+    ///
+    /// Only mincross uses this copy. Network simplex and `dot_position` still
+    /// walk the elists, because they add and remove edges as they go.
+    typedef struct {
+	int n;           ///< number of nodes
+	node_t **node;   ///< node with each ID
+	int *order;      ///< `ND_order` of each node
+	bool *has_port;  ///< `ND_has_port` of each node
+	int *out;        ///< `n + 1` offsets of each node's out-edges
+	int *in;         ///< `n + 1` offsets of each node's in-edges
+	fast_csr_edges_t out_edges;
+	fast_csr_edges_t in_edges;
+    } fast_csr_t;
+
+    /// copy the fast graph on the ranks of `dot_root(g)`, replacing `fg`
+    extern void fast_csr_build(fast_csr_t *fg, Agraph_t *g);
+    extern void fast_csr_free(fast_csr_t *fg);
+    /// copy `ND_order` of the nodes in the ranks of `g` into `fg`
+    extern void fast_csr_sync_order(fast_csr_t *fg, Agraph_t *g);
+#define FAST_CSR_ID(v) ND_lim(v)
+
     extern Agraph_t* dot_root(void *);
     extern void dot_concentrate(Agraph_t *);
     extern void dot_mincross(Agraph_t *);
@@ -78,6 +115,30 @@ DEFINE_LIST(node_queue, Agnode_t *)
     extern void dot_sameports(Agraph_t *);
     extern void dot_splines(Agraph_t *);
 
+    /// result of a dot layout, kept to seed the layout of the edited graph
+    typedef struct dot_layout_memo_s dot_layout_memo_t;
+
+    /// start laying out `g` from `previous` if not NULL, and remember the
+    /// layout if `capture`
+    extern void dot_incremental_begin(Agraph_t *g, const dot_layout_memo_t *previous,
+                                      bool capture);
+    /// stop, and return the memo of the layouts since `dot_incremental_begin`,
+    /// or NULL if they were not captured
+    extern dot_layout_memo_t *dot_incremental_end(void);
+    extern void dot_layout_memo_free(dot_layout_memo_t *memo);
+    /// number of edges whose previous spline was reused
+    extern size_t dot_layout_memo_reused_splines(const dot_layout_memo_t *memo);
+
+    extern bool dot_incremental_active(Agraph_t *);
+    extern void dot_incremental_seed_ranks(Agraph_t *);
+    extern void dot_incremental_restore_ranks(Agraph_t *);
+    extern void dot_incremental_seed_order(Agraph_t *);
+    extern void dot_incremental_seed_coords(Agraph_t *);
+    extern void dot_incremental_restore_coords(Agraph_t *);
+    extern bool dot_incremental_reuse_splines(Agraph_t *, Agedge_t **, unsigned);
+    extern void dot_incremental_install_splines(Agraph_t *);
+    extern void dot_incremental_capture(Agraph_t *);
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,7 @@ extern "C" {
 #include <fdpgen/xlayout.h>
 
     extern void fdp_initParams(graph_t *);
+    extern double fdp_springK(void);
     extern void fdp_tLayout(graph_t *, xparams *);
 
 #ifdef __cplusplus
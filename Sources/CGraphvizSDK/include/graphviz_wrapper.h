@@ -16,6 +16,15 @@
 #include <common/geom.h>
 #include <common/types.h>
 #include <dotgen/dotprocs.h>
+#include <label/packed_rtree.h>
+#include <neatogen/kkutils.h>
+#include <neatogen/simd.h>
+#include <neatogen/stress.h>
+#include <sfdpgen/Multilevel.h>
+#include <sfdpgen/sparse_solve.h>
+#include <sparse/QuadTree.h>
+#include <sparse/flat_quadtree.h>
+#include <stdint.h>
 
 extern gvplugin_library_t gvplugin_dot_layout_LTX_library;
 extern gvplugin_library_t gvplugin_core_LTX_library;
@@ -56,4 +65,19 @@ pointf* gd_lp(Agraph_t* g);
 pointf* gd_lsize(Agraph_t* g);
 char* gd_label_text(Agraph_t* g);
 
+///HASHING
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} graph_hash_t;
+graph_hash_t graph_layout_hash(Agraph_t* g, const char* engine);
+
+///LAYOUT
+int dot_layout_incremental(GVC_t* gvc, Agraph_t* g, const dot_layout_memo_t* previous, dot_layout_memo_t** memo);
+void attach_layout_attrs(Agraph_t* g);
+
+///PARALLELISM
+int layout_threads(void);
+void set_layout_threads(int threads);
+
 #endif /* Header_h */
@@ -0,0 +1,60 @@
+/// @file
+/// @brief static R-tree over the boxes of a finished layout
+///
+/// Unlike the dynamic R-tree of index.h, which xlabels grows one insertion at a
+/// time, this tree is built once from all boxes and never changes. Boxes are
+/// packed bottom-up in Sort-Tile-Recursive order, so every tree node is full,
+/// siblings are spatially close, and the whole tree lives in two flat arrays.
+///
+/// Objects are identified by their position in the array the tree was built
+/// from. Queries return these positions in increasing order.
+
+#pragma once
+
+#include <common/geom.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct packed_rtree_s packed_rtree_t;
+
+/// build a tree over `n` boxes
+///
+/// Boxes with `LL` above `UR` in either dimension are stored but never match.
+///
+/// @param boxes Boxes to index, copied into the tree
+/// @param n Number of boxes
+/// @return A new tree, to be released with `packed_rtree_free`
+packed_rtree_t *packed_rtree_build(const boxf *boxes, size_t n);
+
+/// release a tree built by `packed_rtree_build`
+void packed_rtree_free(packed_rtree_t *tree);
+
+/// number of boxes in the tree
+size_t packed_rtree_size(const packed_rtree_t *tree);
+
+/// find the boxes that overlap `rect`, including ones that only touch it
+///
+/// @param tree Tree to search
+/// @param rect Query rectangle
+/// @param hits [out] Positions of the matching boxes, in increasing order, to
+///   be released with `free`. `NULL` when nothing matches.
+/// @return Number of matching boxes
+size_t packed_rtree_query_rect(const packed_rtree_t *tree, boxf rect,
+                               size_t **hits);
+
+/// find the boxes at most `tolerance` away from `p`
+///
+/// @param tree Tree to search
+/// @param p Query point
+/// @param tolerance Largest distance from `p` to a box that still matches
+/// @param hits [out] As for `packed_rtree_query_rect`
+/// @return Number of matching boxes
+size_t packed_rtree_query_point(const packed_rtree_t *tree, pointf p,
+                                double tolerance, size_t **hits);
+
+#ifdef __cplusplus
+}
+#endif
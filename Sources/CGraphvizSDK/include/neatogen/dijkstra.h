@@ -20,6 +20,7 @@ extern "C" {
     extern void dijkstra(int, vtx_data *, int, DistType *);
     extern void dijkstra_f(int, vtx_data *, int, float *);
     extern int dijkstra_sgd(graph_sgd *, int, term_sgd *);
+    extern void dijkstra_sgd_dist(graph_sgd *, int, float *);
 
 #ifdef __cplusplus
 }
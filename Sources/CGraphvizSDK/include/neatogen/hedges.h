@@ -27,7 +27,7 @@ extern "C" {
 	struct Halfedge *PQnext;
     } Halfedge;
 
-    extern Halfedge *ELleftend, *ELrightend;
+    extern _Thread_local Halfedge *ELleftend, *ELrightend;
 
     extern void ELinitialize(void);
     extern void ELcleanup(void);
@@ -31,7 +31,7 @@ typedef struct {
 } Info_t;
 
 /// array of node info
-extern Info_t *nodeInfo;
+extern _Thread_local Info_t *nodeInfo;
 
 /// insert vertex into sorted list
 void addVertex(Site *, double, double);
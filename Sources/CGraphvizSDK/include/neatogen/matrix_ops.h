@@ -11,6 +11,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,6 +74,10 @@ extern "C" {
     extern void sqrt_vecf(int n, float *source, float *target);
     extern void invert_sqrt_vec(int n, float *vec);
 
+    /* sorted float arrays: qsort comparator and upper bound search */
+    extern int cmp_float(const void *x, const void *y);
+    extern size_t count_le(const float *a, size_t len, float bound);
+
 #ifdef __cplusplus
 }
 #endif
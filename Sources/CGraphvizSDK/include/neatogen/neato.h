@@ -16,6 +16,7 @@
 #define MODEL_CIRCUIT        1
 #define MODEL_SUBSET         2
 #define MODEL_MDS            3
+#define MODEL_LANDMARK       4
 
 #define MODE_KK          0
 #define MODE_MAJOR       1
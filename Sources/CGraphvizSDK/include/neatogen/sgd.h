@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <util/bitarray.h>
 
@@ -21,7 +22,17 @@ typedef struct graph_sgd {
     float *weights; // weights of edges (length sources[n])
 } graph_sgd;
 
-extern void sgd(graph_t *, int);
+/// default number of pivots for `mode="sgd:sparse"`
+#define DFLT_SGD_PIVOTS 50
+
+/// options selected by the `mode="sgd:…"` suffixes
+typedef struct {
+    int n_pivots; ///< pivots of the sparse model, 0 for the exact model
+    bool hogwild; ///< lock-free multithreaded epochs instead of the serial ones
+    int threads;  ///< threads for the exact terms and hogwild epochs, see `get_threads`
+} sgd_options_t;
+
+extern void sgd(graph_t *, int, sgd_options_t);
 
 #ifdef __cplusplus
 }
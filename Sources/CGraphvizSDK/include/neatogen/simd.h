@@ -0,0 +1,57 @@
+/// @file
+/// @brief vectorized kernels behind the dense routines of matrix_ops.c
+///
+/// The kernels are compiled for SSE2 (every x86-64 CPU), AVX2 (picked at
+/// run time when the CPU has it) and NEON (every AArch64 CPU). Callers check
+/// `simd_enabled()` and otherwise fall back to their scalar loops, which stay
+/// the reference implementation. The NEON kernels start disabled.
+///
+/// Element-wise kernels give exactly the scalar results. Reductions add the
+/// same terms in a different order, so their last bits may differ.
+
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// whether kernels are compiled for this CPU, enabled or not
+///
+/// The `simd_*` kernels below may only be called when this is true.
+bool simd_available(void);
+
+/// whether the vectorized kernels are available and not disabled
+bool simd_enabled(void);
+
+/// turn the vectorized kernels on or off, e.g. to compare against the scalar
+/// loops
+///
+/// This is process-wide. It has no effect when no kernels are available. On
+/// AArch64 the kernels are off until this turns them on.
+void simd_set_enabled(bool enabled);
+
+/// name of the instruction set in use, or "scalar"
+const char *simd_isa(void);
+
+/// Σ a[i]·b[i], products in float, sum in double
+double simd_dotf(int n, const float *a, const float *b);
+
+/// Σ a[i]·b[i], in double
+double simd_dot_fd(int n, const float *a, const double *b);
+
+/// y[i] += alpha·x[i]
+void simd_axpyf(int n, float *y, float alpha, const float *x);
+
+/// y[i] += alpha·x[i], in double
+void simd_axpy_fd(int n, double *y, double alpha, const float *x);
+
+/// one off-diagonal row of a packed symmetric matrix-vector product:
+/// result[j] += row[j]·v_i for each j, and return Σ row[j]·v[j]
+float simd_packed_row(int n, const float *row, const float *v, float v_i,
+                      float *result);
+
+#ifdef __cplusplus
+}
+#endif
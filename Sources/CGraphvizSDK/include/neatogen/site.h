@@ -25,8 +25,8 @@ extern "C" {
 	unsigned refcnt;
     } Site;
 
-    extern int siteidx;
-    extern Site *bottomsite;
+    extern _Thread_local int siteidx;
+    extern _Thread_local Site *bottomsite;
 
     extern void siteinit(void);
     extern Site *getsite(void);
@@ -25,6 +25,9 @@ extern "C" {
     /* some possible values for 'num_pivots_stress' */
 #define num_pivots_stress 40
 
+    /* landmarks of the landmark stress model (model=landmark) */
+#define num_landmarks_stress 50
+
 #define opt_smart_init 0x4
 #define opt_exp_flag   0x3
 
@@ -30,6 +30,7 @@ enum { MAX_CLUSTER_SIZE = 4 };
 
 typedef struct {
   int maxlevel;
+  int threads; ///< threads for coarsening large levels, 0 for the default
 } Multilevel_control;
 
 void Multilevel_delete(Multilevel grid);
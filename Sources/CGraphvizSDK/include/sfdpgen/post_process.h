@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <sfdpgen/Multilevel.h>
 #include <sfdpgen/spring_electrical.h>
 #include <stdbool.h>
 
@@ -28,6 +29,9 @@ struct StressMajorizationSmoother_struct {
 		 typically the Laplacian only needs to be solved very crudely as it is part of an
 		 outer iteration.*/
   double maxit_cg;
+  int precon;/* preconditioner for the Laplacian solves, PRECON_* in sparse_solve.h */
+  Multilevel grid;/* hierarchy over the graph that PRECON_AMG coarsens along, or NULL. Not owned */
+  int threads;/* threads for the sparse kernels, as in gv_parallel_for_threads. 1 by default */
 };
 
 typedef struct StressMajorizationSmoother_struct *StressMajorizationSmoother;
@@ -68,7 +72,9 @@ void SpringSmoother_delete(SpringSmoother sm);
 void SpringSmoother_smooth(SpringSmoother sm, SparseMatrix A, int dim, double *x);
 /*------------------------------------------------------------------*/
 
-void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control ctrl, double *x);
+/* grid, if not NULL, is the sfdp hierarchy over A, for AMG preconditioning */
+void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control ctrl,
+                            Multilevel grid, double *x);
 
 /*-------------------- sparse stress majorizationp ------------------- */
 typedef  StressMajorizationSmoother SparseStressMajorizationSmoother;
@@ -10,7 +10,43 @@
 
 #pragma once
 
+#include <sfdpgen/Multilevel.h>
 #include <sparse/SparseMatrix.h>
 
+/* preconditioners for the conjugate gradient solver */
+enum {PRECON_JACOBI, PRECON_IC0, PRECON_AMG};
+
+struct SparseSolver_struct {
+  SparseMatrix A;
+  int precon;/* the preconditioner actually in use, PRECON_* */
+  void *data;/* its factors or level hierarchy */
+  int solves;/* right hand sides solved so far */
+  int iterations;/* CG iterations over all of them */
+  double setup_time;/* seconds spent building the preconditioner */
+  double solve_time;/* seconds spent in CG */
+  int threads;/* threads for its matrix products, as in SparseMatrix_multiply_vector */
+};
+
+typedef struct SparseSolver_struct *SparseSolver;
+
+/* Set up conjugate gradient for the symmetric positive definite A, to solve
+   with it repeatedly. PRECON_AMG uses the aggregates of grid, a hierarchy over
+   a graph on the same nodes as A, as its coarse levels; without a usable grid
+   it falls back to PRECON_IC0. A and grid must outlive the solver. Its matrix
+   products use threads threads. */
+SparseSolver SparseSolver_new(SparseMatrix A, int precon, Multilevel grid,
+                              int threads);
+
+void SparseSolver_delete(SparseSolver solver);
+
+/* As SparseMatrix_solve, with the preconditioner of solver. */
+double SparseSolver_solve(SparseSolver solver, int dim, double *x0, double *rhs,
+                          double tol, double maxit);
+
+/* Solve A x = rhs for each of the dim columns of rhs with Jacobi preconditioned
+   CG, starting from x0. The solution overwrites rhs. */
 double SparseMatrix_solve(SparseMatrix A, int dim, double *x0, double *rhs,
                           double tol, double maxit);
+
+/* name of a PRECON_* value */
+const char *precon_name(int precon);
@@ -61,8 +61,11 @@ void SparseMatrix_export(FILE *f, SparseMatrix A);/* export into MM format excep
 
 void SparseMatrix_delete(SparseMatrix A);
 
-SparseMatrix SparseMatrix_add(SparseMatrix A, SparseMatrix B);
-SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B);
+/* The kernels that take a thread count split large matrices over that many
+   threads, with 0 for gv_parallel_threads(), and keep small ones on the calling
+   thread. The result does not depend on the count. */
+SparseMatrix SparseMatrix_add(SparseMatrix A, SparseMatrix B, int threads);
+SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B, int threads);
 SparseMatrix SparseMatrix_multiply3(SparseMatrix A, SparseMatrix B, SparseMatrix C);
 
 enum {SUM_REPEATED_NONE = 0, SUM_REPEATED_ALL, };
@@ -70,16 +73,16 @@ SparseMatrix SparseMatrix_sum_repeat_entries(SparseMatrix A);
 SparseMatrix SparseMatrix_coordinate_form_add_entry(SparseMatrix A, int irn,
                                                     int jcn, const void *val);
 bool SparseMatrix_is_symmetric(SparseMatrix A, bool test_pattern_symmetry_only);
-SparseMatrix SparseMatrix_transpose(SparseMatrix A);
+SparseMatrix SparseMatrix_transpose(SparseMatrix A, int threads);
 SparseMatrix SparseMatrix_symmetrize(SparseMatrix A,
                                      bool pattern_symmetric_only);
-void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res);/* if v = NULL, v is assumed to be {1,1,...,1}*/
+void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res, int threads);/* if v = NULL, v is assumed to be {1,1,...,1}*/
 SparseMatrix SparseMatrix_remove_diagonal(SparseMatrix A);
 SparseMatrix SparseMatrix_remove_upper(SparseMatrix A);/* remove diag and upper diag */
 SparseMatrix SparseMatrix_divide_row_by_degree(SparseMatrix A);
 SparseMatrix SparseMatrix_get_real_adjacency_matrix_symmetrized(SparseMatrix A);  /* symmetric, all entries to 1, diaginal removed */
 void SparseMatrix_multiply_dense(SparseMatrix A, const double *v, double *res,
-                                 int dim);
+                                 int dim, int threads);
 SparseMatrix SparseMatrix_apply_fun(SparseMatrix A, double (*fun)(double x));/* for real only! */
 SparseMatrix SparseMatrix_copy(SparseMatrix A);
 bool SparseMatrix_has_diagonal(SparseMatrix A);
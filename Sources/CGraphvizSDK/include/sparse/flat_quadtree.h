@@ -0,0 +1,59 @@
+/// @file
+/// @brief pointer-free Barnes-Hut quadtree/octree for sfdp
+///
+/// A drop-in replacement for the `QuadTree` built by
+/// `QuadTree_new_from_point_list`, for callers that rebuild the tree on every
+/// iteration. Cells are stored breadth-first as parallel arrays, points are
+/// permuted into cell order (Morton order), and all of it lives in buffers that
+/// the next build reuses, so a rebuild does no allocation once the buffers have
+/// grown to fit.
+///
+/// The tree has the same cells, cell averages and visiting order as the
+/// pointer-based one, so force queries give identical results.
+///
+/// Trees over many points are built, and their repulsive forces computed, on
+/// several threads. The results do not depend on the number of threads.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct flat_quadtree_s flat_quadtree_t;
+
+/// create an empty tree for points of dimension `dim`
+flat_quadtree_t *flat_quadtree_new(int dim);
+
+void flat_quadtree_free(flat_quadtree_t *qt);
+
+/// set the number of threads builds and force passes may use
+///
+/// @param qt Tree to configure
+/// @param threads Thread count, or 0 for `gv_parallel_threads()`
+void flat_quadtree_set_threads(flat_quadtree_t *qt, int threads);
+
+/// rebuild the tree over `n` points, reusing its buffers
+///
+/// @param qt Tree to rebuild
+/// @param n Number of points, each with weight 1
+/// @param max_level Depth below which cells are not split further
+/// @param coord Point `i` is at `coord[i × dim]`; copied into the tree
+void flat_quadtree_build(flat_quadtree_t *qt, int n, int max_level,
+                         const double *coord);
+
+/// as `QuadTree_get_repulsive_force`
+void flat_quadtree_get_repulsive_force(flat_quadtree_t *qt, double *force,
+                                       double *x, double bh, double p,
+                                       double KP, double *counts);
+
+/// as `QuadTree_get_supernodes`
+void flat_quadtree_get_supernodes(const flat_quadtree_t *qt, double bh,
+                                  double *pt, int nodeid, int *nsuper,
+                                  int *nsupermax, double **center,
+                                  double **supernode_wgts, double **distances,
+                                  double *counts);
+
+#ifdef __cplusplus
+}
+#endif
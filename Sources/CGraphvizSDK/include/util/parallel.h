@@ -0,0 +1,77 @@
+/// @file
+/// @brief fork/join parallel loops over index ranges
+///
+/// Layout kernels whose iterations are independent (one shortest path search
+/// per source, one force evaluation per node, …) hand the index range to
+/// `gv_parallel_for`. The range is cut into chunks that the calling thread and
+/// a handful of short-lived worker threads claim until none are left.
+///
+/// Loop bodies run on threads other than the caller, so they must not touch
+/// the thread-local layout state (`Ndim`, `Epsilon`, attribute symbols, …);
+/// copy whatever they need into the context first.
+
+#pragma once
+
+#include <stddef.h>
+
+/// hide the symbols this header declares by default
+///
+/// See util/random.h for why this is appropriate while the containing library
+/// is built statically.
+#ifndef UTIL_API
+#if !defined(__CYGWIN__) && defined(__GNUC__) && !defined(__MINGW32__)
+#define UTIL_API __attribute__((visibility("hidden")))
+#else
+#define UTIL_API /* nothing */
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// body of a parallel loop
+///
+/// @param ctx Caller-supplied context passed through from `gv_parallel_for`
+/// @param begin First index of the chunk
+/// @param end One past the last index of the chunk
+typedef void (*gv_parallel_body_t)(void *ctx, size_t begin, size_t end);
+
+/// number of threads parallel loops use, including the caller
+UTIL_API int gv_parallel_threads(void);
+
+/// override the number of threads parallel loops use
+///
+/// @param threads Thread count, or 0 to restore the default of one thread per
+///   online processor
+UTIL_API void gv_parallel_set_threads(int threads);
+
+/// run `body` over `[0, n)` in chunks of at most `grain` indices
+///
+/// Returns once every chunk has run. Loops with a single chunk, or when only
+/// one thread is configured, run entirely on the calling thread. Chunks may run
+/// in any order and concurrently, so `body` must only write state owned by its
+/// own indices.
+///
+/// @param n Number of indices
+/// @param grain Maximum chunk size, at least 1
+/// @param body Function to call for each chunk
+/// @param ctx Context forwarded to `body`
+UTIL_API void gv_parallel_for(size_t n, size_t grain, gv_parallel_body_t body,
+                              void *ctx);
+
+/// `gv_parallel_for` with a thread count chosen by the caller
+///
+/// For layouts that take their thread count from a graph attribute, without
+/// changing the setting other layouts see.
+///
+/// Chunks are claimed in increasing order, so a chunk may wait for an earlier
+/// one to finish without risking deadlock.
+///
+/// @param threads Thread count, or 0 for `gv_parallel_threads()`
+UTIL_API void gv_parallel_for_threads(int threads, size_t n, size_t grain,
+                                      gv_parallel_body_t body, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,259 @@
+/// @file
+/// @ingroup cgraph_core
+/// @brief storage shared by the objects of a root graph
+///
+/// Objects created in bulk take their storage from chunks owned by the root
+/// graph instead of one allocation each. Such storage is not given back when
+/// an object is deleted, only when the root graph is closed.
+///
+/// @ref AgArenaDisc carves every allocation of a graph out of chunks the same
+/// way, keeping freed blocks on lists by size for reuse.
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include <cgraph/cghdr.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+
+/// smallest chunk worth asking the system for
+#define ARENA_CHUNK ((size_t)64 * 1024)
+
+/// every allocation is aligned to this
+#define ARENA_ALIGN ((size_t)16)
+
+typedef struct {
+  char *base;  ///< start of the chunk
+  size_t size; ///< bytes in the chunk
+  size_t used; ///< bytes handed out from the start of the chunk
+} chunk_t;
+
+struct agarena_s {
+  chunk_t *chunks; ///< sorted by base address
+  size_t n_chunks;
+  size_t capacity;
+  size_t last; ///< chunk small allocations are taken from
+};
+
+static agarena_t *arenaof(Agraph_t *g) {
+  Agclos_t *clos = agroot(g)->clos;
+  if (clos->arena == NULL)
+    clos->arena = gv_alloc(sizeof(agarena_t));
+  return clos->arena;
+}
+
+/// add a chunk of at least `size` bytes, keeping the list sorted by address
+static size_t add_chunk(agarena_t *a, size_t size) {
+  if (size < ARENA_CHUNK)
+    size = ARENA_CHUNK;
+  if (a->n_chunks == a->capacity) {
+    const size_t capacity = a->capacity ? 2 * a->capacity : 8;
+    a->chunks = gv_recalloc(a->chunks, a->capacity, capacity, sizeof(chunk_t));
+    a->capacity = capacity;
+  }
+  const chunk_t c = {.base = gv_alloc(size), .size = size};
+  size_t i = a->n_chunks;
+  while (i > 0 && (uintptr_t)a->chunks[i - 1].base > (uintptr_t)c.base) {
+    a->chunks[i] = a->chunks[i - 1];
+    --i;
+  }
+  a->chunks[i] = c;
+  ++a->n_chunks;
+  if (i <= a->last && a->last + 1 < a->n_chunks)
+    ++a->last;
+  return i;
+}
+
+/// zeroed storage of `size` bytes, a multiple of `ARENA_ALIGN`
+static void *take(agarena_t *a, size_t size) {
+  size_t i = a->last;
+  if (i >= a->n_chunks || a->chunks[i].size - a->chunks[i].used < size) {
+    i = add_chunk(a, size);
+    /* a request that fills a chunk of its own leaves the current one in use */
+    if (size < ARENA_CHUNK / 2)
+      a->last = i;
+  }
+
+  chunk_t *c = &a->chunks[i];
+  void *p = c->base + c->used;
+  c->used += size;
+  return p;
+}
+
+static void release(agarena_t *a) {
+  for (size_t i = 0; i < a->n_chunks; ++i)
+    free(a->chunks[i].base);
+  free(a->chunks);
+}
+
+static size_t roundup(size_t size) {
+  size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  return size == 0 ? ARENA_ALIGN : size;
+}
+
+/* chunks come zeroed and are never reused, so neither is what take returns */
+void *agarena_alloc(Agraph_t *g, size_t size) {
+  return take(arenaof(g), roundup(size));
+}
+
+bool agarena_owns(Agraph_t *g, const void *p) {
+  const agarena_t *a = agroot(g)->clos->arena;
+  if (a == NULL)
+    return false;
+  const uintptr_t q = (uintptr_t)p;
+  size_t lo = 0, hi = a->n_chunks;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if ((uintptr_t)a->chunks[mid].base <= q)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo > 0 && q - (uintptr_t)a->chunks[lo - 1].base < a->chunks[lo - 1].size;
+}
+
+void agarena_close(Agraph_t *g) {
+  Agclos_t *clos = agroot(g)->clos;
+  agarena_t *a = clos->arena;
+  if (a == NULL)
+    return;
+  release(a);
+  free(a);
+  clos->arena = NULL;
+}
+
+/* AgArenaDisc
+ *
+ * Each block is preceded by a header holding its size class. Classes step by
+ * ARENA_ALIGN up to SMALL_MAX and double after that.
+ */
+
+/// largest block of the evenly spaced classes
+#define SMALL_MAX ((size_t)1024)
+
+enum {
+  N_SMALL = SMALL_MAX / ARENA_ALIGN,
+  N_CLASSES = N_SMALL + sizeof(size_t) * 8,
+};
+
+typedef union {
+  size_t cls;
+  char align[ARENA_ALIGN];
+} header_t;
+
+/// a free block, linked through its payload
+typedef struct freeblock_s {
+  struct freeblock_s *next;
+} freeblock_t;
+
+typedef struct {
+  agarena_t chunks;
+  freeblock_t *free[N_CLASSES]; ///< free blocks by size class
+  size_t bytes;
+  size_t peak_bytes;
+} pool_t;
+
+static size_t size_class(size_t size) {
+  size = roundup(size);
+  if (size <= SMALL_MAX)
+    return size / ARENA_ALIGN - 1;
+  size_t cls = N_SMALL;
+  for (size_t s = 2 * SMALL_MAX; s < size; s *= 2)
+    ++cls;
+  return cls;
+}
+
+static size_t class_size(size_t cls) {
+  if (cls < N_SMALL)
+    return (cls + 1) * ARENA_ALIGN;
+  return 2 * SMALL_MAX << (cls - N_SMALL);
+}
+
+static void *poolopen(Agdisc_t *disc) {
+  (void)disc;
+  return gv_alloc(sizeof(pool_t));
+}
+
+static void *poolalloc(void *state, size_t req) {
+  pool_t *pool = state;
+  const size_t cls = size_class(req);
+  const size_t size = class_size(cls);
+
+  header_t *h;
+  freeblock_t *f = pool->free[cls];
+  if (f != NULL) {
+    pool->free[cls] = f->next;
+    h = (header_t *)f - 1;
+    memset(h + 1, 0, size);
+  } else {
+    h = take(&pool->chunks, sizeof(header_t) + size);
+    h->cls = cls;
+  }
+  pool->bytes += size;
+  if (pool->bytes > pool->peak_bytes)
+    pool->peak_bytes = pool->bytes;
+  return h + 1;
+}
+
+static void poolfree(void *state, void *ptr) {
+  pool_t *pool = state;
+  if (ptr == NULL)
+    return;
+  const size_t cls = ((header_t *)ptr - 1)->cls;
+  freeblock_t *f = ptr;
+  f->next = pool->free[cls];
+  pool->free[cls] = f;
+  pool->bytes -= class_size(cls);
+}
+
+static void *poolresize(void *state, void *ptr, size_t old, size_t req) {
+  if (ptr == NULL)
+    return poolalloc(state, req);
+  const size_t have = class_size(((header_t *)ptr - 1)->cls);
+  if (req <= have) {
+    if (req > old)
+      memset((char *)ptr + old, 0, req - old);
+    return ptr;
+  }
+  /* blocks are not merged, so a block grown a little at a time would leave
+   * one of every class behind it */
+  void *p = poolalloc(state, req > have && req < 2 * have ? 2 * have : req);
+  memcpy(p, ptr, old < req ? old : req);
+  poolfree(state, ptr);
+  return p;
+}
+
+static void poolclose(void *state) {
+  pool_t *pool = state;
+  release(&pool->chunks);
+  free(pool);
+}
+
+static void poolstats(void *state, Agmemstats_t *stats) {
+  const pool_t *pool = state;
+  stats->bytes = pool->bytes;
+  stats->peak_bytes = pool->peak_bytes;
+  stats->chunks = pool->chunks.n_chunks;
+  stats->chunk_bytes = 0;
+  for (size_t i = 0; i < pool->chunks.n_chunks; ++i)
+    stats->chunk_bytes += pool->chunks.chunks[i].size;
+}
+
+Agmemdisc_t AgArenaDisc = {
+    .open = poolopen,
+    .alloc = poolalloc,
+    .resize = poolresize,
+    .free = poolfree,
+    .close = poolclose,
+    .stats = poolstats,
+};
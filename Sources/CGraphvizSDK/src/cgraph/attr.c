@@ -197,7 +197,7 @@ static Agrec_t *agmakeattrs(Agraph_t * context, void *obj)
 	sz = topdictsize(obj);
 	if (sz < MINATTR)
 	    sz = MINATTR;
-	rec->str = gv_calloc((size_t)sz, sizeof(char *));
+	rec->str = agalloc(agraphof(obj), (size_t)sz * sizeof(char *));
 	/* doesn't call agxset() so no obj-modified callbacks occur */
 	for (sym = dtfirst(datadict); sym; sym = dtnext(datadict, sym)) {
 	    if (aghtmlstr(sym->defval)) {
@@ -221,7 +221,7 @@ static void freeattr(Agobj_t * obj, Agattr_t * attr)
     sz = topdictsize(obj);
     for (i = 0; i < sz; i++)
 	agstrfree(g, attr->str[i], aghtmlstr(attr->str[i]));
-    free(attr->str);
+    agfree(g, attr->str);
 }
 
 static void freesym(void *obj) {
@@ -244,8 +244,9 @@ static void addattr(Agraph_t * g, Agobj_t * obj, Agsym_t * sym)
     Agattr_t *attr = agattrrec(obj);
     assert(attr != NULL);
     if (sym->id >= MINATTR)
-	attr->str = gv_recalloc(attr->str, (size_t)sym->id, (size_t)sym->id + 1,
-	                        sizeof(char *));
+	attr->str = agrealloc(agraphof(obj), attr->str,
+	                      (size_t)sym->id * sizeof(char *),
+	                      ((size_t)sym->id + 1) * sizeof(char *));
     if (aghtmlstr(sym->defval)) {
 	attr->str[sym->id] = agstrdup_html(g, sym->defval);
     } else {
@@ -532,6 +533,23 @@ int agsafeset(void *obj, char *name, const char *value, const char *def) {
     return agxset(obj, a, value);
 }
 
+int agsafeset_bulk(Agraph_t *g, int kind, char *name, const char *def,
+                   size_t n, void **objs, char **values) {
+    Agsym_t *a;
+
+    if (kind != AGRAPH)
+	g = agroot(g);
+    a = agattr(g, kind, name, 0);
+    if (!a)
+	a = agattr(g, kind, name, def);
+    if (!a)
+	return FAILURE;
+    for (size_t i = 0; i < n; i++)
+	if (objs[i] && values[i])
+	    agxset(objs[i], a, values[i]);
+    return SUCCESS;
+}
+
 static void agraphattr_init_wrapper(Agraph_t *g, Agobj_t *ignored1,
                                     void *ignored2) {
   (void)ignored1;
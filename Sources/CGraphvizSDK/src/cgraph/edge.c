@@ -15,10 +15,13 @@
 
 #include <assert.h>
 #include <cgraph/cghdr.h>
+#include <cgraph/edge_set.h>
 #include <cgraph/node_set.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <util/alloc.h>
+#include <util/unreachable.h>
 
 /* return first outedge of <n> */
 Agedge_t *agfstout(Agraph_t * g, Agnode_t * n)
@@ -111,25 +114,19 @@ Agedge_t *agnxtedge(Agraph_t * g, Agedge_t * e, Agnode_t * n)
     return rv;
 }
 
-/* internal edge set lookup */
+/* internal edge set lookup.  key.objtype == 0 means the ID is a wildcard. */
 static Agedge_t *agfindedge_by_key(Agraph_t * g, Agnode_t * t, Agnode_t * h,
 			    Agtag_t key)
 {
-    Agedge_t *e, template;
-    Agsubnode_t *sn;
+    Agedge_t *e;
 
     if (t == NULL || h == NULL)
 	return NULL;
-    template.base.tag = key;
-    template.node = t;		/* guess that fan-in < fan-out */
-    sn = agsubrep(g, h);
-    if (!sn) e = 0;
-    else {
-	    dtrestore(g->e_id, sn->in_id);
-	    e = dtsearch(g->e_id, &template);
-	    sn->in_id = dtextract(g->e_id);
-    }
-    return e;
+    if (key.objtype == 0)
+	e = edge_set_find_any(g->e_id, t, h);
+    else
+	e = edge_set_find(g->e_id, t, h, key.id);
+    return e ? AGMKIN(e) : NULL;
 }
 
 static Agedge_t *agfindedge_by_id(Agraph_t * g, Agnode_t * t, Agnode_t * h,
@@ -174,14 +171,12 @@ static void installedge(Agraph_t * g, Agedge_t * e)
     in = AGMKIN(e);
     t = agtail(e);
     h = aghead(e);
-    while (g) {
-	if (agfindedge_by_key(g, t, h, AGTAG(e))) break;
+    /* a graph that has the edge already has it in all its ancestors */
+    while (g && edge_set_add(g->e_id, out)) {
 	sn = agsubrep(g, t);
 	ins(g->e_seq, &sn->out_seq, out);
-	ins(g->e_id, &sn->out_id, out);
 	sn = agsubrep(g, h);
 	ins(g->e_seq, &sn->in_seq, in);
-	ins(g->e_id, &sn->in_id, in);
 	g = agparent(g);
     }
 }
@@ -192,14 +187,12 @@ static void subedge(Agraph_t * g, Agedge_t * e)
     /* might an init method call be needed here? */
 }
 
-static Agedge_t *newedge(Agraph_t * g, Agnode_t * t, Agnode_t * h,
-             IDTYPE id)
+/* fill in zeroed storage <e2> as an edge from <t> to <h> */
+static Agedge_t *initedge(Agraph_t * g, Agnode_t * t, Agnode_t * h,
+             IDTYPE id, Agedgepair_t * e2)
 {
     Agedge_t *in, *out;
 
-    (void)agsubnode(g, t, 1);
-    (void)agsubnode(g, h, 1);
-    Agedgepair_t *e2 = gv_alloc(sizeof(Agedgepair_t));
     in = &e2->in;
     out = &e2->out;
     uint64_t seq = agnextseq(g, AGEDGE);
@@ -210,13 +203,28 @@ static Agedge_t *newedge(Agraph_t * g, Agnode_t * t, Agnode_t * h,
     AGSEQ(in) = AGSEQ(out) = seq & SEQ_MASK;
     in->node = t;
     out->node = h;
+    return out;
+}
 
-    installedge(g, out);
+static void initedgeattrs(Agraph_t * g, Agedge_t * out)
+{
     if (g->desc.has_attrs) {
 	(void)agbindrec(out, AgDataRecName, sizeof(Agattr_t), false);
 	agedgeattr_init(g, out);
     }
     agmethod_init(g, out);
+}
+
+static Agedge_t *newedge(Agraph_t * g, Agnode_t * t, Agnode_t * h,
+             IDTYPE id)
+{
+    Agedge_t *out;
+
+    (void)agsubnode(g, t, 1);
+    (void)agsubnode(g, h, 1);
+    out = initedge(g, t, h, id, agalloc(g, sizeof(Agedgepair_t)));
+    installedge(g, out);
+    initedgeattrs(g, out);
     return out;
 }
 
@@ -297,6 +305,133 @@ Agedge_t *agedge(Agraph_t * g, Agnode_t * t, Agnode_t * h, char *name,
     return e;
 }
 
+static int agedgeseqcmpf(void *arg_e0, void *arg_e1);
+
+static int bulkseqcmpf(const void *e0, const void *e1) {
+    return agedgeseqcmpf(*(Agedge_t *const *)e0, *(Agedge_t *const *)e1);
+}
+
+/* balanced tree over <es>, sorted, linked through the field at <link> */
+static Dtlink_t *bulktree(Agedge_t **es, size_t n, size_t link)
+{
+    if (n == 0)
+	return NULL;
+    Dtlink_t *root = (Dtlink_t *)((char *)es[n / 2] + link);
+    root->hl._left = bulktree(es, n / 2, link);
+    root->right = bulktree(es + n / 2 + 1, n - n / 2 - 1, link);
+    return root;
+}
+
+/* enter <es>, edges new to a node's <set> of dictionary <d>. An empty set is
+ * built sorted in one go rather than one insertion at a time. */
+static void bulkins(Dict_t * d, Dtlink_t ** set, Agedge_t ** es, size_t n,
+		    int (*cmpf)(const void *, const void *))
+{
+    if (*set) {
+	for (size_t i = 0; i < n; i++)
+	    ins(d, set, es[i]);
+	return;
+    }
+    qsort(es, n, sizeof(es[0]), cmpf);
+    *set = bulktree(es, n, (size_t)d->disc->link);
+}
+
+/* enter the edges <es> in the sets of the nodes they leave (<out>) or enter,
+ * a node at a time; <key> gives each edge's index in <nodes> */
+static void bulkinstall(Agraph_t * g, size_t n_nodes, Agnode_t ** nodes,
+			Agedge_t ** es, size_t n, const size_t *key, bool out)
+{
+    size_t *start = gv_calloc(n_nodes + 1, sizeof(size_t));
+    Agedge_t **byNode = gv_calloc(n, sizeof(Agedge_t *));
+
+    for (size_t i = 0; i < n; i++)
+	start[key[i] + 1]++;
+    for (size_t v = 0; v < n_nodes; v++)
+	start[v + 1] += start[v];
+    for (size_t i = 0; i < n; i++)
+	byNode[start[key[i]]++] = out ? es[i] : AGOPP(es[i]);
+    for (size_t v = n_nodes; v > 0; v--)
+	start[v] = start[v - 1];
+    start[0] = 0;
+
+    for (size_t v = 0; v < n_nodes; v++) {
+	Agedge_t **group = byNode + start[v];
+	const size_t size = start[v + 1] - start[v];
+	if (size == 0)
+	    continue;
+	Agsubnode_t *sn = agsubrep(g, nodes[v]);
+	bulkins(g->e_seq, out ? &sn->out_seq : &sn->in_seq, group, size,
+		bulkseqcmpf);
+    }
+
+    free(byNode);
+    free(start);
+}
+
+size_t agedges_bulk(Agraph_t * g, size_t n_nodes, Agnode_t ** nodes,
+		    size_t n, const size_t *tails, const size_t *heads,
+		    Agedge_t ** edges)
+{
+    size_t created = 0;
+
+    /* strict graphs must see each edge before making the next, subgraphs
+     * keep their sets in holders, and callbacks expect an edge to be
+     * installed when they see it: these go an edge at a time */
+    if (g != agroot(g) || agisstrict(g) || g->clos->cb) {
+	for (size_t i = 0; i < n; i++) {
+	    Agedge_t *e = NULL;
+	    if (tails[i] < n_nodes && heads[i] < n_nodes)
+		e = agedge(g, nodes[tails[i]], nodes[heads[i]], NULL, 1);
+	    if (e)
+		created++;
+	    if (edges)
+		edges[i] = e;
+	}
+	return created;
+    }
+    if (n == 0)
+	return 0;
+
+    Agedgepair_t *block = agarena_alloc(g, n * sizeof(Agedgepair_t));
+    Agedge_t **made = gv_calloc(n, sizeof(Agedge_t *));
+    size_t *madeTails = gv_calloc(n, sizeof(size_t));
+    size_t *madeHeads = gv_calloc(n, sizeof(size_t));
+
+    for (size_t i = 0; i < n; i++) {
+	Agedge_t *e = NULL;
+	IDTYPE id;
+	if (tails[i] < n_nodes && heads[i] < n_nodes) {
+	    Agnode_t *t = nodes[tails[i]];
+	    Agnode_t *h = nodes[heads[i]];
+	    if (t && h && t->root == g && h->root == g
+		&& ok_to_make_edge(g, t, h)
+		&& agmapnametoid(g, AGEDGE, NULL, &id, true)) {
+		e = initedge(g, t, h, id, &block[created]);
+		made[created] = e;
+		madeTails[created] = tails[i];
+		madeHeads[created] = heads[i];
+		created++;
+	    }
+	}
+	if (edges)
+	    edges[i] = e;
+    }
+
+    bulkinstall(g, n_nodes, nodes, made, created, madeTails, true);
+    bulkinstall(g, n_nodes, nodes, made, created, madeHeads, false);
+    for (size_t i = 0; i < created; i++)
+	edge_set_add(g->e_id, made[i]);
+    for (size_t i = 0; i < created; i++) {
+	initedgeattrs(g, made[i]);
+	agregister(g, AGEDGE, made[i]);
+    }
+
+    free(madeHeads);
+    free(madeTails);
+    free(made);
+    return created;
+}
+
 void agdeledgeimage(Agraph_t * g, Agedge_t * e, void *ignored)
 {
     Agedge_t *in, *out;
@@ -314,11 +449,19 @@ void agdeledgeimage(Agraph_t * g, Agedge_t * e, void *ignored)
     t = in->node;
     h = out->node;
     sn = agsubrep(g, t);
+    /* the edge standing for all from <t> to <h> hands over to the next */
+    Agedge_t *next = NULL;
+    if (edge_set_find_any(g->e_id, t, h) == out) {
+	dtrestore(g->e_seq, sn->out_seq);
+	next = dtnext(g->e_seq, out);
+	sn->out_seq = dtextract(g->e_seq);
+	if (next && next->node != h)
+	    next = NULL;
+    }
+    edge_set_remove(g->e_id, out, next);
     del(g->e_seq, &sn->out_seq, out);
-    del(g->e_id, &sn->out_id, out);
     sn = agsubrep(g, h);
     del(g->e_seq, &sn->in_seq, in);
-    del(g->e_id, &sn->in_id, in);
 #ifdef DEBUG
     for (e = agfstin(g,h); e; e = agnxtin(g,e))
 	assert(e != in);
@@ -341,8 +484,8 @@ int agdeledge(Agraph_t * g, Agedge_t * e)
 	agfreeid(g, AGEDGE, AGID(e));
     }
     if (agapply(g, (Agobj_t *)e, (agobjfn_t)agdeledgeimage, NULL, false) == SUCCESS) {
-	if (g == agroot(g))
-		free(e);
+	if (g == agroot(g) && !agarena_owns(g, e))
+		agfree(g, e);
 	return SUCCESS;
     } else
 	return FAILURE;
@@ -370,21 +513,6 @@ Agedge_t *agsubedge(Agraph_t * g, Agedge_t * e, int cflag)
     return rv;
 }
 
-/* edge comparison.  AGTYPE(e) == 0 means ID is a wildcard. */
-static int agedgeidcmpf(void *arg_e0, void *arg_e1) {
-    Agedge_t *e0 = arg_e0;
-    Agedge_t *e1 = arg_e1;
-
-    if (AGID(e0->node) < AGID(e1->node)) return -1;
-    if (AGID(e0->node) > AGID(e1->node)) return 1;
-    /* same node */
-    if (AGTYPE(e0) != 0 && AGTYPE(e1) != 0) {
-        if (AGID(e0) < AGID(e1)) return -1;
-        if (AGID(e0) > AGID(e1)) return 1;
-    }
-    return 0;
-}
-
 /* edge comparison.  for ordered traversal. */
 static int agedgeseqcmpf(void *arg_e0, void *arg_e1) {
     Agedge_t *e0 = arg_e0;
@@ -413,16 +541,286 @@ Dtdisc_t Ag_subedge_seq_disc = {
     .comparf = agedgeseqcmpf,
 };
 
-/* indexing for random search */
-Dtdisc_t Ag_mainedge_id_disc = {
-    .link = offsetof(Agedge_t, id_link), // use internal links
-    .comparf = agedgeidcmpf,
+/// a table slot, keeping the hash of its edge so rehashing and probing past
+/// other edges need not touch them
+typedef struct {
+  Agedge_t *edge;
+  size_t hash;
+} edge_slot_t;
+
+/// one of the two tables of an edge set
+typedef struct {
+  edge_slot_t *slots;  ///< backing store for elements
+  size_t size;         ///< number of elements in the table
+  size_t deleted;      ///< number of slots holding a tombstone
+  size_t capacity_exp; ///< log₂ size of `slots`
+} edge_table_t;
+
+/// Most pairs of nodes have at most one edge between them, so the earliest edge
+/// of each pair is kept apart from the rest. Finding an edge by ID then takes a
+/// single probe unless there are parallel edges, and in a graph without any,
+/// `others` stays empty.
+struct graphviz_edge_set {
+  edge_table_t first;  ///< earliest edge of each tail and head, keyed by them
+  edge_table_t others; ///< the rest, keyed by tail, head and ID
 };
 
-Dtdisc_t Ag_subedge_id_disc = {
-    .link = -1, // use external holder objects
-    .comparf = agedgeidcmpf,
-};
+/// a sentinel, marking a table slot from which an element has been deleted
+static Agedge_t *const TOMBSTONE = (Agedge_t *)-1;
+
+edge_set_t *edge_set_new(void) { return gv_alloc(sizeof(edge_set_t)); }
+
+/// compute a hash of an edge
+///
+/// Nodes are hashed by address rather than by ID, as IDs change when a node is
+/// relabeled. The final steps are the 64-bit finalizer of MurmurHash3, which
+/// spreads the few significant bits of an address over the whole digest.
+///
+/// @param tail Tail of the edge
+/// @param head Head of the edge
+/// @param id Identifier of the edge, 0 when hashing for `first`
+/// @return Hash digest of the target edge
+static size_t edge_set_hash(const Agnode_t *tail, const Agnode_t *head,
+                            IDTYPE id) {
+  uint64_t h = (uint64_t)(uintptr_t)tail * UINT64_C(0x9e3779b97f4a7c15);
+  h ^= (uint64_t)(uintptr_t)head * UINT64_C(0xc2b2ae3d27d4eb4f);
+  h ^= (uint64_t)id;
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+static size_t edge_table_get_capacity(const edge_table_t *self) {
+  return self->slots == NULL ? 0 : 1ul << self->capacity_exp;
+}
+
+/// find the slot holding an edge
+///
+/// @param self Table to search
+/// @param tail Tail of the edge to look for
+/// @param head Head of the edge to look for
+/// @param id Identifier of the edge to look for, ignored for `first`
+/// @param by_id Whether `self` is keyed by ID as well as by ends
+/// @param vacant [out] If non-null and the edge is not in the table, the slot
+///   it would be added in, or `SIZE_MAX` if the table is full
+/// @return Index of the slot, or `SIZE_MAX` if the edge is not in the table
+static size_t edge_table_find(const edge_table_t *self, const Agnode_t *tail,
+                              const Agnode_t *head, IDTYPE id, bool by_id,
+                              size_t *vacant) {
+  if (vacant != NULL) {
+    *vacant = SIZE_MAX;
+  }
+
+  const size_t capacity = edge_table_get_capacity(self);
+  if (capacity == 0) {
+    return SIZE_MAX;
+  }
+
+  const size_t hash = edge_set_hash(tail, head, by_id ? id : 0);
+
+  for (size_t i = 0; i < capacity; ++i) {
+    const size_t candidate = (hash + i) & (capacity - 1);
+    Agedge_t *const e = self->slots[candidate].edge;
+
+    // if we found an empty slot, the sought item does not exist
+    if (e == NULL) {
+      if (vacant != NULL && *vacant == SIZE_MAX) {
+        *vacant = candidate;
+      }
+      return SIZE_MAX;
+    }
+
+    // if we found a previously deleted slot, skip over it
+    if (e == TOMBSTONE) {
+      if (vacant != NULL && *vacant == SIZE_MAX) {
+        *vacant = candidate;
+      }
+      continue;
+    }
+
+    if (self->slots[candidate].hash == hash && e->node == head &&
+        AGOUT2IN(e)->node == tail && (!by_id || AGID(e) == id)) {
+      return candidate;
+    }
+  }
+
+  return SIZE_MAX;
+}
+
+/// make room for one more element, rebuilding the backing store if needed
+static void edge_table_reserve(edge_table_t *self) {
+  // a watermark ratio at which the table should be rebuilt
+  static const size_t OCCUPANCY_THRESHOLD_PERCENT = 70;
+
+  // Do we need to rebuild the backing store? Tombstones lengthen probes as much
+  // as elements do, so they count towards the watermark. A table that is
+  // mostly tombstones is rebuilt at the same size.
+  const size_t capacity = edge_table_get_capacity(self);
+  if (100 * (self->size + self->deleted) <
+      OCCUPANCY_THRESHOLD_PERCENT * capacity) {
+    return;
+  }
+
+  size_t new_c = capacity == 0 ? 10 : self->capacity_exp;
+  if (capacity != 0 &&
+      2 * 100 * self->size >= OCCUPANCY_THRESHOLD_PERCENT * capacity) {
+    ++new_c;
+  }
+  edge_slot_t *new_slots = gv_calloc(1ul << new_c, sizeof(edge_slot_t));
+  const size_t mask = (1ul << new_c) - 1;
+  for (size_t i = 0; i < capacity; ++i) {
+    const edge_slot_t slot = self->slots[i];
+    if (slot.edge == NULL || slot.edge == TOMBSTONE) {
+      continue;
+    }
+    size_t candidate = slot.hash & mask;
+    while (new_slots[candidate].edge != NULL) {
+      candidate = (candidate + 1) & mask;
+    }
+    new_slots[candidate] = slot;
+  }
+  free(self->slots);
+  self->slots = new_slots;
+  self->deleted = 0;
+  self->capacity_exp = new_c;
+}
+
+/// put an edge in a slot found vacant by `edge_table_find`
+static void edge_table_put(edge_table_t *self, size_t slot, Agedge_t *item,
+                           bool by_id) {
+  assert(slot != SIZE_MAX && "no vacant slot in a reserved table");
+  if (self->slots[slot].edge == TOMBSTONE) {
+    --self->deleted;
+  } else {
+    assert(self->slots[slot].edge == NULL);
+  }
+  const size_t hash =
+      edge_set_hash(AGOUT2IN(item)->node, item->node, by_id ? AGID(item) : 0);
+  self->slots[slot] = (edge_slot_t){item, hash};
+  ++self->size;
+}
+
+static void edge_table_remove(edge_table_t *self, size_t slot) {
+  assert(self->size > 0);
+  self->slots[slot].edge = TOMBSTONE;
+  --self->size;
+  ++self->deleted;
+}
+
+bool edge_set_add(edge_set_t *self, Agedge_t *item) {
+  assert(self != NULL);
+  assert(item != NULL && AGTYPE(item) == AGOUTEDGE);
+
+  Agnode_t *const tail = AGOUT2IN(item)->node;
+  Agnode_t *const head = item->node;
+  size_t vacant;
+  edge_table_reserve(&self->first);
+  const size_t first =
+      edge_table_find(&self->first, tail, head, 0, false, &vacant);
+  if (first == SIZE_MAX) {
+    edge_table_put(&self->first, vacant, item, false);
+    return true;
+  }
+
+  Agedge_t *const earliest = self->first.slots[first].edge;
+  if (earliest == item) {
+    return false;
+  }
+  edge_table_reserve(&self->others);
+  if (edge_table_find(&self->others, tail, head, AGID(item), true, &vacant) !=
+      SIZE_MAX) {
+    return false;
+  }
+
+  // keep the earlier of the two in `first`
+  if (AGSEQ(earliest) > AGSEQ(item)) {
+    edge_table_find(&self->others, tail, head, AGID(earliest), true, &vacant);
+    self->first.slots[first].edge = item;
+    item = earliest;
+  }
+  edge_table_put(&self->others, vacant, item, true);
+  return true;
+}
+
+Agedge_t *edge_set_find(const edge_set_t *self, const Agnode_t *tail,
+                        const Agnode_t *head, IDTYPE id) {
+  assert(self != NULL);
+
+  const size_t first =
+      edge_table_find(&self->first, tail, head, 0, false, NULL);
+  if (first == SIZE_MAX) {
+    return NULL;
+  }
+  if (AGID(self->first.slots[first].edge) == id) {
+    return self->first.slots[first].edge;
+  }
+  const size_t other =
+      edge_table_find(&self->others, tail, head, id, true, NULL);
+  return other == SIZE_MAX ? NULL : self->others.slots[other].edge;
+}
+
+Agedge_t *edge_set_find_any(const edge_set_t *self, const Agnode_t *tail,
+                            const Agnode_t *head) {
+  assert(self != NULL);
+  const size_t first =
+      edge_table_find(&self->first, tail, head, 0, false, NULL);
+  return first == SIZE_MAX ? NULL : self->first.slots[first].edge;
+}
+
+void edge_set_remove(edge_set_t *self, Agedge_t *item, Agedge_t *next) {
+  assert(self != NULL);
+  assert(item != NULL && AGTYPE(item) == AGOUTEDGE);
+
+  Agnode_t *const tail = AGOUT2IN(item)->node;
+  Agnode_t *const head = item->node;
+  const size_t first =
+      edge_table_find(&self->first, tail, head, 0, false, NULL);
+  if (first == SIZE_MAX) {
+    return;
+  }
+
+  if (self->first.slots[first].edge != item) {
+    const size_t other =
+        edge_table_find(&self->others, tail, head, AGID(item), true, NULL);
+    if (other != SIZE_MAX && self->others.slots[other].edge == item) {
+      edge_table_remove(&self->others, other);
+    }
+    return;
+  }
+
+  if (next == NULL) {
+    edge_table_remove(&self->first, first);
+    return;
+  }
+
+  // promote the next edge between the same nodes
+  assert(next->node == head && AGOUT2IN(next)->node == tail);
+  const size_t other =
+      edge_table_find(&self->others, tail, head, AGID(next), true, NULL);
+  assert(other != SIZE_MAX && self->others.slots[other].edge == next);
+  edge_table_remove(&self->others, other);
+  self->first.slots[first].edge = next;
+}
+
+size_t edge_set_size(const edge_set_t *self) {
+  assert(self != NULL);
+  return self->first.size + self->others.size;
+}
+
+void edge_set_free(edge_set_t **self) {
+  assert(self != NULL);
+
+  if (*self != NULL) {
+    free((*self)->first.slots);
+    free((*self)->others.slots);
+  }
+
+  free(*self);
+  *self = NULL;
+}
 
 /* expose macros as functions for ease of debugging
 and to expose them to foreign languages without C preprocessor. */
@@ -15,13 +15,15 @@
 
 #include <assert.h>
 #include <cgraph/cghdr.h>
+#include <cgraph/edge_set.h>
+#include <cgraph/node_seq.h>
 #include <cgraph/node_set.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <util/alloc.h>
 
-Agraph_t *Ag_G_global;
+_Thread_local Agraph_t *Ag_G_global;
 
 /*
  * this code sets up the resource management discipline
@@ -35,6 +37,8 @@ static Agclos_t *agclos(Agdisc_t * proto)
     rv = gv_calloc(1, sizeof(Agclos_t));
     rv->disc.id = ((proto && proto->id) ? proto->id : &AgIdDisc);
     rv->disc.io = ((proto && proto->io) ? proto->io : &AgIoDisc);
+    rv->disc.mem = ((proto && proto->mem) ? proto->mem : &AgMemDisc);
+    rv->state.mem = rv->disc.mem->open(proto);
     return rv;
 }
 
@@ -69,10 +73,10 @@ Agraph_t *agopen1(Agraph_t * g)
 {
     Agraph_t *par;
 
-    g->n_seq = agdtopen(&Ag_subnode_seq_disc, Dttree);
+    g->n_seq = node_seq_new();
     g->n_id = node_set_new();
     g->e_seq = agdtopen(g == agroot(g)? &Ag_mainedge_seq_disc : &Ag_subedge_seq_disc, Dttree);
-    g->e_id = agdtopen(g == agroot(g)? &Ag_mainedge_id_disc : &Ag_subedge_id_disc, Dttree);
+    g->e_id = edge_set_new();
     g->g_seq = agdtopen(&Ag_subgraph_seq_disc, Dttree);
 
     g->g_id = agdtopen(&Ag_subgraph_id_disc, Dttree);
@@ -91,6 +95,66 @@ Agraph_t *agopen1(Agraph_t * g)
     return g;
 }
 
+/* free the cdt holders of an edge set extracted from <d> */
+static void agdropedgeset(Dict_t * d, Dtlink_t ** set)
+{
+    if (*set) {
+	dtrestore(d, *set);
+	dtclear(d);
+	*set = NULL;
+    }
+}
+
+/*
+ * Drop a graph whose objects all live in storage that its memory
+ * discipline releases as a whole: the graph's indexes are closed without
+ * deleting its nodes and edges one by one.
+ */
+static int agdropgraph(Agraph_t * g)
+{
+    Agraph_t *subg, *next_subg;
+
+    for (subg = agfstsubg(g); subg; subg = next_subg) {
+	next_subg = agnxtsubg(subg);
+	if (agdropgraph(subg)) return FAILURE;
+    }
+
+    /* unlike the root's, subgraph edge sets hold their edges in cdt holders */
+    if (agparent(g)) {
+	Agsubnode_t *sn;
+	for (sn = node_seq_first(g->n_seq); sn; sn = node_seq_next(g->n_seq, sn)) {
+	    agdropedgeset(g->e_seq, &sn->out_seq);
+	    agdropedgeset(g->e_seq, &sn->in_seq);
+	}
+    }
+
+    /* subgraph subnodes go with the rest of the graph's storage */
+    node_set_free(&g->n_id);
+    node_seq_free(&g->n_seq);
+    edge_set_free(&g->e_id);
+    if (agdtclose(g, g->e_seq)) return FAILURE;
+    if (agdtclose(g, g->g_seq)) return FAILURE;
+    if (agdtclose(g, g->g_id)) return FAILURE;
+
+    if (g->desc.has_attrs)
+	if (agraphattr_delete(g)) return FAILURE;
+    return SUCCESS;
+}
+
+/* release the resources a root graph shares with its subgraphs */
+static int agcloseroot(Agraph_t * g)
+{
+    Agclos_t *clos = g->clos;
+
+    AGDISC(g, id)->close(AGCLOS(g, id));
+    if (agstrclose(g)) return FAILURE;
+    agarena_close(g);
+    AGDISC(g, mem)->close(AGCLOS(g, mem));
+    free(g);
+    free(clos);
+    return SUCCESS;
+}
+
 /*
  * Close a graph or subgraph, freeing its storage.
  */
@@ -101,6 +165,15 @@ int agclose(Agraph_t * g)
 
     par = agparent(g);
 
+    /* with no callbacks to tell, an arena-backed graph goes all at once */
+    if (!par && AGDISC(g, mem) == &AgArenaDisc && !g->clos->cb) {
+	if (agdropgraph(g)) return FAILURE;
+	aginternalmapclose(g);
+	agrecclose((Agobj_t *) g);
+	agfreeid(g, AGRAPH, AGID(g));
+	return agcloseroot(g);
+    }
+
     for (subg = agfstsubg(g); subg; subg = next_subg) {
 	next_subg = agnxtsubg(subg);
 	agclose(subg);
@@ -116,11 +189,11 @@ int agclose(Agraph_t * g)
 
     assert(node_set_is_empty(g->n_id));
     node_set_free(&g->n_id);
-    assert(dtsize(g->n_seq) == 0);
-    if (agdtclose(g, g->n_seq)) return FAILURE;
+    assert(node_seq_size(g->n_seq) == 0);
+    node_seq_free(&g->n_seq);
 
-    assert(dtsize(g->e_id) == 0);
-    if (agdtclose(g, g->e_id)) return FAILURE;
+    assert(edge_set_is_empty(g->e_id));
+    edge_set_free(&g->e_id);
     assert(dtsize(g->e_seq) == 0);
     if (agdtclose(g, g->e_seq)) return FAILURE;
 
@@ -137,18 +210,12 @@ int agclose(Agraph_t * g)
 
     if (par) {
 	agdelsubg(par, g);
-	free(g);
-    } else {
-	void *clos;
-	while (g->clos->cb)
-	    agpopdisc(g, g->clos->cb->f);
-	AGDISC(g, id)->close(AGCLOS(g, id));
-	if (agstrclose(g)) return FAILURE;
-	clos = g->clos;
-	free(g);
-	free(clos);
+	agfree(par, g);
+	return SUCCESS;
     }
-    return SUCCESS;
+    while (g->clos->cb)
+	agpopdisc(g, g->clos->cb->f);
+    return agcloseroot(g);
 }
 
 uint64_t agnextseq(Agraph_t * g, int objtype)
@@ -276,7 +343,7 @@ Agdesc_t Agstrictdirected = {.directed = true, .strict = true, .maingraph = true
 Agdesc_t Agundirected = {.maingraph = true};
 Agdesc_t Agstrictundirected = {.strict = true, .maingraph = true};
 
-Agdisc_t AgDefaultDisc = { &AgIdDisc, &AgIoDisc };
+Agdisc_t AgDefaultDisc = { &AgIdDisc, &AgIoDisc, &AgMemDisc };
 
 /**
  * @dir lib/cgraph
@@ -12,6 +12,7 @@
  * Contributors: Details at https://graphviz.org
  *************************************************************************/
 
+#include <limits.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <cgraph/cghdr.h>
@@ -70,22 +71,32 @@ memiofread(void *chan, char *buf, int bufsize)
 
 static Agiodisc_t memIoDisc = {memiofread, 0, 0};
 
-static Agraph_t *agmemread0(Agraph_t *arg_g, const char *cp)
+/* Inputs the scanner can hold in one buffer are handed to it whole; flex's
+ * buffer size is an int, so anything larger is read a line at a time.
+ */
+#define MEMREAD_MAX ((size_t)INT_MAX - 2)
+
+static Agraph_t *agmemread0(Agraph_t *arg_g, const char *cp, size_t len)
 {
     Agraph_t* g;
     rdr_t rdr;
     Agdisc_t disc;
+    const bool whole = len <= MEMREAD_MAX;
+    void *lexbuf = NULL;
 
     memIoDisc.putstr = AgIoDisc.putstr;
     memIoDisc.flush = AgIoDisc.flush;
     rdr.data = cp;
-    rdr.len = strlen(cp);
+    rdr.len = len;
     rdr.cur = 0;
 
     disc.id = &AgIdDisc;
     disc.io = &memIoDisc;  
+    disc.mem = NULL;
+    if (whole) lexbuf = aglexmem(cp, len);
     if (arg_g) g = agconcat(arg_g, &rdr, &disc);
     else g = agread (&rdr, &disc);
+    if (whole) aglexmemend(lexbuf);
     /* Null out filename and reset line number 
      * The name may have been set with a ppDirective, and
      * we want to reset line_num.
@@ -96,10 +107,15 @@ static Agraph_t *agmemread0(Agraph_t *arg_g, const char *cp)
 
 Agraph_t *agmemread(const char *cp)
 {
-    return agmemread0(0, cp);
+    return agmemread0(0, cp, strlen(cp));
+}
+
+Agraph_t *agmemread_len(const char *cp, size_t len)
+{
+    return agmemread0(0, cp, len);
 }
 
 Agraph_t *agmemconcat(Agraph_t *g, const char *cp)
 {
-    return agmemread0(g, cp);
+    return agmemread0(g, cp, strlen(cp));
 }
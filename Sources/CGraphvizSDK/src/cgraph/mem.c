@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @brief memory disciplines and the allocation calls that use them
+ * @ingroup cgraph_memory
+ */
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property 
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include <cgraph/cghdr.h>
+#include <stdlib.h>
+#include <util/alloc.h>
+
+/* default memory discipline: the system allocator */
+
+static void *memopen(Agdisc_t * disc)
+{
+    (void)disc;
+    return NULL;
+}
+
+static void *memalloc(void *state, size_t request)
+{
+    (void)state;
+    return gv_alloc(request);
+}
+
+static void *memresize(void *state, void *ptr, size_t oldsize,
+		       size_t request)
+{
+    (void)state;
+    return gv_realloc(ptr, oldsize, request);
+}
+
+static void memfree(void *state, void *ptr)
+{
+    (void)state;
+    free(ptr);
+}
+
+static void memclose(void *state)
+{
+    (void)state;
+}
+
+Agmemdisc_t AgMemDisc =
+    { memopen, memalloc, memresize, memfree, memclose, NULL };
+
+void *agalloc(Agraph_t * g, size_t size)
+{
+    g->clos->allocations++;
+    return AGDISC(g, mem)->alloc(AGCLOS(g, mem), size);
+}
+
+void *agrealloc(Agraph_t * g, void *ptr, size_t oldsize, size_t size)
+{
+    if (ptr == NULL)
+	return agalloc(g, size);
+    return AGDISC(g, mem)->resize(AGCLOS(g, mem), ptr, oldsize, size);
+}
+
+void agfree(Agraph_t * g, void *ptr)
+{
+    if (ptr)
+	AGDISC(g, mem)->free(AGCLOS(g, mem), ptr);
+}
+
+Agmemstats_t agmemstats(Agraph_t * g)
+{
+    Agmemstats_t stats = {.allocations = g->clos->allocations};
+    if (AGDISC(g, mem)->stats)
+	AGDISC(g, mem)->stats(AGCLOS(g, mem), &stats);
+    return stats;
+}
@@ -13,8 +13,10 @@
 
 #include <assert.h>
 #include <cgraph/cghdr.h>
+#include <cgraph/node_seq.h>
 #include <cgraph/node_set.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <util/alloc.h>
 #include <util/unreachable.h>
@@ -40,7 +42,7 @@ static Agnode_t *agfindnode_by_name(Agraph_t * g, char *name)
 Agnode_t *agfstnode(Agraph_t * g)
 {
     Agsubnode_t *sn;
-    sn = dtfirst(g->n_seq);
+    sn = node_seq_first(g->n_seq);
     return sn ? sn->node : NULL;
 }
 
@@ -48,14 +50,14 @@ Agnode_t *agnxtnode(Agraph_t * g, Agnode_t * n)
 {
     Agsubnode_t *sn;
     sn = agsubrep(g, n);
-    if (sn) sn = dtnext(g->n_seq, sn);
+    if (sn) sn = node_seq_next(g->n_seq, sn);
     return sn ? sn->node : NULL;
 }
 
 Agnode_t *aglstnode(Agraph_t * g)
 {
     Agsubnode_t *sn;
-    sn = dtlast(g->n_seq);
+    sn = node_seq_last(g->n_seq);
     return sn ? sn->node : NULL;
 }
 
@@ -63,17 +65,16 @@ Agnode_t *agprvnode(Agraph_t * g, Agnode_t * n)
 {
     Agsubnode_t *sn;
     sn = agsubrep(g, n);
-    if (sn) sn = dtprev(g->n_seq, sn);
+    if (sn) sn = node_seq_prev(g->n_seq, sn);
     return sn ? sn->node : NULL;
 }
 
 
-/* internal node constructor */
-static Agnode_t *newnode(Agraph_t * g, IDTYPE id, uint64_t seq)
+/* internal node constructor, in zeroed storage <n> */
+static Agnode_t *newnode(Agraph_t * g, IDTYPE id, uint64_t seq, Agnode_t *n)
 {
     assert((seq & SEQ_MASK) == seq && "sequence ID overflow");
 
-    Agnode_t *n = gv_alloc(sizeof(Agnode_t));
     AGTYPE(n) = AGNODE;
     AGID(n) = id;
     AGSEQ(n) = seq & SEQ_MASK;
@@ -92,14 +93,14 @@ static void installnode(Agraph_t * g, Agnode_t * n)
     size_t osize;
     (void)osize;
 
-    assert(node_set_size(g->n_id) == (size_t)dtsize(g->n_seq));
+    assert(node_set_size(g->n_id) == node_seq_size(g->n_seq));
     osize = node_set_size(g->n_id);
     if (g == agroot(g)) sn = &(n->mainsub);
-    else sn = gv_alloc(sizeof(Agsubnode_t));
+    else sn = agalloc(g, sizeof(Agsubnode_t));
     sn->node = n;
     node_set_add(g->n_id, sn);
-    dtinsert(g->n_seq, sn);
-    assert(node_set_size(g->n_id) == (size_t)dtsize(g->n_seq));
+    node_seq_add(g->n_seq, sn);
+    assert(node_set_size(g->n_id) == node_seq_size(g->n_seq));
     assert(node_set_size(g->n_id) == osize + 1);
 }
 
@@ -118,6 +119,17 @@ static void initnode(Agraph_t * g, Agnode_t * n)
     agmethod_init(g, n);
 }
 
+/* create a node with the newly reserved <id> and enter it everywhere */
+static Agnode_t *makenode(Agraph_t * g, IDTYPE id, Agnode_t * storage)
+{
+    Agnode_t *n = newnode(g, id, agnextseq(g, AGNODE), storage);
+    installnodetoroot(g, n);
+    initnode(g, n);
+    assert(agsubrep(g,n));
+    agregister(g, AGNODE, n); /* register in external namespace */
+    return n;
+}
+
 /* external node constructor - create by id */
 Agnode_t *agidnode(Agraph_t * g, IDTYPE id, int cflag)
 {
@@ -155,36 +167,72 @@ Agnode_t *agnode(Agraph_t * g, char *name, int cflag)
 	}
     }
 
-    if (cflag && agmapnametoid(g, AGNODE, name, &id, true)) {	/* reserve id */
-	n = newnode(g, id, agnextseq(g, AGNODE));
-	installnodetoroot(g, n);
-	initnode(g, n);
-	assert(agsubrep(g,n));
-	agregister(g, AGNODE, n); /* register in external namespace */
-	return n;
-    }
+    if (cflag && agmapnametoid(g, AGNODE, name, &id, true))	/* reserve id */
+	return makenode(g, id, agalloc(g, sizeof(Agnode_t)));
 
     return NULL;
 }
 
+size_t agnodes_bulk(Agraph_t * g, size_t n, char **names, Agnode_t **nodes)
+{
+    Agraph_t *root = agroot(g);
+    Agnode_t *block = NULL;
+    size_t slots = 0, created = 0;
+
+    for (size_t i = 0; i < n; i++) {
+	char *name = names ? names[i] : NULL;
+	Agnode_t *node = NULL;
+	IDTYPE id;
+
+	if (agmapnametoid(g, AGNODE, name, &id, false)) {
+	    node = agfindnode_by_id(g, id);
+	    if (node == NULL && g != root && (node = agfindnode_by_id(root, id)))
+		node = agsubnode(g, node, 1);
+	}
+	if (node == NULL && agmapnametoid(g, AGNODE, name, &id, true)) {
+	    /* the rest of the names get one block, which repeats may leave
+	     * partly unused */
+	    if (slots == 0) {
+		slots = n - i;
+		block = agarena_alloc(g, slots * sizeof(Agnode_t));
+	    }
+	    node = makenode(g, id, block++);
+	    slots--;
+	    created++;
+	}
+	if (nodes)
+	    nodes[i] = node;
+    }
+    return created;
+}
+
+/* free_subnode:
+ * Free Agsubnode_t allocated in installnode. This should
+ * only be done for subgraphs, as the root graph uses the
+ * subnode structure built into the node. This explains the
+ * AGSNMAIN test.
+ */
+static void free_subnode(Agsubnode_t *sn) {
+   if (!AGSNMAIN(sn))
+	agfree(sn->node->root, sn);
+}
+
 /* removes image of node and its edges from graph.
    caller must ensure n belongs to g. */
 void agdelnodeimage(Agraph_t * g, Agnode_t * n, void *ignored)
 {
     Agedge_t *e, *f;
-    Agsubnode_t template = {0};
-    template.node = n;
+    Agsubnode_t *sn;
 
     (void)ignored;
     for (e = agfstedge(g, n); e; e = f) {
 	f = agnxtedge(g, e, n);
 	agdeledgeimage(g, e, 0);
     }
-    /* If the following lines are switched, switch the discpline using
-     * free_subnode below.
-     */ 
+    sn = agsubrep(g, n);
     node_set_remove(g->n_id, n->base.tag.id);
-    dtdelete(g->n_seq, &template);
+    node_seq_remove(g->n_seq, sn);
+    free_subnode(sn);
 }
 
 int agdelnode(Agraph_t * g, Agnode_t * n)
@@ -205,8 +253,8 @@ int agdelnode(Agraph_t * g, Agnode_t * n)
 	agfreeid(g, AGNODE, AGID(n));
     }
     if (agapply(g, (Agobj_t *)n, (agobjfn_t)agdelnodeimage, NULL, false) == SUCCESS) {
-	if (g == agroot(g))
-	    free(n);
+	if (g == agroot(g) && !agarena_owns(g, n))
+	    agfree(g, n);
 	return SUCCESS;
     } else
 	return FAILURE;
@@ -280,47 +328,9 @@ static bool agsubnodeideq(const Agsubnode_t *sn0, IDTYPE id) {
   return AGID(sn0->node) == id;
 }
 
-static int agsubnodeseqcmpf(void *arg0, void *arg1) {
-    Agsubnode_t *sn0 = arg0;
-    Agsubnode_t *sn1 = arg1;
-
-    if (AGSEQ(sn0->node) < AGSEQ(sn1->node)) return -1;
-    if (AGSEQ(sn0->node) > AGSEQ(sn1->node)) return 1;
-    return 0; 
-}
-
-/* free_subnode:
- * Free Agsubnode_t allocated in installnode. This should
- * only be done for subgraphs, as the root graph uses the
- * subnode structure built into the node. This explains the
- * AGSNMAIN test. Also, note that both the id and the seq
- * dictionaries use the same subnode object, so only one
- * should do the deletion.
- */
-static void free_subnode(void *subnode) {
-   Agsubnode_t *sn = subnode;
-   if (!AGSNMAIN(sn)) 
-	free(sn);
-}
-
-Dtdisc_t Ag_subnode_seq_disc = {
-    .link = offsetof(Agsubnode_t, seq_link), // link offset
-    .freef = free_subnode,
-    .comparf = agsubnodeseqcmpf,
-};
-
-static void agnodesetfinger(Agraph_t * g, Agnode_t * n, void *ignored)
-{
-    Agsubnode_t template = {0};
-	template.node = n;
-	dtsearch(g->n_seq,&template);
-    (void)ignored;
-}
-
-static void agnoderenew(Agraph_t * g, Agnode_t * n, void *ignored)
+static void agnoderenumbered(Agraph_t * g, Agnode_t * n, void *ignored)
 {
-    dtrenew(g->n_seq, dtfinger(g->n_seq));
-    (void)n;
+    node_seq_renumbered(g->n_seq, agsubrep(g, n));
     (void)ignored;
 }
 
@@ -335,38 +345,29 @@ int agnodebefore(Agnode_t *fst, Agnode_t *snd)
 
 	/* move snd out of the way somewhere */
 	n = snd;
-	if (agapply (g,(Agobj_t *)n, (agobjfn_t)agnodesetfinger, n, false) != SUCCESS) {
-		return FAILURE;
-	}
 	{
 		uint64_t seq = g->clos->seq[AGNODE] + 2;
 		assert((seq & SEQ_MASK) == seq && "sequence ID overflow");
 		AGSEQ(snd) = seq & SEQ_MASK;
 	}
-	if (agapply(g, (Agobj_t *)n, (agobjfn_t)agnoderenew, n, false) != SUCCESS) {
+	if (agapply(g, (Agobj_t *)n, (agobjfn_t)agnoderenumbered, n, false) != SUCCESS) {
 		return FAILURE;
 	}
 	n = agprvnode(g,snd);
 	do {
 		nxt = agprvnode(g,n);
-		if (agapply(g, (Agobj_t *)n, (agobjfn_t)agnodesetfinger, n, false) != SUCCESS) {
-		  return FAILURE;
-		}
 		uint64_t seq = AGSEQ(n) + 1;
 		assert((seq & SEQ_MASK) == seq && "sequence ID overflow");
 		AGSEQ(n) = seq & SEQ_MASK;
-		if (agapply(g, (Agobj_t *)n, (agobjfn_t)agnoderenew, n, false) != SUCCESS) {
+		if (agapply(g, (Agobj_t *)n, (agobjfn_t)agnoderenumbered, n, false) != SUCCESS) {
 		  return FAILURE;
 		}
 		if (n == fst) break;
 		n = nxt;
 	} while (n);
-	if (agapply(g, (Agobj_t *)snd, (agobjfn_t)agnodesetfinger, n, false) != SUCCESS) {
-		return FAILURE;
-	}
 	assert(AGSEQ(fst) != 0 && "sequence ID overflow");
 	AGSEQ(snd) = (AGSEQ(fst) - 1) & SEQ_MASK;
-	if (agapply(g, (Agobj_t *)snd, (agobjfn_t)agnoderenew, snd, false) != SUCCESS) {
+	if (agapply(g, (Agobj_t *)snd, (agobjfn_t)agnoderenumbered, snd, false) != SUCCESS) {
 		return FAILURE;
 	}
 	return SUCCESS;
@@ -375,6 +376,7 @@ int agnodebefore(Agnode_t *fst, Agnode_t *snd)
 struct graphviz_node_set {
   Agsubnode_t **slots; ///< backing store for elements
   size_t size;         ///< number of elements in the set
+  size_t deleted;      ///< number of slots holding a tombstone
   size_t capacity_exp; ///< log₂ size of `slots`
 
   /// the minimum and maximum ID of nodes that have been inserted into the set
@@ -409,9 +411,11 @@ node_set_t *node_set_new(void) { return gv_alloc(sizeof(node_set_t)); }
 
 /// compute a hash of a node
 ///
-/// If the suboptimal choice of using the ID here turns out to be bad for
-/// performance, this could be converted to a more sophisticated hashing
-/// algorithm. None of the callers depend on the exact implementation.
+/// The ID is used as it is. Nodes made one after another have neighboring IDs,
+/// which puts them in neighboring slots, so walking the nodes of a subgraph (a
+/// lookup per node) mostly stays in cache. A mixing hash spreads them over the
+/// whole set and measured several times slower for that. None of the callers
+/// depend on the exact implementation.
 ///
 /// @param id Identifier of element being sought/added
 /// @return Hash digest of the target node
@@ -424,17 +428,24 @@ void node_set_add(node_set_t *self, Agsubnode_t *item) {
   // a watermark ratio at which the set capacity should be expanded
   static const size_t OCCUPANCY_THRESHOLD_PERCENT = 70;
 
-  // do we need to expand the backing store?
+  // Do we need to rebuild the backing store? Tombstones lengthen probes as much
+  // as elements do, so they count towards the watermark. A set that is mostly
+  // tombstones is rebuilt at the same size.
   size_t capacity = node_set_get_capacity(self);
-  const bool grow = 100 * self->size >= OCCUPANCY_THRESHOLD_PERCENT * capacity;
-
-  if (grow) {
-    const size_t new_c = capacity == 0 ? 10 : self->capacity_exp + 1;
+  const bool rebuild = 100 * (self->size + self->deleted) >=
+                       OCCUPANCY_THRESHOLD_PERCENT * capacity;
+
+  if (rebuild) {
+    size_t new_c = capacity == 0 ? 10 : self->capacity_exp;
+    if (capacity != 0 &&
+        2 * 100 * self->size >= OCCUPANCY_THRESHOLD_PERCENT * capacity) {
+      ++new_c;
+    }
     Agsubnode_t **new_slots = gv_calloc(1ul << new_c, sizeof(Agsubnode_t *));
 
     // Construct a new set and copy everything into it. Note we need to rehash
-    // because capacity (and hence modulo wraparound behavior) has changed. This
-    // conveniently flushes out the tombstones too.
+    // because capacity (and hence modulo wraparound behavior) may have changed.
+    // This conveniently flushes out the tombstones too.
     node_set_t new_self = {.slots = new_slots, .capacity_exp = new_c};
     for (size_t i = 0; i < capacity; ++i) {
       // skip empty slots
@@ -472,6 +483,9 @@ void node_set_add(node_set_t *self, Agsubnode_t *item) {
 
     // if we found an empty slot or a previously deleted slot, we can insert
     if (self->slots[candidate] == NULL || self->slots[candidate] == TOMBSTONE) {
+      if (self->slots[candidate] == TOMBSTONE) {
+        --self->deleted;
+      }
       self->slots[candidate] = item;
       ++self->size;
       return;
@@ -539,6 +553,7 @@ void node_set_remove(node_set_t *self, IDTYPE item) {
       assert(self->size > 0);
       self->slots[candidate] = TOMBSTONE;
       --self->size;
+      ++self->deleted;
       return;
     }
   }
@@ -559,3 +574,193 @@ void node_set_free(node_set_t **self) {
   free(*self);
   *self = NULL;
 }
+
+/// A removed element leaves a hole in its slot, which holds the index of a later
+/// slot to continue from, tagged by setting its low bit. Following these and
+/// pointing each hole passed straight at the end of the run keeps stepping
+/// over holes cheap without moving anything on removal.
+struct graphviz_node_seq {
+  uintptr_t *slots; ///< `Agsubnode_t *` in sequence, or tagged skips
+  size_t used;      ///< number of leading slots in use, including holes
+  size_t size;      ///< number of elements in the sequence
+  size_t capacity;  ///< allocated number of `slots`
+  bool unsorted;    ///< are `slots` to be put back in sequence order?
+};
+
+node_seq_t *node_seq_new(void) { return gv_alloc(sizeof(node_seq_t)); }
+
+static bool node_seq_is_hole(uintptr_t slot) { return slot & 1; }
+
+static Agsubnode_t *node_seq_item(const node_seq_t *self, size_t index) {
+  assert(index < self->used && !node_seq_is_hole(self->slots[index]));
+  return (Agsubnode_t *)self->slots[index];
+}
+
+/// find the first element at or after a slot
+///
+/// @param self Sequence to search
+/// @param index Slot to start from
+/// @return Index of the element, or `self->used` if there is none
+static size_t node_seq_skip(node_seq_t *self, size_t index) {
+  size_t found = index;
+  while (found < self->used && node_seq_is_hole(self->slots[found])) {
+    found = self->slots[found] >> 1;
+  }
+  // shorten the path for the next search
+  while (index < found) {
+    const size_t next = self->slots[index] >> 1;
+    self->slots[index] = found << 1 | 1;
+    index = next;
+  }
+  return found;
+}
+
+static int node_seq_cmp(const void *a, const void *b) {
+  const Agsubnode_t *const sn0 = *(Agsubnode_t *const *)a;
+  const Agsubnode_t *const sn1 = *(Agsubnode_t *const *)b;
+  if (AGSEQ(sn0->node) < AGSEQ(sn1->node)) {
+    return -1;
+  }
+  if (AGSEQ(sn0->node) > AGSEQ(sn1->node)) {
+    return 1;
+  }
+  return 0;
+}
+
+/// squeeze out holes and, if needed, restore sequence order
+static void node_seq_normalize(node_seq_t *self) {
+  size_t j = 0;
+  for (size_t i = 0; i < self->used; ++i) {
+    if (!node_seq_is_hole(self->slots[i])) {
+      self->slots[j++] = self->slots[i];
+    }
+  }
+  assert(j == self->size);
+  self->used = j;
+  if (self->unsorted) {
+    qsort(self->slots, self->used, sizeof(self->slots[0]), node_seq_cmp);
+    self->unsorted = false;
+  }
+  for (size_t i = 0; i < self->used; ++i) {
+    node_seq_item(self, i)->seq_index = i;
+  }
+}
+
+/// make the slots ready to be read in order
+static void node_seq_ready(node_seq_t *self) {
+  assert(self != NULL);
+  if (self->unsorted) {
+    node_seq_normalize(self);
+  }
+}
+
+void node_seq_add(node_seq_t *self, Agsubnode_t *item) {
+  assert(self != NULL);
+  assert(item != NULL);
+  assert(!node_seq_is_hole((uintptr_t)item));
+
+  if (self->used == self->capacity) {
+    // a sequence with many holes is compacted rather than grown
+    if (self->capacity > 0 && 2 * self->size <= self->capacity) {
+      node_seq_normalize(self);
+    } else {
+      const size_t capacity = self->capacity == 0 ? 16 : 2 * self->capacity;
+      self->slots = gv_recalloc(self->slots, self->capacity, capacity,
+                                sizeof(self->slots[0]));
+      self->capacity = capacity;
+    }
+  }
+
+  // a node newer than all others, the usual case, keeps the slots in order
+  if (self->used > 0 &&
+      AGSEQ(node_seq_item(self, self->used - 1)->node) > AGSEQ(item->node)) {
+    self->unsorted = true;
+  }
+  item->seq_index = self->used;
+  self->slots[self->used++] = (uintptr_t)item;
+  ++self->size;
+}
+
+void node_seq_remove(node_seq_t *self, Agsubnode_t *item) {
+  assert(self != NULL);
+  assert(item != NULL);
+  assert(node_seq_item(self, item->seq_index) == item);
+
+  self->slots[item->seq_index] = (item->seq_index + 1) << 1 | 1;
+  --self->size;
+  // Trailing holes are given back at once, so the last slot in use always
+  // holds an element. No hole before it can skip past it, so none is left
+  // pointing into the slots given back.
+  while (self->used > 0 && node_seq_is_hole(self->slots[self->used - 1])) {
+    --self->used;
+  }
+}
+
+/// find the last element before a slot
+static size_t node_seq_skip_back(const node_seq_t *self, size_t index) {
+  while (index > 0 && node_seq_is_hole(self->slots[index - 1])) {
+    --index;
+  }
+  return index;
+}
+
+void node_seq_renumbered(node_seq_t *self, const Agsubnode_t *item) {
+  assert(self != NULL);
+  assert(item != NULL);
+  assert(node_seq_item(self, item->seq_index) == item);
+
+  if (self->unsorted) {
+    return;
+  }
+  // is the item still between its neighbors?
+  const size_t prev = node_seq_skip_back(self, item->seq_index);
+  const size_t next = node_seq_skip(self, item->seq_index + 1);
+  if (prev > 0 && AGSEQ(node_seq_item(self, prev - 1)->node) > AGSEQ(item->node)) {
+    self->unsorted = true;
+  }
+  if (next < self->used &&
+      AGSEQ(node_seq_item(self, next)->node) < AGSEQ(item->node)) {
+    self->unsorted = true;
+  }
+}
+
+Agsubnode_t *node_seq_first(node_seq_t *self) {
+  node_seq_ready(self);
+  const size_t first = node_seq_skip(self, 0);
+  return first < self->used ? node_seq_item(self, first) : NULL;
+}
+
+Agsubnode_t *node_seq_last(node_seq_t *self) {
+  node_seq_ready(self);
+  return self->used > 0 ? node_seq_item(self, self->used - 1) : NULL;
+}
+
+Agsubnode_t *node_seq_next(node_seq_t *self, const Agsubnode_t *item) {
+  node_seq_ready(self);
+  assert(node_seq_item(self, item->seq_index) == item);
+  const size_t next = node_seq_skip(self, item->seq_index + 1);
+  return next < self->used ? node_seq_item(self, next) : NULL;
+}
+
+Agsubnode_t *node_seq_prev(node_seq_t *self, const Agsubnode_t *item) {
+  node_seq_ready(self);
+  assert(node_seq_item(self, item->seq_index) == item);
+  const size_t prev = node_seq_skip_back(self, item->seq_index);
+  return prev > 0 ? node_seq_item(self, prev - 1) : NULL;
+}
+
+size_t node_seq_size(const node_seq_t *self) {
+  assert(self != NULL);
+  return self->size;
+}
+
+void node_seq_free(node_seq_t **self) {
+  assert(self != NULL);
+
+  if (*self != NULL) {
+    free((*self)->slots);
+  }
+
+  free(*self);
+  *self = NULL;
+}
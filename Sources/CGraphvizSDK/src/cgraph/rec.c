@@ -96,7 +96,7 @@ void *agbindrec(void *arg_obj, const char *recname, unsigned int recsize,
     g = agraphof(obj);
     Agrec_t *rec = aggetrec(obj, recname, 0);
     if (rec == NULL && recsize > 0) {
-	rec = gv_calloc(recsize, sizeof(char));
+	rec = agalloc(g, recsize);
 	rec->name = agstrdup(g, recname);
 	objputrec(obj, rec);
     }
@@ -156,7 +156,7 @@ int agdelrec(void *arg_obj, const char *name)
 	UNREACHABLE();
     }
     agstrfree(g, rec->name, false);
-    free(rec);
+    agfree(g, rec);
 
     return SUCCESS;
 }
@@ -234,7 +234,7 @@ void agrecclose(Agobj_t * obj)
 	do {
 	    nrec = rec->next;
 	    agstrfree(g, rec->name, false);
-	    free(rec);
+	    agfree(g, rec);
 	    rec = nrec;
 	} while (rec != obj->data);
     }
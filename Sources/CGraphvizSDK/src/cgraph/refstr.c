@@ -30,6 +30,8 @@
 typedef struct {
     uint64_t refcnt: sizeof(uint64_t) * 8 - 1;
     uint64_t is_html: 1;
+    char *canon;    ///< form written by agwrite, `s` itself, or NULL if unknown
+    int canon_line; ///< output line length `canon` was made for
     char s[];
 } refstr_t;
 
@@ -50,6 +52,14 @@ static bool refstr_eq(const char *a, bool is_html, const refstr_t *b) {
   return strcmp(a, b->s) == 0;
 }
 
+/// free a reference-counted string and what is cached alongside it
+static void refstr_free(refstr_t *r) {
+  if (r->canon != r->s) {
+    free(r->canon);
+  }
+  free(r);
+}
+
 /// a string dictionary
 typedef struct {
   refstr_t **buckets;  ///< backing store of elements
@@ -277,7 +287,7 @@ static void strdict_remove(strdict_t *dict, const refstr_t *key) {
     // is this the string we are searching for?
     if (refstr_eq(key->s, key->is_html, dict->buckets[candidate])) {
       assert(dict->size > 0);
-      free(dict->buckets[candidate]);
+      refstr_free(dict->buckets[candidate]);
       dict->buckets[candidate] = TOMBSTONE;
       --dict->size;
       return;
@@ -291,8 +301,8 @@ static void strdict_free(strdict_t **dict) {
 
   if (*dict != NULL && (*dict)->buckets != NULL) {
     for (size_t i = 0; i < 1ul << (*dict)->capacity_exp; ++i) {
-      if ((*dict)->buckets[i] != TOMBSTONE) {
-        free((*dict)->buckets[i]);
+      if ((*dict)->buckets[i] != NULL && (*dict)->buckets[i] != TOMBSTONE) {
+        refstr_free((*dict)->buckets[i]);
       }
     }
     free((*dict)->buckets);
@@ -361,6 +371,7 @@ static char *agstrdup_internal(Agraph_t *g, const char *s, bool is_html) {
 	}
 	r->refcnt = 1;
 	r->is_html = is_html;
+	r->canon = NULL;
 	strcpy(r->s, s);
 	strdict_add(strdict, r);
     }
@@ -408,6 +419,29 @@ int aghtmlstr(const char *s)
     return key->is_html;
 }
 
+char *agstrcanon_cached(const char *s, int linelength) {
+    refstr_t *r;
+
+    assert(s != NULL);
+    r = (refstr_t *)(s - offsetof(refstr_t, s));
+    if (r->canon != NULL && r->canon_line == linelength)
+	return r->canon;
+    return NULL;
+}
+
+char *agstrcanon_cache(char *s, int linelength, const char *canon) {
+    refstr_t *r;
+
+    assert(s != NULL && canon != NULL);
+    r = (refstr_t *)(s - offsetof(refstr_t, s));
+    if (r->canon != r->s)
+	free(r->canon);
+    /* most IDs need no quoting, and are then written as they are */
+    r->canon = canon == s ? s : strdup(canon);
+    r->canon_line = linelength;
+    return r->canon != NULL ? r->canon : (char *)canon;
+}
+
 #ifdef DEBUG
 static int refstrprint(const refstr_t *r) {
     fprintf(stderr, "%s\n", r->s);
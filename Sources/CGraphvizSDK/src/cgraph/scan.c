@@ -2421,6 +2421,24 @@ void agsetfile(const char* f) { InputFile = f; line_num = 1; }
  */
 void aglexinit(Agdisc_t *disc, void *ifile) { Disc = disc; Ifile = ifile; graphType = 0;}
 
+/* Scan the `len` bytes at `data` from a single buffer holding all of them,
+ * instead of refilling through the discipline's afread. The buffer in use
+ * until now is set aside; pass the return value to aglexmemend to get it back.
+ */
+void *aglexmem(const char *data, size_t len) {
+  YY_BUFFER_STATE previous = YY_CURRENT_BUFFER;
+  yy_scan_bytes(data, len);
+  return previous;
+}
+
+void aglexmemend(void *previous) {
+  yy_delete_buffer(YY_CURRENT_BUFFER);
+  if (previous)
+    yy_switch_to_buffer(previous);
+  else
+    yy_init = 0; /* the next scan makes a buffer for its own channel */
+}
+
 
 static void beginstr(void) {
   // nothing required, but we should not have pending string data
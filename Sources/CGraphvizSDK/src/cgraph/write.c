@@ -1,7 +1,7 @@
 /**
  * @file
- * @brief implements @ref agwrite, @ref agcanon, @ref agstrcanon,
- * and @ref agcanonStr
+ * @brief implements @ref agwrite, @ref agwritemem, @ref agcanon,
+ * @ref agstrcanon, and @ref agcanonStr
  *
  * @ingroup cgraph_graph
  * @ingroup cgraph_core
@@ -24,6 +24,8 @@
 #include <ctype.h>
 #include <cgraph/cghdr.h>
 #include <inttypes.h>
+#include <stdlib.h>
+#include <util/agxbuf.h>
 #include <util/gv_ctype.h>
 #include <util/strcasecmp.h>
 
@@ -33,17 +35,24 @@
 
 typedef void iochan_t;
 
+/* is the channel an agxbuf rather than one for the graph's I/O discipline? */
+static _Thread_local bool To_xbuf;
+
 static int ioput(Agraph_t * g, iochan_t * ofile, char *str)
 {
+    if (To_xbuf) {
+	agxbput(ofile, str);
+	return 0;
+    }
     return AGDISC(g, io)->putstr(ofile, str);
 
 }
 
 #define MAX_OUTPUTLINE		128
 #define MIN_OUTPUTLINE		 60
-static int Level;
-static int Max_outputline = MAX_OUTPUTLINE;
-static Agsym_t *Tailport, *Headport;
+static _Thread_local int Level;
+static _Thread_local int Max_outputline = MAX_OUTPUTLINE;
+static _Thread_local Agsym_t *Tailport, *Headport;
 
 typedef struct {
 	uint64_t *preorder_number;	// of a graph or subgraph
@@ -226,8 +235,8 @@ char *agstrcanon(char *arg, char *buf)
 
 static char *getoutputbuffer(const char *str)
 {
-    static char *rv;
-    static size_t len = 0;
+    static _Thread_local char *rv;
+    static _Thread_local size_t len = 0;
     size_t req;
 
     req = MAX(2 * strlen(str) + 2, BUFSIZ);
@@ -254,16 +263,12 @@ char *agcanonStr(char *str)
     return agstrcanon(str, buffer);
 }
 
-static int _write_canonstr(Agraph_t *g, iochan_t *ofile, char *str, bool chk) {
-    if (chk) {
-	str = agcanonStr(str);
-    } else {
-	char *buffer = getoutputbuffer(str);
-	if (buffer == NULL)
-	    return EOF;
-	str = _agstrcanon(str, buffer);
-    }
-    return ioput(g, ofile, str);
+/* write a string that is not necessarily a refstr */
+static int _write_canonstr(Agraph_t *g, iochan_t *ofile, char *str) {
+    char *buffer = getoutputbuffer(str);
+    if (buffer == NULL)
+	return EOF;
+    return ioput(g, ofile, _agstrcanon(str, buffer));
 }
 
 /// @param known Is `str` already known to be a reference-counted string?
@@ -275,7 +280,16 @@ static int write_canonstr(Agraph_t *g, iochan_t *ofile, char *str, bool known) {
      */
     s = known ? str : agstrdup(g, str);
 
-    int r = _write_canonstr(g, ofile, s, true);
+    /* the canonical form is kept with the refstr, so each distinct string is
+     * canonicalized once rather than every time it is written
+     */
+    char *canon = agstrcanon_cached(s, Max_outputline);
+    if (canon == NULL) {
+	canon = agcanonStr(s);
+	if (canon != NULL)
+	    canon = agstrcanon_cache(s, Max_outputline, canon);
+    }
+    int r = canon == NULL ? EOF : ioput(g, ofile, canon);
 
     if (!known) {
 	agstrfree(g, s, false);
@@ -283,6 +297,19 @@ static int write_canonstr(Agraph_t *g, iochan_t *ofile, char *str, bool known) {
     return r;
 }
 
+/// is this name of an object known to be a reference-counted string?
+///
+/// With the default ID discipline, the ID of a named object is its name as a
+/// refstr (see `idmap`), so writing it needs no dictionary lookup.
+///
+/// @param g Graph of the object
+/// @param obj Object whose name this is
+/// @param name Result of `agnameof(obj)`
+/// @return True if `name` is a refstr of `g`
+static bool is_refstr_name(Agraph_t *g, void *obj, const char *name) {
+  return AGDISC(g, id) == &AgIdDisc && (uintptr_t)name == AGID(obj);
+}
+
 static int write_dict(Agraph_t * g, iochan_t * ofile, char *name,
                       Dict_t * dict, bool top) {
     int cnt = 0;
@@ -372,7 +399,7 @@ static int write_hdr(Agraph_t *g, iochan_t *ofile, bool top) {
 	CHKRV(ioput(g, ofile, "graph "));
     }
     if (hasName)
-	CHKRV(write_canonstr(g, ofile, name, false));
+	CHKRV(write_canonstr(g, ofile, name, is_refstr_name(g, g, name)));
     CHKRV(ioput(g, ofile, sep));
     CHKRV(ioput(g, ofile, "{\n"));
     Level++;
@@ -482,7 +509,7 @@ static int write_edge_name(Agedge_t *e, iochan_t *ofile, bool terminate) {
 	    Level++;
 	}
 	CHKRV(ioput(g, ofile, "\t[key="));
-	CHKRV(write_canonstr(g, ofile, p, false));
+	CHKRV(write_canonstr(g, ofile, p, is_refstr_name(g, e, p)));
 	if (terminate)
 	    CHKRV(ioput(g, ofile, "]"));
 	return 1;
@@ -544,7 +571,7 @@ static int write_nodename(Agnode_t * n, iochan_t * ofile)
     name = agnameof(n);
     g = agraphof(n);
     if (name) {
-	CHKRV(write_canonstr(g, ofile, name, false));
+	CHKRV(write_canonstr(g, ofile, name, is_refstr_name(g, n, name)));
     } else {
 	char buf[sizeof("__SUSPECT") + 20];
 	snprintf(buf, sizeof(buf), "_%" PRIu64 "_SUSPECT", AGID(n));	/* could be deadly wrong */
@@ -605,12 +632,12 @@ static int write_port(Agedge_t * e, iochan_t * ofile, Agsym_t * port)
 	char *s = strchr(val, ':');
 	if (s) {
 	    *s = '\0';
-	    CHKRV(_write_canonstr(g, ofile, val, false));
+	    CHKRV(_write_canonstr(g, ofile, val));
 	    CHKRV(ioput(g, ofile, ":"));
-	    CHKRV(_write_canonstr(g, ofile, s + 1, false));
+	    CHKRV(_write_canonstr(g, ofile, s + 1));
 	    *s = ':';
 	} else {
-	    CHKRV(_write_canonstr(g, ofile, val, false));
+	    CHKRV(_write_canonstr(g, ofile, val));
 	}
     }
     return 0;
@@ -690,7 +717,7 @@ static void set_attrwf(Agraph_t * g, bool toplevel, bool value)
 }
 
 /// Return 0 on success, EOF on failure
-int agwrite(Agraph_t * g, void *ofile)
+static int write_graph(Agraph_t * g, iochan_t * ofile)
 {
     char* s;
     Level = 0;			/* re-initialize tab level */
@@ -706,9 +733,38 @@ int agwrite(Agraph_t * g, void *ofile)
     CHKRV(write_trl(g, ofile));
     after_write(wr_info);
     Max_outputline = MAX_OUTPUTLINE;
+    return 0;
+}
+
+/// Return 0 on success, EOF on failure
+int agwrite(Agraph_t * g, void *ofile)
+{
+    CHKRV(write_graph(g, ofile));
     return AGDISC(g, io)->flush(ofile);
 }
 
+/// Return 0 on success, EOF on failure
+int agwrite_xb(Agraph_t * g, agxbuf * xb)
+{
+    To_xbuf = true;
+    const int rc = write_graph(g, xb);
+    To_xbuf = false;
+    return rc;
+}
+
+char *agwritemem(Agraph_t * g, size_t * len)
+{
+    agxbuf xb = {0};
+
+    if (agwrite_xb(g, &xb) == EOF) {
+	agxbfree(&xb);
+	return NULL;
+    }
+    if (len)
+	*len = agxblen(&xb);
+    return agxbdisown(&xb);
+}
+
 static uint64_t subgdfs(Agraph_t *g, uint64_t ix, write_info_t *wr_info) {
     uint64_t ix0 = ix;
     Agraph_t *subg;
@@ -23,6 +23,7 @@
 #include <limits.h>
 #include <locale.h>
 #include <math.h>
+#include <pthread.h>
 #include <common/geomprocs.h>
 #include <common/render.h>
 #include <common/htmltable.h>
@@ -1695,7 +1696,7 @@ static bool node_in_box(node_t *n, boxf b)
   return boxf_overlap(ND_bb(n), b);
 }
 
-static char *saved_color_scheme;
+static _Thread_local char *saved_color_scheme;
 
 static void emit_begin_node(GVJ_t * job, node_t * n)
 {
@@ -3410,7 +3411,7 @@ void emit_graph(GVJ_t * job, graph_t * g)
     emit_end_graph(job);
 }
 
-static Dict_t *strings;
+static _Thread_local Dict_t *strings;
 static Dtdisc_t stringdict = {
     .link = -1, // link - allocate separate holder objects
     .freef = free,
@@ -3690,12 +3691,12 @@ static token_t style_token(char **s) {
  */
 char **parse_style(char *s)
 {
-    static char *parse[FUNLIMIT];
+    static _Thread_local char *parse[FUNLIMIT];
     size_t parse_offsets[sizeof(parse) / sizeof(parse[0])];
     size_t fun = 0;
     bool in_parens = false;
     char *p;
-    static agxbuf ps_xb;
+    static _Thread_local agxbuf ps_xb;
 
     p = s;
     while (true) {
@@ -3853,13 +3854,16 @@ extern gvdevice_callbacks_t gvdevice_callbacks;
  * 
  * If set is non-zero, the "C" locale set;
  * if set is zero, the original locale is reset.
- * Calls to the function can nest.
+ * Calls to the function can nest, also across threads: the locale is
+ * process-wide, so it is only restored once every caller has finished.
  */
 void gv_fixLocale (int set)
 {
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
     static char* save_locale;
     static int cnt;
 
+    pthread_mutex_lock(&lock);
     if (set) {
 	cnt++;
 	if (cnt == 1) {
@@ -3874,6 +3878,7 @@ void gv_fixLocale (int set)
 	    free (save_locale);
 	}
     }
+    pthread_mutex_unlock(&lock);
 }
 
 
@@ -3881,7 +3886,7 @@ void gv_fixLocale (int set)
 
 int gvRenderJobs (GVC_t * gvc, graph_t * g)
 {
-    static GVJ_t *prevjob;
+    static _Thread_local GVJ_t *prevjob;
     GVJ_t *job, *firstjob;
 
     if (Verbose)
@@ -26,7 +26,7 @@ static fdpParms_t fdpParms = {
     50,                         /* unscaled */
     0.0,                        /* C */
     1.0,                        /* Tfact */
-    -1.0,                       /* K - set in initParams; used in init_edge */
+    -1.0,                       /* K - unused; see fdp_springK */
     -1.0,                       /* T0 */
 };
 
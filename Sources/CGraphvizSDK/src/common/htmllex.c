@@ -770,7 +770,7 @@ int initHTMLlexer(htmlscan_t *scanner, char *src, agxbuf * xb, htmlenv_t *env)
     (void)xb;
     (void)env;
 
-    static int first;
+    static _Thread_local int first;
     if (!first) {
 	agwarningf(
 	      "Not built with libexpat. Table formatting is not available.\n");
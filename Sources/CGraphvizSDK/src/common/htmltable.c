@@ -382,7 +382,7 @@ initAnchor(GVJ_t * job, htmlenv_t * env, htmldata_t * data, boxf b,
     obj_state_t *obj = job->obj;
     int changed;
     char *id;
-    static int anchorId;
+    static _Thread_local int anchorId;
     agxbuf xb = {0};
 
     save->url = obj->url;
@@ -520,7 +520,7 @@ static void emit_html_tbl(GVJ_t * job, htmltbl_t * tbl, htmlenv_t * env)
     pointf pos = env->pos;
     htmlcell_t **cells = tbl->u.n.cells;
     htmlcell_t *cp;
-    static textfont_t savef;
+    static _Thread_local textfont_t savef;
     htmlmap_data_t saved;
     int anchor;			/* if true, we need to undo anchor settings. */
     const bool doAnchor = tbl->data.href || tbl->data.target || tbl->data.title;
@@ -1645,7 +1645,7 @@ size_html_tbl(graph_t * g, htmltbl_t * tbl, htmlcell_t * parent,
 	      htmlenv_t * env)
 {
     int rv = 0;
-    static textfont_t savef;
+    static _Thread_local textfont_t savef;
 
     if (tbl->font)
 	pushFontInfo(env, tbl->font, &savef);
@@ -161,7 +161,8 @@ static char *dotneato_basename(char *pathname) {
 
 static void use_library(GVC_t *gvc, const char *name)
 {
-    static size_t cnt = 0;
+    /* entries in Lib, which is thread-local too */
+    static _Thread_local size_t cnt = 0;
     if (name) {
 	const size_t old_nmemb = cnt == 0 ? cnt : cnt + 1;
 	Lib = gv_recalloc(Lib, old_nmemb, cnt + 2, sizeof(const char *));
@@ -615,7 +616,7 @@ void graph_init(graph_t * g, bool use_rankdir)
 #ifdef HAVE_SETENV
 	setenv("GDFONTPATH", p, 1);
 #else
-	static agxbuf buf;
+	static _Thread_local agxbuf buf;
 	agxbprint(&buf, "GDFONTPATH=%s", p);
 	putenv(agxbuse(&buf));
 #endif
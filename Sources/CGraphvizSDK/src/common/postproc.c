@@ -20,9 +20,9 @@
 #include <util/prisize_t.h>
 #include <util/unreachable.h>
 
-static int Rankdir;
-static bool Flip;
-static pointf Offset;
+static _Thread_local int Rankdir;
+static _Thread_local bool Flip;
+static _Thread_local pointf Offset;
 
 static void place_flip_graph_label(graph_t * g);
 
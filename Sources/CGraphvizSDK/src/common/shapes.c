@@ -3352,7 +3352,7 @@ static bool ISCTRL(int c) {
   return c == '{' || c == '}' || c == '|' || c == '<' || c == '>';
 }
 
-static char *reclblp;
+static _Thread_local char *reclblp;
 
 static void free_field(field_t * f)
 {
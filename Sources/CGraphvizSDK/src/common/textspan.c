@@ -63,8 +63,8 @@ static int fontcmpf(const void *a, const void *b)
 
 static PostscriptAlias* translate_postscript_fontname(char* fontname)
 {
-    static char *key;
-    static PostscriptAlias *result;
+    static _Thread_local char *key;
+    static _Thread_local PostscriptAlias *result;
 
     if (key == NULL || strcasecmp(key, fontname)) {
         free(key);
@@ -38,7 +38,7 @@ typedef clock_t mytime_t;
 #include <common/types.h>
 #include <common/utils.h>
 
-static mytime_t T;
+static _Thread_local mytime_t T;
 
 void start_timer(void)
 {
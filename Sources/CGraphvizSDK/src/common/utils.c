@@ -26,6 +26,7 @@
 #include <util/alloc.h>
 #include <util/gv_ctype.h>
 #include <util/gv_math.h>
+#include <util/parallel.h>
 #include <util/startswith.h>
 #include <util/strcasecmp.h>
 #include <util/streq.h>
@@ -77,6 +78,18 @@ double get_inputscale(graph_t *g) {
     return d;
 }
 
+/** Return the number of threads a layout engine may use, from the graph's
+ * threads attribute. Every engine that runs in parallel reads it here, so they
+ * share one default: if the attribute is not set or has a bad value, the
+ * layout runs on the calling thread alone. If the value is 0, we return
+ * gv_parallel_threads(), one per online processor unless overridden.
+ * The layout is the same whatever the count.
+ */
+int get_threads(graph_t *g) {
+    const int threads = late_int(g, agfindgraphattr(g, "threads"), 1, 0);
+    return threads > 0 ? threads : gv_parallel_threads();
+}
+
 char *late_string(void *obj, attrsym_t *attr, char *defaultValue) {
     if (!attr || !obj)
         return defaultValue;
@@ -246,7 +259,7 @@ static strview_t *mkDirlist(const char *list) {
 }
 
 static char *findPath(const strview_t *dirs, const char *str) {
-    static agxbuf safefilename;
+    static _Thread_local agxbuf safefilename;
 
     for (const strview_t *dp = dirs; dp != NULL && dp->data != NULL; dp++) {
 	agxbprint(&safefilename, "%.*s%s%s", (int)dp->size, dp->data, DIRSEP, str);
@@ -399,7 +412,7 @@ pointf dotneato_closest(splines * spl, pointf pt)
     return pt2;
 }
 
-static int Tflag;
+static _Thread_local int Tflag;
 void gvToggle(int s)
 {
     (void)s;
@@ -727,7 +740,7 @@ static node_t *clustNode(node_t * n, graph_t * cg, agxbuf * xb,
 			 graph_t * clg)
 {
     node_t *cn;
-    static int idx = 0;
+    static _Thread_local int idx = 0;
 
     agxbprint(xb, "__%d:%s", idx++, agnameof(cg));
 
@@ -1193,7 +1206,7 @@ cvtAndAppend (unsigned char c, agxbuf* xb)
  */
 char* htmlEntityUTF8 (char* s, graph_t* g)
 {
-    static graph_t* lastg;
+    static _Thread_local graph_t* lastg;
     static atomic_flag warned;
     unsigned char c;
     unsigned int v;
@@ -448,6 +448,19 @@ static void xdot_end_graph(graph_t* g)
 
 typedef int (*putstrfn) (void *chan, const char *str);
 typedef int (*flushfn) (void *chan);
+
+/* write the graph as DOT in memory, then hand it to the device in one piece */
+static void dot_write_graph(GVJ_t *job, graph_t *g)
+{
+    size_t len;
+    char *dot = agwritemem(g, &len);
+    if (dot == NULL)
+	return;
+    gvwrite(job, dot, len);
+    gvflush(job);
+    free(dot);
+}
+
 static void dot_end_graph(GVJ_t *job)
 {
     graph_t *g = job->obj->u.g;
@@ -472,14 +485,14 @@ static void dot_end_graph(GVJ_t *job)
 	case FORMAT_DOT:
 	case FORMAT_CANON:
 	    if (!(job->flags & OUTPUT_NOT_REQUIRED))
-		agwrite(g, job);
+		dot_write_graph(job, g);
 	    break;
 	case FORMAT_XDOT:
 	case FORMAT_XDOT12:
 	case FORMAT_XDOT14:
 	    xdot_end_graph(g);
 	    if (!(job->flags & OUTPUT_NOT_REQUIRED))
-		agwrite(g, job);
+		dot_write_graph(job, g);
 	    break;
 	default:
 	    UNREACHABLE();
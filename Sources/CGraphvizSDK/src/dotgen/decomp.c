@@ -23,8 +23,8 @@
 #include <util/alloc.h>
 #include <util/list.h>
 
-static node_t *Last_node;
-static size_t Cmark;
+static _Thread_local node_t *Last_node;
+static _Thread_local size_t Cmark;
 
 static void 
 begin_component(graph_t* g)
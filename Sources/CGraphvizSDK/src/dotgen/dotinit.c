@@ -333,6 +333,7 @@ static void dotLayout(Agraph_t * g)
     dot_splines(g);
     if (mapbool(agget(g, "compound")))
 	dot_compoundEdges(g);
+    dot_incremental_capture(g);
 }
 
 static void
@@ -395,7 +395,9 @@ static void dot_splines_(graph_t *g, int normalize) {
         break;
     }
 
-    if (et == EDGETYPE_CURVED) {
+    if (dot_incremental_reuse_splines(g, edges + ind, cnt)) {
+      continue; // installed once the routed splines are normalized
+    } else if (et == EDGETYPE_CURVED) {
       edge_t **edgelist = gv_calloc(cnt, sizeof(edge_t *));
       edgelist[0] = getmainedge((edges + ind)[0]);
       for (unsigned ii = 1; ii < cnt; ii++)
@@ -441,8 +443,10 @@ static void dot_splines_(graph_t *g, int normalize) {
 
   /* normalize splines so they always go from tail to head */
   /* place_portlabel relies on this being done first */
-  if (normalize)
+  if (normalize) {
     edge_normalize(g);
+    dot_incremental_install_splines(g);
+  }
 
 #ifdef ORTHO
 finish:
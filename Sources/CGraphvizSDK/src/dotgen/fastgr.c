@@ -231,7 +231,7 @@ void delete_flat_edge(edge_t * e)
 #ifdef DEBUG
 static char *NAME(node_t * n)
 {
-    static char buf[20];
+    static _Thread_local char buf[20];
     if (ND_node_type(n) == NORMAL)
 	return agnameof(n);
     snprintf(buf, sizeof(buf), "V%p", n);
@@ -296,3 +296,128 @@ merge_oneway(edge_t * e, edge_t * rep)
     ED_to_virt(e) = rep;
     basic_merge(e, rep);
 }
+
+/* fast_csr_t: a copy of the fast graph in flat arrays, for the loops of
+ * mincross that would otherwise chase a pointer per edge.
+ */
+
+static void csr_edges_alloc(fast_csr_edges_t *edges, size_t n)
+{
+    edges->node = gv_calloc(n, sizeof(int));
+    edges->xpenalty = gv_calloc(n, sizeof(int));
+    edges->port = gv_calloc(n, sizeof(int));
+    edges->tail_x = gv_calloc(n, sizeof(double));
+    edges->head_x = gv_calloc(n, sizeof(double));
+}
+
+static void csr_edges_free(fast_csr_edges_t *edges)
+{
+    free(edges->node);
+    free(edges->xpenalty);
+    free(edges->port);
+    free(edges->tail_x);
+    free(edges->head_x);
+}
+
+static bool csr_has(const fast_csr_t *fg, int count, node_t *v)
+{
+    const int id = FAST_CSR_ID(v);
+    return id >= 0 && id < count && fg->node[id] == v;
+}
+
+/* give v an ID if it does not have one yet */
+static void csr_add(fast_csr_t *fg, int *count, size_t *capacity, node_t *v)
+{
+    if (csr_has(fg, *count, v))
+	return;
+    if ((size_t)*count == *capacity) {
+	const size_t c = *capacity == 0 ? 64 : 2 * *capacity;
+	fg->node = gv_recalloc(fg->node, *capacity, c, sizeof(node_t *));
+	*capacity = c;
+    }
+    FAST_CSR_ID(v) = *count;
+    fg->node[(*count)++] = v;
+}
+
+/* rows of the first `ranked` nodes; the others only get IDs and empty rows */
+static void csr_rows(fast_csr_t *fg, int ranked, int *offsets,
+		     fast_csr_edges_t *edges, bool out)
+{
+    int i, j, k = 0;
+    edge_t *e;
+
+    for (i = 0; i < fg->n; i++) {
+	const elist l = out ? ND_out(fg->node[i]) : ND_in(fg->node[i]);
+	offsets[i + 1] = offsets[i] + (i < ranked ? (int)l.size : 0);
+    }
+    csr_edges_alloc(edges, (size_t)offsets[fg->n]);
+    for (i = 0; i < ranked; i++) {
+	const elist l = out ? ND_out(fg->node[i]) : ND_in(fg->node[i]);
+	for (j = 0; (e = l.list[j]); j++, k++) {
+	    edges->node[k] = FAST_CSR_ID(out ? aghead(e) : agtail(e));
+	    edges->xpenalty[k] = ED_xpenalty(e);
+	    edges->port[k] = out ? ED_head_port(e).order : ED_tail_port(e).order;
+	    edges->tail_x[k] = ED_tail_port(e).p.x;
+	    edges->head_x[k] = ED_head_port(e).p.x;
+	}
+    }
+}
+
+void fast_csr_build(fast_csr_t *fg, graph_t *g)
+{
+    graph_t *root = dot_root(g);
+    int r, i, j, count = 0;
+    size_t capacity = 0;
+    node_t *v;
+    edge_t *e;
+
+    fast_csr_free(fg);
+    /* nodes rank by rank, then any other ends of their edges */
+    for (r = GD_minrank(root); r <= GD_maxrank(root); r++)
+	for (i = 0; i < GD_rank(root)[r].n; i++)
+	    csr_add(fg, &count, &capacity, GD_rank(root)[r].v[i]);
+    const int ranked = count;
+    for (i = 0; i < ranked; i++) {
+	v = fg->node[i];
+	for (j = 0; (e = ND_out(v).list[j]); j++)
+	    csr_add(fg, &count, &capacity, aghead(e));
+	for (j = 0; (e = ND_in(v).list[j]); j++)
+	    csr_add(fg, &count, &capacity, agtail(e));
+    }
+
+    fg->n = count;
+    fg->order = gv_calloc((size_t)count, sizeof(int));
+    fg->has_port = gv_calloc((size_t)count, sizeof(bool));
+    for (i = 0; i < count; i++) {
+	fg->order[i] = ND_order(fg->node[i]);
+	fg->has_port[i] = ND_has_port(fg->node[i]);
+    }
+    fg->out = gv_calloc((size_t)count + 1, sizeof(int));
+    fg->in = gv_calloc((size_t)count + 1, sizeof(int));
+    csr_rows(fg, ranked, fg->out, &fg->out_edges, true);
+    csr_rows(fg, ranked, fg->in, &fg->in_edges, false);
+}
+
+void fast_csr_free(fast_csr_t *fg)
+{
+    free(fg->node);
+    free(fg->order);
+    free(fg->has_port);
+    free(fg->out);
+    free(fg->in);
+    csr_edges_free(&fg->out_edges);
+    csr_edges_free(&fg->in_edges);
+    *fg = (fast_csr_t){0};
+}
+
+void fast_csr_sync_order(fast_csr_t *fg, graph_t *g)
+{
+    int r, i;
+    node_t *v;
+
+    for (r = GD_minrank(g); r <= GD_maxrank(g); r++)
+	for (i = 0; i < GD_rank(g)[r].n; i++) {
+	    v = GD_rank(g)[r].v[i];
+	    fg->order[FAST_CSR_ID(v)] = ND_order(v);
+	}
+}
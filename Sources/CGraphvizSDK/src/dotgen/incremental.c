@@ -0,0 +1,906 @@
+/// @file
+/// @brief seeding a dot layout with the result of the previous one
+///
+/// An editor that lays out a graph again after a small edit wants the new
+/// drawing to look like the old one, and wants it quickly. Between
+/// `dot_incremental_begin` and `dot_incremental_end`, dot matches the graph
+/// against a memo of the previous layout by node name and by edge (tail, head,
+/// key) and then:
+///
+///   - seeds network simplex with the previous ranks, repaired into a feasible
+///     ranking, instead of its longest-path initial ranking
+///   - orders every rank by the previous x coordinates instead of by a
+///     breadth-first walk, and lets mincross only accept improvements on it
+///   - copies the previous spline of a regular edge, translated, when the
+///     edge's path through the ranks kept its shape and its surroundings
+///
+/// Everything happens in dot's internal coordinates, before the drawing is
+/// rotated or translated by postprocessing, so the memo does not depend on
+/// `rankdir` or on the final bounding box.
+
+#include <dotgen/dot.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+
+/// largest coordinate change still treated as no change
+#define TOLERANCE 1e-3
+
+/// an edge's node on one rank, with what routing sees around it
+typedef struct {
+  pointf p;
+  double lw, rw, ht;
+  double left_gap, right_gap; ///< free space to the neighbours in the rank
+  double ht1, ht2;            ///< heights of the rank
+} stop_t;
+
+typedef struct {
+  char *name;
+  int rank;
+  pointf coord;
+  size_t index; ///< position at capture, to renumber the edges
+} memo_node_t;
+
+typedef struct {
+  size_t tail, head; ///< positions in the memo nodes
+  char *key;         ///< edge name, or `NULL`
+  size_t ordinal;    ///< position among edges of equal tail, head and key
+  size_t seq;        ///< AGSEQ at capture, to compute `ordinal`
+  splines *spl;      ///< copy of a reusable spline, or `NULL`
+  port tail_port, head_port;
+  stop_t *stops; ///< path of the edge through the ranks, from the top
+  size_t n_stops;
+} memo_edge_t;
+
+struct dot_layout_memo_s {
+  memo_node_t *nodes; ///< sorted by name
+  size_t n_nodes;
+  memo_edge_t *edges; ///< sorted by tail, head, key and ordinal
+  size_t n_edges;
+  int edgetype; ///< `splines` setting the edges were routed with
+  size_t reused_splines;
+};
+
+typedef struct {
+  edge_t *e;
+  const memo_edge_t *m;
+  pointf delta;
+} pending_t;
+
+typedef struct {
+  Agraph_t *graph;
+  const dot_layout_memo_t *previous;
+  dot_layout_memo_t *next;
+  bool capture; ///< whether to fill `next` for the layout after this one
+  size_t *node_match;    ///< memo node of each node by AGSEQ, or SIZE_MAX
+  size_t *edge_match;    ///< memo edge of each edge by AGSEQ, or SIZE_MAX
+  size_t *capture_index; ///< position in `next` of each node by AGSEQ
+  size_t n_node_seqs, n_edge_seqs;
+  size_t nodes_capacity, edges_capacity;
+  bool reuse_splines;
+  pending_t *pending;
+  size_t n_pending, pending_capacity;
+} incremental_t;
+
+static _Thread_local incremental_t *Incremental;
+
+static incremental_t *active(graph_t *g) {
+  if (Incremental == NULL || agroot(g) != Incremental->graph)
+    return NULL;
+  return Incremental;
+}
+
+bool dot_incremental_active(graph_t *g) {
+  return active(g) != NULL && Incremental->previous != NULL;
+}
+
+static int cmp_key(const char *a, const char *b) {
+  if (a == NULL || b == NULL)
+    return (a != NULL) - (b != NULL);
+  return strcmp(a, b);
+}
+
+static int cmp_memo_node(const void *a, const void *b) {
+  const memo_node_t *x = a;
+  const memo_node_t *y = b;
+  return strcmp(x->name, y->name);
+}
+
+/// order of edges by tail, head, key, then by `seq` or `ordinal`
+static int cmp_edge_ids(size_t tail0, size_t head0, const char *key0,
+                        size_t tail1, size_t head1, const char *key1) {
+  if (tail0 != tail1)
+    return tail0 < tail1 ? -1 : 1;
+  if (head0 != head1)
+    return head0 < head1 ? -1 : 1;
+  return cmp_key(key0, key1);
+}
+
+static int cmp_memo_edge_seq(const void *a, const void *b) {
+  const memo_edge_t *x = a;
+  const memo_edge_t *y = b;
+  const int c =
+      cmp_edge_ids(x->tail, x->head, x->key, y->tail, y->head, y->key);
+  if (c != 0)
+    return c;
+  return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static int cmp_memo_edge(const void *a, const void *b) {
+  const memo_edge_t *x = a;
+  const memo_edge_t *y = b;
+  const int c =
+      cmp_edge_ids(x->tail, x->head, x->key, y->tail, y->head, y->key);
+  if (c != 0)
+    return c;
+  return x->ordinal < y->ordinal ? -1 : x->ordinal > y->ordinal;
+}
+
+static size_t find_node(const dot_layout_memo_t *memo, const char *name) {
+  const memo_node_t key = {.name = (char *)name};
+  const memo_node_t *found = bsearch(&key, memo->nodes, memo->n_nodes,
+                                     sizeof(memo_node_t), cmp_memo_node);
+  return found == NULL ? SIZE_MAX : (size_t)(found - memo->nodes);
+}
+
+/// an edge of the graph being matched against the memo
+typedef struct {
+  edge_t *e;
+  size_t tail, head;
+  const char *key;
+} edge_ref_t;
+
+static int cmp_edge_ref(const void *a, const void *b) {
+  const edge_ref_t *x = a;
+  const edge_ref_t *y = b;
+  const int c =
+      cmp_edge_ids(x->tail, x->head, x->key, y->tail, y->head, y->key);
+  if (c != 0)
+    return c;
+  return AGSEQ(x->e) < AGSEQ(y->e) ? -1 : AGSEQ(x->e) > AGSEQ(y->e);
+}
+
+static void match_graph(incremental_t *st) {
+  Agraph_t *g = st->graph;
+  const dot_layout_memo_t *memo = st->previous;
+
+  for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n))
+    st->node_match[AGSEQ(n)] =
+        memo == NULL ? SIZE_MAX : find_node(memo, agnameof(n));
+  if (memo == NULL)
+    return;
+
+  edge_ref_t *refs = gv_calloc((size_t)agnedges(g), sizeof(edge_ref_t));
+  size_t n_refs = 0;
+  for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    for (edge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+      const size_t tail = st->node_match[AGSEQ(agtail(e))];
+      const size_t head = st->node_match[AGSEQ(aghead(e))];
+      if (tail != SIZE_MAX && head != SIZE_MAX)
+        refs[n_refs++] = (edge_ref_t){e, tail, head, agnameof(e)};
+    }
+  }
+  qsort(refs, n_refs, sizeof(edge_ref_t), cmp_edge_ref);
+
+  for (size_t i = 0, ordinal = 0; i < n_refs; i++) {
+    if (i > 0 && cmp_edge_ids(refs[i - 1].tail, refs[i - 1].head,
+                              refs[i - 1].key, refs[i].tail, refs[i].head,
+                              refs[i].key) == 0)
+      ordinal++;
+    else
+      ordinal = 0;
+    const memo_edge_t key = {.tail = refs[i].tail,
+                             .head = refs[i].head,
+                             .key = (char *)refs[i].key,
+                             .ordinal = ordinal};
+    const memo_edge_t *found = bsearch(&key, memo->edges, memo->n_edges,
+                                       sizeof(memo_edge_t), cmp_memo_edge);
+    if (found != NULL)
+      st->edge_match[AGSEQ(refs[i].e)] = (size_t)(found - memo->edges);
+  }
+  free(refs);
+}
+
+void dot_incremental_begin(Agraph_t *g, const dot_layout_memo_t *previous,
+                           bool capture) {
+  dot_layout_memo_free(dot_incremental_end());
+
+  incremental_t *st = gv_alloc(sizeof(incremental_t));
+  st->graph = g;
+  st->previous = previous;
+  st->next = gv_alloc(sizeof(dot_layout_memo_t));
+  st->capture = capture;
+  st->reuse_splines = previous != NULL && !mapbool(agget(g, "concentrate")) &&
+                      !mapbool(agget(g, "compound"));
+
+  for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    st->n_node_seqs = MAX(st->n_node_seqs, (size_t)AGSEQ(n) + 1);
+    for (edge_t *e = agfstout(g, n); e; e = agnxtout(g, e))
+      st->n_edge_seqs = MAX(st->n_edge_seqs, (size_t)AGSEQ(e) + 1);
+  }
+  st->node_match = gv_calloc(st->n_node_seqs, sizeof(size_t));
+  st->capture_index = gv_calloc(st->n_node_seqs, sizeof(size_t));
+  st->edge_match = gv_calloc(st->n_edge_seqs, sizeof(size_t));
+  for (size_t i = 0; i < st->n_edge_seqs; i++)
+    st->edge_match[i] = SIZE_MAX;
+  match_graph(st);
+
+  Incremental = st;
+}
+
+/// put the captured nodes and edges in the order lookups expect
+static void sort_memo(dot_layout_memo_t *memo) {
+  // sort the nodes by name and point the edges at their new positions
+  qsort(memo->nodes, memo->n_nodes, sizeof(memo_node_t), cmp_memo_node);
+  size_t *position = gv_calloc(memo->n_nodes, sizeof(size_t));
+  for (size_t i = 0; i < memo->n_nodes; i++)
+    position[memo->nodes[i].index] = i;
+  for (size_t i = 0; i < memo->n_edges; i++) {
+    memo->edges[i].tail = position[memo->edges[i].tail];
+    memo->edges[i].head = position[memo->edges[i].head];
+  }
+  free(position);
+
+  qsort(memo->edges, memo->n_edges, sizeof(memo_edge_t), cmp_memo_edge_seq);
+  for (size_t i = 1; i < memo->n_edges; i++) {
+    const memo_edge_t *prev = &memo->edges[i - 1];
+    memo_edge_t *e = &memo->edges[i];
+    if (cmp_edge_ids(prev->tail, prev->head, prev->key, e->tail, e->head,
+                     e->key) == 0)
+      e->ordinal = prev->ordinal + 1;
+  }
+}
+
+dot_layout_memo_t *dot_incremental_end(void) {
+  incremental_t *st = Incremental;
+  if (st == NULL)
+    return NULL;
+  Incremental = NULL;
+
+  dot_layout_memo_t *memo = st->next;
+  if (st->capture) {
+    sort_memo(memo);
+  } else {
+    dot_layout_memo_free(memo);
+    memo = NULL;
+  }
+
+  free(st->node_match);
+  free(st->edge_match);
+  free(st->capture_index);
+  free(st->pending);
+  free(st);
+  return memo;
+}
+
+void dot_layout_memo_free(dot_layout_memo_t *memo) {
+  if (memo == NULL)
+    return;
+  for (size_t i = 0; i < memo->n_nodes; i++)
+    free(memo->nodes[i].name);
+  for (size_t i = 0; i < memo->n_edges; i++) {
+    memo_edge_t *e = &memo->edges[i];
+    free(e->key);
+    free(e->stops);
+    if (e->spl != NULL) {
+      for (size_t j = 0; j < e->spl->size; j++)
+        free(e->spl->list[j].list);
+      free(e->spl->list);
+      free(e->spl);
+    }
+  }
+  free(memo->nodes);
+  free(memo->edges);
+  free(memo);
+}
+
+size_t dot_layout_memo_reused_splines(const dot_layout_memo_t *memo) {
+  return memo->reused_splines;
+}
+
+/// memo entry of a real node of the graph being laid out
+static const memo_node_t *memo_node(const incremental_t *st, node_t *n) {
+  if (st->previous == NULL || ND_node_type(n) != NORMAL ||
+      (size_t)AGSEQ(n) >= st->n_node_seqs)
+    return NULL;
+  const size_t i = st->node_match[AGSEQ(n)];
+  return i == SIZE_MAX ? NULL : &st->previous->nodes[i];
+}
+
+/// the fast edges of a node, which position.c moves aside for its own
+static elist fast_in(node_t *v, bool saved) {
+  return saved ? ND_save_in(v) : ND_in(v);
+}
+
+static elist fast_out(node_t *v, bool saved) {
+  return saved ? ND_save_out(v) : ND_out(v);
+}
+
+/// the real edge a chain of virtual nodes stands for
+static edge_t *chain_edge(node_t *v, bool saved) {
+  const elist in = fast_in(v, saved);
+  const elist out = fast_out(v, saved);
+  edge_t *e = in.size > 0 ? in.list[0] : out.size > 0 ? out.list[0] : NULL;
+  while (e != NULL && ED_to_orig(e) != NULL)
+    e = ED_to_orig(e);
+  return e;
+}
+
+/// previous x coordinate of a node of a long edge
+///
+/// During mincross, ranks tell how far down the edge `v` is. Once position.c
+/// has reused ranks for x coordinates, the chain is walked instead.
+///
+/// @param saved Whether the fast graph is in `ND_save_in` and `ND_save_out`
+static bool chain_key(const incremental_t *st, node_t *v, bool saved,
+                      double *x) {
+  edge_t *e = chain_edge(v, saved);
+  if (e == NULL || (size_t)AGSEQ(e) >= st->n_edge_seqs ||
+      st->edge_match[AGSEQ(e)] == SIZE_MAX)
+    return false;
+  const memo_edge_t *m = &st->previous->edges[st->edge_match[AGSEQ(e)]];
+
+  size_t index, length;
+  if (!saved) {
+    const int top = MIN(ND_rank(agtail(e)), ND_rank(aghead(e)));
+    const int bottom = MAX(ND_rank(agtail(e)), ND_rank(aghead(e)));
+    index = (size_t)(ND_rank(v) - top);
+    length = (size_t)(bottom - top) + 1;
+  } else {
+    size_t before = 0, after = 0;
+    for (node_t *u = v; ND_node_type(u) == VIRTUAL; before++) {
+      const elist in = fast_in(u, saved);
+      if (in.size != 1)
+        return false;
+      u = agtail(in.list[0]);
+    }
+    for (node_t *u = v; ND_node_type(u) == VIRTUAL; after++) {
+      const elist out = fast_out(u, saved);
+      if (out.size != 1)
+        return false;
+      u = aghead(out.list[0]);
+    }
+    index = before;
+    length = before + after + 1;
+  }
+  if (m->n_stops != length || index >= length)
+    return false;
+  *x = m->stops[index].p.x;
+  return true;
+}
+
+/// previous x coordinate of the real nodes of a cluster on a rank, averaged
+///
+/// Clusters that have no matched node on the rank use all their nodes.
+static bool cluster_key(const incremental_t *st, graph_t *clust, int rank,
+                        double *x) {
+  double sum = 0, rank_sum = 0;
+  size_t n_matched = 0, n_rank_matched = 0;
+  for (node_t *n = agfstnode(clust); n; n = agnxtnode(clust, n)) {
+    const memo_node_t *m = memo_node(st, n);
+    if (m == NULL)
+      continue;
+    sum += m->coord.x;
+    n_matched++;
+    if (ND_rank(n) == rank) {
+      rank_sum += m->coord.x;
+      n_rank_matched++;
+    }
+  }
+  if (n_rank_matched > 0) {
+    *x = rank_sum / (double)n_rank_matched;
+    return true;
+  }
+  if (n_matched == 0)
+    return false;
+  *x = sum / (double)n_matched;
+  return true;
+}
+
+/// where the previous layout put `v`
+static bool x_key(const incremental_t *st, node_t *v, bool saved, double *x) {
+  const memo_node_t *m = memo_node(st, v);
+  if (m != NULL) {
+    *x = m->coord.x;
+    return true;
+  }
+  if (ND_node_type(v) != VIRTUAL)
+    return false;
+  if (ND_clust(v) != NULL && ND_ranktype(v) == CLUSTER)
+    return cluster_key(st, ND_clust(v), ND_rank(v), x);
+  return chain_key(st, v, saved, x);
+}
+
+/// seeds of the nodes of a graph's node list, sorted by node
+typedef struct {
+  node_t *n;
+  double seed; ///< NAN if none
+} seed_t;
+
+typedef struct {
+  seed_t *list;
+  size_t size;
+} seeds_t;
+
+static int cmp_seed(const void *a, const void *b) {
+  const seed_t *x = a;
+  const seed_t *y = b;
+  return (uintptr_t)x->n < (uintptr_t)y->n ? -1 : (uintptr_t)x->n > (uintptr_t)y->n;
+}
+
+static seed_t *find_seed(const seeds_t *seeds, node_t *n) {
+  const seed_t key = {.n = n};
+  return bsearch(&key, seeds->list, seeds->size, sizeof(seed_t), cmp_seed);
+}
+
+static double seed_of(const seeds_t *seeds, node_t *n) {
+  const seed_t *s = find_seed(seeds, n);
+  return s == NULL ? NAN : s->seed;
+}
+
+static seeds_t make_seeds(graph_t *g) {
+  seeds_t seeds = {0};
+  for (node_t *n = GD_nlist(g); n; n = ND_next(n))
+    seeds.size++;
+  seeds.list = gv_calloc(seeds.size, sizeof(seed_t));
+  size_t i = 0;
+  for (node_t *n = GD_nlist(g); n; n = ND_next(n))
+    seeds.list[i++] = (seed_t){n, NAN};
+  qsort(seeds.list, seeds.size, sizeof(seed_t), cmp_seed);
+  return seeds;
+}
+
+/// give the nodes of `g`'s node list a feasible ranking close to their seeds
+///
+/// This is Kahn's algorithm, as in init_rank of ns.c, except that each node
+/// is placed at its seed when the constraints from its predecessors allow.
+/// A node without a seed is placed as low as its predecessors allow, or if it
+/// has none, just above its nearest seeded successor. A cycle leaves part of
+/// the ranking infeasible, and network simplex then ranks from scratch.
+static void seed_feasible(graph_t *g, const seeds_t *seeds) {
+  node_queue_t q = {0};
+  for (node_t *n = GD_nlist(g); n; n = ND_next(n)) {
+    ND_priority(n) = (int)ND_in(n).size;
+    if (ND_priority(n) == 0)
+      node_queue_push_back(&q, n);
+  }
+  while (!node_queue_is_empty(&q)) {
+    node_t *n = node_queue_pop_front(&q);
+    const double seed = seed_of(seeds, n);
+    edge_t *e;
+    int rank = INT_MIN;
+    for (int i = 0; (e = ND_in(n).list[i]); i++)
+      rank = MAX(rank, ND_rank(agtail(e)) + ED_minlen(e));
+    if (!isnan(seed)) {
+      rank = MAX(rank, (int)lround(seed));
+    } else if (rank == INT_MIN) {
+      for (int i = 0; (e = ND_out(n).list[i]); i++) {
+        const double h = seed_of(seeds, aghead(e));
+        if (!isnan(h))
+          rank = rank == INT_MIN ? (int)lround(h) - ED_minlen(e)
+                                 : MIN(rank, (int)lround(h) - ED_minlen(e));
+      }
+    }
+    ND_rank(n) = rank == INT_MIN ? 0 : rank;
+    for (int i = 0; (e = ND_out(n).list[i]); i++) {
+      if (--ND_priority(aghead(e)) == 0)
+        node_queue_push_back(&q, aghead(e));
+    }
+  }
+  node_queue_free(&q);
+}
+
+static int cmp_int(const void *a, const void *b) {
+  const int x = *(const int *)a;
+  const int y = *(const int *)b;
+  return x < y ? -1 : x > y;
+}
+
+/// move nodes back to their seeds where that does not change the cost
+///
+/// Network simplex turns a seeded ranking into an optimal one, but among equal
+/// optima it need not keep the seeds. As in TB_balance of ns.c, a node with
+/// equal in and out weight can move anywhere between its neighbours without
+/// changing the cost, so such nodes are put back.
+///
+/// @param bounded Keep ranks within 0 and the current largest rank
+static void restore_seeds(graph_t *g, const seeds_t *seeds, bool bounded) {
+  // ranks may have been normalized since, e.g. after an edit above a node;
+  // take the most common shift as the offset between seeds and ranks
+  int *shifts = gv_calloc(seeds->size, sizeof(int));
+  size_t n_shifts = 0;
+  int maxrank = 0;
+  for (size_t i = 0; i < seeds->size; i++) {
+    maxrank = MAX(maxrank, ND_rank(seeds->list[i].n));
+    if (!isnan(seeds->list[i].seed))
+      shifts[n_shifts++] =
+          (int)lround(seeds->list[i].seed) - ND_rank(seeds->list[i].n);
+  }
+  qsort(shifts, n_shifts, sizeof(int), cmp_int);
+  int offset = 0;
+  for (size_t i = 0, best = 0; i < n_shifts;) {
+    size_t j = i;
+    while (j < n_shifts && shifts[j] == shifts[i])
+      j++;
+    if (j - i > best) {
+      best = j - i;
+      offset = shifts[i];
+    }
+    i = j;
+  }
+  free(shifts);
+
+  // a move can free a neighbour, so sweep a few times
+  for (int pass = 0, moved = 1; pass < 4 && moved; pass++) {
+    moved = 0;
+    for (node_t *n = GD_nlist(g); n; n = ND_next(n)) {
+      const double seed = seed_of(seeds, n);
+      if (isnan(seed))
+        continue;
+      const int want = (int)lround(seed) - offset;
+      if (want == ND_rank(n))
+        continue;
+      int inweight = 0, outweight = 0;
+      int low = bounded ? 0 : INT_MIN, high = bounded ? maxrank : INT_MAX;
+      edge_t *e;
+      for (int i = 0; (e = ND_in(n).list[i]); i++) {
+        inweight += ED_weight(e);
+        low = MAX(low, ND_rank(agtail(e)) + ED_minlen(e));
+      }
+      for (int i = 0; (e = ND_out(n).list[i]); i++) {
+        outweight += ED_weight(e);
+        high = MIN(high, ND_rank(aghead(e)) - ED_minlen(e));
+      }
+      if (inweight == outweight && low <= want && want <= high) {
+        ND_rank(n) = want;
+        moved = 1;
+      }
+    }
+  }
+}
+
+/// seeds of the ranks from the previous layout
+static seeds_t rank_seeds(const incremental_t *st, graph_t *g) {
+  seeds_t seeds = make_seeds(g);
+  for (size_t i = 0; i < seeds.size; i++) {
+    const memo_node_t *m = memo_node(st, seeds.list[i].n);
+    if (m != NULL)
+      seeds.list[i].seed = m->rank;
+  }
+  return seeds;
+}
+
+/// seeds of the x coordinates from the previous layout
+static seeds_t coord_seeds(const incremental_t *st, graph_t *g) {
+  seeds_t seeds = make_seeds(g);
+  for (size_t i = 0; i < seeds.size; i++) {
+    double x;
+    if (x_key(st, seeds.list[i].n, true, &x))
+      seeds.list[i].seed = x;
+  }
+  return seeds;
+}
+
+void dot_incremental_seed_ranks(graph_t *g) {
+  const incremental_t *st = active(g);
+  if (st == NULL || st->previous == NULL)
+    return;
+  seeds_t seeds = rank_seeds(st, g);
+  seed_feasible(g, &seeds);
+  free(seeds.list);
+}
+
+void dot_incremental_restore_ranks(graph_t *g) {
+  const incremental_t *st = active(g);
+  if (st == NULL || st->previous == NULL)
+    return;
+  seeds_t seeds = rank_seeds(st, g);
+  restore_seeds(g, &seeds, true);
+  free(seeds.list);
+}
+
+void dot_incremental_seed_coords(graph_t *g) {
+  const incremental_t *st = active(g);
+  if (st == NULL || st->previous == NULL)
+    return;
+  seeds_t seeds = coord_seeds(st, g);
+  seed_feasible(g, &seeds);
+  free(seeds.list);
+}
+
+void dot_incremental_restore_coords(graph_t *g) {
+  const incremental_t *st = active(g);
+  if (st == NULL || st->previous == NULL)
+    return;
+  seeds_t seeds = coord_seeds(st, g);
+  restore_seeds(g, &seeds, false);
+  free(seeds.list);
+}
+
+typedef struct {
+  node_t *v;
+  double x;
+  int index;
+} keyed_node_t;
+
+static int cmp_keyed_node(const void *a, const void *b) {
+  const keyed_node_t *x = a;
+  const keyed_node_t *y = b;
+  if (x->x != y->x)
+    return x->x < y->x ? -1 : 1;
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+void dot_incremental_seed_order(graph_t *g) {
+  const incremental_t *st = active(g);
+  if (st == NULL || st->previous == NULL)
+    return;
+
+  graph_t *root = dot_root(g);
+  keyed_node_t *keys = NULL;
+  size_t capacity = 0;
+  for (int r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+    const int n = GD_rank(g)[r].n;
+    if (n < 2)
+      continue;
+    if ((size_t)n > capacity) {
+      keys = gv_recalloc(keys, capacity, (size_t)n, sizeof(keyed_node_t));
+      capacity = (size_t)n;
+    }
+    node_t **vlist = GD_rank(g)[r].v;
+    int base = INT_MAX;
+    double last = -DBL_MAX;
+    for (int i = 0; i < n; i++) {
+      base = MIN(base, ND_order(vlist[i]));
+      // nodes the previous layout did not have stay next to their current
+      // left neighbour
+      double x;
+      if (x_key(st, vlist[i], false, &x))
+        last = x;
+      keys[i] = (keyed_node_t){vlist[i], last, i};
+    }
+    qsort(keys, (size_t)n, sizeof(keyed_node_t), cmp_keyed_node);
+    for (int i = 0; i < n; i++) {
+      vlist[i] = keys[i].v;
+      ND_order(vlist[i]) = base + i;
+    }
+    GD_rank(root)[r].valid = false;
+  }
+  free(keys);
+}
+
+/// describe `v` as routing sees it
+static stop_t make_stop(graph_t *root, node_t *v) {
+  const rank_t *rank = &GD_rank(root)[ND_rank(v)];
+  const int order = ND_order(v);
+  stop_t s = {.p = ND_coord(v),
+              .lw = ND_lw(v),
+              .rw = ND_rw(v),
+              .ht = ND_ht(v),
+              .left_gap = INFINITY,
+              .right_gap = INFINITY,
+              .ht1 = rank->ht1,
+              .ht2 = rank->ht2};
+  if (order > 0) {
+    node_t *u = rank->v[order - 1];
+    s.left_gap = ND_coord(v).x - ND_lw(v) - ND_coord(u).x - ND_rw(u);
+  }
+  if (order + 1 < rank->n) {
+    node_t *u = rank->v[order + 1];
+    s.right_gap = ND_coord(u).x - ND_lw(u) - ND_coord(v).x - ND_rw(v);
+  }
+  return s;
+}
+
+/// the nodes a regular edge passes through, one per rank
+///
+/// @return Number of stops, or 0 if `e` is not a plain chain between its ends
+static size_t edge_path(graph_t *root, edge_t *e, stop_t **stops) {
+  *stops = NULL;
+  edge_t *fe = ED_to_virt(e);
+  if (fe == NULL || ND_rank(agtail(e)) == ND_rank(aghead(e)))
+    return 0;
+  const size_t limit = (size_t)(GD_maxrank(root) - GD_minrank(root)) + 2;
+  node_t *first = agtail(fe);
+  stop_t *path = gv_calloc(limit, sizeof(stop_t));
+  size_t n = 0;
+  path[n++] = make_stop(root, first);
+  for (node_t *v = aghead(fe);; v = aghead(fe)) {
+    if (n == limit)
+      goto fail;
+    path[n++] = make_stop(root, v);
+    if (ND_node_type(v) != VIRTUAL) {
+      const bool ends = (first == agtail(e) && v == aghead(e)) ||
+                        (first == aghead(e) && v == agtail(e));
+      if (!ends)
+        goto fail;
+      break;
+    }
+    if (ND_out(v).size != 1)
+      goto fail;
+    fe = ND_out(v).list[0];
+  }
+  *stops = path;
+  return n;
+
+fail:
+  free(path);
+  return 0;
+}
+
+static bool near(double a, double b) { return a == b || fabs(a - b) <= TOLERANCE; }
+
+/// is `cur` the path `prev` translated by `delta`, with the same surroundings?
+static bool same_path(const stop_t *cur, const stop_t *prev, size_t n,
+                      pointf delta) {
+  for (size_t i = 0; i < n; i++) {
+    if (!near(cur[i].p.x - prev[i].p.x, delta.x) ||
+        !near(cur[i].p.y - prev[i].p.y, delta.y) ||
+        !near(cur[i].lw, prev[i].lw) || !near(cur[i].rw, prev[i].rw) ||
+        !near(cur[i].ht, prev[i].ht) ||
+        !near(cur[i].left_gap, prev[i].left_gap) ||
+        !near(cur[i].right_gap, prev[i].right_gap) ||
+        !near(cur[i].ht1, prev[i].ht1) || !near(cur[i].ht2, prev[i].ht2))
+      return false;
+  }
+  return true;
+}
+
+static bool same_port(port a, port b) {
+  return a.defined == b.defined && a.side == b.side && near(a.p.x, b.p.x) &&
+         near(a.p.y, b.p.y);
+}
+
+/// the previous spline of `e` if it still fits, and by how much it moved
+static const memo_edge_t *reusable(const incremental_t *st, graph_t *root,
+                                   edge_t *e, pointf *delta) {
+  if ((size_t)AGSEQ(e) >= st->n_edge_seqs)
+    return NULL;
+  const size_t i = st->edge_match[AGSEQ(e)];
+  if (i == SIZE_MAX)
+    return NULL;
+  const memo_edge_t *m = &st->previous->edges[i];
+  if (m->spl == NULL || ED_label(e) != NULL || ED_spl(e) != NULL ||
+      !same_port(ED_tail_port(e), m->tail_port) ||
+      !same_port(ED_head_port(e), m->head_port))
+    return NULL;
+
+  stop_t *path;
+  const size_t n = edge_path(root, e, &path);
+  bool same = n == m->n_stops;
+  if (same) {
+    *delta = (pointf){path[0].p.x - m->stops[0].p.x,
+                      path[0].p.y - m->stops[0].p.y};
+    same = same_path(path, m->stops, n, *delta);
+  }
+  free(path);
+  return same ? m : NULL;
+}
+
+bool dot_incremental_reuse_splines(graph_t *g, edge_t **edges, unsigned cnt) {
+  incremental_t *st = active(g);
+  if (st == NULL || !st->reuse_splines ||
+      EDGE_TYPE(g) != st->previous->edgetype || EDGE_TYPE(g) == EDGETYPE_CURVED)
+    return false;
+
+  graph_t *root = dot_root(g);
+  const size_t first = st->n_pending;
+  for (unsigned i = 0; i < cnt; i++) {
+    edge_t *e = edges[i];
+    while (ED_to_orig(e) != NULL)
+      e = ED_to_orig(e);
+    pointf delta;
+    const memo_edge_t *m = reusable(st, root, e, &delta);
+    // edges routed together are spread as a group, so reuse all or none
+    if (m == NULL || (st->n_pending > first &&
+                      (!near(delta.x, st->pending[first].delta.x) ||
+                       !near(delta.y, st->pending[first].delta.y)))) {
+      st->n_pending = first;
+      return false;
+    }
+    if (st->n_pending == st->pending_capacity) {
+      const size_t grown =
+          st->pending_capacity == 0 ? 64 : st->pending_capacity * 2;
+      st->pending =
+          gv_recalloc(st->pending, st->pending_capacity, grown, sizeof(pending_t));
+      st->pending_capacity = grown;
+    }
+    st->pending[st->n_pending++] = (pending_t){e, m, delta};
+  }
+  return true;
+}
+
+static pointf translate(pointf p, pointf delta) {
+  return (pointf){p.x + delta.x, p.y + delta.y};
+}
+
+void dot_incremental_install_splines(graph_t *g) {
+  incremental_t *st = active(g);
+  if (st == NULL)
+    return;
+  for (size_t i = 0; i < st->n_pending; i++) {
+    const pending_t *p = &st->pending[i];
+    graph_t *bbg = agraphof(agtail(p->e));
+    for (size_t j = 0; j < p->m->spl->size; j++) {
+      const bezier *from = &p->m->spl->list[j];
+      bezier *to = new_spline(p->e, from->size);
+      for (size_t k = 0; k < from->size; k++)
+        to->list[k] = translate(from->list[k], p->delta);
+      to->sflag = from->sflag;
+      to->eflag = from->eflag;
+      to->sp = translate(from->sp, p->delta);
+      to->ep = translate(from->ep, p->delta);
+      for (size_t k = 0; k + 3 < to->size; k += 3)
+        update_bb_bz(&GD_bb(bbg), &to->list[k]);
+    }
+  }
+  st->next->reused_splines += st->n_pending;
+  st->n_pending = 0;
+}
+
+static splines *copy_splines(const splines *spl) {
+  splines *copy = gv_alloc(sizeof(splines));
+  copy->list = gv_calloc(spl->size, sizeof(bezier));
+  copy->size = spl->size;
+  copy->bb = spl->bb;
+  for (size_t i = 0; i < spl->size; i++) {
+    copy->list[i] = spl->list[i];
+    copy->list[i].list = gv_calloc(spl->list[i].size, sizeof(pointf));
+    memcpy(copy->list[i].list, spl->list[i].list,
+           spl->list[i].size * sizeof(pointf));
+  }
+  return copy;
+}
+
+void dot_incremental_capture(graph_t *g) {
+  incremental_t *st = active(g);
+  if (st == NULL || !st->capture)
+    return;
+  dot_layout_memo_t *memo = st->next;
+  graph_t *root = dot_root(g);
+  memo->edgetype = EDGE_TYPE(g);
+
+  for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    if (memo->n_nodes == st->nodes_capacity) {
+      const size_t grown =
+          st->nodes_capacity == 0 ? 64 : st->nodes_capacity * 2;
+      memo->nodes = gv_recalloc(memo->nodes, st->nodes_capacity, grown,
+                                sizeof(memo_node_t));
+      st->nodes_capacity = grown;
+    }
+    st->capture_index[AGSEQ(n)] = memo->n_nodes;
+    memo->nodes[memo->n_nodes] = (memo_node_t){.name = gv_strdup(agnameof(n)),
+                                               .rank = ND_rank(n),
+                                               .coord = ND_coord(n),
+                                               .index = memo->n_nodes};
+    memo->n_nodes++;
+  }
+
+  for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    for (edge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+      if (memo->n_edges == st->edges_capacity) {
+        const size_t grown =
+            st->edges_capacity == 0 ? 64 : st->edges_capacity * 2;
+        memo->edges = gv_recalloc(memo->edges, st->edges_capacity, grown,
+                                  sizeof(memo_edge_t));
+        st->edges_capacity = grown;
+      }
+      const char *key = agnameof(e);
+      memo_edge_t m = {.tail = st->capture_index[AGSEQ(agtail(e))],
+                       .head = st->capture_index[AGSEQ(aghead(e))],
+                       .key = key == NULL ? NULL : gv_strdup(key),
+                       .seq = (size_t)AGSEQ(e),
+                       .tail_port = ED_tail_port(e),
+                       .head_port = ED_head_port(e)};
+      m.n_stops = edge_path(root, e, &m.stops);
+      if (m.n_stops > 0 && ED_spl(e) != NULL && ED_label(e) == NULL)
+        m.spl = copy_splines(ED_spl(e));
+      memo->edges[memo->n_edges++] = m;
+    }
+  }
+}
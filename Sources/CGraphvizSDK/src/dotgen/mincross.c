@@ -25,11 +25,13 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <util/agxbuf.h>
 #include <util/alloc.h>
 #include <util/exit.h>
 #include <util/gv_math.h>
 #include <util/list.h>
+#include <util/parallel.h>
 #include <util/streq.h>
 
 struct adjmatrix_t {
@@ -43,27 +45,59 @@ struct adjmatrix_t {
 #define saveorder(v)	(ND_coord(v)).x
 #define flatindex(v)	((size_t)ND_low(v))
 
+/// state of one `dot_mincross` run
+///
+/// This lives on the stack of `dot_mincross` rather than in file statics so
+/// that independent graphs can be ordered concurrently. The graph whose rank
+/// arrays are permuted is always `dot_root(g)`.
+typedef struct {
+  int MinQuit;
+  int MaxIter;
+  int GlobalMinRank, GlobalMaxRank;
+  edge_t **TE_list;
+  int *TI_list;
+  bool ReMincross;
+  bool Incremental; ///< the ranks start out ordered like a previous layout
+  double Deadline; ///< `mc_clock` time at which `mclimit_ms` runs out, or 0
+  double RestartsEnd; ///< `mc_clock` time by which the component's restarts stop
+  /// threads `ncross` may count on; 1 on the workers of `mincross_components`,
+  /// which already keep every thread busy
+  int Threads;
+} mincross_state_t;
+
 	/* forward declarations */
-static bool medians(graph_t * g, int r0, int r1);
+static bool medians(graph_t *g, const fast_csr_t *fg, int r0, int r1,
+                    const mincross_state_t *st);
 static int nodeposcmpf(const void *, const void *);
 static int edgeidcmpf(const void *, const void *);
 static void flat_breakcycles(graph_t * g);
 static void flat_reorder(graph_t * g);
 static void flat_search(graph_t * g, node_t * v);
-static void init_mincross(graph_t * g);
-static void merge2(graph_t * g);
-static void init_mccomp(graph_t *g, size_t c);
-static void cleanup2(graph_t *g, int64_t nc);
-static int64_t mincross_clust(graph_t *g, ints_t *scratch);
-static int64_t mincross(graph_t *g, int startpass, ints_t *scratch);
-static void mincross_step(graph_t * g, int pass);
-static void mincross_options(graph_t * g);
+static void init_mincross(graph_t *g, mincross_state_t *st);
+static void merge2(graph_t *g, const mincross_state_t *st);
+static void keep_flat(rank_t *rank, int offset, int width, adjmatrix_t **kept);
+static void init_mccomp(graph_t *g, size_t c, adjmatrix_t **kept);
+static int64_t mincross_components(graph_t *g, ints_t *scratch,
+                                   const mincross_state_t *st);
+static void cleanup2(graph_t *g, int64_t nc, mincross_state_t *st);
+static int64_t mincross_clust(graph_t *g, ints_t *scratch,
+                              const mincross_state_t *st);
+static int64_t mincross(graph_t *g, int startpass, ints_t *scratch,
+                        const mincross_state_t *st);
+static void mincross_step(graph_t *g, fast_csr_t *fg, int pass,
+                          const mincross_state_t *st);
+static void mincross_options(graph_t *g, mincross_state_t *st);
+static void build_ranks_seeded(graph_t *g, int pass, uint64_t seed,
+                               int threads, ints_t *scratch);
+static int64_t mincross_restarts(graph_t *g, fast_csr_t *fg, int64_t best_cross,
+                                 ints_t *scratch, const mincross_state_t *st);
 static void save_best(graph_t * g);
-static void restore_best(graph_t * g);
+static void restore_best(graph_t *g, fast_csr_t *fg);
 static adjmatrix_t *new_matrix(size_t i, size_t j);
 static void free_matrix(adjmatrix_t * p);
 static int ordercmpf(const void *, const void *);
-static int64_t ncross(ints_t *scratch);
+static int64_t ncross(graph_t *g, const fast_csr_t *fg, int threads,
+                      ints_t *scratch);
 #ifdef DEBUG
 #if DEBUG > 1
 static int gd_minrank(Agraph_t *g) {return GD_minrank(g);}
@@ -72,21 +106,26 @@ static rank_t *gd_rank(Agraph_t *g, int r) {return &GD_rank(g)[r];}
 static int nd_order(Agnode_t *v) { return ND_order(v); }
 #endif
 void check_rs(graph_t * g, int null_ok);
-void check_order(void);
+void check_order(graph_t *g);
 void check_vlists(graph_t * g);
 void node_in_root_vlist(node_t * n);
 #endif
 
 
 	/* mincross parameters */
-static int MinQuit;
 static const double Convergence = .995;
 
-static graph_t *Root;
-static int GlobalMinRank, GlobalMaxRank;
-static edge_t **TE_list;
-static int *TI_list;
-static bool ReMincross;
+/// seconds on a monotonic clock
+static double mc_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/// has the `mclimit_ms` budget of this run been spent?
+static bool out_of_time(const mincross_state_t *st) {
+  return st->Deadline > 0 && mc_clock() >= st->Deadline;
+}
 
 #if defined(DEBUG) && DEBUG > 1
 static void indent(graph_t* g)
@@ -99,7 +138,7 @@ static void indent(graph_t* g)
 
 static char* nname(node_t* v)
 {
-        static char buf[1000];
+        static _Thread_local char buf[1000];
 	if (ND_node_type(v)) {
 		if (ND_ranktype(v) == CLUSTER)
 			snprintf(buf, sizeof(buf), "v%s_%p", agnameof(ND_clust(v)), v);
@@ -366,38 +405,35 @@ void dot_mincross(graph_t *g) {
 	}
     }
 
-    init_mincross(g);
+    mincross_state_t st = {0};
+    init_mincross(g, &st);
 
     ints_t scratch = {0};
 
-    size_t comp;
-    for (nc = 0, comp = 0; comp < GD_comp(g).size; comp++) {
-	init_mccomp(g, comp);
-	nc += mincross(g, 0, &scratch);
-    }
+    nc = mincross_components(g, &scratch, &st);
 
-    merge2(g);
+    merge2(g, &st);
 
     /* run mincross on contents of each cluster */
     for (int c = 1; c <= GD_n_cluster(g); c++) {
-	nc += mincross_clust(GD_clust(g)[c], &scratch);
+	nc += mincross_clust(GD_clust(g)[c], &scratch, &st);
 #ifdef DEBUG
 	check_vlists(GD_clust(g)[c]);
-	check_order();
+	check_order(g);
 #endif
     }
 
     if (GD_n_cluster(g) > 0 && (!(s = agget(g, "remincross")) || mapbool(s))) {
 	mark_lowclusters(g);
-	ReMincross = true;
-	nc = mincross(g, 2, &scratch);
+	st.ReMincross = true;
+	nc = mincross(g, 2, &scratch, &st);
 #ifdef DEBUG
 	for (int c = 1; c <= GD_n_cluster(g); c++)
 	    check_vlists(GD_clust(g)[c]);
 #endif
     }
     ints_free(&scratch);
-    cleanup2(g, nc);
+    cleanup2(g, nc, &st);
 }
 
 static adjmatrix_t *new_matrix(size_t i, size_t j) {
@@ -418,16 +454,228 @@ static void free_matrix(adjmatrix_t * p)
 
 #define ELT(M,i,j)		(M->data[((i)*M->ncols)+(j)])
 
-static void init_mccomp(graph_t *g, size_t c) {
+/* copy src into dst, starting at row and column offset */
+static void copy_block(adjmatrix_t *dst, const adjmatrix_t *src, size_t offset) {
+    for (size_t i = 0; i < src->nrows; i++)
+	memcpy(&ELT(dst, offset + i, offset), &ELT(src, i, 0), src->ncols);
+}
+
+/* fold the flat edge matrix of a finished component into kept
+ *
+ * rank holds the component's part of a rank, which starts at offset in the
+ * complete rank of the given width. The component's flatindex labels are
+ * shifted by offset, so that once the components are merged each node is
+ * still looked up in its own component's block, and no component consults
+ * another's matrix.
+ */
+static void keep_flat(rank_t *rank, int offset, int width, adjmatrix_t **kept) {
+    for (int i = 0; i < rank->n; i++)
+	ND_low(rank->v[i]) += offset;
+    adjmatrix_t *M = rank->flat;
+    if (M == NULL)
+	return;
+    rank->flat = NULL;
+    if (*kept == NULL && offset == 0) {
+	*kept = M;
+	return;
+    }
+    if (*kept == NULL || (*kept)->nrows < (size_t)width) {
+	adjmatrix_t *wide = new_matrix((size_t)width, (size_t)width);
+	if (*kept != NULL)
+	    copy_block(wide, *kept, 0);
+	free_matrix(*kept);
+	*kept = wide;
+    }
+    copy_block(*kept, M, (size_t)offset);
+    free_matrix(M);
+}
+
+static void init_mccomp(graph_t *g, size_t c, adjmatrix_t **kept) {
     int r;
 
     GD_nlist(g) = GD_comp(g).list[c];
     if (c > 0) {
 	for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
-	    GD_rank(g)[r].v = GD_rank(g)[r].v + GD_rank(g)[r].n;
-	    GD_rank(g)[r].n = 0;
+	    rank_t *rank = &GD_rank(g)[r];
+	    keep_flat(rank, (int)(rank->v - rank->av), rank->an, &kept[r]);
+	    rank->v = rank->v + rank->n;
+	    rank->n = 0;
+	}
+    }
+}
+
+/// a connected component ordered on a thread of its own
+///
+/// `g` stands in for the root while the component is ordered. It carries a
+/// copy of the root's layout record whose ranks are windows onto the
+/// component's part of the root's rank arrays, and is its own `dot_root`, so
+/// components ordered at the same time share no state. It is not a cgraph
+/// graph: beyond the layout record, only `agnameof` works on it.
+typedef struct {
+    Agraph_t g;
+    Agraphinfo_t info;
+    rank_t *rank;
+    int64_t nc;
+    double restarts_end; ///< `RestartsEnd` of the component
+} mccomp_t;
+
+/// a batch of components ordered by `mincross_components`
+typedef struct {
+    mccomp_t *comps;
+    const mincross_state_t *st;
+    size_t list_size; ///< number of entries in `TI_list`
+} mccomp_job_t;
+
+static void mincross_comps(void *context, size_t begin, size_t end) {
+    const mccomp_job_t *job = context;
+    mincross_state_t st = *job->st;
+    st.Threads = 1;
+    st.TE_list = NULL;
+    st.TI_list = gv_calloc(job->list_size, sizeof(int));
+    ints_t scratch = {0};
+    for (size_t i = begin; i < end; i++) {
+	st.RestartsEnd = job->comps[i].restarts_end;
+	job->comps[i].nc = mincross(&job->comps[i].g, 0, &scratch, &st);
+    }
+    ints_free(&scratch);
+    free(st.TI_list);
+}
+
+/* set up comp to order component c of g, whose ranks start at used */
+static void init_mccomp_copy(graph_t *g, size_t c, mccomp_t *comp, int *used) {
+    int r;
+    node_t *v;
+
+    comp->info = *(Agraphinfo_t *)AGDATA(g);
+    comp->g = (Agraph_t){.base.tag = g->base.tag, .desc = g->desc,
+                         .clos = g->clos};
+    comp->g.base.data = (Agrec_t *)&comp->info;
+    comp->g.root = &comp->g;
+    GD_dotroot(&comp->g) = &comp->g;
+    GD_nlist(&comp->g) = GD_comp(g).list[c];
+    GD_rank(&comp->g) = comp->rank;
+    for (r = GD_minrank(g); r <= GD_maxrank(g); r++)
+	comp->rank[r] = (rank_t){.v = GD_rank(g)[r].av + used[r],
+	                         .av = GD_rank(g)[r].av + used[r]};
+    for (v = GD_nlist(&comp->g); v; v = ND_next(v))
+	comp->rank[ND_rank(v)].an++;
+    for (r = GD_minrank(g); r <= GD_maxrank(g); r++)
+	used[r] += comp->rank[r].an;
+}
+
+/* when the restarts of each component of g have to stop
+ *
+ * What is left of the mclimit_ms budget is split between the components by
+ * their number of nodes, as if they were ordered one after another, so that
+ * early components cannot starve later ones. If there are clusters, half of
+ * it is kept for ordering their contents.
+ */
+static double *restarts_ends(graph_t *g, const mincross_state_t *st) {
+    const size_t n_comps = GD_comp(g).size;
+    double *ends = gv_calloc(n_comps, sizeof(double));
+    size_t total = 0, done = 0;
+    node_t *v;
+
+    if (st->Deadline <= 0 || st->Incremental)
+	return ends;
+    for (size_t c = 0; c < n_comps; c++)
+	for (v = GD_comp(g).list[c]; v; v = ND_next(v))
+	    total++;
+    const double now = mc_clock();
+    double span = MAX(0, st->Deadline - now);
+    if (GD_n_cluster(g) > 0)
+	span /= 2;
+    for (size_t c = 0; c < n_comps; c++) {
+	for (v = GD_comp(g).list[c]; v; v = ND_next(v))
+	    done++;
+	ends[c] = now + span * (double)done / (double)MAX(total, 1);
+    }
+    return ends;
+}
+
+/* order the connected components of g
+ *
+ * Components share nothing but the rank arrays of g, in which each occupies
+ * its own stretch, so when several threads are available they are ordered
+ * concurrently on stand-ins for the root (mccomp_t) and then folded back in
+ * component order, leaving g as ordering them one by one would.
+ */
+static int64_t mincross_components(graph_t *g, ints_t *scratch,
+                                   const mincross_state_t *st) {
+    const size_t n_comps = GD_comp(g).size;
+    const int threads = st->Threads;
+    adjmatrix_t **kept = gv_calloc((size_t)GD_maxrank(g) + 2,
+                                   sizeof(adjmatrix_t *));
+    double *ends = restarts_ends(g, st);
+    int64_t nc = 0;
+    int r;
+
+    // the incremental seed order is looked up by root graph, and verbose
+    // output should come out in order
+    if (threads < 2 || n_comps < 2 || Verbose || st->Incremental) {
+	mincross_state_t comp_st = *st;
+	for (size_t c = 0; c < n_comps; c++) {
+	    init_mccomp(g, c, kept);
+	    comp_st.RestartsEnd = ends[c];
+	    nc += mincross(g, 0, scratch, &comp_st);
+	}
+	for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+	    rank_t *rank = &GD_rank(g)[r];
+	    keep_flat(rank, (int)(rank->v - rank->av), rank->an, &kept[r]);
+	}
+    } else {
+	const size_t batch = MIN(n_comps, 4 * (size_t)threads);
+	mccomp_t *comps = gv_calloc(batch, sizeof(mccomp_t));
+	int *used = gv_calloc((size_t)GD_maxrank(g) + 2, sizeof(int));
+	for (size_t i = 0; i < batch; i++)
+	    comps[i].rank = gv_calloc((size_t)GD_maxrank(g) + 2, sizeof(rank_t));
+	mccomp_job_t job = {.comps = comps, .st = st,
+	                    .list_size = (size_t)agnedges(g) + 1};
+
+	mccomp_t *last = NULL;
+	for (size_t first = 0; first < n_comps; first += batch) {
+	    const size_t n = MIN(batch, n_comps - first);
+	    for (size_t i = 0; i < n; i++) {
+		init_mccomp_copy(g, first + i, &comps[i], used);
+		comps[i].restarts_end = ends[first + i];
+	    }
+	    gv_parallel_for(n, 1, mincross_comps, &job);
+	    for (size_t i = 0; i < n; i++) {
+		nc += comps[i].nc;
+		if (GD_has_flat_edges(&comps[i].g))
+		    GD_has_flat_edges(g) = true;
+		for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+		    rank_t *rank = &comps[i].rank[r];
+		    assert(rank->n == rank->an);
+		    keep_flat(rank, (int)(rank->v - GD_rank(g)[r].av),
+		              GD_rank(g)[r].an, &kept[r]);
+		}
+	    }
+	    last = &comps[n - 1];
+	}
+
+	// the last component leaves its rank state behind, as in order
+	GD_nlist(g) = GD_nlist(&last->g);
+	for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+	    rank_t *rank = &GD_rank(g)[r];
+	    rank->v = last->rank[r].v;
+	    rank->n = last->rank[r].n;
+	    rank->candidate = last->rank[r].candidate;
+	    rank->valid = last->rank[r].valid;
+	    rank->cache_nc = last->rank[r].cache_nc;
 	}
+
+	for (size_t i = 0; i < batch; i++)
+	    free(comps[i].rank);
+	free(comps);
+	free(used);
     }
+
+    for (r = GD_minrank(g); r <= GD_maxrank(g); r++)
+	GD_rank(g)[r].flat = kept[r];
+    free(kept);
+    free(ends);
+    return nc;
 }
 
 static int betweenclust(edge_t * e)
@@ -437,11 +685,12 @@ static int betweenclust(edge_t * e)
     return (ND_clust(agtail(e)) != ND_clust(aghead(e)));
 }
 
-static void do_ordering_node(graph_t *g, node_t *n, bool outflag) {
+static void do_ordering_node(graph_t *g, node_t *n, bool outflag,
+                             const mincross_state_t *st) {
     int i, ne;
     node_t *u, *v;
     edge_t *e, *f, *fe;
-    edge_t **sortlist = TE_list;
+    edge_t **sortlist = st->TE_list;
 
     if (ND_clust(n))
 	return;
@@ -477,16 +726,16 @@ static void do_ordering_node(graph_t *g, node_t *n, bool outflag) {
     }
 }
 
-static void do_ordering(graph_t *g, bool outflag) {
+static void do_ordering(graph_t *g, bool outflag, const mincross_state_t *st) {
     /* Order all nodes in graph */
     node_t *n;
 
     for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
-	do_ordering_node (g, n, outflag);
+	do_ordering_node (g, n, outflag, st);
     }
 }
 
-static void do_ordering_for_nodes(graph_t * g)
+static void do_ordering_for_nodes(graph_t *g, const mincross_state_t *st)
 {
     /* Order nodes which have the "ordered" attribute */
     node_t *n;
@@ -495,9 +744,9 @@ static void do_ordering_for_nodes(graph_t * g)
     for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
 	if ((ordering = late_string(n, N_ordering, NULL))) {
 	    if (streq(ordering, "out"))
-		do_ordering_node(g, n, true);
+		do_ordering_node(g, n, true, st);
 	    else if (streq(ordering, "in"))
-		do_ordering_node(g, n, false);
+		do_ordering_node(g, n, false, st);
 	    else if (ordering[0])
 		agerrorf("ordering '%s' not recognized for node '%s'.\n", ordering, agnameof(n));
 	}
@@ -511,7 +760,7 @@ static void do_ordering_for_nodes(graph_t * g)
  * Note that, in this implementation, the value of G_ordering
  * dominates the value of N_ordering.
  */
-static void ordered_edges(graph_t * g)
+static void ordered_edges(graph_t *g, const mincross_state_t *st)
 {
     char *ordering;
 
@@ -519,9 +768,9 @@ static void ordered_edges(graph_t * g)
 	return;
     if ((ordering = late_string(g, G_ordering, NULL))) {
 	if (streq(ordering, "out"))
-	    do_ordering(g, true);
+	    do_ordering(g, true, st);
 	else if (streq(ordering, "in"))
-	    do_ordering(g, false);
+	    do_ordering(g, false, st);
 	else if (ordering[0])
 	    agerrorf("ordering '%s' not recognized.\n", ordering);
     }
@@ -532,33 +781,34 @@ static void ordered_edges(graph_t * g)
 	for (subg = agfstsubg(g); subg; subg = agnxtsubg(subg)) {
 	    /* clusters are processed by separate calls to ordered_edges */
 	    if (!is_cluster(subg))
-		ordered_edges(subg);
+		ordered_edges(subg, st);
 	}
-	if (N_ordering) do_ordering_for_nodes (g);
+	if (N_ordering) do_ordering_for_nodes (g, st);
     }
 }
 
-static int64_t mincross_clust(graph_t *g, ints_t *scratch) {
+static int64_t mincross_clust(graph_t *g, ints_t *scratch,
+                              const mincross_state_t *st) {
     int c;
 
     expand_cluster(g);
-    ordered_edges(g);
+    ordered_edges(g, st);
     flat_breakcycles(g);
     flat_reorder(g);
-    int64_t nc = mincross(g, 2, scratch);
+    int64_t nc = mincross(g, 2, scratch, st);
 
     for (c = 1; c <= GD_n_cluster(g); c++)
-	nc += mincross_clust(GD_clust(g)[c], scratch);
+	nc += mincross_clust(GD_clust(g)[c], scratch, st);
 
     save_vlist(g);
     return nc;
 }
 
-static bool left2right(graph_t *g, node_t *v, node_t *w) {
+static bool left2right(graph_t *g, node_t *v, node_t *w, bool remincross) {
     adjmatrix_t *M;
 
     /* CLUSTER indicates orig nodes of clusters, and vnodes of skeletons */
-    if (!ReMincross) {
+    if (!remincross) {
 	if (ND_clust(v) != ND_clust(w) && ND_clust(v) && ND_clust(w)) {
 	    /* the following allows cluster skeletons to be swapped */
 	    if (ND_ranktype(v) == CLUSTER && ND_node_type(v) == VIRTUAL)
@@ -580,45 +830,48 @@ static bool left2right(graph_t *g, node_t *v, node_t *w) {
     return ELT(M, flatindex(v), flatindex(w)) != 0;
 }
 
-static int64_t in_cross(node_t *v, node_t *w) {
-    edge_t **e1, **e2;
-    int inv, t;
+static int64_t in_cross(const fast_csr_t *fg, node_t *v, node_t *w) {
+    const fast_csr_edges_t *in = &fg->in_edges;
+    const int vi = FAST_CSR_ID(v), wi = FAST_CSR_ID(w);
+    int e1, e2, inv, t;
     int64_t cross = 0;
 
-    for (e2 = ND_in(w).list; *e2; e2++) {
-	int cnt = ED_xpenalty(*e2);		
-		
-	inv = ND_order(agtail(*e2));
+    for (e2 = fg->in[wi]; e2 < fg->in[wi + 1]; e2++) {
+	int cnt = in->xpenalty[e2];
+
+	inv = fg->order[in->node[e2]];
 
-	for (e1 = ND_in(v).list; *e1; e1++) {
-	    t = ND_order(agtail(*e1)) - inv;
-	    if (t > 0 || (t == 0 && ED_tail_port(*e1).p.x > ED_tail_port(*e2).p.x))
-		cross += ED_xpenalty(*e1) * cnt;
+	for (e1 = fg->in[vi]; e1 < fg->in[vi + 1]; e1++) {
+	    t = fg->order[in->node[e1]] - inv;
+	    if (t > 0 || (t == 0 && in->tail_x[e1] > in->tail_x[e2]))
+		cross += in->xpenalty[e1] * cnt;
 	}
     }
     return cross;
 }
 
-static int out_cross(node_t * v, node_t * w)
+static int out_cross(const fast_csr_t *fg, node_t *v, node_t *w)
 {
-    edge_t **e1, **e2;
-    int inv, cross = 0, t;
-
-    for (e2 = ND_out(w).list; *e2; e2++) {
-	int cnt = ED_xpenalty(*e2);
-	inv = ND_order(aghead(*e2));
-
-	for (e1 = ND_out(v).list; *e1; e1++) {
-	    t = ND_order(aghead(*e1)) - inv;
-	    if (t > 0 || (t == 0 && (ED_head_port(*e1)).p.x > (ED_head_port(*e2)).p.x))
-		cross += ED_xpenalty(*e1) * cnt;
+    const fast_csr_edges_t *out = &fg->out_edges;
+    const int vi = FAST_CSR_ID(v), wi = FAST_CSR_ID(w);
+    int e1, e2, inv, cross = 0, t;
+
+    for (e2 = fg->out[wi]; e2 < fg->out[wi + 1]; e2++) {
+	int cnt = out->xpenalty[e2];
+	inv = fg->order[out->node[e2]];
+
+	for (e1 = fg->out[vi]; e1 < fg->out[vi + 1]; e1++) {
+	    t = fg->order[out->node[e1]] - inv;
+	    if (t > 0 || (t == 0 && out->head_x[e1] > out->head_x[e2]))
+		cross += out->xpenalty[e1] * cnt;
 	}
     }
     return cross;
 
 }
 
-static void exchange(node_t * v, node_t * w)
+/* swap v and w in their rank, and in fg if not NULL */
+static void exchange(graph_t *root, fast_csr_t *fg, node_t *v, node_t *w)
 {
     int vi, wi, r;
 
@@ -626,14 +879,20 @@ static void exchange(node_t * v, node_t * w)
     vi = ND_order(v);
     wi = ND_order(w);
     ND_order(v) = wi;
-    GD_rank(Root)[r].v[wi] = v;
+    GD_rank(root)[r].v[wi] = v;
     ND_order(w) = vi;
-    GD_rank(Root)[r].v[vi] = w;
+    GD_rank(root)[r].v[vi] = w;
+    if (fg) {
+	fg->order[FAST_CSR_ID(v)] = wi;
+	fg->order[FAST_CSR_ID(w)] = vi;
+    }
 }
 
-static int64_t transpose_step(graph_t *g, int r, bool reverse) {
+static int64_t transpose_step(graph_t *g, fast_csr_t *fg, int r, bool reverse,
+                              bool remincross) {
     int i;
     node_t *v, *w;
+    graph_t *root = dot_root(g);
 
     int64_t rv = 0;
     GD_rank(g)[r].candidate = false;
@@ -641,30 +900,30 @@ static int64_t transpose_step(graph_t *g, int r, bool reverse) {
 	v = GD_rank(g)[r].v[i];
 	w = GD_rank(g)[r].v[i + 1];
 	assert(ND_order(v) < ND_order(w));
-	if (left2right(g, v, w))
+	if (left2right(g, v, w, remincross))
 	    continue;
 	int64_t c0 = 0;
 	int64_t c1 = 0;
 	if (r > 0) {
-	    c0 += in_cross(v, w);
-	    c1 += in_cross(w, v);
+	    c0 += in_cross(fg, v, w);
+	    c1 += in_cross(fg, w, v);
 	}
 	if (GD_rank(g)[r + 1].n > 0) {
-	    c0 += out_cross(v, w);
-	    c1 += out_cross(w, v);
+	    c0 += out_cross(fg, v, w);
+	    c1 += out_cross(fg, w, v);
 	}
 	if (c1 < c0 || (c0 > 0 && reverse && c1 == c0)) {
-	    exchange(v, w);
+	    exchange(root, fg, v, w);
 	    rv += c0 - c1;
-	    GD_rank(Root)[r].valid = false;
+	    GD_rank(root)[r].valid = false;
 	    GD_rank(g)[r].candidate = true;
 
 	    if (r > GD_minrank(g)) {
-		GD_rank(Root)[r - 1].valid = false;
+		GD_rank(root)[r - 1].valid = false;
 		GD_rank(g)[r - 1].candidate = true;
 	    }
 	    if (r < GD_maxrank(g)) {
-		GD_rank(Root)[r + 1].valid = false;
+		GD_rank(root)[r + 1].valid = false;
 		GD_rank(g)[r + 1].candidate = true;
 	    }
 	}
@@ -672,7 +931,8 @@ static int64_t transpose_step(graph_t *g, int r, bool reverse) {
     return rv;
 }
 
-static void transpose(graph_t * g, bool reverse)
+static void transpose(graph_t *g, fast_csr_t *fg, bool reverse,
+                      bool remincross)
 {
     int r;
 
@@ -683,39 +943,47 @@ static void transpose(graph_t * g, bool reverse)
 	delta = 0;
 	for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
 	    if (GD_rank(g)[r].candidate) {
-		delta += transpose_step(g, r, reverse);
+		delta += transpose_step(g, fg, r, reverse, remincross);
 	    }
 	}
     } while (delta >= 1);
 }
 
-static int64_t mincross(graph_t *g, int startpass, ints_t *scratch) {
+static int64_t mincross(graph_t *g, int startpass, ints_t *scratch,
+                        const mincross_state_t *st) {
     const int endpass = 2;
     int maxthispass = 0, iter, trying, pass;
     int64_t cur_cross, best_cross;
+    fast_csr_t fg = {0};
 
     if (startpass > 1) {
-	cur_cross = best_cross = ncross(scratch);
+	fast_csr_build(&fg, g);
+	cur_cross = best_cross = ncross(g, &fg, st->Threads, scratch);
 	save_best(g);
     } else
 	cur_cross = best_cross = INT64_MAX;
     for (pass = startpass; pass <= endpass; pass++) {
+	if (pass == 1 && st->Incremental)
+	    continue; // keep the ordering seeded from the previous layout
 	if (pass <= 1) {
-	    maxthispass = MIN(4, MaxIter);
+	    maxthispass = MIN(4, st->MaxIter);
 	    if (g == dot_root(g))
-		build_ranks(g, pass, scratch);
+		build_ranks_seeded(g, pass, 0, st->Threads, scratch);
 	    if (pass == 0)
 		flat_breakcycles(g);
 	    flat_reorder(g);
+	    fast_csr_build(&fg, g);
 
-	    if ((cur_cross = ncross(scratch)) <= best_cross) {
+	    if ((cur_cross = ncross(g, &fg, st->Threads, scratch)) <= best_cross) {
 		save_best(g);
 		best_cross = cur_cross;
 	    }
 	} else {
-	    maxthispass = MaxIter;
-	    if (cur_cross > best_cross)
-		restore_best(g);
+	    maxthispass = st->MaxIter;
+	    if (fg.n == 0)
+		fast_csr_build(&fg, g);
+	    if (cur_cross > best_cross || st->Incremental)
+		restore_best(g, &fg);
 	    cur_cross = best_cross;
 	}
 	trying = 0;
@@ -725,12 +993,14 @@ static int64_t mincross(graph_t *g, int startpass, ints_t *scratch) {
 			"mincross: pass %d iter %d trying %d cur_cross %" PRId64 " best_cross %"
 			PRId64 "\n",
 			pass, iter, trying, cur_cross, best_cross);
-	    if (trying++ >= MinQuit)
+	    if (trying++ >= st->MinQuit)
 		break;
-	    if (cur_cross == 0)
+	    if (cur_cross == 0 || out_of_time(st))
 		break;
-	    mincross_step(g, iter);
-	    if ((cur_cross = ncross(scratch)) <= best_cross) {
+	    mincross_step(g, &fg, iter, st);
+	    cur_cross = ncross(g, &fg, st->Threads, scratch);
+	    if (cur_cross < best_cross ||
+	        (cur_cross == best_cross && !st->Incremental)) {
 		save_best(g);
 		if (cur_cross < Convergence * (double)best_cross)
 		    trying = 0;
@@ -740,17 +1010,21 @@ static int64_t mincross(graph_t *g, int startpass, ints_t *scratch) {
 	if (cur_cross == 0)
 	    break;
     }
-    if (cur_cross > best_cross)
-	restore_best(g);
+    /* an incremental run only keeps an ordering that crosses less */
+    if (cur_cross > best_cross || st->Incremental)
+	restore_best(g, &fg);
+    if (startpass == 0 && st->Deadline > 0 && !st->Incremental)
+	best_cross = mincross_restarts(g, &fg, best_cross, scratch, st);
     if (best_cross > 0) {
-	transpose(g, false);
-	best_cross = ncross(scratch);
+	transpose(g, &fg, false, st->ReMincross);
+	best_cross = ncross(g, &fg, st->Threads, scratch);
     }
+    fast_csr_free(&fg);
 
     return best_cross;
 }
 
-static void restore_best(graph_t * g)
+static void restore_best(graph_t *g, fast_csr_t *fg)
 {
     node_t *n;
     int i, r;
@@ -762,10 +1036,11 @@ static void restore_best(graph_t * g)
 	}
     }
     for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
-	GD_rank(Root)[r].valid = false;
+	GD_rank(dot_root(g))[r].valid = false;
 	qsort(GD_rank(g)[r].v, GD_rank(g)[r].n, sizeof(GD_rank(g)[0].v[0]),
 	      nodeposcmpf);
     }
+    fast_csr_sync_order(fg, g);
 }
 
 static void save_best(graph_t * g)
@@ -780,8 +1055,84 @@ static void save_best(graph_t * g)
     }
 }
 
+/* copy the ranks of g into order, or back from it when restore is set */
+static void copy_ranks(graph_t *g, node_t **order, bool restore) {
+    for (int r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+	rank_t *rank = &GD_rank(g)[r];
+	if (restore) {
+	    memcpy(rank->v, order, (size_t)rank->n * sizeof(node_t *));
+	    for (int i = 0; i < rank->n; i++)
+		ND_order(rank->v[i]) = i;
+	    GD_rank(dot_root(g))[r].valid = false;
+	} else
+	    memcpy(order, rank->v, (size_t)rank->n * sizeof(node_t *));
+	order += rank->n;
+    }
+}
+
+/* spend what is left of the mclimit_ms budget on further starts
+ *
+ * Each start builds the ranks of the component g again, searching from its
+ * sources in a random order and alternately along out- and in-edges, and
+ * refines that ordering as pass 2 refines the better of passes 0 and 1. The
+ * best ordering of all starts is kept aside and left in the ranks of g.
+ * Starts run one after another because an ordering lives in the node
+ * records; several threads help by ordering separate components.
+ */
+static int64_t mincross_restarts(graph_t *g, fast_csr_t *fg, int64_t best_cross,
+                                 ints_t *scratch, const mincross_state_t *st) {
+    size_t total = 0;
+    uint64_t start;
+
+    for (int r = GD_minrank(g); r <= GD_maxrank(g); r++)
+	total += (size_t)GD_rank(g)[r].n;
+    node_t **best = gv_calloc(total, sizeof(node_t *));
+    copy_ranks(g, best, false);
+
+    for (start = 1; best_cross > 0 && mc_clock() < st->RestartsEnd; start++) {
+	// let build_ranks install the clusters again, whatever the last pass
+	for (node_t *v = GD_nlist(g); v; v = ND_next(v))
+	    if (ND_ranktype(v) == CLUSTER)
+		GD_installed(ND_clust(v)) = 0;
+	build_ranks_seeded(g, (int)(start % 2), start, st->Threads,
+	                   scratch);
+	flat_reorder(g);
+	fast_csr_build(fg, g);
+	int64_t cur_cross = ncross(g, fg, st->Threads, scratch);
+	int64_t start_cross = cur_cross;
+	save_best(g);
+	int trying = 0;
+	for (int iter = 0; iter < st->MaxIter; iter++) {
+	    if (trying++ >= st->MinQuit || cur_cross == 0 || out_of_time(st))
+		break;
+	    mincross_step(g, fg, iter, st);
+	    cur_cross = ncross(g, fg, st->Threads, scratch);
+	    if (cur_cross <= start_cross) {
+		save_best(g);
+		if (cur_cross < Convergence * (double)start_cross)
+		    trying = 0;
+		start_cross = cur_cross;
+	    }
+	}
+	if (start_cross < best_cross) {
+	    if (cur_cross > start_cross)
+		restore_best(g, fg);
+	    copy_ranks(g, best, false);
+	    best_cross = start_cross;
+	}
+    }
+    if (Verbose && start > 1)
+	fprintf(stderr, "mincross: %" PRIu64 " restarts, best_cross %" PRId64 "\n",
+	        start - 1, best_cross);
+
+    copy_ranks(g, best, true);
+    fast_csr_sync_order(fg, g);
+    free(best);
+    return best_cross;
+}
+
 /* merges the connected components of g */
-static void merge_components(graph_t * g)
+static void merge_components(graph_t *g, const mincross_state_t *st)
 {
     node_t *u, *v;
 
@@ -800,18 +1151,18 @@ static void merge_components(graph_t * g)
     }
     GD_comp(g).size = 1;
     GD_nlist(g) = GD_comp(g).list[0];
-    GD_minrank(g) = GlobalMinRank;
-    GD_maxrank(g) = GlobalMaxRank;
+    GD_minrank(g) = st->GlobalMinRank;
+    GD_maxrank(g) = st->GlobalMaxRank;
 }
 
 /* merge connected components, create globally consistent rank lists */
-static void merge2(graph_t * g)
+static void merge2(graph_t *g, const mincross_state_t *st)
 {
     int i, r;
     node_t *v;
 
     /* merge the components and rank limits */
-    merge_components(g);
+    merge_components(g, st);
 
     /* install complete ranks */
     for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
@@ -832,19 +1183,15 @@ static void merge2(graph_t * g)
     }
 }
 
-static void cleanup2(graph_t *g, int64_t nc) {
+static void cleanup2(graph_t *g, int64_t nc, mincross_state_t *st) {
     int i, j, r, c;
     node_t *v;
     edge_t *e;
 
-    if (TI_list) {
-	free(TI_list);
-	TI_list = NULL;
-    }
-    if (TE_list) {
-	free(TE_list);
-	TE_list = NULL;
-    }
+    free(st->TI_list);
+    st->TI_list = NULL;
+    free(st->TE_list);
+    st->TE_list = NULL;
     /* fix vlists of clusters */
     for (c = 1; c <= GD_n_cluster(g); c++)
 	rec_reset_vlists(GD_clust(g)[c]);
@@ -877,17 +1224,34 @@ static node_t *neighbor(node_t * v, int dir)
 
     rv = NULL;
 assert(v);
+    graph_t *root = dot_root(v);
     if (dir < 0) {
 	if (ND_order(v) > 0)
-	    rv = GD_rank(Root)[ND_rank(v)].v[ND_order(v) - 1];
+	    rv = GD_rank(root)[ND_rank(v)].v[ND_order(v) - 1];
     } else
-	rv = GD_rank(Root)[ND_rank(v)].v[ND_order(v) + 1];
+	rv = GD_rank(root)[ND_rank(v)].v[ND_order(v) + 1];
 assert((rv == 0) || (ND_order(rv)-ND_order(v))*dir > 0);
     return rv;
 }
 
+/* agcontains for the nodes and edges of the fast graph
+ *
+ * A root contains exactly the nodes and edges that are not virtual. Answering
+ * that without a lookup also covers the stand-ins of mincross_components, and
+ * keeps concurrent orderings away from cgraph's dictionaries, which lookups
+ * reorganize.
+ */
+static bool fast_contains(graph_t *g, void *obj) {
+    if (g == dot_root(g)) {
+	if (AGTYPE(obj) == AGNODE)
+	    return ND_node_type((node_t *)obj) == NORMAL;
+	return ED_edge_type((edge_t *)obj) == NORMAL;
+    }
+    return agcontains(g, obj);
+}
+
 static bool is_a_normal_node_of(graph_t *g, node_t *v) {
-    return ND_node_type(v) == NORMAL && agcontains(g, v);
+    return ND_node_type(v) == NORMAL && fast_contains(g, v);
 }
 
 static bool is_a_vnode_of_an_edge_of(graph_t *g, node_t *v) {
@@ -896,7 +1260,7 @@ static bool is_a_vnode_of_an_edge_of(graph_t *g, node_t *v) {
 	edge_t *e = ND_out(v).list[0];
 	while (ED_edge_type(e) != NORMAL)
 	    e = ED_to_orig(e);
-	if (agcontains(g, e))
+	if (fast_contains(g, e))
 	    return true;
     }
     return false;
@@ -1026,28 +1390,28 @@ fillRanks (Agraph_t* g)
     free (rnks);
 }
 
-static void init_mincross(graph_t * g)
+static void init_mincross(graph_t *g, mincross_state_t *st)
 {
     int size;
 
     if (Verbose)
 	start_timer();
 
-    ReMincross = false;
-    Root = g;
+    assert(dot_root(g) == g);
+    st->ReMincross = false;
     /* alloc +1 for the null terminator usage in do_ordering() */
     size = agnedges(dot_root(g)) + 1;
-    TE_list = gv_calloc(size, sizeof(edge_t*));
-    TI_list = gv_calloc(size, sizeof(int));
-    mincross_options(g);
+    st->TE_list = gv_calloc(size, sizeof(edge_t*));
+    st->TI_list = gv_calloc(size, sizeof(int));
+    mincross_options(g, st);
     if (GD_flags(g) & NEW_RANK)
 	fillRanks (g);
     class2(g);
     decompose(g, 1);
     allocate_ranks(g);
-    ordered_edges(g);
-    GlobalMinRank = GD_minrank(g);
-    GlobalMaxRank = GD_maxrank(g);
+    ordered_edges(g, st);
+    st->GlobalMinRank = GD_minrank(g);
+    st->GlobalMaxRank = GD_maxrank(g);
 }
 
 static void flat_rev(Agraph_t * g, Agedge_t * e)
@@ -1089,7 +1453,8 @@ static void flat_search(graph_t * g, node_t * v)
     hascl = GD_n_cluster(dot_root(g)) > 0;
     if (ND_flat_out(v).list)
 	for (i = 0; (e = ND_flat_out(v).list[i]); i++) {
-	    if (hascl && !(agcontains(g, agtail(e)) && agcontains(g, aghead(e))))
+	    if (hascl && !(fast_contains(g, agtail(e)) &&
+	                   fast_contains(g, aghead(e))))
 		continue;
 	    if (ED_weight(e) == 0)
 		continue;
@@ -1199,9 +1564,10 @@ void install_in_rank(graph_t * g, node_t * n)
 	assert(v != NULL);
     }
 #endif
-    if (ND_order(n) > GD_rank(Root)[r].an) {
+    graph_t *root = dot_root(g);
+    if (ND_order(n) > GD_rank(root)[r].an) {
 	agerrorf("install_in_rank, line %d: ND_order(%s) [%d] > GD_rank(Root)[%d].an [%d]\n",
-	      __LINE__, agnameof(n), ND_order(n), r, GD_rank(Root)[r].an);
+	      __LINE__, agnameof(n), ND_order(n), r, GD_rank(root)[r].an);
 	return;
     }
     if (r < GD_minrank(g) || r > GD_maxrank(g)) {
@@ -1210,22 +1576,66 @@ void install_in_rank(graph_t * g, node_t * n)
 	return;
     }
     if (GD_rank(g)[r].v + ND_order(n) >
-	GD_rank(g)[r].av + GD_rank(Root)[r].an) {
+	GD_rank(g)[r].av + GD_rank(root)[r].an) {
 	agerrorf("install_in_rank, line %d: GD_rank(g)[%d].v + ND_order(%s) [%d] > GD_rank(g)[%d].av + GD_rank(Root)[%d].an [%d]\n",
-	      __LINE__, r, agnameof(n),ND_order(n), r, r, GD_rank(Root)[r].an);
+	      __LINE__, r, agnameof(n),ND_order(n), r, r, GD_rank(root)[r].an);
 	return;
     }
 }
 
-/*	install nodes in ranks. the initial ordering ensure that series-parallel
- *	graphs such as trees are drawn with no crossings.  it tries searching
- *	in- and out-edges and takes the better of the two initial orderings.
+DEFINE_LIST(nodes, node_t *)
+
+/// next number from a splitmix64 stream
+///
+/// Restarts draw from a stream of their own rather than from `rand`, which is
+/// shared between threads and whose sequence other layouts depend on.
+static uint64_t mc_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static void shuffle_nodes(nodes_t *list, uint64_t *state) {
+    for (size_t i = nodes_size(list); i > 1; i--) {
+	const size_t j = (size_t)(mc_random(state) % i);
+	node_t *const tmp = nodes_get(list, i - 1);
+	nodes_set(list, i - 1, nodes_get(list, j));
+	nodes_set(list, j, tmp);
+    }
+}
+
+/* as enqueue_neighbors, in a random order */
+static void enqueue_shuffled(node_queue_t *q, node_t *n0, int pass,
+                             nodes_t *tmp, uint64_t *state) {
+    const elist *edges = pass == 0 ? &ND_out(n0) : &ND_in(n0);
+
+    nodes_clear(tmp);
+    for (size_t i = 0; i < edges->size; i++) {
+	edge_t *e = edges->list[i];
+	node_t *other = pass == 0 ? aghead(e) : agtail(e);
+	if (!MARK(other)) {
+	    MARK(other) = true;
+	    nodes_append(tmp, other);
+	}
+    }
+    shuffle_nodes(tmp, state);
+    for (size_t i = 0; i < nodes_size(tmp); i++)
+	node_queue_push_back(q, nodes_get(tmp, i));
+}
+
+/* build_ranks, visiting the sources and the neighbors of each node in an
+ * order shuffled by seed, unless seed is 0, and counting crossings on up to
+ * threads threads
  */
-void build_ranks(graph_t *g, int pass, ints_t *scratch) {
+static void build_ranks_seeded(graph_t *g, int pass, uint64_t seed,
+                               int threads, ints_t *scratch) {
     int i, j;
     node_t *n, *ns;
     edge_t **otheredges;
     node_queue_t q = {0};
+    nodes_t starts = {0};
+    nodes_t shuffled = {0};
     for (n = GD_nlist(g); n; n = ND_next(n))
 	MARK(n) = false;
 
@@ -1256,8 +1666,13 @@ void build_ranks(graph_t *g, int pass, ints_t *scratch) {
     }
     for (n = ns; n; n = walkbackwards ? ND_prev(n) : ND_next(n)) {
 	otheredges = pass == 0 ? ND_in(n).list : ND_out(n).list;
-	if (otheredges[0] != NULL)
-	    continue;
+	if (otheredges[0] == NULL)
+	    nodes_append(&starts, n);
+    }
+    if (seed != 0)
+	shuffle_nodes(&starts, &seed);
+    for (size_t k = 0; k < nodes_size(&starts); k++) {
+	n = nodes_get(&starts, k);
 	if (!MARK(n)) {
 	    MARK(n) = true;
 	    node_queue_push_back(&q, n);
@@ -1265,7 +1680,10 @@ void build_ranks(graph_t *g, int pass, ints_t *scratch) {
 		node_t *n0 = node_queue_pop_front(&q);
 		if (ND_ranktype(n0) != CLUSTER) {
 		    install_in_rank(g, n0);
-		    enqueue_neighbors(&q, n0, pass);
+		    if (seed != 0)
+			enqueue_shuffled(&q, n0, pass, &shuffled, &seed);
+		    else
+			enqueue_neighbors(&q, n0, pass);
 		} else {
 		    install_cluster(g, n0, pass, &q);
 		}
@@ -1273,20 +1691,38 @@ void build_ranks(graph_t *g, int pass, ints_t *scratch) {
 	}
     }
     assert(node_queue_is_empty(&q));
+    graph_t *root = dot_root(g);
     for (i = GD_minrank(g); i <= GD_maxrank(g); i++) {
-	GD_rank(Root)[i].valid = false;
+	GD_rank(root)[i].valid = false;
 	if (GD_flip(g) && GD_rank(g)[i].n > 0) {
 	    node_t **vlist = GD_rank(g)[i].v;
 	    int num_nodes_1 = GD_rank(g)[i].n - 1;
 	    int half_num_nodes_1 = num_nodes_1 / 2;
 	    for (j = 0; j <= half_num_nodes_1; j++)
-		exchange(vlist[j], vlist[num_nodes_1 - j]);
+		exchange(root, NULL, vlist[j], vlist[num_nodes_1 - j]);
 	}
     }
+    dot_incremental_seed_order(g);
 
-    if (g == dot_root(g) && ncross(scratch) > 0)
-	transpose(g, false);
+    // the initial ordering is only built for the root before any remincross
+    if (g == root) {
+	fast_csr_t fg = {0};
+	fast_csr_build(&fg, g);
+	if (ncross(g, &fg, threads, scratch) > 0)
+	    transpose(g, &fg, false, false);
+	fast_csr_free(&fg);
+    }
     node_queue_free(&q);
+    nodes_free(&starts);
+    nodes_free(&shuffled);
+}
+
+/*	install nodes in ranks. the initial ordering ensure that series-parallel
+ *	graphs such as trees are drawn with no crossings.  it tries searching
+ *	in- and out-edges and takes the better of the two initial orderings.
+ */
+void build_ranks(graph_t *g, int pass, ints_t *scratch) {
+    build_ranks_seeded(g, pass, 0, get_threads(dot_root(g)), scratch);
 }
 
 void enqueue_neighbors(node_queue_t *q, node_t *n0, int pass) {
@@ -1321,8 +1757,6 @@ static bool constraining_flat_edge(Agraph_t *g, Agedge_t *e) {
   return true;
 }
 
-DEFINE_LIST(nodes, node_t *)
-
 /* construct nodes reachable from 'here' in post-order.
 * This is the same as doing a topological sort in reverse order.
 */
@@ -1408,14 +1842,16 @@ static void flat_reorder(graph_t * g)
 	    /* postprocess to restore intended order */
 	}
 	/* else do no harm! */
-	GD_rank(Root)[r].valid = false;
+	GD_rank(dot_root(g))[r].valid = false;
     }
     nodes_free(&temprank);
 }
 
-static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
+static void reorder(graph_t *g, fast_csr_t *fg, int r, bool reverse,
+                    bool hasfixed, bool remincross)
 {
     int changed = 0, nelt;
+    graph_t *root = dot_root(g);
     node_t **vlist = GD_rank(g)[r].v;
     node_t **lp, **rp, **ep = vlist + GD_rank(g)[r].n;
 
@@ -1433,7 +1869,7 @@ static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
 	    for (rp = lp + 1; rp < ep; rp++) {
 		if (sawclust && ND_clust(*rp))
 		    continue;	/* ### */
-		if (left2right(g, *lp, *rp)) {
+		if (left2right(g, *lp, *rp, remincross)) {
 		    muststay = true;
 		    break;
 		}
@@ -1448,7 +1884,7 @@ static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
 		const double p1 = ND_mval(*lp);
 		const double p2 = ND_mval(*rp);
 		if (p1 > p2 || (p1 >= p2 && reverse)) {
-		    exchange(*lp, *rp);
+		    exchange(root, fg, *lp, *rp);
 		    changed++;
 		}
 	    }
@@ -1459,122 +1895,183 @@ static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
     }
 
     if (changed) {
-	GD_rank(Root)[r].valid = false;
+	GD_rank(root)[r].valid = false;
 	if (r > 0)
-	    GD_rank(Root)[r - 1].valid = false;
+	    GD_rank(root)[r - 1].valid = false;
     }
 }
 
-static void mincross_step(graph_t * g, int pass)
+static void mincross_step(graph_t *g, fast_csr_t *fg, int pass,
+                          const mincross_state_t *st)
 {
     int r, other, first, last, dir;
+    graph_t *root = dot_root(g);
 
     bool reverse = pass % 4 < 2;
 
     if (pass % 2 == 0) {	/* down pass */
 	first = GD_minrank(g) + 1;
-	if (GD_minrank(g) > GD_minrank(Root))
+	if (GD_minrank(g) > GD_minrank(root))
 	    first--;
 	last = GD_maxrank(g);
 	dir = 1;
     } else {			/* up pass */
 	first = GD_maxrank(g) - 1;
 	last = GD_minrank(g);
-	if (GD_maxrank(g) < GD_maxrank(Root))
+	if (GD_maxrank(g) < GD_maxrank(root))
 	    first++;
 	dir = -1;
     }
 
     for (r = first; r != last + dir; r += dir) {
 	other = r - dir;
-	bool hasfixed = medians(g, r, other);
-	reorder(g, r, reverse, hasfixed);
+	bool hasfixed = medians(g, fg, r, other, st);
+	reorder(g, fg, r, reverse, hasfixed, st->ReMincross);
     }
-    transpose(g, !reverse);
+    transpose(g, fg, !reverse, st->ReMincross);
 }
 
-static int local_cross(elist l, int dir)
+/* crossings among the out-edges (dir > 0) or in-edges of node v due to ports */
+static int local_cross(const fast_csr_t *fg, int v, int dir)
 {
     int i, j;
     int cross = 0;
-    edge_t *e, *f;
     bool is_out = dir > 0;
-    for (i = 0; (e = l.list[i]); i++) {
+    const int *off = is_out ? fg->out : fg->in;
+    const fast_csr_edges_t *l = is_out ? &fg->out_edges : &fg->in_edges;
+    for (i = off[v]; i < off[v + 1]; i++) {
 	if (is_out)
-	    for (j = i + 1; (f = l.list[j]); j++) {
-		if ((ND_order(aghead(f)) - ND_order(aghead(e)))
-			 * (ED_tail_port(f).p.x - ED_tail_port(e).p.x) < 0)
-		    cross += ED_xpenalty(e) * ED_xpenalty(f);
+	    for (j = i + 1; j < off[v + 1]; j++) {
+		if ((fg->order[l->node[j]] - fg->order[l->node[i]])
+			 * (l->tail_x[j] - l->tail_x[i]) < 0)
+		    cross += l->xpenalty[i] * l->xpenalty[j];
 	} else
-	    for (j = i + 1; (f = l.list[j]); j++) {
-		if ((ND_order(agtail(f)) - ND_order(agtail(e)))
-			* (ED_head_port(f).p.x - ED_head_port(e).p.x) < 0)
-		    cross += ED_xpenalty(e) * ED_xpenalty(f);
+	    for (j = i + 1; j < off[v + 1]; j++) {
+		if ((fg->order[l->node[j]] - fg->order[l->node[i]])
+			* (l->head_x[j] - l->head_x[i]) < 0)
+		    cross += l->xpenalty[i] * l->xpenalty[j];
 	    }
     }
     return cross;
 }
 
-static int64_t rcross(graph_t *g, int r, ints_t *Count) {
-    int top, bot, max, i, k;
-    node_t **rtop, *v;
+/* crossings between ranks r and r + 1
+ *
+ * Edges are visited in order of their tails. Each is crossed by the edges seen
+ * before it from other tails whose heads lie further right, so the head
+ * positions of the edges seen so far are kept as sums of xpenalty in an
+ * accumulator (Fenwick) tree, giving O(E log V) instead of O(E V).
+ */
+static int64_t rcross(graph_t *g, const fast_csr_t *fg, int r, ints_t *Count) {
+    int top, bot, i, k, v;
+    node_t **rtop;
+    const fast_csr_edges_t *out = &fg->out_edges;
 
     int64_t cross = 0;
-    max = 0;
+    int64_t total = 0;
     rtop = GD_rank(g)[r].v;
 
+    // size the tree for the widest head position on rank r + 1
+    int width = GD_rank(g)[r + 1].n;
+    for (top = 0; top < GD_rank(g)[r].n; top++) {
+	v = FAST_CSR_ID(rtop[top]);
+	for (i = fg->out[v]; i < fg->out[v + 1]; i++)
+	    width = imax(width, fg->order[out->node[i]] + 1);
+    }
+
     // discard any data from previous runs
     ints_clear(Count);
+    ints_resize(Count, (size_t)width + 1, 0);
+    int *tree = ints_at(Count, 0);
 
     for (top = 0; top < GD_rank(g)[r].n; top++) {
-	edge_t *e;
-	if (max > 0) {
-	    for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-		for (k = ND_order(aghead(e)) + 1; k <= max; k++)
-		    cross += ints_size(Count) <= (size_t)k
-		             ? 0
-		             : ints_get(Count, (size_t)k) * ED_xpenalty(e);
-	    }
+	v = FAST_CSR_ID(rtop[top]);
+	// edges of one tail cross each other only through ports (local_cross)
+	for (i = fg->out[v]; i < fg->out[v + 1]; i++) {
+	    int64_t left = 0;
+	    for (k = fg->order[out->node[i]] + 1; k > 0; k -= k & -k)
+		left += tree[k];
+	    cross += (total - left) * out->xpenalty[i];
 	}
-	for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-	    int inv = ND_order(aghead(e));
-	    if (inv > max)
-		max = inv;
-	    const size_t inv_z = (size_t)inv;
-	    if (ints_size(Count) <= inv_z) {
-		ints_resize(Count, inv_z + 1, 0);
-	    }
-	    ints_set(Count, inv_z, ints_get(Count, inv_z) + ED_xpenalty(e));
+	for (i = fg->out[v]; i < fg->out[v + 1]; i++) {
+	    for (k = fg->order[out->node[i]] + 1; k <= width; k += k & -k)
+		tree[k] += out->xpenalty[i];
+	    total += out->xpenalty[i];
 	}
     }
     for (top = 0; top < GD_rank(g)[r].n; top++) {
-	v = GD_rank(g)[r].v[top];
-	if (ND_has_port(v))
-	    cross += local_cross(ND_out(v), 1);
+	v = FAST_CSR_ID(GD_rank(g)[r].v[top]);
+	if (fg->has_port[v])
+	    cross += local_cross(fg, v, 1);
     }
     for (bot = 0; bot < GD_rank(g)[r + 1].n; bot++) {
-	v = GD_rank(g)[r + 1].v[bot];
-	if (ND_has_port(v))
-	    cross += local_cross(ND_in(v), -1);
+	v = FAST_CSR_ID(GD_rank(g)[r + 1].v[bot]);
+	if (fg->has_port[v])
+	    cross += local_cross(fg, v, -1);
     }
     return cross;
 }
 
-static int64_t ncross(ints_t *scratch) {
+/// out-edges between ranks at which `ncross` counts them on several threads
+enum { NCROSS_PARALLEL_EDGES = 20000 };
+
+/// ranks whose crossings `ncross` recounts on several threads
+typedef struct {
+    graph_t *g;
+    const fast_csr_t *fg;
+    const int *ranks;
+} ncross_t;
+
+static void ncross_ranks(void *context, size_t begin, size_t end) {
+    const ncross_t *job = context;
+    ints_t Count = {0};
+    for (size_t i = begin; i < end; i++) {
+	rank_t *rank = &GD_rank(job->g)[job->ranks[i]];
+	rank->cache_nc = rcross(job->g, job->fg, job->ranks[i], &Count);
+	rank->valid = true;
+    }
+    ints_free(&Count);
+}
+
+/* total crossings, recounting only ranks invalidated since the last call, on up
+ * to threads threads
+ */
+static int64_t ncross(graph_t *g, const fast_csr_t *fg, int threads,
+                      ints_t *scratch) {
     assert(scratch != NULL);
     int r;
 
-    graph_t *g = Root;
-    int64_t count = 0;
+    g = dot_root(g);
+    // the pairs of ranks are independent, so count stale ones in parallel
+    // when there is enough work to share
+    int *stale = gv_calloc((size_t)imax(GD_maxrank(g) - GD_minrank(g), 0),
+                           sizeof(int));
+    size_t n_stale = 0;
+    int edges = 0;
     for (r = GD_minrank(g); r < GD_maxrank(g); r++) {
 	if (GD_rank(g)[r].valid)
-	    count += GD_rank(g)[r].cache_nc;
-	else {
-	    const int64_t nc = GD_rank(g)[r].cache_nc = rcross(g, r, scratch);
-	    count += nc;
+	    continue;
+	stale[n_stale++] = r;
+	for (int i = 0; i < GD_rank(g)[r].n; i++) {
+	    const int v = FAST_CSR_ID(GD_rank(g)[r].v[i]);
+	    edges += fg->out[v + 1] - fg->out[v];
+	}
+    }
+    if (n_stale > 1 && edges >= NCROSS_PARALLEL_EDGES && threads > 1) {
+	ncross_t job = {.g = g, .fg = fg, .ranks = stale};
+	gv_parallel_for_threads(threads, n_stale, 1, ncross_ranks, &job);
+    } else {
+	for (size_t i = 0; i < n_stale; i++) {
+	    r = stale[i];
+	    GD_rank(g)[r].cache_nc = rcross(g, fg, r, scratch);
 	    GD_rank(g)[r].valid = true;
 	}
     }
+    free(stale);
+
+    int64_t count = 0;
+    for (r = GD_minrank(g); r < GD_maxrank(g); r++)
+	count += GD_rank(g)[r].cache_nc;
     return count;
 }
 
@@ -1630,29 +2127,28 @@ static bool flat_mval(node_t * n)
     return true;
 }
 
-#define VAL(node,port) (MC_SCALE * ND_order(node) + (port).order)
+#define VAL(order,port) (MC_SCALE * (order) + (port))
 
-static bool medians(graph_t * g, int r0, int r1)
+static bool medians(graph_t *g, const fast_csr_t *fg, int r0, int r1,
+                    const mincross_state_t *st)
 {
     int i, j0, lspan, rspan, *list;
     node_t *n, **v;
-    edge_t *e;
     bool hasfixed = false;
+    const bool down = r1 > r0;
+    const int *off = down ? fg->out : fg->in;
+    const fast_csr_edges_t *edges = down ? &fg->out_edges : &fg->in_edges;
 
-    list = TI_list;
+    list = st->TI_list;
     v = GD_rank(g)[r0].v;
     for (i = 0; i < GD_rank(g)[r0].n; i++) {
 	n = v[i];
+	const int id = FAST_CSR_ID(n);
 	size_t j = 0;
-	if (r1 > r0)
-	    for (j0 = 0; (e = ND_out(n).list[j0]); j0++) {
-		if (ED_xpenalty(e) > 0)
-		    list[j++] = VAL(aghead(e), ED_head_port(e));
-	} else
-	    for (j0 = 0; (e = ND_in(n).list[j0]); j0++) {
-		if (ED_xpenalty(e) > 0)
-		    list[j++] = VAL(agtail(e), ED_tail_port(e));
-	    }
+	for (j0 = off[id]; j0 < off[id + 1]; j0++) {
+	    if (edges->xpenalty[j0] > 0)
+		list[j++] = VAL(fg->order[edges->node[j0]], edges->port[j0]);
+	}
 	switch (j) {
 	case 0:
 	    ND_mval(n) = -1;
@@ -1745,7 +2241,7 @@ static int edgeidcmpf(const void *x, const void *y) {
 #define C_SS		2
 #define C_VV		4
 
-static int table[NTYPES][NTYPES] = {
+static const int table[NTYPES][NTYPES] = {
     /* ordinary */ {C_EE, C_EE, C_EE},
     /* singleton */ {C_EE, C_SS, C_VS},
     /* virtual */ {C_EE, C_VS, C_VV}
@@ -1802,11 +2298,11 @@ void check_rs(graph_t * g, int null_ok)
     }
 }
 
-void check_order(void)
+void check_order(graph_t *g)
 {
     int i, r;
     node_t *v;
-    graph_t *g = Root;
+    g = dot_root(g);
 
     for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
 	assert(GD_rank(g)[r].v[GD_rank(g)[r].n] == NULL);
@@ -1818,20 +2314,35 @@ void check_order(void)
 }
 #endif
 
-static void mincross_options(graph_t * g)
+static void mincross_options(graph_t *g, mincross_state_t *st)
 {
     char *p;
     double f;
 
     /* set default values */
-    MinQuit = 8;
-    MaxIter = 24;
+    st->MinQuit = 8;
+    st->MaxIter = 24;
 
     p = agget(g, "mclimit");
     if (p && (f = atof(p)) > 0.0) {
-	MinQuit = MAX(1, MinQuit * f);
-	MaxIter = MAX(1, MaxIter * f);
+	st->MinQuit = MAX(1, st->MinQuit * f);
+	st->MaxIter = MAX(1, st->MaxIter * f);
     }
+
+    /* starting from the previous ordering, only polish it */
+    st->Incremental = dot_incremental_active(g);
+    if (st->Incremental) {
+	st->MinQuit = MIN(st->MinQuit, 2);
+	st->MaxIter = MIN(st->MaxIter, 4);
+    }
+
+    /* a wall-clock budget caps the iterations and is spent on restarts */
+    p = agget(g, "mclimit_ms");
+    if (p && (f = atof(p)) > 0.0)
+	st->Deadline = mc_clock() + f / 1000.0;
+
+    /* threads to order components and count crossings on */
+    st->Threads = get_threads(g);
 }
 
 #ifdef DEBUG
@@ -1863,12 +2374,12 @@ void check_vlists(graph_t * g)
 	for (i = 0; i < GD_rank(g)[r].n; i++) {
 	    u = GD_rank(g)[r].v[i];
 	    j = ND_order(u);
-	    assert(GD_rank(Root)[r].v[j] == u);
+	    assert(GD_rank(dot_root(g))[r].v[j] == u);
 	}
 	if (GD_rankleader(g)) {
 	    u = GD_rankleader(g)[r];
 	    j = ND_order(u);
-	    assert(GD_rank(Root)[r].v[j] == u);
+	    assert(GD_rank(dot_root(g))[r].v[j] == u);
 	}
     }
     for (c = 1; c <= GD_n_cluster(g); c++)
@@ -1879,7 +2390,7 @@ void node_in_root_vlist(node_t * n)
 {
     node_t **vptr;
 
-    for (vptr = GD_rank(Root)[ND_rank(n)].v; *vptr; vptr++)
+    for (vptr = GD_rank(dot_root(n))[ND_rank(n)].v; *vptr; vptr++)
 	if (*vptr == n)
 	    break;
     if (*vptr == 0)
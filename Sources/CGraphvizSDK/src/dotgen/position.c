@@ -133,12 +133,14 @@ void dot_position(graph_t *g) {
     if (flat_edges(g))
 	set_ycoords(g);
     create_aux_edges(g);
+    dot_incremental_seed_coords(g);
     if (rank(g, 2, nsiter2(g))) { /* LR balance == 2 */
 	connectGraph (g);
 	const int rank_result = rank(g, 2, nsiter2(g));
 	assert(rank_result == 0);
 	(void)rank_result;
     }
+    dot_incremental_restore_coords(g);
     set_xcoords(g);
     set_aspect(g);
     remove_aux_edges(g);	/* must come after set_aspect since we now
@@ -379,7 +379,9 @@ void rank1(graph_t * g)
 	maxiter = scale_clamp(agnnodes(g), atof(s));
     for (size_t c = 0; c < GD_comp(g).size; c++) {
 	GD_nlist(g) = GD_comp(g).list[c];
+	dot_incremental_seed_ranks(g);
 	rank(g, (GD_n_cluster(g) == 0 ? 1 : 0), maxiter);	/* TB balance */
+	dot_incremental_restore_ranks(g);
     }
 }
 
@@ -655,7 +657,7 @@ static bool is_internal_to_cluster(edge_t * e)
     return false;
 }
 
-static node_t* Last_node;
+static _Thread_local node_t* Last_node;
 static node_t* makeXnode (graph_t* G, char* name)
 {
     node_t *n = agnode(G, name, 1);
@@ -711,7 +713,7 @@ static void weak(graph_t * g, node_t * t, node_t * h, edge_t * orig)
 {
     node_t *v;
     edge_t *e, *f;
-    static int id;
+    static _Thread_local int id;
     char buf[100];
 
     for (e = agfstin(g, t); e; e = agnxtin(g, e)) {
@@ -1033,7 +1035,7 @@ void dot2_rank(graph_t *g) {
 	ssize = atoi(s);
     else
 	ssize = -1;
-    rank2(Xg, 1, maxiter, ssize);
+    rank2(Xg, 1, maxiter, ssize, mapbool(agget(g, "nspriority")));
 /* fastgr(Xg); */
     readout_levels(g, Xg, ncc);
 #ifdef DEBUG
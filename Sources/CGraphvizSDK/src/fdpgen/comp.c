@@ -57,7 +57,7 @@ static void dfs(Agraph_t *g, Agnode_t *n, Agraph_t *out, bitarray_t *marks) {
  * Note that if ports and/or pinned nodes exists, they will all be
  * in the first component returned by findCComp.
  */
-static size_t C_cnt = 0;
+static _Thread_local size_t C_cnt = 0;
 graph_t **findCComp(graph_t *g, size_t *cnt, int *pinned) {
     node_t *n;
     graph_t *subg;
@@ -24,7 +24,7 @@
 #include <math.h>
 #include <util/exit.h>
 
-static int indent = -1;
+static _Thread_local int indent = -1;
 
 void incInd()
 {
@@ -288,7 +288,7 @@ static char *portName(graph_t * g, bport_t * p)
     edge_t *e = p->e;
     node_t *h = aghead(e);
     node_t *t = agtail(e);
-    static char buf[BSZ + 1];
+    static _Thread_local char buf[BSZ + 1];
 
 	snprintf(buf, sizeof(buf), "_port_%s_(%d)_(%d)_%u",agnameof(g),
 		ND_id(t), ND_id(h), AGSEQ(e));
@@ -473,7 +473,7 @@ static graph_t *deriveGraph(graph_t * g, layout_info * infop)
 	    hd = DNODE(aghead(e));
 	    if (hd == tl)
 		continue;
-	    if (hd > tl)
+	    if (AGSEQ(hd) > AGSEQ(tl))
 		de = agedge(dg, tl, hd, NULL,1);
 	    else
 		de = agedge(dg, hd, tl, NULL,1);
@@ -507,7 +507,7 @@ static graph_t *deriveGraph(graph_t * g, layout_info * infop)
 		dn = mkDeriveNode(dg, portName(g, pp));
 		sz++;
 		ND_id(dn) = id++;
-		if (dn > m)
+		if (AGSEQ(dn) > AGSEQ(m))
 		    de = agedge(dg, m, dn, NULL,1);
 		else
 		    de = agedge(dg, dn, m, NULL,1);
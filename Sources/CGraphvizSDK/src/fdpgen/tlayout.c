@@ -52,7 +52,6 @@
 #define D_unscaled  (fdp_parms->unscaled)
 #define D_C         (fdp_parms->C)
 #define D_Tfact     (fdp_parms->Tfact)
-#define D_K         (fdp_parms->K)
 #define D_T0        (fdp_parms->T0)
 
   /* Actual parameters used; initialized using fdp_parms, then possibly
@@ -77,7 +76,7 @@ typedef struct {
     int loopcnt;        /* actual iterations in this pass */
 } parms_t;
 
-static parms_t parms;
+static _Thread_local parms_t parms;
 
 #define T_useGrid   (parms.useGrid)
 #define T_useNew    (parms.useNew)
@@ -160,6 +159,14 @@ static int init_params(graph_t * g, xparams * xpms)
     return ret;
 }
 
+/* fdp_springK:
+ * Spring constant set by the last call to fdp_initParams on this thread.
+ */
+double fdp_springK(void)
+{
+    return T_K;
+}
+
 /* fdp_initParams:
  * Initialize parameters based on root graph attributes.
  */
@@ -173,7 +180,7 @@ void fdp_initParams(graph_t * g)
     T_C = D_C;
     T_Tfact = D_Tfact;
     T_maxIters = late_int(g, agattr(g,AGRAPH, "maxiter", NULL), DFLT_maxIters, 0);
-    D_K = T_K = late_double(g, agattr(g,AGRAPH, "K", NULL), DFLT_K, 0.0);
+    T_K = late_double(g, agattr(g,AGRAPH, "K", NULL), DFLT_K, 0.0);
     if (D_T0 == -1.0) {
 	T_T0 = late_double(g, agattr(g,AGRAPH, "T0", NULL), -1.0, 0.0);
     } else
@@ -31,14 +31,14 @@ Increase less between tries
 
 #define DFLT_overlap   "9:prism"    /* default overlap value */
 
-static xparams xParams = {
+static _Thread_local xparams xParams = {
     60,				/* numIters */
     0.0,			/* T0 */
     0.3,			/* K */
     1.5,			/* C */
     0				/* loopcnt */
 };
-static expand_t X_marg;
+static _Thread_local expand_t X_marg;
 
 static double WD2(Agnode_t *n) {
   return X_marg.doAdd ? (ND_width(n) / 2.0 + X_marg.x) : (ND_width(n) * X_marg.x / 2.0);
@@ -5,8 +5,13 @@
 //  Created by Татьяна Макеева on 26.03.2025.
 //
 
+#include <graphviz_wrapper.h>
 #include <gvc/gvc.h>
 #include <common/types.h>
+#include <dotgen/dotprocs.h>
+#include <stdint.h>
+#include <string.h>
+#include <util/parallel.h>
 
 extern gvplugin_library_t gvplugin_dot_layout_LTX_library;
 extern gvplugin_library_t gvplugin_neato_layout_LTX_library;
@@ -16,8 +21,6 @@ extern gvplugin_library_t gvplugin_core_LTX_library;
 //extern gvplugin_library_t gvplugin_lasi_LTX_library;
 //extern gvplugin_library_t gvplugin_pango_LTX_library;
 
-extern struct _dt_s * textfont_dict_open(GVC_t * gvc);
-
 lt_symlist_t lt_preloaded_symbols[] = {
     { "gvplugin_core_LTX_library", (void*)(&gvplugin_core_LTX_library) },
     { "gvplugin_dot_layout_LTX_library", (void*)(&gvplugin_dot_layout_LTX_library) },
@@ -231,3 +234,185 @@ char* gd_label_text(Agraph_t* g){
     }
     return 0;
 }
+
+
+//////////// HASHING
+
+/// Attributes that only change how a laid out graph is drawn, or how fast it
+/// is laid out, not where anything is placed, so editing them keeps the cached
+/// layout valid.
+static const char *const cosmetic_attributes[] = {
+    "bgcolor", "class", "color", "colorscheme", "comment", "fillcolor",
+    "fontcolor", "gradientangle", "href", "id", "labeltooltip", "pencolor",
+    "target", "threads", "tooltip", "URL", NULL,
+};
+
+static bool is_cosmetic(const char* name) {
+    for (size_t i = 0; cosmetic_attributes[i] != NULL; ++i) {
+        if (strcmp(cosmetic_attributes[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Two independent 64-bit streams: FNV-1a and a multiply-xorshift mix.
+static void hash_bytes(graph_hash_t* h, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        h->lo = (h->lo ^ bytes[i]) * UINT64_C(0x100000001b3);
+        h->hi = (h->hi + bytes[i] + 1) * UINT64_C(0x9e3779b97f4a7c15);
+        h->hi ^= h->hi >> 29;
+    }
+}
+
+/// Strings are length-prefixed so that adjacent strings cannot run together.
+static void hash_string(graph_hash_t* h, const char* s) {
+    const size_t size = s == NULL ? SIZE_MAX : strlen(s);
+    hash_bytes(h, &size, sizeof(size));
+    if (s != NULL) {
+        hash_bytes(h, s, size);
+    }
+}
+
+static void hash_attributes(graph_hash_t* h, Agraph_t* root, int kind, void* obj) {
+    for (Agsym_t* sym = agnxtattr(root, kind, NULL); sym != NULL; sym = agnxtattr(root, kind, sym)) {
+        const char* value = agxget(obj, sym);
+        // every gvLayout writes bb to the root, and no engine reads it back
+        if (value[0] == '\0' || is_cosmetic(sym->name) ||
+            (kind == AGRAPH && obj == root && strcmp(sym->name, "bb") == 0)) {
+            continue;
+        }
+        hash_string(h, sym->name);
+        hash_string(h, value);
+    }
+    hash_string(h, NULL);
+}
+
+static void hash_subgraphs(graph_hash_t* h, Agraph_t* root, Agraph_t* g) {
+    for (Agraph_t* subg = agfstsubg(g); subg != NULL; subg = agnxtsubg(subg)) {
+        hash_string(h, agnameof(subg));
+        hash_attributes(h, root, AGRAPH, subg);
+        for (Agnode_t* n = agfstnode(subg); n != NULL; n = agnxtnode(subg, n)) {
+            hash_string(h, agnameof(n));
+        }
+        hash_subgraphs(h, root, subg);
+        hash_string(h, NULL);
+    }
+}
+
+/// Hash of the graph kind, node names, edge ends and keys, the subgraph tree
+/// and all attributes that are not purely cosmetic, in the order the layout
+/// visits them.
+static graph_hash_t graph_content_hash(Agraph_t* g) {
+    graph_hash_t h = {
+        .lo = UINT64_C(0xcbf29ce484222325),
+        .hi = UINT64_C(0x6a09e667f3bcc909),
+    };
+    const int kind[] = {agisdirected(g), agisstrict(g)};
+    hash_bytes(&h, kind, sizeof(kind));
+    hash_attributes(&h, g, AGRAPH, g);
+    for (Agnode_t* n = agfstnode(g); n != NULL; n = agnxtnode(g, n)) {
+        hash_string(&h, agnameof(n));
+        hash_attributes(&h, g, AGNODE, n);
+    }
+    for (Agnode_t* n = agfstnode(g); n != NULL; n = agnxtnode(g, n)) {
+        for (Agedge_t* e = agfstout(g, n); e != NULL; e = agnxtout(g, e)) {
+            hash_string(&h, agnameof(agtail(e)));
+            hash_string(&h, agnameof(aghead(e)));
+            hash_string(&h, agnameof(e));
+            hash_attributes(&h, g, AGEDGE, e);
+        }
+    }
+    hash_subgraphs(&h, g, g);
+    return h;
+}
+
+/// Record on a root graph left by `attach_layout_attrs`: the content hash
+/// before the layout was written into the graph, and the hash right after.
+typedef struct {
+    Agrec_t header;
+    graph_hash_t input;
+    graph_hash_t output;
+} layout_output_t;
+
+static const char layout_output_name[] = "graph_layout_output";
+
+/// Content hash of `g` as it was before any layout was attached to it. pos,
+/// width, height and the label positions are inputs to some layouts as well
+/// as output of all of them, so they cannot simply be left out of the hash.
+/// Instead, a graph whose content is still exactly what the last
+/// `attach_layout_attrs` left hashes as the graph that was laid out.
+static graph_hash_t graph_input_hash(Agraph_t* g) {
+    const graph_hash_t h = graph_content_hash(g);
+    const layout_output_t* output = (layout_output_t*)aggetrec(g, layout_output_name, false);
+    if (output != NULL && output->output.lo == h.lo && output->output.hi == h.hi) {
+        return output->input;
+    }
+    return h;
+}
+
+/// Content hash of everything in `g` that a layout with `engine` depends on:
+/// the graph kind, node names, edge ends and keys, the subgraph tree and all
+/// attributes that are not purely cosmetic. Objects are visited in the order
+/// the layout sees them, so equal hashes mean the layouts come out the same.
+/// What a layout writes into the graph does not count, so laying a graph out
+/// again, or after `attach_layout_attrs`, gives the same hash.
+graph_hash_t graph_layout_hash(Agraph_t* g, const char* engine) {
+    graph_hash_t h = {
+        .lo = UINT64_C(0xcbf29ce484222325),
+        .hi = UINT64_C(0x6a09e667f3bcc909),
+    };
+    hash_string(&h, engine);
+    const graph_hash_t input = graph_input_hash(g);
+    hash_bytes(&h, &input, sizeof(input));
+    return h;
+}
+
+
+//////////// LAYOUT
+
+/// Lay out `g` with dot, starting from `previous` (the memo of an earlier
+/// layout of the same graph before an edit) when it is not NULL. On success
+/// `*memo` receives the memo of this layout, to be released with
+/// `dot_layout_memo_free`. With `memo` NULL nothing is captured, for layouts
+/// that no later layout will start from.
+int dot_layout_incremental(GVC_t* gvc, Agraph_t* g, const dot_layout_memo_t* previous, dot_layout_memo_t** memo) {
+    if (previous == NULL && memo == NULL) {
+        return gvLayout(gvc, g, "dot");
+    }
+    dot_incremental_begin(g, previous, memo != NULL);
+    const int rc = gvLayout(gvc, g, "dot");
+    dot_layout_memo_t* next = dot_incremental_end();
+    if (memo == NULL) {
+        return rc;
+    }
+    if (rc != 0) {
+        dot_layout_memo_free(next);
+        next = NULL;
+    }
+    *memo = next;
+    return rc;
+}
+
+
+/// `attach_attrs`, remembering the graph as it was before so that
+/// `graph_layout_hash` still recognizes it afterwards.
+void attach_layout_attrs(Agraph_t* g) {
+    const graph_hash_t input = graph_input_hash(g);
+    attach_attrs(g);
+    layout_output_t* output = (layout_output_t*)agbindrec(g, layout_output_name, sizeof(layout_output_t), false);
+    output->input = input;
+    output->output = graph_content_hash(g);
+}
+
+
+//////////// PARALLELISM
+
+int layout_threads(void) {
+    return gv_parallel_threads();
+}
+
+void set_layout_threads(int threads) {
+    gv_parallel_set_threads(threads);
+}
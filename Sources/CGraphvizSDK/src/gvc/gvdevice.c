@@ -40,10 +40,10 @@
 static const unsigned char z_file_header[] =
    {0x1f, 0x8b, /*magic*/ Z_DEFLATED, 0 /*flags*/, 0,0,0,0 /*time*/, 0 /*xflags*/, OS_CODE};
 
-static z_stream z_strm;
-static unsigned char *df;
-static unsigned int dfallocated;
-static uint64_t crc;
+static _Thread_local z_stream z_strm;
+static _Thread_local unsigned char *df;
+static _Thread_local unsigned int dfallocated;
+static _Thread_local uint64_t crc;
 #endif /* HAVE_LIBZ */
 
 #include <assert.h>
@@ -82,7 +82,7 @@ static size_t gvwrite_no_z(GVJ_t * job, const void *s, size_t len) {
 
 static void auto_output_filename(GVJ_t *job)
 {
-    static agxbuf buf;
+    static _Thread_local agxbuf buf;
     char *fn;
 
     if (!(fn = job->input_filename))
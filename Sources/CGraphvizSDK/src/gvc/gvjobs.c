@@ -19,8 +19,8 @@
 #include        <stddef.h>
 #include        <util/alloc.h>
 
-static GVJ_t *output_filename_job;
-static GVJ_t *output_langname_job;
+static _Thread_local GVJ_t *output_filename_job;
+static _Thread_local GVJ_t *output_langname_job;
 
 /*
  * -T and -o can be specified in any order relative to the other, e.g.
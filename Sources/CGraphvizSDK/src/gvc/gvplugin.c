@@ -361,7 +361,7 @@ char *gvplugin_list(GVC_t * gvc, api_t api, const char *str)
     const gvplugin_available_t *pnext, *plugin;
     char *bp;
     bool new = true;
-    static agxbuf xb;
+    static _Thread_local agxbuf xb;
 
     /* check for valid str */
     if (!str)
@@ -40,7 +40,7 @@
 #include <util/gv_ctype.h>
 #include <util/strview.h>
 
-extern char *Gvimagepath;
+extern _Thread_local char *Gvimagepath;
 extern char *HTTPServerEnVar;
 extern shape_desc *find_user_shape(const char *);
 
@@ -0,0 +1,217 @@
+/// @file
+/// @brief Implementation of the static, Sort-Tile-Recursive packed R-tree
+
+#include <label/packed_rtree.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <util/alloc.h>
+
+/// entries per tree node
+enum { NODE_SIZE = 16 };
+
+struct packed_rtree_s {
+  size_t count;      ///< number of indexed boxes
+  size_t levels;     ///< number of tree levels, leaves first
+  size_t *level_end; ///< one past the last entry of each level
+  boxf *boxes;       ///< boxes of all entries, level by level
+  size_t *indices;   ///< leaves: object position, others: first child
+};
+
+typedef struct {
+  boxf box;
+  size_t index;
+} entry_t;
+
+static bool is_empty(boxf b) { return !(b.LL.x <= b.UR.x && b.LL.y <= b.UR.y); }
+
+static boxf box_union(boxf a, boxf b) {
+  if (is_empty(a))
+    return b;
+  if (is_empty(b))
+    return a;
+  return (boxf){{fmin(a.LL.x, b.LL.x), fmin(a.LL.y, b.LL.y)},
+                {fmax(a.UR.x, b.UR.x), fmax(a.UR.y, b.UR.y)}};
+}
+
+static bool box_overlap(boxf a, boxf b) {
+  return !is_empty(a) && a.LL.x <= b.UR.x && b.LL.x <= a.UR.x &&
+         a.LL.y <= b.UR.y && b.LL.y <= a.UR.y;
+}
+
+/// twice the center of an entry along x (`dim` 0) or y (`dim` 1)
+static double center(const entry_t *e, int dim) {
+  if (is_empty(e->box))
+    return 0;
+  return dim == 0 ? e->box.LL.x + e->box.UR.x : e->box.LL.y + e->box.UR.y;
+}
+
+static int cmp_center(const entry_t *a, const entry_t *b, int dim) {
+  const double ca = center(a, dim);
+  const double cb = center(b, dim);
+  if (ca != cb)
+    return ca < cb ? -1 : 1;
+  return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static int cmp_x(const void *a, const void *b) { return cmp_center(a, b, 0); }
+
+static int cmp_y(const void *a, const void *b) { return cmp_center(a, b, 1); }
+
+static int cmp_size(const void *a, const void *b) {
+  const size_t x = *(const size_t *)a;
+  const size_t y = *(const size_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+packed_rtree_t *packed_rtree_build(const boxf *boxes, size_t n) {
+  packed_rtree_t *tree = gv_alloc(sizeof(packed_rtree_t));
+  tree->count = n;
+  if (n == 0)
+    return tree;
+
+  // order the leaves: sort by x into vertical slices of whole nodes, then sort
+  // each slice by y
+  entry_t *entries = gv_calloc(n, sizeof(entry_t));
+  for (size_t i = 0; i < n; i++)
+    entries[i] = (entry_t){boxes[i], i};
+  const size_t leaf_nodes = (n + NODE_SIZE - 1) / NODE_SIZE;
+  const size_t slices = (size_t)ceil(sqrt((double)leaf_nodes));
+  const size_t slice_len = NODE_SIZE * ((leaf_nodes + slices - 1) / slices);
+  qsort(entries, n, sizeof(entry_t), cmp_x);
+  for (size_t start = 0; start < n; start += slice_len) {
+    const size_t len = n - start < slice_len ? n - start : slice_len;
+    qsort(entries + start, len, sizeof(entry_t), cmp_y);
+  }
+
+  size_t size = n;
+  tree->levels = 1;
+  for (size_t level_n = n; level_n > 1; tree->levels++) {
+    level_n = (level_n + NODE_SIZE - 1) / NODE_SIZE;
+    size += level_n;
+  }
+  if (tree->levels == 1) { // a single box still gets a root above it
+    tree->levels = 2;
+    size = 2;
+  }
+  tree->level_end = gv_calloc(tree->levels, sizeof(size_t));
+  tree->boxes = gv_calloc(size, sizeof(boxf));
+  tree->indices = gv_calloc(size, sizeof(size_t));
+
+  for (size_t i = 0; i < n; i++) {
+    tree->boxes[i] = entries[i].box;
+    tree->indices[i] = entries[i].index;
+  }
+  free(entries);
+  tree->level_end[0] = n;
+
+  // each upper level groups consecutive runs of the level below
+  size_t pos = n;
+  for (size_t level = 1, begin = 0; level < tree->levels; level++) {
+    const size_t end = tree->level_end[level - 1];
+    for (size_t child = begin; child < end; child += NODE_SIZE) {
+      const size_t last = end - child < NODE_SIZE ? end : child + NODE_SIZE;
+      boxf bb = tree->boxes[child];
+      for (size_t c = child + 1; c < last; c++)
+        bb = box_union(bb, tree->boxes[c]);
+      tree->boxes[pos] = bb;
+      tree->indices[pos] = child;
+      pos++;
+    }
+    tree->level_end[level] = pos;
+    begin = end;
+  }
+  return tree;
+}
+
+void packed_rtree_free(packed_rtree_t *tree) {
+  if (tree == NULL)
+    return;
+  free(tree->level_end);
+  free(tree->boxes);
+  free(tree->indices);
+  free(tree);
+}
+
+size_t packed_rtree_size(const packed_rtree_t *tree) { return tree->count; }
+
+/// a query: boxes overlapping `rect`, and if `by_point`, also at most
+/// `tolerance` away from `p`
+typedef struct {
+  boxf rect;
+  bool by_point;
+  pointf p;
+  double tolerance;
+} query_t;
+
+static bool leaf_matches(const query_t *q, boxf b) {
+  if (!box_overlap(b, q->rect))
+    return false;
+  if (!q->by_point)
+    return true;
+  const double dx = fmax(fmax(b.LL.x - q->p.x, q->p.x - b.UR.x), 0);
+  const double dy = fmax(fmax(b.LL.y - q->p.y, q->p.y - b.UR.y), 0);
+  return dx * dx + dy * dy <= q->tolerance * q->tolerance;
+}
+
+static size_t search(const packed_rtree_t *tree, const query_t *q,
+                     size_t **hits) {
+  *hits = NULL;
+  if (tree->count == 0)
+    return 0;
+
+  // depth-first, one pending entry per sibling of each level on the path
+  typedef struct {
+    size_t pos;
+    size_t level;
+  } pending_t;
+  pending_t *stack = gv_calloc(tree->levels * NODE_SIZE, sizeof(pending_t));
+  size_t depth = 0;
+  const size_t root = tree->level_end[tree->levels - 1] - 1;
+  if (box_overlap(tree->boxes[root], q->rect))
+    stack[depth++] = (pending_t){root, tree->levels - 1};
+
+  size_t count = 0, capacity = 0;
+  size_t *found = NULL;
+  while (depth > 0) {
+    const pending_t node = stack[--depth];
+    const size_t first = tree->indices[node.pos];
+    const size_t end = tree->level_end[node.level - 1];
+    const size_t last = end - first < NODE_SIZE ? end : first + NODE_SIZE;
+    for (size_t c = first; c < last; c++) {
+      if (node.level > 1) {
+        if (box_overlap(tree->boxes[c], q->rect))
+          stack[depth++] = (pending_t){c, node.level - 1};
+      } else if (leaf_matches(q, tree->boxes[c])) {
+        if (count == capacity) {
+          const size_t grown = capacity == 0 ? 16 : capacity * 2;
+          found = gv_recalloc(found, capacity, grown, sizeof(size_t));
+          capacity = grown;
+        }
+        found[count++] = tree->indices[c];
+      }
+    }
+  }
+  free(stack);
+
+  if (count > 1)
+    qsort(found, count, sizeof(size_t), cmp_size);
+  *hits = found;
+  return count;
+}
+
+size_t packed_rtree_query_rect(const packed_rtree_t *tree, boxf rect,
+                               size_t **hits) {
+  const query_t q = {.rect = rect};
+  return search(tree, &q, hits);
+}
+
+size_t packed_rtree_query_point(const packed_rtree_t *tree, pointf p,
+                                double tolerance, size_t **hits) {
+  const double t = fmax(tolerance, 0);
+  const query_t q = {.rect = {{p.x - t, p.y - t}, {p.x + t, p.y + t}},
+                     .by_point = true,
+                     .p = p,
+                     .tolerance = t};
+  return search(tree, &q, hits);
+}
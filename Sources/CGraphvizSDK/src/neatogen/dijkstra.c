@@ -333,3 +333,38 @@ int dijkstra_sgd(graph_sgd *graph, int source, term_sgd *terms) {
     free(dists);
     return offset;
 }
+
+// single source shortest paths over a graph_sgd, storing all distances
+// unreachable nodes are left at FLT_MAX
+void dijkstra_sgd_dist(graph_sgd *graph, int source, float *dists) {
+    heap h;
+    int *indices = gv_calloc(graph->n, sizeof(int));
+    for (size_t i = 0; i < graph->n; i++) {
+        dists[i] = FLT_MAX;
+    }
+    dists[source] = 0;
+    for (size_t i = graph->sources[source]; i < graph->sources[source + 1];
+         i++) {
+        size_t target = graph->targets[i];
+        dists[target] = graph->weights[i];
+    }
+    assert(graph->n <= INT_MAX);
+    initHeap_f(&h, source, indices, dists, (int)graph->n);
+
+    int closest = 0;
+    while (extractMax_f(&h, &closest, indices, dists)) {
+        float d = dists[closest];
+        if (d == FLT_MAX) {
+            break;
+        }
+        for (size_t i = graph->sources[closest]; i < graph->sources[closest + 1];
+             i++) {
+            size_t target = graph->targets[i];
+            float weight = graph->weights[i];
+            assert(target <= INT_MAX);
+            increaseKey_f(&h, (int)target, d+weight, indices, dists);
+        }
+    }
+    freeHeap(&h);
+    free(indices);
+}
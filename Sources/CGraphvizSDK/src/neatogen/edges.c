@@ -15,9 +15,9 @@
 #include <math.h>
 
 
-double pxmin, pxmax, pymin, pymax;	/* clipping window */
+_Thread_local double pxmin, pxmax, pymin, pymax;	/* clipping window */
 
-static Freelist efl;
+static _Thread_local Freelist efl;
 
 void edgeinit(void)
 {
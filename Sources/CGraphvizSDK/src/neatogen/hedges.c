@@ -16,11 +16,11 @@
 
 #define DELETED -2
 
-Halfedge *ELleftend, *ELrightend;
+_Thread_local Halfedge *ELleftend, *ELrightend;
 
-static Freelist hfl;
-static int ELhashsize;
-static Halfedge **ELhash;
+static _Thread_local Freelist hfl;
+static _Thread_local int ELhashsize;
+static _Thread_local Halfedge **ELhash;
 
 void ELcleanup(void)
 {
@@ -46,9 +46,9 @@
 #include <neatogen/neato.h>
 #include <util/alloc.h>
 
-static double *scales;
-static double **lu;
-static int *ps;
+static _Thread_local double *scales;
+static _Thread_local double **lu;
+static _Thread_local int *ps;
 
 /* lu_decompose() decomposes the coefficient matrix A into upper and lower
  * triangular matrices, the composite being the LU matrix.
@@ -9,6 +9,7 @@
  *************************************************************************/
 
 #include <neatogen/matrix_ops.h>
+#include <neatogen/simd.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -145,6 +146,21 @@ mult_dense_mat(double **A, float **B, int dim1, int dim2, int dim3,
 	storage += dim3;
     }
 
+    if (simd_enabled()) {
+	/* accumulate whole rows of C, adding the terms in the same order */
+	double *row = gv_calloc(dim3, sizeof(double));
+	for (i = 0; i < dim1; i++) {
+	    for (j = 0; j < dim3; j++)
+		row[j] = 0;
+	    for (k = 0; k < dim2; k++)
+		simd_axpy_fd(dim3, row, A[i][k], B[k]);
+	    for (j = 0; j < dim3; j++)
+		C[i][j] = (float)row[j];
+	}
+	free(row);
+	return;
+    }
+
     for (i = 0; i < dim1; i++) {
 	for (j = 0; j < dim3; j++) {
 	    sum = 0;
@@ -284,6 +300,11 @@ right_mult_with_vector_f(float **matrix, int n, double *vector,
     int i, j;
 
     double res;
+    if (simd_enabled()) {
+	for (i = 0; i < n; i++)
+	    result[i] = simd_dot_fd(n, matrix[i], vector);
+	return;
+    }
     for (i = 0; i < n; i++) {
 	res = 0;
 	for (j = 0; j < n; j++)
@@ -421,6 +442,13 @@ void right_mult_with_vector_ff
 	/* deal with main diag */
 	res += packed_matrix[index++] * vector_i;
 	/* deal with off diag */
+	if (simd_enabled()) {
+	    res += simd_packed_row(n - i - 1, packed_matrix + index,
+				   vector + i + 1, vector_i, result + i + 1);
+	    index += n - i - 1;
+	    result[i] += res;
+	    continue;
+	}
 	for (j = i + 1; j < n; j++, index++) {
 	    res += packed_matrix[index] * vector[j];
 	    result[j] += packed_matrix[index] * vector_i;
@@ -451,6 +479,10 @@ void
 vectors_mult_additionf(int n, float *vector1, float alpha, float *vector2)
 {
     int i;
+    if (simd_enabled()) {
+	simd_axpyf(n, vector1, alpha, vector2);
+	return;
+    }
     for (i = 0; i < n; i++) {
 	vector1[i] = vector1[i] + alpha * vector2[i];
     }
@@ -467,6 +499,8 @@ double vectors_inner_productf(int n, float *vector1, float *vector2)
 {
     int i;
     double result = 0;
+    if (simd_enabled())
+	return simd_dotf(n, vector1, vector2);
     for (i = 0; i < n; i++) {
 	result += vector1[i] * vector2[i];
     }
@@ -535,3 +569,26 @@ void invert_sqrt_vec(int n, float *vec)
 	}
     }
 }
+
+int cmp_float(const void *x, const void *y)
+{
+    const float a = *(const float *)x;
+    const float b = *(const float *)y;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+/* count_le:
+ * Number of entries in the sorted array 'a' that are <= 'bound'
+ */
+size_t count_le(const float *a, size_t len, float bound)
+{
+    size_t lo = 0, hi = len;
+    while (lo < hi) {
+	const size_t mid = lo + (hi - lo) / 2;
+	if (a[mid] <= bound)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
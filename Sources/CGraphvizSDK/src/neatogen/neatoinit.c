@@ -52,8 +52,8 @@
 #define srand48 srand
 #endif
 
-static attrsym_t *N_pos;
-static int Pack;		/* If >= 0, layout components separately and pack together
+static _Thread_local attrsym_t *N_pos;
+static _Thread_local int Pack;		/* If >= 0, layout components separately and pack together
 				 * The value of Pack gives margins around graphs.
 				 */
 static char *cc_pfx = "_neato_cc";
@@ -637,6 +637,8 @@ static int neatoModel(graph_t * g)
 	return MODEL_SUBSET;
     if (streq(p, "shortpath"))
 	return MODEL_SHORTPATH;
+    if (streq(p, "landmark"))
+	return MODEL_LANDMARK;
     if (streq(p, "mds")) {
 	if (agattr(g, AGEDGE, "len", 0))
 	    return MODEL_MDS;
@@ -666,7 +668,7 @@ static int neatoMode(graph_t * g)
 	    mode = MODE_KK;
 	else if (streq(str, "major"))
 	    mode = MODE_MAJOR;
-	else if (streq(str, "sgd"))
+	else if (streq(str, "sgd") || startswith(str, "sgd:"))
 		mode = MODE_SGD;
 #ifdef DIGCOLA
 	else if (streq(str, "hier"))
@@ -685,6 +687,37 @@ static int neatoMode(graph_t * g)
     return mode;
 }
 
+/* sgdOptions:
+ * Options given as colon-separated suffixes of mode="sgd", e.g.
+ * "sgd:sparse", "sgd:sparse100:hogwild". "sparse" selects the pivot-based
+ * model, optionally with a pivot count; "hogwild" runs the epochs on the
+ * threads given by the threads attribute without a fixed update order.
+ */
+static sgd_options_t sgdOptions(graph_t * g)
+{
+    sgd_options_t opts = {.threads = get_threads(g)};
+    const char *str = agget(g, "mode");
+    int v;
+
+    if (!str || !startswith(str, "sgd:"))
+	return opts;
+    for (str += strlen("sgd:"); *str; str += *str == ':') {
+	size_t len = strcspn(str, ":");
+	if (startswith(str, "sparse") && len >= strlen("sparse")) {
+	    opts.n_pivots = DFLT_SGD_PIVOTS;
+	    if (sscanf(str + strlen("sparse"), "%d", &v) > 0 && v > 0)
+		opts.n_pivots = v;
+	} else if (len == strlen("hogwild") && startswith(str, "hogwild")) {
+	    opts.hogwild = true;
+	} else {
+	    agwarningf("Unknown sgd option \"%.*s\" in mode - ignored\n",
+		       (int)len, str);
+	}
+	str += len;
+    }
+    return opts;
+}
+
 /* checkEdge:
  *
  */
@@ -1338,7 +1371,7 @@ neatoLayout(Agraph_t * mg, Agraph_t * g, int layoutMode, int layoutModel,
     if (layoutMode == MODE_KK)
 	kkNeato(g, nG, layoutModel);
     else if (layoutMode == MODE_SGD)
-	sgd(g, layoutModel);
+	sgd(g, layoutModel, sgdOptions(g));
     else
 	majorization(mg, g, nG, layoutMode, layoutModel, Ndim, am);
 }
@@ -358,7 +358,7 @@ OverlapSmoother OverlapSmoother_new(SparseMatrix A, int m,
   if (!neighborhood_only){
     SparseMatrix C, D;
     C = get_overlap_graph(dim, m, x, width, 0);
-    D = SparseMatrix_add(B, C);
+    D = SparseMatrix_add(B, C, 1);
     SparseMatrix_delete(B);
     SparseMatrix_delete(C);
     B = D;
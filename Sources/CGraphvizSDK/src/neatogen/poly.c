@@ -25,10 +25,10 @@ static const int CIRCLE = 2;
 static bool ISBOX(const Poly *p) { return p->kind & BOX; }
 static bool ISCIRCLE(const Poly *p) { return p->kind & CIRCLE; }
 
-static size_t maxcnt = 0;
-static Point *tp1 = NULL;
-static Point *tp2 = NULL;
-static Point *tp3 = NULL;
+static _Thread_local size_t maxcnt = 0;
+static _Thread_local Point *tp1 = NULL;
+static _Thread_local Point *tp2 = NULL;
+static _Thread_local Point *tp3 = NULL;
 
 void polyFree(void)
 {
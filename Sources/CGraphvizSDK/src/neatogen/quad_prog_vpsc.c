@@ -57,7 +57,7 @@ constrained_majorization_vpsc(CMajEnvVPSC * e, float *b, float *place,
     int n = e->nv + e->nldv;
     bool converged = false;
 #ifdef CONMAJ_LOGGING
-    static int call_no = 0;
+    static _Thread_local int call_no = 0;
 #endif				/* CONMAJ_LOGGING */
 
     if (max_iterations == 0)
@@ -1,14 +1,20 @@
 #include <assert.h>
+#include <float.h>
 #include <limits.h>
 #include <math.h>
 #include <neatogen/dijkstra.h>
+#include <neatogen/matrix_ops.h>
 #include <neatogen/neato.h>
 #include <neatogen/neatoprocs.h>
 #include <neatogen/randomkit.h>
 #include <neatogen/sgd.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <util/alloc.h>
 #include <util/bitarray.h>
+#include <util/parallel.h>
 #include <util/unreachable.h>
 
 static double calculate_stress(double *pos, term_sgd *terms, int n_terms) {
@@ -138,8 +144,326 @@ static void free_adjacency(graph_sgd *graph) {
   free(graph);
 }
 
+typedef struct {
+  graph_sgd *graph;
+  term_sgd *terms;
+  const size_t *slot; ///< first term of each source
+  int *built;         ///< number of terms each source produced
+} exact_terms_ctx_t;
+
+static void exact_terms_range(void *arg, size_t begin, size_t end) {
+  exact_terms_ctx_t *ctx = arg;
+  for (size_t i = begin; i < end; i++) {
+    if (!bitarray_get(ctx->graph->pinneds, i)) {
+      ctx->built[i] =
+          dijkstra_sgd(ctx->graph, (int)i, ctx->terms + ctx->slot[i]);
+    }
+  }
+}
+
+// exact model: one term for every connected pair of nodes that are not both
+// fixed
+static term_sgd *exact_terms(graph_sgd *graph, int *n_terms, int threads) {
+  const int n = (int)graph->n;
+
+  // Source i produces a term for every reachable node before it and every
+  // reachable fixed node after it. Give each source room for that many so the
+  // searches can run concurrently, then close any gaps left by unreachable
+  // nodes. The result is in the same order as running the sources in turn.
+  size_t *slot = gv_calloc(n + 1, sizeof(size_t));
+  size_t fixed_after = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    if (!bitarray_get(graph->pinneds, i)) {
+      slot[i + 1] = (size_t)i + fixed_after;
+    } else {
+      fixed_after++;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    slot[i + 1] += slot[i];
+  }
+  term_sgd *terms = gv_calloc(slot[n], sizeof(term_sgd));
+  int *built = gv_calloc(n, sizeof(int));
+  exact_terms_ctx_t ctx = {
+      .graph = graph, .terms = terms, .slot = slot, .built = built};
+  gv_parallel_for_threads(threads, graph->n, 16, exact_terms_range, &ctx);
+
+  int offset = 0;
+  for (int i = 0; i < n; i++) {
+    if (built[i] > 0 && (size_t)offset != slot[i]) {
+      memmove(terms + offset, terms + slot[i], built[i] * sizeof(term_sgd));
+    }
+    offset += built[i];
+  }
+  free(built);
+  free(slot);
+  // pinned components are laid out together, so pairs in different
+  // components may have no term
+  *n_terms = offset;
+  return terms;
+}
+
+/// sparse model: exact terms along edges plus terms to a set of pivots
+///
+/// Pivots are chosen by max/min sampling, starting from node 0. Every node
+/// belongs to the region of its nearest pivot. A pivot term (i, p) stands in
+/// for the terms between i and the nodes of p’s region, so only i moves and
+/// its weight is scaled by the number of region nodes within d(i, p)/2 of p.
+/// This follows the sparse stress approximation of Ortmann et al. and needs
+/// O(n·pivots + edges) terms instead of O(n²).
+static term_sgd *sparse_terms(graph_sgd *graph, int n_pivots, int *n_terms,
+                              term_sgd **pivot_terms, int *n_pivot_terms) {
+  const size_t n = graph->n;
+  assert(n_pivots > 0 && (size_t)n_pivots < n);
+
+  int *pivots = gv_calloc(n_pivots, sizeof(int));
+  float *dists = gv_calloc((size_t)n_pivots * n, sizeof(float));
+  float *min_dist = gv_calloc(n, sizeof(float));
+  for (size_t i = 0; i < n; i++) {
+    min_dist[i] = FLT_MAX;
+  }
+  int next = 0;
+  for (int p = 0; p < n_pivots; p++) {
+    pivots[p] = next;
+    float *d = dists + (size_t)p * n;
+    dijkstra_sgd_dist(graph, next, d);
+    // the next pivot is the node furthest from all current pivots, which
+    // prefers nodes in components no pivot has reached yet
+    float furthest = -1;
+    for (size_t i = 0; i < n; i++) {
+      min_dist[i] = fminf(min_dist[i], d[i]);
+      if (min_dist[i] > furthest) {
+        furthest = min_dist[i];
+        next = (int)i;
+      }
+    }
+  }
+  free(min_dist);
+
+  // assign each node to the region of its nearest pivot and sort the
+  // distances within each region for the weight lookups below
+  int *region = gv_calloc(n, sizeof(int));
+  size_t *region_start = gv_calloc((size_t)n_pivots + 1, sizeof(size_t));
+  for (size_t i = 0; i < n; i++) {
+    region[i] = -1;
+    float best = FLT_MAX;
+    for (int p = 0; p < n_pivots; p++) {
+      if (dists[(size_t)p * n + i] < best) {
+        best = dists[(size_t)p * n + i];
+        region[i] = p;
+      }
+    }
+    if (region[i] >= 0) {
+      region_start[region[i] + 1]++;
+    }
+  }
+  for (int p = 0; p < n_pivots; p++) {
+    region_start[p + 1] += region_start[p];
+  }
+  float *region_dists = gv_calloc(region_start[n_pivots], sizeof(float));
+  size_t *fill = gv_calloc(n_pivots, sizeof(size_t));
+  for (size_t i = 0; i < n; i++) {
+    if (region[i] >= 0) {
+      const int p = region[i];
+      region_dists[region_start[p] + fill[p]++] = dists[(size_t)p * n + i];
+    }
+  }
+  free(fill);
+  free(region);
+  for (int p = 0; p < n_pivots; p++) {
+    qsort(region_dists + region_start[p], region_start[p + 1] - region_start[p],
+          sizeof(float), cmp_float);
+  }
+
+  // exact terms along edges, once per pair of adjacent nodes
+  size_t n_edge_terms = 0;
+  int *seen = gv_calloc(n, sizeof(int));
+  for (size_t i = 0; i < n; i++) {
+    seen[i] = -1;
+  }
+  for (size_t i = 0; i < n; i++) {
+    for (size_t x = graph->sources[i]; x < graph->sources[i + 1]; x++) {
+      const size_t j = graph->targets[x];
+      if (j > i && seen[j] != (int)i) {
+        seen[j] = (int)i;
+        if (!bitarray_get(graph->pinneds, i) ||
+            !bitarray_get(graph->pinneds, j)) {
+          n_edge_terms++;
+        }
+      }
+    }
+  }
+  assert(n_edge_terms <= INT_MAX);
+  term_sgd *terms = gv_calloc(n_edge_terms, sizeof(term_sgd));
+  *n_terms = 0;
+  for (size_t i = 0; i < n; i++) {
+    seen[i] = -1;
+  }
+  for (size_t i = 0; i < n; i++) {
+    for (size_t x = graph->sources[i]; x < graph->sources[i + 1]; x++) {
+      const size_t j = graph->targets[x];
+      if (j > i && seen[j] != (int)i) {
+        seen[j] = (int)i;
+        if (!bitarray_get(graph->pinneds, i) ||
+            !bitarray_get(graph->pinneds, j)) {
+          const float d = graph->weights[x];
+          terms[*n_terms] = (term_sgd){.i = (int)i, .j = (int)j, .d = d,
+                                       .w = 1 / (d * d)};
+          ++*n_terms;
+        }
+      }
+    }
+  }
+  free(seen);
+
+  // one-sided terms from every movable node to every reachable pivot
+  size_t n_movable = 0;
+  for (size_t i = 0; i < n; i++) {
+    n_movable += !bitarray_get(graph->pinneds, i);
+  }
+  assert(n_movable * (size_t)n_pivots <= INT_MAX);
+  *pivot_terms = gv_calloc(n_movable * (size_t)n_pivots, sizeof(term_sgd));
+  *n_pivot_terms = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (bitarray_get(graph->pinneds, i)) {
+      continue;
+    }
+    for (int p = 0; p < n_pivots; p++) {
+      const float d = dists[(size_t)p * n + i];
+      if (pivots[p] == (int)i || d == FLT_MAX) {
+        continue;
+      }
+      const size_t s =
+          count_le(region_dists + region_start[p],
+                   region_start[p + 1] - region_start[p], d / 2);
+      (*pivot_terms)[*n_pivot_terms] = (term_sgd){
+          .i = (int)i, .j = pivots[p], .d = d, .w = (float)s / (d * d)};
+      ++*n_pivot_terms;
+    }
+  }
+
+  free(region_dists);
+  free(region_start);
+  free(dists);
+  free(pivots);
+  return terms;
+}
+
+// move the ends of one term towards its ideal distance
+// `j` is only moved for two-sided terms
+static inline void apply_term(double *pos, const bool *unfixed,
+                              const term_sgd *term, double eta, bool move_j) {
+  // cap step size
+  const double mu = fmin(eta * term->w, 1);
+
+  const double dx = pos[2 * term->i] - pos[2 * term->j];
+  const double dy = pos[2 * term->i + 1] - pos[2 * term->j + 1];
+  const double mag = hypot(dx, dy);
+
+  const double r = (mu * (mag - term->d)) / (2 * mag);
+  const double r_x = r * dx;
+  const double r_y = r * dy;
+
+  if (unfixed[term->i]) {
+    pos[2 * term->i] -= r_x;
+    pos[2 * term->i + 1] -= r_y;
+  }
+  if (move_j && unfixed[term->j]) {
+    pos[2 * term->j] += r_x;
+    pos[2 * term->j + 1] += r_y;
+  }
+}
+
+typedef struct {
+  _Atomic double *pos;
+  const bool *unfixed;
+  term_sgd *terms;
+  size_t n_terms;
+  size_t block;  ///< terms per block
+  bool move_j;   ///< whether `j` moves too, see `apply_term`
+  double eta;
+  unsigned long seed;
+} hogwild_ctx_t;
+
+// `apply_term` for positions shared with other threads
+//
+// The loads and stores are individually atomic but the update as a whole is
+// not, so a concurrent update to the same node may be lost. SGD tolerates
+// this, and in a large graph two threads rarely touch the same node at once.
+static inline void apply_term_shared(_Atomic double *pos, const bool *unfixed,
+                                     const term_sgd *term, double eta,
+                                     bool move_j) {
+  const double mu = fmin(eta * term->w, 1);
+
+  const double ix = atomic_load_explicit(&pos[2 * term->i], memory_order_relaxed);
+  const double iy = atomic_load_explicit(&pos[2 * term->i + 1], memory_order_relaxed);
+  const double jx = atomic_load_explicit(&pos[2 * term->j], memory_order_relaxed);
+  const double jy = atomic_load_explicit(&pos[2 * term->j + 1], memory_order_relaxed);
+  const double dx = ix - jx;
+  const double dy = iy - jy;
+  const double mag = hypot(dx, dy);
+
+  const double r = (mu * (mag - term->d)) / (2 * mag);
+  const double r_x = r * dx;
+  const double r_y = r * dy;
+
+  if (unfixed[term->i]) {
+    atomic_store_explicit(&pos[2 * term->i], ix - r_x, memory_order_relaxed);
+    atomic_store_explicit(&pos[2 * term->i + 1], iy - r_y, memory_order_relaxed);
+  }
+  if (move_j && unfixed[term->j]) {
+    atomic_store_explicit(&pos[2 * term->j], jx + r_x, memory_order_relaxed);
+    atomic_store_explicit(&pos[2 * term->j + 1], jy + r_y, memory_order_relaxed);
+  }
+}
+
+// shuffle and apply whole blocks of terms
+//
+// Each block is shuffled with its own generator, seeded from the epoch and
+// block number, so the work per block does not depend on which thread runs it.
+static void hogwild_blocks(void *arg, size_t begin, size_t end) {
+  hogwild_ctx_t *ctx = arg;
+  for (size_t b = begin; b < end; b++) {
+    const size_t first = b * ctx->block;
+    const size_t count = ctx->n_terms - first < ctx->block
+                             ? ctx->n_terms - first
+                             : ctx->block;
+    rk_state rstate;
+    rk_seed(ctx->seed * 1000003UL + b, &rstate);
+    fisheryates_shuffle(ctx->terms + first, (int)count, &rstate);
+    for (size_t ij = first; ij < first + count; ij++) {
+      apply_term_shared(ctx->pos, ctx->unfixed, &ctx->terms[ij], ctx->eta,
+                        ctx->move_j);
+    }
+  }
+}
+
+// run one epoch over `terms` on `threads` threads
+static void hogwild_epoch(_Atomic double *pos, const bool *unfixed,
+                          term_sgd *terms, int n_terms, bool move_j,
+                          double eta, int epoch, int threads) {
+  // enough blocks to balance the threads, each large enough to amortise
+  // the scheduling and generator seeding
+  const size_t block = 4096;
+  hogwild_ctx_t ctx = {.pos = pos, .unfixed = unfixed, .terms = terms,
+                       .n_terms = (size_t)n_terms, .block = block,
+                       .move_j = move_j, .eta = eta,
+                       .seed = (unsigned long)epoch * 2 + move_j};
+  const size_t blocks = ((size_t)n_terms + block - 1) / block;
+  gv_parallel_for_threads(threads, blocks, 1, hogwild_blocks, &ctx);
+}
+
 void sgd(graph_t *G, /* input graph */
-         int model /* distance model */) {
+         int model, /* distance model */
+         sgd_options_t opts) {
+  int n_pivots = opts.n_pivots;
+  if (model == MODEL_LANDMARK) {
+    // the sparse model is sgd's landmark model
+    model = MODEL_SHORTPATH;
+    if (n_pivots == 0) {
+      n_pivots = DFLT_SGD_PIVOTS;
+    }
+  }
   if (model == MODEL_CIRCUIT) {
     agwarningf("circuit model not yet supported in Gmode=sgd, reverting to "
                "shortpath model\n");
@@ -156,35 +480,39 @@ void sgd(graph_t *G, /* input graph */
     fprintf(stderr, "calculating shortest paths and setting up stress terms:");
     start_timer();
   }
-  // calculate how many terms will be needed as fixed nodes can be ignored
-  int n_fixed = 0, n_terms = 0;
-  for (int i = 0; i < n; i++) {
-    if (!isFixed(GD_neato_nlist(G)[i])) {
-      n_fixed++;
-      n_terms += n - n_fixed;
-    }
-  }
-  term_sgd *terms = gv_calloc(n_terms, sizeof(term_sgd));
-  // calculate term values through shortest paths
-  int offset = 0;
   graph_sgd *graph = extract_adjacency(G, model);
-  for (int i = 0; i < n; i++) {
-    if (!isFixed(GD_neato_nlist(G)[i])) {
-      offset += dijkstra_sgd(graph, i, terms + offset);
-    }
+  int n_terms = 0, n_pivot_terms = 0;
+  term_sgd *terms, *pivot_terms = NULL;
+  if (n_pivots > 0 && n_pivots < n) {
+    terms = sparse_terms(graph, n_pivots, &n_terms, &pivot_terms,
+                         &n_pivot_terms);
+  } else {
+    terms = exact_terms(graph, &n_terms, opts.threads);
   }
-  assert(offset == n_terms);
   free_adjacency(graph);
   if (Verbose) {
     fprintf(stderr, " %.2f sec\n", elapsed_sec());
+    if (pivot_terms) {
+      fprintf(stderr, "sparse model: %d pivots, %d edge terms, %d pivot terms\n",
+              n_pivots, n_terms, n_pivot_terms);
+    }
+  }
+  if (n_terms + n_pivot_terms == 0) {
+    free(terms);
+    free(pivot_terms);
+    return;
   }
 
   // initialise annealing schedule
-  float w_min = terms[0].w, w_max = terms[0].w;
-  for (int ij = 1; ij < n_terms; ij++) {
+  float w_min = FLT_MAX, w_max = 0;
+  for (int ij = 0; ij < n_terms; ij++) {
     w_min = fminf(w_min, terms[ij].w);
     w_max = fmaxf(w_max, terms[ij].w);
   }
+  for (int ij = 0; ij < n_pivot_terms; ij++) {
+    w_min = fminf(w_min, pivot_terms[ij].w);
+    w_max = fmaxf(w_max, pivot_terms[ij].w);
+  }
   // note: Epsilon is different from MODE_KK and MODE_MAJOR as it is a minimum
   // step size rather than energy threshold
   //       MaxIter is also different as it is a fixed number of iterations
@@ -210,40 +538,55 @@ void sgd(graph_t *G, /* input graph */
     fprintf(stderr, "solving model:");
     start_timer();
   }
-  rk_state rstate;
-  rk_seed(0, &rstate); // TODO: get seed from graph
-  for (int t = 0; t < MaxIter; t++) {
-    fisheryates_shuffle(terms, n_terms, &rstate);
-    const double eta = eta_max * exp(-lambda * t);
-    for (int ij = 0; ij < n_terms; ij++) {
-      // cap step size
-      const double mu = fmin(eta * terms[ij].w, 1);
-
-      const double dx = pos[2 * terms[ij].i] - pos[2 * terms[ij].j];
-      const double dy = pos[2 * terms[ij].i + 1] - pos[2 * terms[ij].j + 1];
-      const double mag = hypot(dx, dy);
-
-      const double r = (mu * (mag - terms[ij].d)) / (2 * mag);
-      const double r_x = r * dx;
-      const double r_y = r * dy;
-
-      if (unfixed[terms[ij].i]) {
-        pos[2 * terms[ij].i] -= r_x;
-        pos[2 * terms[ij].i + 1] -= r_y;
-      }
-      if (unfixed[terms[ij].j]) {
-        pos[2 * terms[ij].j] += r_x;
-        pos[2 * terms[ij].j + 1] += r_y;
+  if (opts.hogwild && opts.threads > 1) {
+    _Atomic double *shared = gv_calloc(2 * n, sizeof(_Atomic double));
+    for (int i = 0; i < 2 * n; i++) {
+      atomic_init(&shared[i], pos[i]);
+    }
+    for (int t = 0; t < MaxIter; t++) {
+      const double eta = eta_max * exp(-lambda * t);
+      hogwild_epoch(shared, unfixed, terms, n_terms, true, eta, t,
+                    opts.threads);
+      hogwild_epoch(shared, unfixed, pivot_terms, n_pivot_terms, false, eta, t,
+                    opts.threads);
+      if (Verbose) {
+        for (int i = 0; i < 2 * n; i++) {
+          pos[i] = atomic_load_explicit(&shared[i], memory_order_relaxed);
+        }
+        fprintf(stderr, " %.3f", calculate_stress(pos, terms, n_terms) +
+                                     calculate_stress(pos, pivot_terms,
+                                                      n_pivot_terms));
       }
     }
-    if (Verbose) {
-      fprintf(stderr, " %.3f", calculate_stress(pos, terms, n_terms));
+    for (int i = 0; i < 2 * n; i++) {
+      pos[i] = atomic_load_explicit(&shared[i], memory_order_relaxed);
+    }
+    free(shared);
+  } else {
+    rk_state rstate;
+    rk_seed(0, &rstate); // TODO: get seed from graph
+    for (int t = 0; t < MaxIter; t++) {
+      fisheryates_shuffle(terms, n_terms, &rstate);
+      fisheryates_shuffle(pivot_terms, n_pivot_terms, &rstate);
+      const double eta = eta_max * exp(-lambda * t);
+      for (int ij = 0; ij < n_terms; ij++) {
+        apply_term(pos, unfixed, &terms[ij], eta, true);
+      }
+      for (int ij = 0; ij < n_pivot_terms; ij++) {
+        apply_term(pos, unfixed, &pivot_terms[ij], eta, false);
+      }
+      if (Verbose) {
+        fprintf(stderr, " %.3f", calculate_stress(pos, terms, n_terms) +
+                                     calculate_stress(pos, pivot_terms,
+                                                      n_pivot_terms));
+      }
     }
   }
   if (Verbose) {
     fprintf(stderr, "\nfinished in %.2f sec\n", elapsed_sec());
   }
   free(terms);
+  free(pivot_terms);
 
   // copy temporary positions back into graph_t
   for (int i = 0; i < n; i++) {
@@ -0,0 +1,460 @@
+/// @file
+/// @brief SSE2, AVX2 and NEON versions of the dense vector kernels
+///
+/// Products and sums are kept as separate instructions rather than fused
+/// multiply-adds, so element-wise kernels round exactly like the scalar loops.
+
+#include <neatogen/simd.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <util/unreachable.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+    (defined(__i386__) && defined(__SSE2__))
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef enum { ISA_UNKNOWN, ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_NEON } isa_t;
+
+static atomic_int detected_isa = ISA_UNKNOWN;
+
+// The NEON kernels have not yet been run against the scalar loops on AArch64
+// hardware (testDenseKernelsMatchScalar does that), so they stay off until
+// enabled explicitly.
+#ifdef SIMD_NEON
+static atomic_bool disabled = true;
+#else
+static atomic_bool disabled;
+#endif
+
+static isa_t isa(void) {
+  int found = atomic_load_explicit(&detected_isa, memory_order_relaxed);
+  if (found != ISA_UNKNOWN) {
+    return (isa_t)found;
+  }
+#if defined(SIMD_AVX2)
+  __builtin_cpu_init();
+  found = __builtin_cpu_supports("avx2") ? ISA_AVX2 : ISA_SSE2;
+#elif defined(SIMD_SSE2)
+  found = ISA_SSE2;
+#elif defined(SIMD_NEON)
+  found = ISA_NEON;
+#else
+  found = ISA_SCALAR;
+#endif
+  atomic_store_explicit(&detected_isa, found, memory_order_relaxed);
+  return (isa_t)found;
+}
+
+bool simd_available(void) { return isa() != ISA_SCALAR; }
+
+bool simd_enabled(void) { return simd_available() && !atomic_load(&disabled); }
+
+void simd_set_enabled(bool enabled) { atomic_store(&disabled, !enabled); }
+
+const char *simd_isa(void) {
+  if (!simd_enabled()) {
+    return "scalar";
+  }
+  switch (isa()) {
+  case ISA_SSE2:
+    return "sse2";
+  case ISA_AVX2:
+    return "avx2";
+  case ISA_NEON:
+    return "neon";
+  default:
+    return "scalar";
+  }
+}
+
+#ifdef SIMD_SSE2
+
+static double hsum_pd(__m128d v) {
+  double lanes[2];
+  _mm_storeu_pd(lanes, v);
+  return lanes[0] + lanes[1];
+}
+
+static float hsum_ps(__m128 v) {
+  float lanes[4];
+  _mm_storeu_ps(lanes, v);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+static double dotf_sse2(int n, const float *a, const float *b) {
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 p = _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(p));
+    acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(p, p)));
+  }
+  double sum = hsum_pd(_mm_add_pd(acc0, acc1));
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static double dot_fd_sse2(int n, const float *a, const double *b) {
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 x = _mm_loadu_ps(a + i);
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_cvtps_pd(x), _mm_loadu_pd(b + i)));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)),
+                                       _mm_loadu_pd(b + i + 2)));
+  }
+  double sum = hsum_pd(_mm_add_pd(acc0, acc1));
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static void axpyf_sse2(int n, float *y, float alpha, const float *x) {
+  const __m128 va = _mm_set1_ps(alpha);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i),
+                                    _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+  }
+  for (; i < n; i++) {
+    y[i] = y[i] + alpha * x[i];
+  }
+}
+
+static void axpy_fd_sse2(int n, double *y, double alpha, const float *x) {
+  const __m128d va = _mm_set1_pd(alpha);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 v = _mm_loadu_ps(x + i);
+    _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i),
+                                    _mm_mul_pd(va, _mm_cvtps_pd(v))));
+    _mm_storeu_pd(y + i + 2,
+                  _mm_add_pd(_mm_loadu_pd(y + i + 2),
+                             _mm_mul_pd(va, _mm_cvtps_pd(_mm_movehl_ps(v, v)))));
+  }
+  for (; i < n; i++) {
+    y[i] += alpha * x[i];
+  }
+}
+
+static float packed_row_sse2(int n, const float *row, const float *v,
+                             float v_i, float *result) {
+  const __m128 vi = _mm_set1_ps(v_i);
+  __m128 acc = _mm_setzero_ps();
+  int j = 0;
+  for (; j + 4 <= n; j += 4) {
+    const __m128 r = _mm_loadu_ps(row + j);
+    acc = _mm_add_ps(acc, _mm_mul_ps(r, _mm_loadu_ps(v + j)));
+    _mm_storeu_ps(result + j,
+                  _mm_add_ps(_mm_loadu_ps(result + j), _mm_mul_ps(r, vi)));
+  }
+  float sum = hsum_ps(acc);
+  for (; j < n; j++) {
+    sum += row[j] * v[j];
+    result[j] += row[j] * v_i;
+  }
+  return sum;
+}
+
+#endif
+
+#ifdef SIMD_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static double hsum256_pd(__m256d v) {
+  double lanes[4];
+  _mm256_storeu_pd(lanes, v);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+AVX2 static float hsum256_ps(__m256 v) {
+  float lanes[8];
+  _mm256_storeu_ps(lanes, v);
+  return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+         ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+AVX2 static double dotf_avx2(int n, const float *a, const float *b) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 p =
+        _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(p)));
+    acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(p, 1)));
+  }
+  double sum = hsum256_pd(_mm256_add_pd(acc0, acc1));
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+AVX2 static double dot_fd_avx2(int n, const float *a, const double *b) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 x = _mm256_loadu_ps(a + i);
+    acc0 = _mm256_add_pd(
+        acc0, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(x)),
+                            _mm256_loadu_pd(b + i)));
+    acc1 = _mm256_add_pd(
+        acc1, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)),
+                            _mm256_loadu_pd(b + i + 4)));
+  }
+  double sum = hsum256_pd(_mm256_add_pd(acc0, acc1));
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+AVX2 static void axpyf_avx2(int n, float *y, float alpha, const float *x) {
+  const __m256 va = _mm256_set1_ps(alpha);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(y + i,
+                     _mm256_add_ps(_mm256_loadu_ps(y + i),
+                                   _mm256_mul_ps(va, _mm256_loadu_ps(x + i))));
+  }
+  for (; i < n; i++) {
+    y[i] = y[i] + alpha * x[i];
+  }
+}
+
+AVX2 static void axpy_fd_avx2(int n, double *y, double alpha,
+                              const float *x) {
+  const __m256d va = _mm256_set1_pd(alpha);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+    _mm256_storeu_pd(y + i,
+                     _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(va, v)));
+  }
+  for (; i < n; i++) {
+    y[i] += alpha * x[i];
+  }
+}
+
+AVX2 static float packed_row_avx2(int n, const float *row, const float *v,
+                                  float v_i, float *result) {
+  const __m256 vi = _mm256_set1_ps(v_i);
+  __m256 acc = _mm256_setzero_ps();
+  int j = 0;
+  for (; j + 8 <= n; j += 8) {
+    const __m256 r = _mm256_loadu_ps(row + j);
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(r, _mm256_loadu_ps(v + j)));
+    _mm256_storeu_ps(result + j, _mm256_add_ps(_mm256_loadu_ps(result + j),
+                                               _mm256_mul_ps(r, vi)));
+  }
+  float sum = hsum256_ps(acc);
+  for (; j < n; j++) {
+    sum += row[j] * v[j];
+    result[j] += row[j] * v_i;
+  }
+  return sum;
+}
+
+#endif
+
+#ifdef SIMD_NEON
+
+static double dotf_neon(int n, const float *a, const float *b) {
+  float64x2_t acc0 = vdupq_n_f64(0);
+  float64x2_t acc1 = vdupq_n_f64(0);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t p = vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+    acc0 = vaddq_f64(acc0, vcvt_f64_f32(vget_low_f32(p)));
+    acc1 = vaddq_f64(acc1, vcvt_high_f64_f32(p));
+  }
+  double sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static double dot_fd_neon(int n, const float *a, const double *b) {
+  float64x2_t acc0 = vdupq_n_f64(0);
+  float64x2_t acc1 = vdupq_n_f64(0);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t x = vld1q_f32(a + i);
+    acc0 = vaddq_f64(acc0, vmulq_f64(vcvt_f64_f32(vget_low_f32(x)),
+                                     vld1q_f64(b + i)));
+    acc1 = vaddq_f64(acc1,
+                     vmulq_f64(vcvt_high_f64_f32(x), vld1q_f64(b + i + 2)));
+  }
+  double sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static void axpyf_neon(int n, float *y, float alpha, const float *x) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(y + i,
+              vaddq_f32(vld1q_f32(y + i), vmulq_n_f32(vld1q_f32(x + i), alpha)));
+  }
+  for (; i < n; i++) {
+    y[i] = y[i] + alpha * x[i];
+  }
+}
+
+static void axpy_fd_neon(int n, double *y, double alpha, const float *x) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t v = vld1q_f32(x + i);
+    vst1q_f64(y + i, vaddq_f64(vld1q_f64(y + i),
+                               vmulq_n_f64(vcvt_f64_f32(vget_low_f32(v)), alpha)));
+    vst1q_f64(y + i + 2, vaddq_f64(vld1q_f64(y + i + 2),
+                                   vmulq_n_f64(vcvt_high_f64_f32(v), alpha)));
+  }
+  for (; i < n; i++) {
+    y[i] += alpha * x[i];
+  }
+}
+
+static float packed_row_neon(int n, const float *row, const float *v,
+                             float v_i, float *result) {
+  float32x4_t acc = vdupq_n_f32(0);
+  int j = 0;
+  for (; j + 4 <= n; j += 4) {
+    const float32x4_t r = vld1q_f32(row + j);
+    acc = vaddq_f32(acc, vmulq_f32(r, vld1q_f32(v + j)));
+    vst1q_f32(result + j, vaddq_f32(vld1q_f32(result + j), vmulq_n_f32(r, v_i)));
+  }
+  float sum = vaddvq_f32(acc);
+  for (; j < n; j++) {
+    sum += row[j] * v[j];
+    result[j] += row[j] * v_i;
+  }
+  return sum;
+}
+
+#endif
+
+// Each entry point dispatches on the detected instruction set. Callers only
+// use them when `simd_available()`, so there is no scalar case.
+
+double simd_dotf(int n, const float *a, const float *b) {
+  switch (isa()) {
+#ifdef SIMD_AVX2
+  case ISA_AVX2:
+    return dotf_avx2(n, a, b);
+#endif
+#ifdef SIMD_SSE2
+  case ISA_SSE2:
+    return dotf_sse2(n, a, b);
+#endif
+#ifdef SIMD_NEON
+  case ISA_NEON:
+    return dotf_neon(n, a, b);
+#endif
+  default:
+    UNREACHABLE();
+  }
+}
+
+double simd_dot_fd(int n, const float *a, const double *b) {
+  switch (isa()) {
+#ifdef SIMD_AVX2
+  case ISA_AVX2:
+    return dot_fd_avx2(n, a, b);
+#endif
+#ifdef SIMD_SSE2
+  case ISA_SSE2:
+    return dot_fd_sse2(n, a, b);
+#endif
+#ifdef SIMD_NEON
+  case ISA_NEON:
+    return dot_fd_neon(n, a, b);
+#endif
+  default:
+    UNREACHABLE();
+  }
+}
+
+void simd_axpyf(int n, float *y, float alpha, const float *x) {
+  switch (isa()) {
+#ifdef SIMD_AVX2
+  case ISA_AVX2:
+    axpyf_avx2(n, y, alpha, x);
+    return;
+#endif
+#ifdef SIMD_SSE2
+  case ISA_SSE2:
+    axpyf_sse2(n, y, alpha, x);
+    return;
+#endif
+#ifdef SIMD_NEON
+  case ISA_NEON:
+    axpyf_neon(n, y, alpha, x);
+    return;
+#endif
+  default:
+    UNREACHABLE();
+  }
+}
+
+void simd_axpy_fd(int n, double *y, double alpha, const float *x) {
+  switch (isa()) {
+#ifdef SIMD_AVX2
+  case ISA_AVX2:
+    axpy_fd_avx2(n, y, alpha, x);
+    return;
+#endif
+#ifdef SIMD_SSE2
+  case ISA_SSE2:
+    axpy_fd_sse2(n, y, alpha, x);
+    return;
+#endif
+#ifdef SIMD_NEON
+  case ISA_NEON:
+    axpy_fd_neon(n, y, alpha, x);
+    return;
+#endif
+  default:
+    UNREACHABLE();
+  }
+}
+
+float simd_packed_row(int n, const float *row, const float *v, float v_i,
+                      float *result) {
+  switch (isa()) {
+#ifdef SIMD_AVX2
+  case ISA_AVX2:
+    return packed_row_avx2(n, row, v, v_i, result);
+#endif
+#ifdef SIMD_SSE2
+  case ISA_SSE2:
+    return packed_row_sse2(n, row, v, v_i, result);
+#endif
+#ifdef SIMD_NEON
+  case ISA_NEON:
+    return packed_row_neon(n, row, v, v_i, result);
+#endif
+  default:
+    UNREACHABLE();
+  }
+}
@@ -13,11 +13,11 @@
 #include <math.h>
 
 
-int siteidx;
-Site *bottomsite;
+_Thread_local int siteidx;
+_Thread_local Site *bottomsite;
 
-static Freelist sfl;
-static size_t nvertices;
+static _Thread_local Freelist sfl;
+static _Thread_local size_t nvertices;
 
 void siteinit(void)
 {
@@ -21,8 +21,10 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <util/alloc.h>
+#include <util/parallel.h>
 
 // the terms in the stress energy are normalized by dᵢⱼ¯²
 
@@ -639,27 +641,44 @@ finish0:
     return iterations;
 }
 
-/* compute_weighted_apsp_packed:
- * Edge lengths can be any float > 0
- */
-static float *compute_weighted_apsp_packed(vtx_data * graph, int n)
+/// shared state of the parallel all-pairs shortest path loops
+typedef struct {
+    vtx_data *graph;
+    int n;
+    float *Dij; ///< packed upper triangle, row `i` holds `Dij[i][i..n-1]`
+} apsp_ctx_t;
+
+/// offset of row `i` in a packed upper triangle of an `n`×`n` matrix
+static size_t packed_row(int n, int i)
 {
-    int i, j, count;
-    float *Dij = gv_calloc(n * (n + 1) / 2, sizeof(float));
+    return (size_t)i * (2 * (size_t)n - (size_t)i + 1) / 2;
+}
 
+static void weighted_apsp_rows(void *arg, size_t begin, size_t end)
+{
+    apsp_ctx_t *ctx = arg;
+    const int n = ctx->n;
     float *Di = gv_calloc(n, sizeof(float));
 
-    count = 0;
-    for (i = 0; i < n; i++) {
-	dijkstra_f(i, graph, n, Di);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = Di[j];
-	}
+    for (int i = (int)begin; i < (int)end; i++) {
+	dijkstra_f(i, ctx->graph, n, Di);
+	memcpy(ctx->Dij + packed_row(n, i), Di + i, (n - i) * sizeof(float));
     }
     free(Di);
-    return Dij;
 }
 
+/* compute_weighted_apsp_packed:
+ * Edge lengths can be any float > 0
+ * Sources are spread over the worker threads; each writes only its own rows.
+ */
+static float *compute_weighted_apsp_packed(vtx_data * graph, int n)
+{
+    apsp_ctx_t ctx = {.graph = graph, .n = n,
+		      .Dij = gv_calloc(packed_row(n, n), sizeof(float))};
+
+    gv_parallel_for((size_t)n, 8, weighted_apsp_rows, &ctx);
+    return ctx.Dij;
+}
 
 /* mdsModel:
  * Update matrix with actual edge lengths
@@ -694,25 +713,33 @@ float *mdsModel(vtx_data * graph, int nG)
     return Dij;
 }
 
-/* compute_apsp_packed:
- * Assumes integral weights > 0.
- */
-float *compute_apsp_packed(vtx_data * graph, int n)
+static void apsp_rows(void *arg, size_t begin, size_t end)
 {
-    int i, j, count;
-    float *Dij = gv_calloc(n * (n + 1) / 2, sizeof(float));
-
+    apsp_ctx_t *ctx = arg;
+    const int n = ctx->n;
     DistType *Di = gv_calloc(n, sizeof(DistType));
 
-    count = 0;
-    for (i = 0; i < n; i++) {
-	bfs(i, graph, n, Di);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = (float)Di[j];
+    for (int i = (int)begin; i < (int)end; i++) {
+	bfs(i, ctx->graph, n, Di);
+	float *row = ctx->Dij + packed_row(n, i);
+	for (int j = i; j < n; j++) {
+	    row[j - i] = (float)Di[j];
 	}
     }
     free(Di);
-    return Dij;
+}
+
+/* compute_apsp_packed:
+ * Assumes integral weights > 0.
+ * Sources are spread over the worker threads; each writes only its own rows.
+ */
+float *compute_apsp_packed(vtx_data * graph, int n)
+{
+    apsp_ctx_t ctx = {.graph = graph, .n = n,
+		      .Dij = gv_calloc(packed_row(n, n), sizeof(float))};
+
+    gv_parallel_for((size_t)n, 8, apsp_rows, &ctx);
+    return ctx.Dij;
 }
 
 float *compute_apsp_artificial_weights_packed(vtx_data *graph, int n) {
@@ -795,6 +822,274 @@ static void dumpMatrix(float *Dij, int n)
  */
 #define DegType long double
 
+/* landmark_distances:
+ * Select 'k' landmarks spread over the graph by max/min sampling, starting
+ * from node 0, and return their distances to every node as a k×n matrix.
+ * Unreachable nodes are at distance FLT_MAX, so the next landmark falls into
+ * a component that has none yet.
+ */
+static float *landmark_distances(vtx_data * graph, int n, int k,
+				 int *landmarks)
+{
+    float *dists = gv_calloc((size_t)k * n, sizeof(float));
+    float *min_dist = gv_calloc(n, sizeof(float));
+    DistType *Di = graph->ewgts ? NULL : gv_calloc(n, sizeof(DistType));
+    int next = 0;
+
+    for (int i = 0; i < n; i++)
+	min_dist[i] = FLT_MAX;
+    for (int q = 0; q < k; q++) {
+	float *row = dists + (size_t)q * n;
+	landmarks[q] = next;
+	if (graph->ewgts) {
+	    dijkstra_f(next, graph, n, row);
+	} else {
+	    bfs(next, graph, n, Di);
+	    for (int i = 0; i < n; i++)
+		row[i] = Di[i] < 0 ? FLT_MAX : (float)Di[i];
+	}
+	float max_dist = -1;
+	for (int i = 0; i < n; i++) {
+	    min_dist[i] = fminf(min_dist[i], row[i]);
+	    if (min_dist[i] > max_dist) {
+		max_dist = min_dist[i];
+		next = i;
+	    }
+	}
+    }
+    free(Di);
+    free(min_dist);
+    return dists;
+}
+
+/* landmark_terms:
+ * Stress terms of the landmark model, as one row per node: entries[i].edges
+ * lists the nodes i is pulled towards, with the target distance in ewgts and
+ * the weight in eweights. entries[i].edges[0] is i itself, as in vtx_data,
+ * and is not a term.
+ *
+ * Each node has a term for each of its edges and one for every landmark it is
+ * not adjacent to. A landmark term only moves i, and stands in for the nodes
+ * of the landmark's region (those closer to it than to any other landmark)
+ * that are at most half as far from the landmark as i is.
+ */
+static vtx_data *landmark_terms(vtx_data * graph, int n, int k,
+				const int *landmarks, const float *dists,
+				int exp)
+{
+    /* keep the distances from each landmark into its region, sorted */
+    size_t *region_start = gv_calloc(k + 1, sizeof(size_t));
+    int *nearest = gv_calloc(n, sizeof(int));
+    for (int i = 0; i < n; i++) {
+	nearest[i] = -1;
+	for (int q = 0; q < k; q++) {
+	    const float d = dists[(size_t)q * n + i];
+	    if (d < FLT_MAX
+		&& (nearest[i] < 0 || d < dists[(size_t)nearest[i] * n + i]))
+		nearest[i] = q;
+	}
+	if (nearest[i] >= 0)
+	    region_start[nearest[i] + 1]++;
+    }
+    for (int q = 0; q < k; q++)
+	region_start[q + 1] += region_start[q];
+    float *region_dists = gv_calloc(region_start[k], sizeof(float));
+    size_t *fill = gv_calloc(k, sizeof(size_t));
+    for (int i = 0; i < n; i++) {
+	const int q = nearest[i];
+	if (q >= 0)
+	    region_dists[region_start[q] + fill[q]++] = dists[(size_t)q * n + i];
+    }
+    for (int q = 0; q < k; q++)
+	qsort(region_dists + region_start[q],
+	      region_start[q + 1] - region_start[q], sizeof(float), cmp_float);
+    free(fill);
+    free(nearest);
+
+    size_t nentries = 0;
+    for (int i = 0; i < n; i++)
+	nentries += graph[i].nedges + (size_t)k;
+    vtx_data *terms = gv_calloc(n, sizeof(vtx_data));
+    int *edges = gv_calloc(nentries, sizeof(int));
+    float *ewgts = gv_calloc(nentries, sizeof(float));
+    float *eweights = gv_calloc(nentries, sizeof(float));
+    int *mark = gv_calloc(n, sizeof(int));
+    for (int i = 0; i < n; i++)
+	mark[i] = -1;
+
+    for (int i = 0; i < n; i++) {
+	size_t count = 0;
+	terms[i].edges = edges;
+	terms[i].ewgts = ewgts;
+	terms[i].eweights = eweights;
+	edges[count++] = i;
+	mark[i] = i;
+	for (size_t e = 1; e < graph[i].nedges; e++) {
+	    const int j = graph[i].edges[e];
+	    if (mark[j] == i)
+		continue;
+	    mark[j] = i;
+	    const float d = graph[i].ewgts ? graph[i].ewgts[e] : 1.0f;
+	    edges[count] = j;
+	    ewgts[count] = d;
+	    eweights[count++] = 1.0f / (exp == 2 ? d * d : d);
+	}
+	for (int q = 0; q < k; q++) {
+	    const int p = landmarks[q];
+	    const float d = dists[(size_t)q * n + i];
+	    if (mark[p] == i || d == FLT_MAX)
+		continue;
+	    const size_t s = count_le(region_dists + region_start[q],
+				      region_start[q + 1] - region_start[q],
+				      d / 2);
+	    edges[count] = p;
+	    ewgts[count] = d;
+	    eweights[count++] = (float)s / (exp == 2 ? d * d : d);
+	}
+	terms[i].nedges = count;
+	edges += count;
+	ewgts += count;
+	eweights += count;
+    }
+
+    free(mark);
+    free(region_dists);
+    free(region_start);
+    return terms;
+}
+
+/// shared state of a parallel landmark majorization sweep
+typedef struct {
+    vtx_data *terms;
+    int dim;
+    double **coords;	 ///< current layout, read only during the sweep
+    double **next;	 ///< layout after the sweep
+    const bool *movable;
+    double *stress;	 ///< stress of 'coords' per chunk of nodes
+    size_t grain;
+} landmark_sweep_t;
+
+/* landmark_sweep_range:
+ * Move every movable node in [begin, end) to the position that minimizes
+ * the majorant of its own terms, holding all other nodes where they are.
+ */
+static void landmark_sweep_range(void *arg, size_t begin, size_t end)
+{
+    landmark_sweep_t *ctx = arg;
+    const int dim = ctx->dim;
+    double **x = ctx->coords;
+    double *acc = gv_calloc(dim, sizeof(double));
+    double stress = 0;
+
+    for (size_t i = begin; i < end; i++) {
+	const vtx_data *row = &ctx->terms[i];
+	double wsum = 0;
+	for (int d = 0; d < dim; d++)
+	    acc[d] = 0;
+	for (size_t e = 1; e < row->nedges; e++) {
+	    const int j = row->edges[e];
+	    const double target = row->ewgts[e];
+	    const double w = row->eweights[e];
+	    double len = 0;
+	    for (int d = 0; d < dim; d++)
+		len += (x[d][i] - x[d][j]) * (x[d][i] - x[d][j]);
+	    len = sqrt(len);
+	    stress += w * (len - target) * (len - target);
+	    const double r = len > 0 ? target / len : 0;
+	    for (int d = 0; d < dim; d++)
+		acc[d] += w * (x[d][j] + r * (x[d][i] - x[d][j]));
+	    wsum += w;
+	}
+	for (int d = 0; d < dim; d++) {
+	    ctx->next[d][i] =
+		ctx->movable[i] && wsum > 0 ? acc[d] / wsum : x[d][i];
+	}
+    }
+    ctx->stress[begin / ctx->grain] = stress;
+    free(acc);
+}
+
+/* stress_majorization_landmarks:
+ * Stress majorization over the landmark model built by landmark_terms.
+ * Nothing here is quadratic in n: the model has O(k·n + |E|) terms, and as
+ * landmark terms are one-sided there is no symmetric system to solve.
+ * Instead each iteration moves all nodes at once to their localized
+ * majorization optimum, spread over the threads the graph's threads
+ * attribute allows.
+ * Works on d_coords in place and returns the number of iterations.
+ */
+static int stress_majorization_landmarks(vtx_data * graph, int n,
+					 double **d_coords, node_t ** nodes,
+					 int dim, int exp, int maxi)
+{
+    const int k = MIN(n, num_landmarks_stress);
+    int *landmarks = gv_calloc(k, sizeof(int));
+    int iterations;
+    double old_stress = DBL_MAX;
+    bool converged;
+
+    float *dists = landmark_distances(graph, n, k, landmarks);
+    vtx_data *terms = landmark_terms(graph, n, k, landmarks, dists, exp);
+    free(dists);
+    free(landmarks);
+
+    bool *movable = gv_calloc(n, sizeof(bool));
+    for (int i = 0; i < n; i++)
+	movable[i] = !isFixed(nodes[i]);
+    double **next = gv_calloc(dim, sizeof(double *));
+    next[0] = gv_calloc((size_t)dim * n, sizeof(double));
+    for (int d = 1; d < dim; d++)
+	next[d] = next[0] + (size_t)d * n;
+
+    const int threads = get_threads(agraphof(nodes[0]));
+    const size_t grain = 256;
+    const size_t chunks = ((size_t)n + grain - 1) / grain;
+    landmark_sweep_t ctx = {.terms = terms, .dim = dim, .coords = d_coords,
+			    .next = next, .movable = movable,
+			    .stress = gv_calloc(chunks, sizeof(double)),
+			    .grain = grain};
+
+    for (converged = false, iterations = 0;
+	 iterations < maxi && !converged; iterations++) {
+	gv_parallel_for_threads(threads, (size_t)n, grain,
+			       landmark_sweep_range, &ctx);
+
+	/* sum in a fixed order, so the result does not depend on threads */
+	double new_stress = 0;
+	for (size_t c = 0; c < chunks; c++)
+	    new_stress += ctx.stress[c];
+	{
+	    double diff = old_stress - new_stress;
+	    double change = fabs(diff);
+	    converged = change / old_stress < Epsilon || new_stress < Epsilon;
+	}
+	old_stress = new_stress;
+
+	for (int d = 0; d < dim; d++)
+	    memcpy(d_coords[d], next[d], n * sizeof(double));
+
+	if (Verbose && iterations % 5 == 0) {
+	    fprintf(stderr, "%.3f ", new_stress);
+	    if ((iterations + 5) % 50 == 0)
+		fprintf(stderr, "\n");
+	}
+    }
+    if (Verbose) {
+	fprintf(stderr, "\nfinal e = %f %d iterations %.2f sec\n",
+		old_stress, iterations, elapsed_sec());
+    }
+
+    free(ctx.stress);
+    free(next[0]);
+    free(next);
+    free(movable);
+    free(terms[0].edges);
+    free(terms[0].ewgts);
+    free(terms[0].eweights);
+    free(terms);
+    return iterations;
+}
+
 /* stress_majorization_kD_mkernel:
  * At present, if any nodes have pos set, smart_ini is false.
  */
@@ -849,7 +1144,11 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
     if (Verbose)
 	start_timer();
 
-    if (model == MODEL_SUBSET) {
+    if (model == MODEL_LANDMARK) {
+	/* distances come from the landmarks, after initialization */
+	if (Verbose)
+	    fprintf(stderr, "Using landmark model");
+    } else if (model == MODEL_SUBSET) {
 	/* weight graph to separate high-degree nodes */
 	/* and perform slower Dijkstra-based computation */
 	if (Verbose)
@@ -868,7 +1167,7 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 	    fprintf(stderr, "Calculating MDS model");
 	Dij = mdsModel(graph, n);
     }
-    if (!Dij) {
+    if (!Dij && model != MODEL_LANDMARK) {
 	if (Verbose)
 	    fprintf(stderr, "Calculating shortest paths");
 	if (graph->ewgts)
@@ -927,6 +1226,15 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 	return 0;
     }
 
+    if (model == MODEL_LANDMARK) {
+	if (Verbose) {
+	    fprintf(stderr, "\nSolving landmark model: ");
+	    start_timer();
+	}
+	return stress_majorization_landmarks(graph, n, d_coords, nodes, dim,
+					     exp, maxi);
+    }
+
     if (Verbose) {
 	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
 	fprintf(stderr, "Setting up stress function");
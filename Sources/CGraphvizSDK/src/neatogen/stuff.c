@@ -21,7 +21,7 @@
 #include	<unistd.h>
 #endif
 
-static double Epsilon2;
+static _Thread_local double Epsilon2;
 static Agnode_t *choose_node(graph_t *, int);
 static void make_spring(graph_t *, Agnode_t *, Agnode_t *, double);
 static void move_node(graph_t *, int, Agnode_t *);
@@ -516,7 +516,7 @@ node_t *choose_node(graph_t * G, int nG)
     int i, k;
     double m, max;
     node_t *choice, *np;
-    static int cnt = 0;
+    static _Thread_local int cnt = 0;
 
     cnt++;
     if (GD_move(G) >= MaxIter)
@@ -576,9 +576,9 @@ void move_node(graph_t * G, int nG, node_t * n)
     free(a);
 }
 
-static node_t **Heap;
-static int Heapsize;
-static node_t *Src;
+static _Thread_local node_t **Heap;
+static _Thread_local int Heapsize;
+static _Thread_local node_t *Src;
 
 static void heapup(node_t * v)
 {
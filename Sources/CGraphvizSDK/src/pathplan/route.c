@@ -30,8 +30,8 @@ typedef struct tna_t {
 
 #define POINTSIZE sizeof (Ppoint_t)
 
-static Ppoint_t *ops;
-static size_t opn, opl;
+static _Thread_local Ppoint_t *ops;
+static _Thread_local size_t opn, opl;
 
 static int reallyroutespline(Pedge_t *, size_t,
 			     Ppoint_t *, int, Ppoint_t, Ppoint_t);
@@ -100,8 +100,8 @@ static int reallyroutespline(Pedge_t *edges, size_t edgen, Ppoint_t *inps,
     double maxd, d, t;
     int maxi, i, spliti;
 
-    static tna_t *tnas;
-    static int tnan;
+    static _Thread_local tna_t *tnas;
+    static _Thread_local int tnan;
 
     if (tnan < inpn) {
 	tna_t *new_tnas = realloc(tnas, sizeof(tna_t) * (size_t)inpn);
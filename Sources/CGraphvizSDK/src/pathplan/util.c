@@ -58,8 +58,8 @@ int Ppolybarriers(Ppoly_t ** polys, int npolys, Pedge_t ** barriers,
 void
 make_polyline(Ppolyline_t line, Ppolyline_t* sline)
 {
-    static size_t isz = 0;
-    static Ppoint_t* ispline = 0;
+    static _Thread_local size_t isz = 0;
+    static _Thread_local Ppoint_t* ispline = 0;
     const size_t npts = 4 + 3 * (line.pn - 2);
 
     if (npts > isz) {
@@ -11,14 +11,25 @@
 #include <sfdpgen/Multilevel.h>
 #include <assert.h>
 #include <common/arith.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <util/alloc.h>
+#include <util/parallel.h>
 #include <util/random.h>
 
 static const int minsize = 4;
 static const double min_coarsen_factor = 0.75;
 
+/* levels with at least this many nodes are coarsened in parallel. The parallel
+   matching pairs nodes differently from the serial one, so this does not
+   depend on the thread count: a graph gets the same hierarchy on any machine */
+static const int parallel_coarsen_size = 50000;
+
+/* rounds of handshaking before the remaining nodes are left unmatched */
+static const int max_handshake_rounds = 16;
+
 static Multilevel Multilevel_init(SparseMatrix A) {
   if (!A) return NULL;
   assert(A->m == A->n);
@@ -51,14 +62,40 @@ void Multilevel_delete(Multilevel grid){
   free(grid);
 }
 
+/* put each supervariable (nodes with identical neighborhoods) into clusters of
+   at most MAX_CLUSTER_SIZE, and mark their nodes as matched */
+static void cluster_supervariables(SparseMatrix A, int *cluster, int *clusterp,
+                                   int *ncluster, int *nz, int *matched,
+                                   int matched_value) {
+  int i, j, nz0, nsuper, *super = NULL, *superp = NULL;
+
+  SparseMatrix_decompose_to_supervariables(A, &nsuper, &super, &superp);
+
+  for (i = 0; i < nsuper; i++){
+    if (superp[i+1] - superp[i] <= 1) continue;
+    nz0 = clusterp[*ncluster];
+    for (j = superp[i]; j < superp[i+1]; j++){
+      matched[super[j]] = matched_value;
+      cluster[(*nz)++] = super[j];
+      if (*nz - nz0 >= MAX_CLUSTER_SIZE){
+	clusterp[++(*ncluster)] = *nz;
+	nz0 = *nz;
+      }
+    }
+    if (*nz > nz0) clusterp[++(*ncluster)] = *nz;
+  }
+
+  free(super);
+  free(superp);
+}
+
 static void maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(SparseMatrix A, int **cluster, int **clusterp, int *ncluster){
   int i, ii, j, *ia, *ja, m, n;
   (void)n;
   double *a, amax = 0;
   int jamax = 0;
-  int *matched, nz, nz0;
+  int *matched, nz;
   enum {MATCHED = -1};
-  int  nsuper, *super = NULL, *superp = NULL;
 
   assert(A);
   assert(A->is_pattern_symmetric);
@@ -76,26 +113,12 @@ static void maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(S
   assert(SparseMatrix_is_symmetric(A, false));
   assert(A->type == MATRIX_TYPE_REAL);
 
-  SparseMatrix_decompose_to_supervariables(A, &nsuper, &super, &superp);
-
   *ncluster = 0;
   (*clusterp)[0] = 0;
   nz = 0;
   a = A->a;
 
-  for (i = 0; i < nsuper; i++){
-    if (superp[i+1] - superp[i] <= 1) continue;
-    nz0 = (*clusterp)[*ncluster];
-    for (j = superp[i]; j < superp[i+1]; j++){
-      matched[super[j]] = MATCHED;
-      (*cluster)[nz++] = super[j];
-      if (nz - nz0 >= MAX_CLUSTER_SIZE){
-	(*clusterp)[++(*ncluster)] = nz;
-	nz0 = nz;
-      }
-    }
-    if (nz > nz0) (*clusterp)[++(*ncluster)] = nz;
-  }
+  cluster_supervariables(A, *cluster, *clusterp, ncluster, &nz, matched, MATCHED);
 
   int *const p = gv_permutation(m);
   for (ii = 0; ii < m; ii++){
@@ -134,15 +157,235 @@ static void maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(S
   }
   free(p);
 
-  free(super);
+  free(matched);
+}
 
-  free(superp);
+enum {IN_SUPERVARIABLE = -2}; /* besides UNMATCHED */
+
+/* state of the handshake matching, shared by the threads of one round */
+typedef struct {
+  SparseMatrix A;
+  const int *rank; /* position of each node in a random permutation */
+  int *partner;    /* matched neighbor, UNMATCHED or IN_SUPERVARIABLE */
+  int *candidate;  /* neighbor each unmatched node proposes to, or -1 */
+  atomic_int matched_pairs;
+} handshake_t;
+
+/* whether edge {i, k} ranks before edge {i, l} among equally heavy edges. The
+   order only depends on the edges, not on which end looks at them, so the
+   first unmatched edge in it is always proposed from both ends */
+static bool handshake_before(const int *rank, int i, int k, int l) {
+  const int lo_k = MIN(rank[i], rank[k]), hi_k = MAX(rank[i], rank[k]);
+  const int lo_l = MIN(rank[i], rank[l]), hi_l = MAX(rank[i], rank[l]);
+  return lo_k < lo_l || (lo_k == lo_l && hi_k < hi_l);
+}
 
-  free(matched);
+/* every unmatched node proposes to its heaviest unmatched neighbor */
+static void handshake_propose(void *ctx, size_t begin, size_t end) {
+  handshake_t *h = ctx;
+  const int *ia = h->A->ia, *ja = h->A->ja;
+  const double *a = h->A->a;
+  for (int i = (int)begin; i < (int)end; i++){
+    int best = -1;
+    if (h->partner[i] == UNMATCHED) {
+      for (int j = ia[i]; j < ia[i+1]; j++){
+        const int k = ja[j];
+        if (k == i || h->partner[k] != UNMATCHED) continue;
+        if (best < 0 || a[j] > a[best] ||
+            (a[j] == a[best] && handshake_before(h->rank, i, k, ja[best]))) {
+          best = j;
+        }
+      }
+    }
+    h->candidate[i] = best < 0 ? -1 : ja[best];
+  }
+}
+
+/* nodes that proposed to each other are matched */
+static void handshake_accept(void *ctx, size_t begin, size_t end) {
+  handshake_t *h = ctx;
+  int pairs = 0;
+  for (int i = (int)begin; i < (int)end; i++){
+    const int k = h->candidate[i];
+    if (k >= 0 && h->candidate[k] == i) {
+      h->partner[i] = k;
+      if (i < k) pairs++;
+    }
+  }
+  atomic_fetch_add(&h->matched_pairs, pairs);
+}
+
+/* as maximal_independent_edge_set_heavest_edge_pernode_supernodes_first, but
+   pairs are found by handshaking: in each round every unmatched node proposes
+   to its heaviest unmatched neighbor, and mutual proposals become matches.
+   Each round only reads the state left by the previous one, so the result does
+   not depend on the number of threads. */
+static void handshake_matching_supernodes_first(SparseMatrix A, int threads,
+                                                int **cluster, int **clusterp,
+                                                int *ncluster) {
+  int i, ii, m = A->m, nz = 0;
+
+  assert(A->is_pattern_symmetric);
+  assert(A->m == A->n);
+  assert(A->type == MATRIX_TYPE_REAL);
+  *cluster = gv_calloc(m, sizeof(int));
+  *clusterp = gv_calloc(m + 1, sizeof(int));
+  *ncluster = 0;
+
+  handshake_t h = {.A = A};
+  h.partner = gv_calloc(m, sizeof(int));
+  h.candidate = gv_calloc(m, sizeof(int));
+  for (i = 0; i < m; i++) h.partner[i] = UNMATCHED;
+
+  cluster_supervariables(A, *cluster, *clusterp, ncluster, &nz, h.partner, IN_SUPERVARIABLE);
+
+  /* drawn even though only its order is used, to keep the random sequence the
+     same as with the serial matching */
+  int *const p = gv_permutation(m);
+  int *rank = gv_calloc(m, sizeof(int));
+  for (ii = 0; ii < m; ii++) rank[p[ii]] = ii;
+  h.rank = rank;
+
+  for (int round = 0; round < max_handshake_rounds; round++){
+    atomic_store(&h.matched_pairs, 0);
+    gv_parallel_for_threads(threads, (size_t)m, 4096, handshake_propose, &h);
+    gv_parallel_for_threads(threads, (size_t)m, 4096, handshake_accept, &h);
+    if (atomic_load(&h.matched_pairs) == 0) break;
+  }
+
+  /* pairs in permutation order, like the serial matching, then the rest */
+  for (ii = 0; ii < m; ii++){
+    i = p[ii];
+    const int k = h.partner[i];
+    if (k >= 0 && rank[i] < rank[k]) {
+      (*cluster)[nz++] = i;
+      (*cluster)[nz++] = k;
+      (*clusterp)[++(*ncluster)] = nz;
+    }
+  }
+  for (i = 0; i < m; i++){
+    if (h.partner[i] == UNMATCHED){
+      (*cluster)[nz++] = i;
+      (*clusterp)[++(*ncluster)] = nz;
+    }
+  }
+  assert(nz == m);
+
+  free(p);
+  free(rank);
+  free(h.partner);
+  free(h.candidate);
+}
+
+/* one off-diagonal entry of a coarse row, before entries with the same column
+   are summed */
+typedef struct {
+  int col;
+  int seq; /* position in the row, so equal columns are summed in order */
+  double val;
+} coarse_entry;
+
+static int coarse_entry_cmp(const void *x, const void *y) {
+  const coarse_entry *a = x, *b = y;
+  if (a->col != b->col) return a->col < b->col ? -1 : 1;
+  return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+/* state of the parallel Galerkin product */
+typedef struct {
+  SparseMatrix A;
+  const int *cluster, *clusterp;
+  const int *cid;   /* coarse node of each fine node */
+  const int *start; /* where each coarse row starts in `entries` */
+  int *count;       /* entries left in each coarse row after summing */
+  coarse_entry *entries;
+  SparseMatrix cA;
+} galerkin_t;
+
+/* gather, sort and sum the entries of coarse rows [begin, end) */
+static void galerkin_rows(void *ctx, size_t begin, size_t end) {
+  galerkin_t *g = ctx;
+  const int *ia = g->A->ia, *ja = g->A->ja;
+  const double *a = g->A->a;
+  for (int c = (int)begin; c < (int)end; c++){
+    coarse_entry *row = g->entries + g->start[c];
+    int n = 0;
+    for (int l = g->clusterp[c]; l < g->clusterp[c+1]; l++){
+      const int i = g->cluster[l];
+      for (int j = ia[i]; j < ia[i+1]; j++){
+        const int col = g->cid[ja[j]];
+        if (col == c) continue;
+        row[n] = (coarse_entry){.col = col, .seq = n, .val = a[j]};
+        n++;
+      }
+    }
+    qsort(row, (size_t)n, sizeof(coarse_entry), coarse_entry_cmp);
+    int distinct = 0;
+    for (int l = 0; l < n; l++){
+      if (distinct > 0 && row[distinct-1].col == row[l].col) {
+        row[distinct-1].val += row[l].val;
+      } else {
+        row[distinct++] = row[l];
+      }
+    }
+    g->count[c] = distinct;
+  }
+}
+
+static void galerkin_copy(void *ctx, size_t begin, size_t end) {
+  galerkin_t *g = ctx;
+  int *ja = g->cA->ja;
+  double *a = g->cA->a;
+  for (int c = (int)begin; c < (int)end; c++){
+    const coarse_entry *row = g->entries + g->start[c];
+    for (int l = 0, j = g->cA->ia[c]; l < g->count[c]; l++, j++){
+      ja[j] = row[l].col;
+      a[j] = row[l].val;
+    }
+  }
+}
+
+/* the off-diagonal part of R A P, where P maps each fine node to its cluster
+   and R = Pᵀ: coarse entry (c, d) is the sum of A over rows in cluster c and
+   columns in cluster d. Rows are independent, so they are computed in
+   parallel, with columns sorted and repeated entries summed in a fixed order */
+static SparseMatrix galerkin_product(SparseMatrix A, const int *cluster,
+                                     const int *clusterp, int ncluster,
+                                     int threads) {
+  int n = A->m, c, l;
+  int *cid = gv_calloc(n, sizeof(int));
+  int *start = gv_calloc(ncluster + 1, sizeof(int));
+  for (c = 0; c < ncluster; c++){
+    start[c+1] = start[c];
+    for (l = clusterp[c]; l < clusterp[c+1]; l++){
+      cid[cluster[l]] = c;
+      start[c+1] += A->ia[cluster[l]+1] - A->ia[cluster[l]];
+    }
+  }
+
+  galerkin_t g = {.A = A, .cluster = cluster, .clusterp = clusterp, .cid = cid, .start = start};
+  g.count = gv_calloc(ncluster, sizeof(int));
+  g.entries = gv_calloc(start[ncluster] > 0 ? start[ncluster] : 1, sizeof(coarse_entry));
+  gv_parallel_for_threads(threads, (size_t)ncluster, 1024, galerkin_rows, &g);
+
+  int nz = 0;
+  for (c = 0; c < ncluster; c++) nz += g.count[c];
+  g.cA = SparseMatrix_new(ncluster, ncluster, nz, MATRIX_TYPE_REAL, FORMAT_CSR);
+  g.cA->ia[0] = 0;
+  for (c = 0; c < ncluster; c++) g.cA->ia[c+1] = g.cA->ia[c] + g.count[c];
+  g.cA->nz = nz;
+  gv_parallel_for_threads(threads, (size_t)ncluster, 1024, galerkin_copy, &g);
+
+  free(cid);
+  free(start);
+  free(g.count);
+  free(g.entries);
+  return g.cA;
 }
 
 static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA,
-                                        SparseMatrix *P, SparseMatrix *R) {
+                                        SparseMatrix *P, SparseMatrix *R,
+                                        int threads) {
   int nc, nzc, n, i;
   int *irn = NULL, *jcn = NULL;
   double *val = NULL;
@@ -154,8 +397,13 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA,
   *P = NULL;
   *R = NULL;
   n = A->m;
+  const bool parallel = n >= parallel_coarsen_size;
 
-  maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(A, &cluster, &clusterp, &ncluster);
+  if (parallel) {
+    handshake_matching_supernodes_first(A, threads, &cluster, &clusterp, &ncluster);
+  } else {
+    maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(A, &cluster, &clusterp, &ncluster);
+  }
   assert(ncluster <= n);
   nc = ncluster;
   if (nc == n || nc < minsize) {
@@ -180,9 +428,13 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA,
   assert(nzc == n);
   *P = SparseMatrix_from_coordinate_arrays(nzc, n, nc, irn, jcn, val,
                                            MATRIX_TYPE_REAL, sizeof(double));
-  *R = SparseMatrix_transpose(*P);
+  *R = SparseMatrix_transpose(*P, threads);
 
-  *cA = SparseMatrix_multiply3(*R, A, *P); 
+  if (parallel) {
+    *cA = galerkin_product(A, cluster, clusterp, ncluster, threads);
+  } else {
+    *cA = SparseMatrix_multiply3(*R, A, *P);
+  }
   if (!*cA) goto RETURN;
 
   *R = SparseMatrix_divide_row_by_degree(*R);
@@ -200,7 +452,7 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA,
 }
 
 static void Multilevel_coarsen(SparseMatrix A, SparseMatrix *cA,
-                               SparseMatrix *P, SparseMatrix *R) {
+                               SparseMatrix *P, SparseMatrix *R, int threads) {
   SparseMatrix cA0 = A, P0 = NULL, R0 = NULL, M;
   int nc = 0, n;
   
@@ -209,7 +461,7 @@ static void Multilevel_coarsen(SparseMatrix A, SparseMatrix *cA,
   n = A->n;
 
   do {/* this loop force a sufficient reduction */
-    Multilevel_coarsen_internal(A, &cA0, &P0, &R0);
+    Multilevel_coarsen_internal(A, &cA0, &P0, &R0, threads);
     if (!cA0) return;
     nc = cA0->n;
 #ifdef DEBUG_PRINT
@@ -217,11 +469,11 @@ static void Multilevel_coarsen(SparseMatrix A, SparseMatrix *cA,
 #endif
     if (*P){
       assert(*R);
-      M = SparseMatrix_multiply(*P, P0);
+      M = SparseMatrix_multiply(*P, P0, threads);
       SparseMatrix_delete(*P);
       SparseMatrix_delete(P0);
       *P = M;
-      M = SparseMatrix_multiply(R0, *R);
+      M = SparseMatrix_multiply(R0, *R, threads);
       SparseMatrix_delete(*R);
       SparseMatrix_delete(R0);
       *R = M;
@@ -264,7 +516,7 @@ static Multilevel Multilevel_establish(Multilevel grid,
 #endif
     return grid;
   }
-  Multilevel_coarsen(A, &cA, &P, &R);
+  Multilevel_coarsen(A, &cA, &P, &R, ctrl.threads);
   if (!cA) return grid;
 
   cgrid = Multilevel_init(cA);
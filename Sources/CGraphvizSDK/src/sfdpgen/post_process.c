@@ -119,6 +119,7 @@ StressMajorizationSmoother StressMajorizationSmoother2_new(SparseMatrix A, int d
   sm->scheme = SM_SCHEME_NORMAL;
   sm->tol_cg = 0.01;
   sm->maxit_cg = floor(sqrt(A->m));
+  sm->threads = 1;
 
   lambda = sm->lambda = gv_calloc(m, sizeof(double));
   for (i = 0; i < m; i++) sm->lambda[i] = lambda0;
@@ -319,6 +320,7 @@ StressMajorizationSmoother SparseStressMajorizationSmoother_new(SparseMatrix A,
   sm->D = A;
   sm->tol_cg = 0.01;
   sm->maxit_cg = floor(sqrt(A->m));
+  sm->threads = 1;
 
   lambda = sm->lambda = gv_calloc(m, sizeof(double));
 
@@ -535,6 +537,7 @@ double StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim,
   int i, j, k, m, *id, *jd, *iw, *jw, idiag, iter = 0;
   double *w, *dd, *d, *y = NULL, *x0 = NULL, *x00 = NULL, diag, diff = 1, *lambda = sm->lambda;
   SparseMatrix Lc = NULL;
+  SparseSolver solver = NULL;
   double dij, dist;
 
   const double tol = 0.001;
@@ -564,9 +567,13 @@ double StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim,
   /* for the additional matrix L due to the position constraints */
   if (sm->scheme == SM_SCHEME_NORMAL_ELABEL){
     get_edge_label_matrix(sm->data, m, dim, x, &Lc, &x00);
-    if (Lc) Lw = SparseMatrix_add(Lw, Lc);
+    if (Lc) Lw = SparseMatrix_add(Lw, Lc, sm->threads);
   }
 
+  /* Lw stays the same from one iteration to the next, so the preconditioner
+     is built once; each solve starts from the previous iteration's layout. */
+  solver = SparseSolver_new(Lw, sm->precon, sm->grid, sm->threads);
+
   while (iter++ < maxit_sm && diff > tol){
 
     for (i = 0; i < m; i++){
@@ -597,7 +604,7 @@ double StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim,
     }
     /* solve (Lw+lambda*I) x = Lwdd y + lambda x0 */
 
-    SparseMatrix_multiply_dense(Lwdd, x, y, dim);
+    SparseMatrix_multiply_dense(Lwdd, x, y, dim, sm->threads);
 
     if (lambda){/* is there a penalty term? */
       for (i = 0; i < m; i++){
@@ -627,7 +634,7 @@ double StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim,
     }
 #endif
 
-    SparseMatrix_solve(Lw, dim, x, y,  sm->tol_cg, sm->maxit_cg);
+    SparseSolver_solve(solver, dim, x, y,  sm->tol_cg, sm->maxit_cg);
 
 #ifdef DEBUG_PRINT
     if (Verbose) fprintf(stderr, "stress2 = %g\n",get_stress(m, dim, iw, jw, w, d, y, sm->scaling));
@@ -647,11 +654,18 @@ double StressMajorizationSmoother_smooth(StressMajorizationSmoother sm, int dim,
   _statistics[1] += iter-1;
 #endif
 
+  if (Verbose) {
+    fprintf(stderr, "stress majorization: %d iterations, %d cg iterations for %d solves (%s), setup %.3f sec, solve %.3f sec\n",
+            iter - 1, solver->iterations, solver->solves, precon_name(solver->precon),
+            solver->setup_time, solver->solve_time);
+  }
+
 #ifdef DEBUG_PRINT
   if (Verbose) fprintf(stderr, "iter = %d, final stress = %f\n", iter, get_stress(m, dim, iw, jw, w, d, x, sm->scaling));
 #endif
 
  RETURN:
+  SparseSolver_delete(solver);
   SparseMatrix_delete(Lwdd);
   if (Lc) {
     SparseMatrix_delete(Lc);
@@ -703,6 +717,7 @@ TriangleSmoother TriangleSmoother_new(SparseMatrix A, int dim, double *x,
   sm->scheme = SM_SCHEME_NORMAL;
   sm->tol_cg = 0.01;
   sm->maxit_cg = floor(sqrt(A->m));
+  sm->threads = 1;
 
   double *lambda = sm->lambda = gv_calloc(m, sizeof(double));
   
@@ -718,7 +733,7 @@ TriangleSmoother TriangleSmoother_new(SparseMatrix A, int dim, double *x,
 
 
 
-  sm->Lw = SparseMatrix_add(A, B);
+  sm->Lw = SparseMatrix_add(A, B, sm->threads);
 
   SparseMatrix_delete(B);
   sm->Lwd = SparseMatrix_copy(sm->Lw);
@@ -909,7 +924,8 @@ void SpringSmoother_smooth(SpringSmoother sm, SparseMatrix A, int dim, double *x
 
 /*=============================== end of spring and spring-electrical based smoother =========== */
 
-void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control ctrl, double *x) {
+void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control ctrl,
+                            Multilevel grid, double *x) {
 #ifdef TIME
   clock_t  cpu;
 #endif
@@ -929,6 +945,9 @@ void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control c
       } else {
         sm = TriangleSmoother_new(A, dim, x, true);
       }
+      sm->precon = ctrl->precon;
+      sm->grid = grid;
+      sm->threads = ctrl->threads;
       TriangleSmoother_smooth(sm, dim, x);
       TriangleSmoother_delete(sm);
     }
@@ -950,6 +969,9 @@ void post_process_smoothing(int dim, SparseMatrix A, spring_electrical_control c
       }
 
       sm = StressMajorizationSmoother2_new(A, dim, 0.05, x, dist_scheme);
+      sm->precon = ctrl->precon;
+      sm->grid = grid;
+      sm->threads = ctrl->threads;
       StressMajorizationSmoother_smooth(sm, dim, x, 50);
       StressMajorizationSmoother_delete(sm);
       break;
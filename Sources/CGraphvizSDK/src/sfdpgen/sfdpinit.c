@@ -18,6 +18,7 @@
 #include <pack/pack.h>
 #include <assert.h>
 #include <sfdpgen/spring_electrical.h>
+#include <sfdpgen/sparse_solve.h>
 #include <neatogen/overlap.h>
 #include <sfdpgen/stress_model.h>
 #include <cgraph/cgraph.h>
@@ -193,6 +194,22 @@ late_quadtree_scheme (graph_t* g, Agsym_t* sym, int dflt)
     return rv;
 }
 
+static int
+late_precon (graph_t* g, Agsym_t* sym, int dflt)
+{
+    char* s;
+
+    if (!sym) return dflt;
+    s = agxget (g, sym);
+    if (!strcasecmp(s, "jacobi"))
+	return PRECON_JACOBI;
+    if (!strcasecmp(s, "ic0"))
+	return PRECON_IC0;
+    if (!strcasecmp(s, "amg"))
+	return PRECON_AMG;
+    return dflt;
+}
+
 
 /* tuneControl:
  * Use user values to reset control
@@ -219,6 +236,8 @@ tuneControl (graph_t* g, spring_electrical_control ctrl)
     ctrl->do_shrinking = mapBool(agget(g, "overlap_shrink"), true);
     ctrl->rotation = late_double(g, agfindgraphattr(g, "rotation"), 0.0, -DBL_MAX);
     ctrl->edge_labeling_scheme = late_int(g, agfindgraphattr(g, "label_scheme"), 0, 0);
+    ctrl->threads = get_threads(g);
+    ctrl->precon = late_precon(g, agfindgraphattr(g, "smoothing_precon"), PRECON_JACOBI);
     if (ctrl->edge_labeling_scheme > 4) {
 	agwarningf("label_scheme = %d > 4 : ignoring\n", ctrl->edge_labeling_scheme);
 	ctrl->edge_labeling_scheme = 0;
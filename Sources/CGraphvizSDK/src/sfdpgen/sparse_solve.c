@@ -16,10 +16,41 @@
 #include <common/arith.h>
 #include <common/types.h>
 #include <common/globals.h>
+#include <stdlib.h>
+#include <time.h>
 #include <util/alloc.h>
 
 /* #define DEBUG_PRINT */
 
+/* AMG hierarchies stop at this many levels or at a level this small */
+enum {AMG_MAX_LEVELS = 25, AMG_COARSEST_SIZE = 200};
+
+#define AMG_DAMPING (2. / 3.)
+
+/* minimum size ratio between consecutive AMG levels */
+enum {AMG_COARSENING = 4};
+
+/* symmetric Gauss-Seidel sweep pairs that stand in for an exact solve on the
+   coarsest AMG level */
+enum {AMG_COARSE_SWEEPS = 10};
+
+static double seconds_since(const struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)(end.tv_sec - start->tv_sec) + (double)(end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+const char *precon_name(int precon) {
+  switch (precon) {
+  case PRECON_IC0:
+    return "ic0";
+  case PRECON_AMG:
+    return "amg";
+  default:
+    return "jacobi";
+  }
+}
+
 static double *diag_precon(const double *diag, double *x, double *y) {
   int i, m;
   m = (int) diag[0];
@@ -51,9 +82,284 @@ static double *diag_precon_new(SparseMatrix A) {
   return data;
 }
 
-static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
-                                 double *x, double *rhs, double tol,
-                                 double maxit) {
+/*------------------ incomplete Cholesky ------------------- */
+
+/* A ≈ L Lᵀ with L restricted to the lower triangle of A. Rows of L are sorted
+   by column and end with the diagonal. */
+typedef struct {
+  int n;
+  int *ia, *ja;
+  double *a;
+  double *y;/* work vector */
+} ic0_t;
+
+typedef struct {
+  int col;
+  double val;
+} ic0_entry;
+
+static int ic0_entry_cmp(const void *a, const void *b) {
+  const ic0_entry *x = a, *y = b;
+  return (x->col > y->col) - (x->col < y->col);
+}
+
+static ic0_t *ic0_new(SparseMatrix A) {
+  int i, j, k, p, q, n = A->m, *ia = A->ia, *ja = A->ja, nz = 0;
+  double *a = A->a, s, aii;
+
+  assert(A->type == MATRIX_TYPE_REAL);
+
+  ic0_t *ic = gv_alloc(sizeof(ic0_t));
+  ic->n = n;
+  ic->ia = gv_calloc(n + 1, sizeof(int));
+  /* every row gets a diagonal, even when A lacks one */
+  ic->ja = gv_calloc(A->nz + n, sizeof(int));
+  ic->a = gv_calloc(A->nz + n, sizeof(double));
+  ic->y = gv_calloc(n, sizeof(double));
+  ic0_entry *row = gv_calloc(n, sizeof(ic0_entry));
+
+  for (i = 0; i < n; i++) {
+    k = 0;
+    aii = 0;
+    for (j = ia[i]; j < ia[i+1]; j++) {
+      if (ja[j] < i) {
+        row[k].col = ja[j];
+        row[k++].val = a[j];
+      } else if (ja[j] == i) {
+        aii += a[j];
+      }
+    }
+    qsort(row, k, sizeof(ic0_entry), ic0_entry_cmp);
+    for (j = 0; j < k; j++) {
+      ic->ja[nz] = row[j].col;
+      ic->a[nz++] = row[j].val;
+    }
+    ic->ja[nz] = i;
+    ic->a[nz++] = aii;
+    ic->ia[i+1] = nz;
+  }
+  free(row);
+
+  /* L[i,k] = (A[i,k] - Σ_{j<k} L[i,j] L[k,j]) / L[k,k] */
+  for (i = 0; i < n; i++) {
+    const int diag = ic->ia[i+1] - 1;
+    for (p = ic->ia[i]; p < diag; p++) {
+      k = ic->ja[p];
+      s = ic->a[p];
+      j = ic->ia[i];
+      q = ic->ia[k];
+      while (j < p && q < ic->ia[k+1] - 1) {
+        if (ic->ja[j] < ic->ja[q]) {
+          j++;
+        } else if (ic->ja[j] > ic->ja[q]) {
+          q++;
+        } else {
+          s -= ic->a[j++] * ic->a[q++];
+        }
+      }
+      ic->a[p] = s / ic->a[ic->ia[k+1] - 1];
+    }
+    aii = ic->a[diag];
+    s = aii;
+    for (p = ic->ia[i]; p < diag; p++) s -= ic->a[p] * ic->a[p];
+    /* dropped fill can make the pivot vanish; keep the factor positive */
+    if (s <= 1e-8 * fabs(aii)) s = fabs(aii) > 0 ? fabs(aii) : 1.;
+    ic->a[diag] = sqrt(s);
+  }
+  return ic;
+}
+
+static void ic0_delete(ic0_t *ic) {
+  if (!ic) return;
+  free(ic->ia);
+  free(ic->ja);
+  free(ic->a);
+  free(ic->y);
+  free(ic);
+}
+
+/* y = (L Lᵀ)⁻¹ x */
+static double *ic0_precon(ic0_t *ic, const double *x, double *y) {
+  int i, p, n = ic->n, *ia = ic->ia, *ja = ic->ja;
+  double *a = ic->a, *t = ic->y, s;
+
+  for (i = 0; i < n; i++) {
+    s = x[i];
+    for (p = ia[i]; p < ia[i+1] - 1; p++) s -= a[p] * t[ja[p]];
+    t[i] = s / a[ia[i+1] - 1];
+  }
+  for (i = n - 1; i >= 0; i--) {
+    y[i] = t[i] / a[ia[i+1] - 1];
+    for (p = ia[i]; p < ia[i+1] - 1; p++) t[ja[p]] -= a[p] * y[i];
+  }
+  return y;
+}
+
+/*------------------ aggregation AMG ------------------- */
+
+typedef struct {
+  SparseMatrix A;/* operator of this level, A_{l+1} = Pᵀ A_l P */
+  SparseMatrix P, R;/* prolongation from the next coarser level, R = Pᵀ */
+  double *diag;
+  double *x, *b, *r;/* work vectors */
+} amg_level;
+
+typedef struct {
+  int nlevels;
+  amg_level *levels;
+  int threads;/* as in SparseSolver */
+} amg_t;
+
+static double *amg_diag(SparseMatrix A) {
+  int i, j;
+  double *diag = gv_calloc(A->m, sizeof(double)), *a = A->a;
+
+  for (i = 0; i < A->m; i++) {
+    for (j = A->ia[i]; j < A->ia[i+1]; j++) {
+      if (A->ja[j] == i) diag[i] += a[j];
+    }
+  }
+  return diag;
+}
+
+/* Levels follow the coarsening of grid: its aggregates become the coarse
+   unknowns. Returns NULL if grid does not describe the nodes of A. */
+static amg_t *amg_new(SparseMatrix A, Multilevel grid, int threads) {
+  Multilevel g;
+  int l;
+
+  if (!grid || grid->n != A->m || !grid->next || A->type != MATRIX_TYPE_REAL)
+    return NULL;
+
+  amg_t *amg = gv_alloc(sizeof(amg_t));
+  amg->levels = gv_calloc(AMG_MAX_LEVELS, sizeof(amg_level));
+  amg->levels[0].A = A;
+  amg->nlevels = 1;
+  amg->threads = threads;
+  for (g = grid->next; g && amg->nlevels < AMG_MAX_LEVELS; g = g->next) {
+    amg_level *fine = &amg->levels[amg->nlevels - 1];
+    amg_level *coarse = &amg->levels[amg->nlevels];
+    SparseMatrix P;
+    if (fine->A->m <= AMG_COARSEST_SIZE) break;
+    if (!g->P || g->P->m != fine->A->m || g->P->type != MATRIX_TYPE_REAL) break;
+    /* sfdp levels mostly halve the graph; merge them until a level is at
+       most a quarter of the one above, which makes the cycle cheaper */
+    P = SparseMatrix_copy(g->P);
+    while (g->next && g->next->P && P->n * AMG_COARSENING > P->m) {
+      SparseMatrix PP = SparseMatrix_multiply(P, g->next->P, threads);
+      if (!PP) break;
+      SparseMatrix_delete(P);
+      P = PP;
+      g = g->next;
+    }
+    fine->P = P;
+    fine->R = SparseMatrix_transpose(P, threads);
+    coarse->A = SparseMatrix_multiply3(fine->R, fine->A, fine->P);
+    if (!coarse->A) {
+      SparseMatrix_delete(fine->P);
+      SparseMatrix_delete(fine->R);
+      fine->P = NULL;
+      fine->R = NULL;
+      break;
+    }
+    amg->nlevels++;
+  }
+  for (l = 0; l < amg->nlevels; l++) {
+    amg_level *level = &amg->levels[l];
+    const int n = level->A->m;
+    level->diag = amg_diag(level->A);
+    level->x = gv_calloc(n, sizeof(double));
+    level->b = gv_calloc(n, sizeof(double));
+    level->r = gv_calloc(n, sizeof(double));
+  }
+  return amg;
+}
+
+static void amg_delete(amg_t *amg) {
+  int l;
+
+  if (!amg) return;
+  for (l = 0; l < amg->nlevels; l++) {
+    amg_level *level = &amg->levels[l];
+    if (l > 0) SparseMatrix_delete(level->A);
+    SparseMatrix_delete(level->P);
+    SparseMatrix_delete(level->R);
+    free(level->diag);
+    free(level->x);
+    free(level->b);
+    free(level->r);
+  }
+  free(amg->levels);
+  free(amg);
+}
+
+/* one Gauss-Seidel sweep over the rows of level, forward or backward */
+static void amg_sweep(const amg_level *level, const double *b, double *x,
+                      bool forward) {
+  SparseMatrix A = level->A;
+  int i, j, k, n = A->m, *ia = A->ia, *ja = A->ja;
+  double *a = A->a, s;
+
+  for (k = 0; k < n; k++) {
+    i = forward ? k : n - 1 - k;
+    if (level->diag[i] == 0) continue;
+    s = b[i];
+    for (j = ia[i]; j < ia[i+1]; j++) {
+      if (ja[j] != i) s -= a[j] * x[ja[j]];
+    }
+    x[i] = s / level->diag[i];
+  }
+}
+
+/* x = V-cycle applied to b. Levels are smoothed with damped Jacobi before and
+   after the coarse correction, which keeps the cycle symmetric, as CG requires,
+   and is a matrix-vector product that large levels split over threads. The
+   coarsest level gets symmetric Gauss-Seidel sweeps instead. */
+static void amg_cycle(amg_t *amg, int l, const double *b, double *x) {
+  amg_level *level = &amg->levels[l];
+  const int n = level->A->m;
+  int k;
+
+  memset(x, 0, sizeof(double) * n);
+  if (l == amg->nlevels - 1) {
+    for (k = 0; k < AMG_COARSE_SWEEPS; k++) {
+      amg_sweep(level, b, x, true);
+      amg_sweep(level, b, x, false);
+    }
+    return;
+  }
+
+  amg_level *coarse = &amg->levels[l + 1];
+  /* damped Jacobi from x = 0 */
+  for (k = 0; k < n; k++) x[k] = level->diag[k] != 0 ? AMG_DAMPING * b[k] / level->diag[k] : 0;
+  SparseMatrix_multiply_vector(level->A, x, &level->r, amg->threads);
+  for (k = 0; k < n; k++) level->r[k] = b[k] - level->r[k];
+  SparseMatrix_multiply_vector(level->R, level->r, &coarse->b, amg->threads);
+  amg_cycle(amg, l + 1, coarse->b, coarse->x);
+  SparseMatrix_multiply_vector(level->P, coarse->x, &level->r, amg->threads);
+  for (k = 0; k < n; k++) x[k] += level->r[k];
+  /* and again on the corrected x */
+  SparseMatrix_multiply_vector(level->A, x, &level->r, amg->threads);
+  for (k = 0; k < n; k++) {
+    if (level->diag[k] != 0) x[k] += AMG_DAMPING * (b[k] - level->r[k]) / level->diag[k];
+  }
+}
+
+static double *precondition(SparseSolver solver, double *x, double *y) {
+  switch (solver->precon) {
+  case PRECON_IC0:
+    return ic0_precon(solver->data, x, y);
+  case PRECON_AMG:
+    amg_cycle(solver->data, 0, x, y);
+    return y;
+  default:
+    return diag_precon(solver->data, x, y);
+  }
+}
+
+static double conjugate_gradient(SparseSolver solver, int n, double *x,
+                                 double *rhs, double tol, double maxit) {
+  SparseMatrix A = solver->A;
   double res, alpha;
   double rho, rho_old = 1, res0, beta;
   int iter = 0;
@@ -63,7 +369,7 @@ static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
   double *p = gv_calloc(n, sizeof(double));
   double *q = gv_calloc(n, sizeof(double));
 
-  SparseMatrix_multiply_vector(A, x, &r);
+  SparseMatrix_multiply_vector(A, x, &r, solver->threads);
   r = vector_subtract_to(n, rhs, r);
 
   res0 = res = sqrt(vector_product(n, r, r))/n;
@@ -76,7 +382,7 @@ static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
 #endif
 
   while ((iter++) < maxit && res > tol*res0){
-    z = diag_precon(precon, r, z);
+    z = precondition(solver, r, z);
     rho = vector_product(n, r, z);
 
     if (iter > 1){
@@ -86,7 +392,7 @@ static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
       memcpy(p, z, sizeof(double)*n);
     }
 
-    SparseMatrix_multiply_vector(A, p, &q);
+    SparseMatrix_multiply_vector(A, p, &q, solver->threads);
 
     alpha = rho/vector_product(n, p, q);
 
@@ -98,6 +404,7 @@ static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
     rho_old = rho;
   }
   free(z); free(r); free(p); free(q);
+  solver->iterations += iter - 1;
 #ifdef DEBUG
     _statistics[0] += iter - 1;
 #endif
@@ -110,8 +417,8 @@ static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
   return res;
 }
 
-static double cg(SparseMatrix A, const double *precond, int n, int dim,
-                 double *x0, double *rhs, double tol, double maxit) {
+static double cg(SparseSolver solver, int n, int dim, double *x0, double *rhs,
+                 double tol, double maxit) {
   double res = 0;
   int k, i;
   double *x = gv_calloc(n, sizeof(double));
@@ -122,7 +429,7 @@ static double cg(SparseMatrix A, const double *precond, int n, int dim,
       b[i] = rhs[i*dim+k];
     }
     
-    res += conjugate_gradient(A, precond, n, x, b, tol, maxit);
+    res += conjugate_gradient(solver, n, x, b, tol, maxit);
     for (i = 0; i < n; i++) {
       rhs[i*dim+k] = x[i];
     }
@@ -132,13 +439,60 @@ static double cg(SparseMatrix A, const double *precond, int n, int dim,
   return res;
 }
 
-double SparseMatrix_solve(SparseMatrix A, int dim, double *x0, double *rhs,
+SparseSolver SparseSolver_new(SparseMatrix A, int precon, Multilevel grid,
+                               int threads) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  SparseSolver solver = gv_alloc(sizeof(struct SparseSolver_struct));
+  solver->A = A;
+  solver->precon = precon;
+  solver->threads = threads;
+  if (precon == PRECON_AMG) {
+    solver->data = amg_new(A, grid, threads);
+    if (!solver->data) solver->precon = PRECON_IC0;
+  }
+  if (solver->precon == PRECON_IC0) {
+    solver->data = ic0_new(A);
+  } else if (solver->precon != PRECON_AMG) {
+    solver->precon = PRECON_JACOBI;
+    solver->data = diag_precon_new(A);
+  }
+  solver->setup_time = seconds_since(&start);
+  return solver;
+}
+
+void SparseSolver_delete(SparseSolver solver) {
+  if (!solver) return;
+  switch (solver->precon) {
+  case PRECON_IC0:
+    ic0_delete(solver->data);
+    break;
+  case PRECON_AMG:
+    amg_delete(solver->data);
+    break;
+  default:
+    free(solver->data);
+    break;
+  }
+  free(solver);
+}
+
+double SparseSolver_solve(SparseSolver solver, int dim, double *x0, double *rhs,
                           double tol, double maxit) {
-  int n = A->m;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
 
-  double *precond = diag_precon_new(A);
-  double res = cg(A, precond, n, dim, x0, rhs, tol, maxit);
-  free(precond);
+  double res = cg(solver, solver->A->m, dim, x0, rhs, tol, maxit);
+  solver->solves += dim;
+  solver->solve_time += seconds_since(&start);
   return res;
 }
 
+double SparseMatrix_solve(SparseMatrix A, int dim, double *x0, double *rhs,
+                          double tol, double maxit) {
+  SparseSolver solver = SparseSolver_new(A, PRECON_JACOBI, NULL, 1);
+  double res = SparseSolver_solve(solver, dim, x0, rhs, tol, maxit);
+  SparseSolver_delete(solver);
+  return res;
+}
@@ -11,9 +11,10 @@
 #include "config.h"
 #include <sparse/SparseMatrix.h>
 #include <sfdpgen/spring_electrical.h>
-#include <sparse/QuadTree.h>
+#include <sparse/flat_quadtree.h>
 #include <sfdpgen/Multilevel.h>
 #include <sfdpgen/post_process.h>
+#include <sfdpgen/sparse_solve.h>
 #include <neatogen/overlap.h>
 #include <common/types.h>
 #include <common/arith.h>
@@ -27,6 +28,7 @@
 #include <util/alloc.h>
 #include <util/bitarray.h>
 #include <util/list.h>
+#include <util/parallel.h>
 
 /// another parameter
 /// fₐ(i, j) = C × dist(i , j)² ÷ K × dᵢⱼ, fᵣ(i, j) = K³⁻ᵖ ÷ dist(i, j)⁻ᵖ
@@ -66,6 +68,8 @@ spring_electrical_control spring_electrical_control_new(void){
   ctrl->initial_scaling = -4;
   ctrl->rotation = 0.;
   ctrl->edge_labeling_scheme = 0;
+  ctrl->threads = 1;
+  ctrl->precon = PRECON_JACOBI;
   return ctrl;
 }
 
@@ -98,6 +102,8 @@ void spring_electrical_control_print(spring_electrical_control ctrl){
     smoothings[ctrl->smoothing], ctrl->overlap, ctrl->initial_scaling, (int)ctrl->do_shrinking);
   fprintf (stderr, "  octree scheme %s\n", tschemes[ctrl->tscheme]);
   fprintf (stderr, "  edge_labeling_scheme %d\n", ctrl->edge_labeling_scheme);
+  fprintf (stderr, "  threads %d\n", ctrl->threads);
+  fprintf (stderr, "  smoothing preconditioner %s\n", precon_name(ctrl->precon));
 }
 
 enum { MAX_I = 20, OPT_UP = 1, OPT_DOWN = -1, OPT_INIT = 0 };
@@ -243,17 +249,45 @@ static void beautify_leaves(int dim, SparseMatrix A, double *x){
   bitarray_reset(&checked);
 }
 
+typedef struct {
+  int dim;
+  const int *ia;
+  const int *ja;
+  double *x;
+  double *force;
+  double CRK;
+} attractive_force_job;
+
+/* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i), for nodes [begin, end) */
+static void attractive_force(void *ctx, size_t begin, size_t end){
+  const attractive_force_job *job = ctx;
+  const int dim = job->dim;
+  const int *ia = job->ia, *ja = job->ja;
+  double *x = job->x;
+  for (int i = (int)begin; i < (int)end; i++){
+    double *f = &(job->force[i*dim]);
+    for (int j = ia[i]; j < ia[i+1]; j++){
+      if (ja[j] == i) continue;
+      const double dist = distance(x, dim, i, ja[j]);
+      for (int k = 0; k < dim; k++){
+	f[k] -= job->CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
+      }
+    }
+  }
+}
+
 void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrical_control ctrl, double *x, int *flag){
   /* x is a point to a 1D array, x[i*dim+j] gives the coordinate of the i-th node at dimension j.  */
   SparseMatrix A = A0;
   int m, n;
-  int i, j, k;
+  int i, k;
   double p = ctrl->p, K = ctrl->K, CRK, maxiter = ctrl->maxiter, step = ctrl->step, KP;
   int *ia = NULL, *ja = NULL;
-  double *f = NULL, dist, F, Fnorm = 0, Fnorm0;
+  double *f = NULL, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   const bool adaptive_cooling = ctrl->adaptive_cooling;
   double counts[4], *force = NULL;
+  flat_quadtree_t *qt = NULL;
 #ifdef TIME
   clock_t start, end, start0;
   double qtree_cpu = 0, qtree_new_cpu = 0;
@@ -291,6 +325,9 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
   CRK = pow(C, (2.-p)/3.)/K;
 
   force = gv_calloc(dim * n, sizeof(double));
+  /* rebuilt in place on every iteration */
+  qt = flat_quadtree_new(dim);
+  flat_quadtree_set_threads(qt, ctrl->threads);
 
   do {
     iter++;
@@ -302,7 +339,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 #ifdef TIME
     start = clock();
 #endif
-    QuadTree qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
+    flat_quadtree_build(qt, n, max_qtree_level, x);
 
 #ifdef TIME
     qtree_new_cpu += ((double) (clock() - start))/CLOCKS_PER_SEC;
@@ -313,24 +350,18 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
     start = clock();
 #endif
 
-    QuadTree_get_repulsive_force(qt, force, x, bh, p, KP, counts);
+    flat_quadtree_get_repulsive_force(qt, force, x, bh, p, KP, counts);
 
 #ifdef TIME
     end = clock();
     qtree_cpu += ((double) (end - start)) / CLOCKS_PER_SEC;
 #endif
 
-    /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
-    for (i = 0; i < n; i++){
-      f = &(force[i*dim]);
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
-    }
+    /* each node only adds to its own force, so any split gives the same sums */
+    attractive_force_job attractive = {.dim = dim, .ia = ia, .ja = ja, .x = x,
+                                       .force = force, .CRK = CRK};
+    gv_parallel_for_threads(ctrl->threads, (size_t)n, 4096, attractive_force,
+                            &attractive);
 
 
     /* move */
@@ -346,23 +377,8 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 
 
 
-    if (qt) {
-#ifdef TIME
-      start = clock();
-#endif
-      QuadTree_delete(qt);
-#ifdef TIME
-      end = clock();
-      qtree_new_cpu += ((double) (end - start)) / CLOCKS_PER_SEC;
-#endif
-
-      oned_optimizer_train(&qtree_level_optimizer,
-                           counts[0] + 0.85 * counts[1] + 3.3 * counts[2]);
-    } else {
-      if (Verbose) {
-        fprintf(stderr, "\r                iter = %d, step = %f Fnorm = %f nz = %d  K = %f                                  ",iter, step, Fnorm, A->nz,K);
-      }
-    }
+    oned_optimizer_train(&qtree_level_optimizer,
+                         counts[0] + 0.85 * counts[1] + 3.3 * counts[2]);
 
     step = update_step(adaptive_cooling, step, Fnorm, Fnorm0);
   } while (step > tol && iter < maxiter);
@@ -386,6 +402,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 
   if (A != A0) SparseMatrix_delete(A);
   free(force);
+  flat_quadtree_free(qt);
 }
 
 static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_electrical_control ctrl, double *x, int *flag){
@@ -529,6 +546,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
   bool USE_QT = false;
   int nsuper = 0, nsupermax = 10;
   double *center = NULL, *supernode_wgts = NULL, *distances = NULL, nsuper_avg, counts = 0, counts_avg = 0;
+  flat_quadtree_t *qt = NULL;
 #ifdef TIME
   clock_t start, end, start0, start2;
   double qtree_cpu = 0;
@@ -549,6 +567,8 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
     center = gv_calloc(nsupermax * dim, sizeof(double));
     supernode_wgts = gv_calloc(nsupermax, sizeof(double));
     distances = gv_calloc(nsupermax, sizeof(double));
+    qt = flat_quadtree_new(dim);
+    flat_quadtree_set_threads(qt, ctrl->threads);
   }
   *flag = 0;
   if (m != n) {
@@ -580,13 +600,9 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
     nsuper_avg = 0;
     counts_avg = 0;
 
-    QuadTree qt = NULL;
     if (USE_QT) {
-
       max_qtree_level = oned_optimizer_get(qtree_level_optimizer);
-      qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
-
-	
+      flat_quadtree_build(qt, n, max_qtree_level, x);
     }
 #ifdef TIME
     start2 = clock();
@@ -608,8 +624,8 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
 #ifdef TIME
 	start = clock();
 #endif
-	QuadTree_get_supernodes(qt, bh, &(x[dim*i]), i, &nsuper, &nsupermax,
-				&center, &supernode_wgts, &distances, &counts);
+	flat_quadtree_get_supernodes(qt, bh, &(x[dim*i]), i, &nsuper, &nsupermax,
+				     &center, &supernode_wgts, &distances, &counts);
 
 #ifdef TIME
 	end = clock();
@@ -645,8 +661,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
 
     }/* done vertex i */
 
-    if (qt) {
-      QuadTree_delete(qt);
+    if (USE_QT) {
       nsuper_avg /= n;
       counts_avg /= n;
       oned_optimizer_train(&qtree_level_optimizer, 5 * nsuper_avg + counts_avg);
@@ -681,6 +696,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
   free(center);
   free(supernode_wgts);
   free(distances);
+  flat_quadtree_free(qt);
 }
 
 void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D, spring_electrical_control ctrl, double *x, int *flag){
@@ -701,6 +717,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
   bool USE_QT = false;
   int nsuper = 0, nsupermax = 10;
   double *center = NULL, *supernode_wgts = NULL, *distances = NULL, counts = 0;
+  flat_quadtree_t *qt = NULL;
   int max_qtree_level = 10;
 
   if (!A  || maxiter <= 0) return;
@@ -712,6 +729,8 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
     center = gv_calloc(nsupermax * dim, sizeof(double));
     supernode_wgts = gv_calloc(nsupermax, sizeof(double));
     distances = gv_calloc(nsupermax, sizeof(double));
+    qt = flat_quadtree_new(dim);
+    flat_quadtree_set_threads(qt, ctrl->threads);
   }
   *flag = 0;
   if (m != n) {
@@ -745,9 +764,8 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
     Fnorm0 = Fnorm;
     Fnorm = 0.;
 
-    QuadTree qt = NULL;
     if (USE_QT) {
-      qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
+      flat_quadtree_build(qt, n, max_qtree_level, x);
     }
 
     for (i = 0; i < n; i++){
@@ -777,8 +795,8 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
 
       /* repulsive force K^(1 - p)/||x_i-x_j||^(1 - p) (x_i - x_j) */
       if (USE_QT){
-	QuadTree_get_supernodes(qt, bh, &(x[dim*i]), i, &nsuper, &nsupermax,
-				&center, &supernode_wgts, &distances, &counts);
+	flat_quadtree_get_supernodes(qt, bh, &(x[dim*i]), i, &nsuper, &nsupermax,
+				     &center, &supernode_wgts, &distances, &counts);
 	for (j = 0; j < nsuper; j++){
 	  dist = MAX(distances[j], MINDIST);
 	  for (k = 0; k < dim; k++){
@@ -807,7 +825,6 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
 
     }/* done vertex i */
 
-    if (qt) QuadTree_delete(qt);
 
     step = update_step(adaptive_cooling, step, Fnorm, Fnorm0);
   } while (step > tol && iter < maxiter);
@@ -821,6 +838,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
   free(center);
   free(supernode_wgts);
   free(distances);
+  flat_quadtree_free(qt);
 }
 
 static void interpolate_coord(int dim, SparseMatrix A, double *x) {
@@ -846,9 +864,9 @@ static void interpolate_coord(int dim, SparseMatrix A, double *x) {
 
   free(y);
 }
-static void prolongate(int dim, SparseMatrix A, SparseMatrix P, SparseMatrix R, double *x, double *y, double delta){
+static void prolongate(int dim, SparseMatrix A, SparseMatrix P, SparseMatrix R, double *x, double *y, double delta, int threads){
   int nc, *ia, *ja, i, j, k;
-  SparseMatrix_multiply_dense(P, x, y, dim);
+  SparseMatrix_multiply_dense(P, x, y, dim, threads);
 
   interpolate_coord(dim, A, y);
   nc = R->m;
@@ -1130,7 +1148,7 @@ void multilevel_spring_electrical_embedding(int dim, SparseMatrix A0,
     return;
   }
 
-  Multilevel_control mctrl = {.maxlevel = ctrl->multilevels};
+  Multilevel_control mctrl = {.maxlevel = ctrl->multilevels, .threads = ctrl->threads};
   grid0 = Multilevel_new(A, mctrl);
 
   grid = Multilevel_get_coarsest(grid0);
@@ -1179,7 +1197,7 @@ void multilevel_spring_electrical_embedding(int dim, SparseMatrix A0,
     } else {
       xf = gv_calloc(grid->n * dim, sizeof(double));
     }
-    prolongate(dim, grid->A, P, grid->R, xc, xf, (ctrl->K)*0.001);
+    prolongate(dim, grid->A, P, grid->R, xc, xf, (ctrl->K)*0.001, ctrl->threads);
     free(xc);
     xc = xf;
     ctrl->random_start = false;
@@ -1194,7 +1212,7 @@ void multilevel_spring_electrical_embedding(int dim, SparseMatrix A0,
   cpu = clock();
 #endif
 
-  post_process_smoothing(dim, A, ctrl, x);
+  post_process_smoothing(dim, A, ctrl, grid0, x);
 
   if (Verbose) fprintf(stderr, "ctrl->overlap=%d\n",ctrl->overlap);
 
@@ -18,6 +18,74 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <util/alloc.h>
+#include <util/parallel.h>
+
+/* kernels over fewer stored entries than this run on the calling thread */
+static const int parallel_min_nz = 100000;
+
+/* rows per chunk of a parallel kernel */
+static const size_t parallel_grain = 2048;
+
+/* Number of row blocks for a kernel on threads threads over a matrix with nz
+   entries that needs scratch of n ints per block. Blocks are capped so that the
+   scratch of all of them is no larger than the matrix itself. */
+static int parallel_blocks(int nz, int n, int threads){
+  int blocks, fit;
+
+  if (nz < parallel_min_nz || threads == 1) return 1;
+  blocks = threads > 0 ? threads : gv_parallel_threads();
+  fit = n > 0 ? nz / n : blocks;
+  if (blocks > fit) blocks = fit;
+  return blocks < 1 ? 1 : blocks;
+}
+
+/* Split rows [0, m) into blocks with about as many entries each. bounds has
+   blocks+1 elements; block b is rows [bounds[b], bounds[b+1]). */
+static int *row_blocks(const int *ia, int m, int blocks){
+  int *bounds = gv_calloc((size_t)blocks + 1, sizeof(int));
+  int b, lo, hi, mid;
+  long long target;
+
+  bounds[blocks] = m;
+  for (b = 1; b < blocks; b++){
+    target = ia[0] + (long long)(ia[m] - ia[0]) * b / blocks;
+    lo = bounds[b-1];
+    hi = m;
+    while (lo < hi){
+      mid = lo + (hi - lo) / 2;
+      if (ia[mid] < target){
+	lo = mid + 1;
+      } else {
+	hi = mid;
+      }
+    }
+    bounds[b] = lo;
+  }
+  return bounds;
+}
+
+/* a mask of n ints set to -1 */
+static int *new_mask(int n){
+  int *mask = gv_calloc((size_t)n, sizeof(int));
+  int i;
+
+  for (i = 0; i < n; i++) mask[i] = -1;
+  return mask;
+}
+
+/* Turn the row sizes in ic[1..m] into row pointers. Returns false if the total does not fit in an int. */
+static bool row_pointers(int *ic, int m){
+  long long nz = 0;
+  int i;
+
+  for (i = 0; i < m; i++){
+    nz += ic[i+1];
+    if (nz > INT_MAX) return false;
+    ic[i+1] = (int)nz;
+  }
+  ic[0] = 0;
+  return true;
+}
 
 static size_t size_of_matrix_type(int type){
   size_t size = 0;
@@ -47,9 +115,9 @@ static size_t size_of_matrix_type(int type){
 
 SparseMatrix SparseMatrix_sort(SparseMatrix A){
   SparseMatrix B;
-  B = SparseMatrix_transpose(A);
+  B = SparseMatrix_transpose(A, 1);
   SparseMatrix_delete(A);
-  A = SparseMatrix_transpose(B);
+  A = SparseMatrix_transpose(B, 1);
   SparseMatrix_delete(B);
   return A;
 }
@@ -60,7 +128,102 @@ SparseMatrix SparseMatrix_make_undirected(SparseMatrix A){
   B->is_undirected = true;
   return SparseMatrix_remove_upper(B);
 }
-SparseMatrix SparseMatrix_transpose(SparseMatrix A){
+typedef struct {
+  SparseMatrix A, B;
+  const int *bounds;
+  int *counts; /* blocks × n: entries of each block in each column */
+  int blocks;
+} transpose_t;
+
+static void transpose_count(void *ctx, size_t begin, size_t end){
+  const transpose_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja;
+  size_t b;
+  int i, j, *count;
+
+  for (b = begin; b < end; b++){
+    count = job->counts + b * (size_t)job->A->n;
+    for (i = job->bounds[b]; i < job->bounds[b+1]; i++){
+      for (j = ia[i]; j < ia[i+1]; j++) count[ja[j]]++;
+    }
+  }
+}
+
+/* the start of every block within each column of B */
+static void transpose_offsets(void *ctx, size_t begin, size_t end){
+  const transpose_t *job = ctx;
+  const size_t n = (size_t)job->A->n;
+  size_t c;
+  int b, pos, cnt;
+
+  for (c = begin; c < end; c++){
+    pos = job->B->ia[c];
+    for (b = 0; b < job->blocks; b++){
+      cnt = job->counts[b * n + c];
+      job->counts[b * n + c] = pos;
+      pos += cnt;
+    }
+  }
+}
+
+static void transpose_column_sizes(void *ctx, size_t begin, size_t end){
+  const transpose_t *job = ctx;
+  const size_t n = (size_t)job->A->n;
+  size_t c;
+  int b;
+
+  for (c = begin; c < end; c++){
+    job->B->ia[c+1] = 0;
+    for (b = 0; b < job->blocks; b++) job->B->ia[c+1] += job->counts[b * n + c];
+  }
+}
+
+static void transpose_scatter(void *ctx, size_t begin, size_t end){
+  const transpose_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja;
+  int *jb = job->B->ja, *pos;
+  const size_t size = size_of_matrix_type(job->A->type);
+  const char *a = job->A->a;
+  char *bv = job->B->a;
+  size_t b;
+  int i, j;
+
+  for (b = begin; b < end; b++){
+    pos = job->counts + b * (size_t)job->A->n;
+    for (i = job->bounds[b]; i < job->bounds[b+1]; i++){
+      for (j = ia[i]; j < ia[i+1]; j++){
+	if (size > 0) memcpy(bv + (size_t)pos[ja[j]] * size, a + (size_t)j * size, size);
+	jb[pos[ja[j]]++] = i;
+      }
+    }
+  }
+}
+
+/* SparseMatrix_transpose over row blocks of A on several threads. Each block
+   scatters into its own slice of every column, in row order, so the result is
+   the same as the serial one. */
+static SparseMatrix transpose_blocks(SparseMatrix A, int blocks){
+  transpose_t job = {.A = A, .blocks = blocks};
+
+  job.B = SparseMatrix_new(A->n, A->m, A->nz, A->type, A->format);
+  job.B->nz = A->nz;
+  job.bounds = row_blocks(A->ia, A->m, blocks);
+  job.counts = gv_calloc((size_t)blocks * (size_t)A->n, sizeof(int));
+
+  gv_parallel_for_threads(blocks, (size_t)blocks, 1, transpose_count, &job);
+  gv_parallel_for_threads(blocks, (size_t)A->n, parallel_grain,
+                          transpose_column_sizes, &job);
+  row_pointers(job.B->ia, A->n);
+  gv_parallel_for_threads(blocks, (size_t)A->n, parallel_grain,
+                          transpose_offsets, &job);
+  gv_parallel_for_threads(blocks, (size_t)blocks, 1, transpose_scatter, &job);
+
+  free(job.counts);
+  free((int *)job.bounds);
+  return job.B;
+}
+
+SparseMatrix SparseMatrix_transpose(SparseMatrix A, int threads){
   if (!A) return NULL;
 
   int *ia = A->ia, *ja = A->ja, *ib, *jb, nz = A->nz, m = A->m, n = A->n, type = A->type, format = A->format;
@@ -69,6 +232,10 @@ SparseMatrix SparseMatrix_transpose(SparseMatrix A){
 
   assert(A->format == FORMAT_CSR);/* only implemented for CSR right now */
 
+  const int blocks = parallel_blocks(nz, n, threads);
+  if (blocks > 1 && (size_of_matrix_type(type) > 0 || type == MATRIX_TYPE_PATTERN))
+    return transpose_blocks(A, blocks);
+
   B = SparseMatrix_new(n, m, nz, type, format);
   B->nz = nz;
   ib = B->ia;
@@ -146,9 +313,9 @@ SparseMatrix SparseMatrix_symmetrize(SparseMatrix A,
                                      bool pattern_symmetric_only) {
   SparseMatrix B;
   if (SparseMatrix_is_symmetric(A, pattern_symmetric_only)) return SparseMatrix_copy(A);
-  B = SparseMatrix_transpose(A);
+  B = SparseMatrix_transpose(A, 1);
   if (!B) return NULL;
-  A = SparseMatrix_add(A, B);
+  A = SparseMatrix_add(A, B, 1);
   SparseMatrix_delete(B);
   A->is_symmetric = true;
   A->is_pattern_symmetric = true;
@@ -171,7 +338,7 @@ bool SparseMatrix_is_symmetric(SparseMatrix A, bool test_pattern_symmetry_only)
 
   if (A->m != A->n) return false;
 
-  B = SparseMatrix_transpose(A);
+  B = SparseMatrix_transpose(A, 1);
   if (!B) return false;
 
   ia = A->ia;
@@ -697,154 +864,184 @@ SparseMatrix SparseMatrix_from_coordinate_arrays_not_compacted(int nz, int m, in
   return SparseMatrix_from_coordinate_arrays_internal(nz, m, n, irn, jcn, val0, type, sz, SUM_REPEATED_NONE);
 }
 
-SparseMatrix SparseMatrix_add(SparseMatrix A, SparseMatrix B){
-  int m, n;
-  SparseMatrix C = NULL;
-  int *mask = NULL;
-  int *ia = A->ia, *ja = A->ja, *ib = B->ia, *jb = B->ja, *ic, *jc;
-  int i, j, nz, nzmax;
-
-  assert(A && B);
-  assert(A->format == B->format && A->format == FORMAT_CSR);/* other format not yet supported */
-  assert(A->type == B->type);
-  m = A->m;
-  n = A->n;
-  if (m != B->m || n != B->n) return NULL;
-
-  nzmax = A->nz + B->nz;/* just assume that no entries overlaps for speed */
-
-  C = SparseMatrix_new(m, n, nzmax, A->type, FORMAT_CSR);
-  if (!C) goto RETURN;
-  ic = C->ia;
-  jc = C->ja;
-
-  mask = gv_calloc((size_t)n, sizeof(int));
-
-  for (i = 0; i < n; i++) mask[i] = -1;
+typedef struct {
+  SparseMatrix A, B, C;
+  const int *bounds;
+} add_t;
+
+/* size of each row of A + B into C->ia[i+1] */
+static void add_count(void *ctx, size_t begin, size_t end){
+  const add_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja, *ib = job->B->ia, *jb = job->B->ja;
+  int *ic = job->C->ia, *mask;
+  size_t blk;
+  int i, j;
 
-  nz = 0;
-  ic[0] = 0;
-  switch (A->type){
-  case MATRIX_TYPE_REAL:{
-    double *a = A->a;
-    double *b = B->a;
-    double *c = C->a;
-    for (i = 0; i < m; i++){
-      for (j = ia[i]; j < ia[i+1]; j++){
-	mask[ja[j]] = nz;
-	jc[nz] = ja[j];
-	c[nz] = a[j];
-	nz++;
-      }
+  for (blk = begin; blk < end; blk++){
+    mask = new_mask(job->A->n);
+    for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+      ic[i+1] = ia[i+1] - ia[i];
+      for (j = ia[i]; j < ia[i+1]; j++) mask[ja[j]] = i;
       for (j = ib[i]; j < ib[i+1]; j++){
-	if (mask[jb[j]] < ic[i]){
-	  jc[nz] = jb[j];
-	  c[nz++] = b[j];
-	} else {
-	  c[mask[jb[j]]] += b[j];
-	}
+	if (mask[jb[j]] != i) ic[i+1]++;
       }
-      ic[i+1] = nz;
     }
-    break;
+    free(mask);
   }
-  case MATRIX_TYPE_COMPLEX:{
-    double *a = A->a;
-    double *b = B->a;
-    double *c = C->a;
-    for (i = 0; i < m; i++){
-      for (j = ia[i]; j < ia[i+1]; j++){
-	mask[ja[j]] = nz;
-	jc[nz] = ja[j];
-	c[2*nz] = a[2*j];
-	c[2*nz+1] = a[2*j+1];
-	nz++;
-      }
-      for (j = ib[i]; j < ib[i+1]; j++){
-	if (mask[jb[j]] < ic[i]){
-	  jc[nz] = jb[j];
-	  c[2*nz] = b[2*j];
-	  c[2*nz+1] = b[2*j+1];
+}
+
+/* Rows of A + B: the entries of A in order, then those of B not in A. */
+static void add_fill(void *ctx, size_t begin, size_t end){
+  const add_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja, *ib = job->B->ia, *jb = job->B->ja;
+  const int *ic = job->C->ia;
+  int *jc = job->C->ja, *mask;
+  size_t blk;
+  int i, j, nz;
+
+  for (blk = begin; blk < end; blk++){
+    mask = new_mask(job->A->n);
+    nz = ic[job->bounds[blk]];
+    switch (job->A->type){
+    case MATRIX_TYPE_REAL:{
+      double *a = job->A->a;
+      double *b = job->B->a;
+      double *c = job->C->a;
+      for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+	for (j = ia[i]; j < ia[i+1]; j++){
+	  mask[ja[j]] = nz;
+	  jc[nz] = ja[j];
+	  c[nz] = a[j];
 	  nz++;
-	} else {
-	  c[2*mask[jb[j]]] += b[2*j];
-	  c[2*mask[jb[j]]+1] += b[2*j+1];
+	}
+	for (j = ib[i]; j < ib[i+1]; j++){
+	  if (mask[jb[j]] < ic[i]){
+	    jc[nz] = jb[j];
+	    c[nz++] = b[j];
+	  } else {
+	    c[mask[jb[j]]] += b[j];
+	  }
 	}
       }
-      ic[i+1] = nz;
+      break;
     }
-    break;
-  }
-  case MATRIX_TYPE_INTEGER:{
-    int *a = A->a;
-    int *b = B->a;
-    int *c = C->a;
-    for (i = 0; i < m; i++){
-      for (j = ia[i]; j < ia[i+1]; j++){
-	mask[ja[j]] = nz;
-	jc[nz] = ja[j];
-	c[nz] = a[j];
-	nz++;
-      }
-      for (j = ib[i]; j < ib[i+1]; j++){
-	if (mask[jb[j]] < ic[i]){
-	  jc[nz] = jb[j];
-	  c[nz] = b[j];
+    case MATRIX_TYPE_COMPLEX:{
+      double *a = job->A->a;
+      double *b = job->B->a;
+      double *c = job->C->a;
+      for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+	for (j = ia[i]; j < ia[i+1]; j++){
+	  mask[ja[j]] = nz;
+	  jc[nz] = ja[j];
+	  c[2*nz] = a[2*j];
+	  c[2*nz+1] = a[2*j+1];
 	  nz++;
-	} else {
-	  c[mask[jb[j]]] += b[j];
+	}
+	for (j = ib[i]; j < ib[i+1]; j++){
+	  if (mask[jb[j]] < ic[i]){
+	    jc[nz] = jb[j];
+	    c[2*nz] = b[2*j];
+	    c[2*nz+1] = b[2*j+1];
+	    nz++;
+	  } else {
+	    c[2*mask[jb[j]]] += b[2*j];
+	    c[2*mask[jb[j]]+1] += b[2*j+1];
+	  }
 	}
       }
-      ic[i+1] = nz;
+      break;
     }
-    break;
-  }
-  case MATRIX_TYPE_PATTERN:{
-    for (i = 0; i < m; i++){
-      for (j = ia[i]; j < ia[i+1]; j++){
-	mask[ja[j]] = nz;
-	jc[nz] = ja[j];
-	nz++;
+    case MATRIX_TYPE_INTEGER:{
+      int *a = job->A->a;
+      int *b = job->B->a;
+      int *c = job->C->a;
+      for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+	for (j = ia[i]; j < ia[i+1]; j++){
+	  mask[ja[j]] = nz;
+	  jc[nz] = ja[j];
+	  c[nz] = a[j];
+	  nz++;
+	}
+	for (j = ib[i]; j < ib[i+1]; j++){
+	  if (mask[jb[j]] < ic[i]){
+	    jc[nz] = jb[j];
+	    c[nz] = b[j];
+	    nz++;
+	  } else {
+	    c[mask[jb[j]]] += b[j];
+	  }
+	}
       }
-      for (j = ib[i]; j < ib[i+1]; j++){
-	if (mask[jb[j]] < ic[i]){
-	  jc[nz] = jb[j];
+      break;
+    }
+    case MATRIX_TYPE_PATTERN:{
+      for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+	for (j = ia[i]; j < ia[i+1]; j++){
+	  mask[ja[j]] = nz;
+	  jc[nz] = ja[j];
 	  nz++;
-	} 
+	}
+	for (j = ib[i]; j < ib[i+1]; j++){
+	  if (mask[jb[j]] < ic[i]){
+	    jc[nz] = jb[j];
+	    nz++;
+	  }
+	}
       }
-      ic[i+1] = nz;
+      break;
     }
-    break;
-  }
-  case MATRIX_TYPE_UNKNOWN:
-    break;
-  default:
-    break;
+    case MATRIX_TYPE_UNKNOWN:
+      break;
+    default:
+      break;
+    }
+    free(mask);
   }
-  C->nz = nz;
+}
 
- RETURN:
-  free(mask);
+SparseMatrix SparseMatrix_add(SparseMatrix A, SparseMatrix B, int threads){
+  /* Rows are sized first and then filled, both over blocks of rows that large
+     matrices split over threads. */
+  SparseMatrix C;
+  add_t job;
+  int m, n, blocks;
 
-  return C;
-}
+  assert(A && B);
+  assert(A->format == B->format && A->format == FORMAT_CSR);/* other format not yet supported */
+  assert(A->type == B->type);
+  m = A->m;
+  n = A->n;
+  if (m != B->m || n != B->n) return NULL;
 
-void SparseMatrix_multiply_dense(SparseMatrix A, const double *v, double *res,
-                                 int dim) {
-  // A × V, with A dimension m × n, with V a dense matrix of dimension n × dim.
-  // v[i×dim×j] gives V[i,j]. Result of dimension m × dim. Real only for now.
-  int i, j, k, *ia, *ja, m;
-  double *a;
+  blocks = parallel_blocks(A->nz + B->nz, n, threads);
+  C = SparseMatrix_new(m, n, 0, A->type, FORMAT_CSR);
+  job = (add_t){.A = A, .B = B, .C = C, .bounds = row_blocks(A->ia, m, blocks)};
 
-  assert(A->format == FORMAT_CSR);
-  assert(A->type == MATRIX_TYPE_REAL);
+  gv_parallel_for_threads(blocks, (size_t)blocks, 1, add_count, &job);
+  row_pointers(C->ia, m);/* no more than A->nz + B->nz, which fits */
+  C->nz = C->ia[m];
+  SparseMatrix_alloc(C, C->nz);
+  gv_parallel_for_threads(blocks, (size_t)blocks, 1, add_fill, &job);
 
-  a = A->a;
-  ia = A->ia;
-  ja = A->ja;
-  m = A->m;
+  free((int *)job.bounds);
+  return C;
+}
 
-  for (i = 0; i < m; i++){
+typedef struct {
+  SparseMatrix A;
+  const double *v;
+  double *res;
+  int dim;
+} multiply_dense_t;
+
+static void multiply_dense_rows(void *ctx, size_t begin, size_t end) {
+  const multiply_dense_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja, dim = job->dim;
+  const double *a = job->A->a, *v = job->v;
+  double *res = job->res;
+  int i, j, k;
+
+  for (i = (int)begin; i < (int)end; i++){
     for (k = 0; k < dim; k++) res[i * dim + k] = 0;
     for (j = ia[i]; j < ia[i+1]; j++){
       for (k = 0; k < dim; k++) res[i * dim + k] += a[j] * v[ja[j] *dim + k];
@@ -852,25 +1049,41 @@ void SparseMatrix_multiply_dense(SparseMatrix A, const double *v, double *res,
   }
 }
 
-void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res) {
-  /* A v or A^T v. Real only for now. */
-  int i, j, *ia, *ja, m;
-  double *a, *u = NULL;
-  int *ai;
+void SparseMatrix_multiply_dense(SparseMatrix A, const double *v, double *res,
+                                 int dim, int threads) {
+  // A × V, with A dimension m × n, with V a dense matrix of dimension n × dim.
+  // v[i×dim×j] gives V[i,j]. Result of dimension m × dim. Real only for now.
+  // Rows are independent, so large products split them over `threads`.
   assert(A->format == FORMAT_CSR);
-  assert(A->type == MATRIX_TYPE_REAL || A->type == MATRIX_TYPE_INTEGER);
+  assert(A->type == MATRIX_TYPE_REAL);
 
-  ia = A->ia;
-  ja = A->ja;
-  m = A->m;
-  u = *res;
+  multiply_dense_t job = {.A = A, .v = v, .res = res, .dim = dim};
+  if (A->nz < parallel_min_nz || threads == 1) {
+    multiply_dense_rows(&job, 0, (size_t)A->m);
+  } else {
+    gv_parallel_for_threads(threads, (size_t)A->m, parallel_grain,
+                            multiply_dense_rows, &job);
+  }
+}
 
-  switch (A->type){
+typedef struct {
+  SparseMatrix A;
+  const double *v;
+  double *u;
+} multiply_vector_t;
+
+static void multiply_vector_rows(void *ctx, size_t begin, size_t end) {
+  const multiply_vector_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja;
+  const double *v = job->v;
+  double *u = job->u, *a;
+  int i, j, *ai;
+
+  switch (job->A->type){
   case MATRIX_TYPE_REAL:
-    a = A->a;
+    a = job->A->a;
     if (v){
-      if (!u) u = gv_calloc((size_t)m, sizeof(double));
-      for (i = 0; i < m; i++){
+      for (i = (int)begin; i < (int)end; i++){
 	u[i] = 0.;
 	for (j = ia[i]; j < ia[i+1]; j++){
 	  u[i] += a[j]*v[ja[j]];
@@ -878,8 +1091,7 @@ void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res) {
       }
     } else {
       /* v is assumed to be all 1's */
-      if (!u) u = gv_calloc((size_t)m, sizeof(double));
-      for (i = 0; i < m; i++){
+      for (i = (int)begin; i < (int)end; i++){
 	u[i] = 0.;
 	for (j = ia[i]; j < ia[i+1]; j++){
 	  u[i] += a[j];
@@ -888,10 +1100,9 @@ void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res) {
     }
     break;
   case MATRIX_TYPE_INTEGER:
-    ai = A->a;
+    ai = job->A->a;
     if (v){
-      if (!u) u = gv_calloc((size_t)m, sizeof(double));
-      for (i = 0; i < m; i++){
+      for (i = (int)begin; i < (int)end; i++){
 	u[i] = 0.;
 	for (j = ia[i]; j < ia[i+1]; j++){
 	  u[i] += ai[j]*v[ja[j]];
@@ -899,8 +1110,7 @@ void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res) {
       }
     } else {
       /* v is assumed to be all 1's */
-      if (!u) u = gv_calloc((size_t)m, sizeof(double));
-      for (i = 0; i < m; i++){
+      for (i = (int)begin; i < (int)end; i++){
 	u[i] = 0.;
 	for (j = ia[i]; j < ia[i+1]; j++){
 	  u[i] += ai[j];
@@ -910,170 +1120,209 @@ void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res) {
     break;
   default:
     assert(0);
-    u = NULL;
   }
-  *res = u;
-
 }
 
-SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B){
-  int m;
-  SparseMatrix C = NULL;
-  int *mask = NULL;
-  int *ia = A->ia, *ja = A->ja, *ib = B->ia, *jb = B->ja, *ic, *jc;
-  int i, j, k, jj, type, nz;
-
-  assert(A->format == B->format && A->format == FORMAT_CSR);/* other format not yet supported */
+void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res,
+                                  int threads) {
+  /* A v or A^T v. Real only for now. Large products split rows over threads. */
+  assert(A->format == FORMAT_CSR);
+  assert(A->type == MATRIX_TYPE_REAL || A->type == MATRIX_TYPE_INTEGER);
 
-  m = A->m;
-  if (A->n != B->m) return NULL;
-  if (A->type != B->type){
-#ifdef DEBUG
-    printf("in SparseMatrix_multiply, the matrix types do not match, right now only multiplication of matrices of the same type is supported\n");
-#endif
-    return NULL;
+  multiply_vector_t job = {.A = A, .v = v, .u = *res};
+  if (A->type != MATRIX_TYPE_REAL && A->type != MATRIX_TYPE_INTEGER){
+    *res = NULL;
+    return;
   }
-  type = A->type;
-  
-  mask = calloc((size_t)B->n, sizeof(int));
-  if (!mask) return NULL;
+  if (!job.u) job.u = gv_calloc((size_t)A->m, sizeof(double));
 
-  for (i = 0; i < B->n; i++) mask[i] = -1;
+  if (A->nz < parallel_min_nz || threads == 1) {
+    multiply_vector_rows(&job, 0, (size_t)A->m);
+  } else {
+    gv_parallel_for_threads(threads, (size_t)A->m, parallel_grain,
+                            multiply_vector_rows, &job);
+  }
+  *res = job.u;
+}
 
-  nz = 0;
-  for (i = 0; i < m; i++){
-    for (j = ia[i]; j < ia[i+1]; j++){
-      jj = ja[j];
-      for (k = ib[jj]; k < ib[jj+1]; k++){
-	if (mask[jb[k]] != -i - 2){
-	  if ((nz+1) <= nz) {
-#ifdef DEBUG_PRINT
-	    fprintf(stderr,"overflow in SparseMatrix_multiply !!!\n");
-#endif
-	    free(mask);
-	    return NULL;
+typedef struct {
+  SparseMatrix A, B, C;
+  const int *bounds;
+} multiply_t;
+
+/* symbolic pass: size of each row of A B into C->ia[i+1] */
+static void multiply_count(void *ctx, size_t begin, size_t end){
+  const multiply_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja, *ib = job->B->ia, *jb = job->B->ja;
+  int *ic = job->C->ia, *mask;
+  size_t blk;
+  int i, j, k, jj;
+
+  for (blk = begin; blk < end; blk++){
+    mask = new_mask(job->B->n);
+    for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+      ic[i+1] = 0;
+      for (j = ia[i]; j < ia[i+1]; j++){
+	jj = ja[j];
+	for (k = ib[jj]; k < ib[jj+1]; k++){
+	  if (mask[jb[k]] != -i - 2){
+	    ic[i+1]++;
+	    mask[jb[k]] = -i - 2;
 	  }
-	  nz++;
-	  mask[jb[k]] = -i - 2;
 	}
       }
     }
+    free(mask);
   }
+}
 
-  C = SparseMatrix_new(m, B->n, nz, type, FORMAT_CSR);
-  if (!C) goto RETURN;
-  ic = C->ia;
-  jc = C->ja;
-  
-  nz = 0;
-
-  switch (type){
-  case MATRIX_TYPE_REAL:
-    {
-      double *a = A->a;
-      double *b = B->a;
-      double *c = C->a;
-      ic[0] = 0;
-      for (i = 0; i < m; i++){
-	for (j = ia[i]; j < ia[i+1]; j++){
-	  jj = ja[j];
-	  for (k = ib[jj]; k < ib[jj+1]; k++){
-	    if (mask[jb[k]] < ic[i]){
-	      mask[jb[k]] = nz;
-	      jc[nz] = jb[k];
-	      c[nz] = a[j]*b[k];
-	      nz++;
-	    } else {
-	      assert(jc[mask[jb[k]]] == jb[k]);
-	      c[mask[jb[k]]] += a[j]*b[k];
+/* numeric pass: columns of each row in the order they are first reached */
+static void multiply_fill(void *ctx, size_t begin, size_t end){
+  const multiply_t *job = ctx;
+  const int *ia = job->A->ia, *ja = job->A->ja, *ib = job->B->ia, *jb = job->B->ja;
+  const int *ic = job->C->ia;
+  int *jc = job->C->ja, *mask;
+  size_t blk;
+  int i, j, k, jj, nz;
+
+  for (blk = begin; blk < end; blk++){
+    mask = new_mask(job->B->n);
+    nz = ic[job->bounds[blk]];
+    switch (job->A->type){
+    case MATRIX_TYPE_REAL:
+      {
+	double *a = job->A->a;
+	double *b = job->B->a;
+	double *c = job->C->a;
+	for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+	  for (j = ia[i]; j < ia[i+1]; j++){
+	    jj = ja[j];
+	    for (k = ib[jj]; k < ib[jj+1]; k++){
+	      if (mask[jb[k]] < ic[i]){
+		mask[jb[k]] = nz;
+		jc[nz] = jb[k];
+		c[nz] = a[j]*b[k];
+		nz++;
+	      } else {
+		assert(jc[mask[jb[k]]] == jb[k]);
+		c[mask[jb[k]]] += a[j]*b[k];
+	      }
 	    }
 	  }
 	}
-	ic[i+1] = nz;
       }
-    }
-    break;
-  case MATRIX_TYPE_COMPLEX:
-    {
-      double *a = A->a;
-      double *b = B->a;
-      double *c = C->a;
-      ic[0] = 0;
-      for (i = 0; i < m; i++){
-	for (j = ia[i]; j < ia[i+1]; j++){
-	  jj = ja[j];
-	  for (k = ib[jj]; k < ib[jj+1]; k++){
-	    if (mask[jb[k]] < ic[i]){
-	      mask[jb[k]] = nz;
-	      jc[nz] = jb[k];
-	      c[2*nz] = a[2*j]*b[2*k] - a[2*j+1]*b[2*k+1];/*real part */
-	      c[2*nz+1] = a[2*j]*b[2*k+1] + a[2*j+1]*b[2*k];/*img part */
-	      nz++;
-	    } else {
-	      assert(jc[mask[jb[k]]] == jb[k]);
-	      c[2*mask[jb[k]]] += a[2*j]*b[2*k] - a[2*j+1]*b[2*k+1];/*real part */
-	      c[2*mask[jb[k]]+1] += a[2*j]*b[2*k+1] + a[2*j+1]*b[2*k];/*img part */
+      break;
+    case MATRIX_TYPE_COMPLEX:
+      {
+	double *a = job->A->a;
+	double *b = job->B->a;
+	double *c = job->C->a;
+	for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+	  for (j = ia[i]; j < ia[i+1]; j++){
+	    jj = ja[j];
+	    for (k = ib[jj]; k < ib[jj+1]; k++){
+	      if (mask[jb[k]] < ic[i]){
+		mask[jb[k]] = nz;
+		jc[nz] = jb[k];
+		c[2*nz] = a[2*j]*b[2*k] - a[2*j+1]*b[2*k+1];/*real part */
+		c[2*nz+1] = a[2*j]*b[2*k+1] + a[2*j+1]*b[2*k];/*img part */
+		nz++;
+	      } else {
+		assert(jc[mask[jb[k]]] == jb[k]);
+		c[2*mask[jb[k]]] += a[2*j]*b[2*k] - a[2*j+1]*b[2*k+1];/*real part */
+		c[2*mask[jb[k]]+1] += a[2*j]*b[2*k+1] + a[2*j+1]*b[2*k];/*img part */
+	      }
 	    }
 	  }
 	}
-	ic[i+1] = nz;
       }
-    }
-    break;
-  case MATRIX_TYPE_INTEGER:
-    {
-      int *a = A->a;
-      int *b = B->a;
-      int *c = C->a;
-      ic[0] = 0;
-      for (i = 0; i < m; i++){
+      break;
+    case MATRIX_TYPE_INTEGER:
+      {
+	int *a = job->A->a;
+	int *b = job->B->a;
+	int *c = job->C->a;
+	for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
+	  for (j = ia[i]; j < ia[i+1]; j++){
+	    jj = ja[j];
+	    for (k = ib[jj]; k < ib[jj+1]; k++){
+	      if (mask[jb[k]] < ic[i]){
+		mask[jb[k]] = nz;
+		jc[nz] = jb[k];
+		c[nz] = a[j]*b[k];
+		nz++;
+	      } else {
+		assert(jc[mask[jb[k]]] == jb[k]);
+		c[mask[jb[k]]] += a[j]*b[k];
+	      }
+	    }
+	  }
+	}
+      }
+      break;
+    case MATRIX_TYPE_PATTERN:
+      for (i = job->bounds[blk]; i < job->bounds[blk+1]; i++){
 	for (j = ia[i]; j < ia[i+1]; j++){
 	  jj = ja[j];
 	  for (k = ib[jj]; k < ib[jj+1]; k++){
 	    if (mask[jb[k]] < ic[i]){
 	      mask[jb[k]] = nz;
 	      jc[nz] = jb[k];
-	      c[nz] = a[j]*b[k];
 	      nz++;
 	    } else {
 	      assert(jc[mask[jb[k]]] == jb[k]);
-	      c[mask[jb[k]]] += a[j]*b[k];
 	    }
 	  }
 	}
-	ic[i+1] = nz;
-      }
-    }
-    break;
-  case MATRIX_TYPE_PATTERN:
-    ic[0] = 0;
-    for (i = 0; i < m; i++){
-      for (j = ia[i]; j < ia[i+1]; j++){
-	jj = ja[j];
-	for (k = ib[jj]; k < ib[jj+1]; k++){
-	  if (mask[jb[k]] < ic[i]){
-	    mask[jb[k]] = nz;
-	    jc[nz] = jb[k];
-	    nz++;
-	  } else {
-	    assert(jc[mask[jb[k]]] == jb[k]);
-	  }
-	}
       }
-      ic[i+1] = nz;
+      break;
+    default:
+      break;
     }
-    break;
-  case MATRIX_TYPE_UNKNOWN:
-  default:
+    free(mask);
+  }
+}
+
+SparseMatrix SparseMatrix_multiply(SparseMatrix A, SparseMatrix B, int threads){
+  /* Two passes over blocks of rows, which large products split over threads:
+     one sizes the rows of C, the other fills them in. */
+  SparseMatrix C;
+  multiply_t job;
+  int m, type, blocks;
+
+  assert(A->format == B->format && A->format == FORMAT_CSR);/* other format not yet supported */
+
+  m = A->m;
+  if (A->n != B->m) return NULL;
+  if (A->type != B->type){
+#ifdef DEBUG
+    printf("in SparseMatrix_multiply, the matrix types do not match, right now only multiplication of matrices of the same type is supported\n");
+#endif
+    return NULL;
+  }
+  type = A->type;
+  if (type != MATRIX_TYPE_REAL && type != MATRIX_TYPE_COMPLEX &&
+      type != MATRIX_TYPE_INTEGER && type != MATRIX_TYPE_PATTERN) return NULL;
+
+  blocks = parallel_blocks(A->nz, B->n, threads);
+  C = SparseMatrix_new(m, B->n, 0, type, FORMAT_CSR);
+  job = (multiply_t){.A = A, .B = B, .C = C, .bounds = row_blocks(A->ia, m, blocks)};
+
+  gv_parallel_for_threads(blocks, (size_t)blocks, 1, multiply_count, &job);
+  if (!row_pointers(C->ia, m)){
+#ifdef DEBUG_PRINT
+    fprintf(stderr,"overflow in SparseMatrix_multiply !!!\n");
+#endif
     SparseMatrix_delete(C);
-    C = NULL; goto RETURN;
-    break;
+    C = NULL;
+    goto RETURN;
   }
-  
-  C->nz = nz;
+  C->nz = C->ia[m];
+  SparseMatrix_alloc(C, C->nz);
+  gv_parallel_for_threads(blocks, (size_t)blocks, 1, multiply_fill, &job);
 
  RETURN:
-  free(mask);
+  free((int *)job.bounds);
   return C;
 }
 
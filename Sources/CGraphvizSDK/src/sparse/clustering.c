@@ -211,14 +211,14 @@ static Multilevel_Modularity_Clustering Multilevel_Modularity_Clustering_establi
     }
     R = SparseMatrix_from_coordinate_format(R0);
     SparseMatrix_delete(R0);
-    P = SparseMatrix_transpose(R);
-    B = SparseMatrix_multiply(R, A);
+    P = SparseMatrix_transpose(R, 1);
+    B = SparseMatrix_multiply(R, A, 1);
     SparseMatrix_delete(R);
     if (!B) {
       free(deg_new);
       goto RETURN;
     }
-    cA = SparseMatrix_multiply(B, P); 
+    cA = SparseMatrix_multiply(B, P, 1); 
     SparseMatrix_delete(B);
     if (!cA) {
       free(deg_new);
@@ -318,7 +318,7 @@ static void hierachical_modularity_clustering(SparseMatrix A, int ncluster_targe
   while (cgrid->prev){
     double *v = NULL;
     P = cgrid->prev->P;
-    SparseMatrix_multiply_vector(P, u, &v);
+    SparseMatrix_multiply_vector(P, u, &v, 1);
     free(u);
     u = v;
     cgrid = cgrid->prev;
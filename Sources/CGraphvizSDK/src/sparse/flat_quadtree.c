@@ -0,0 +1,904 @@
+/// @file
+/// @brief pointer-free Barnes-Hut quadtree/octree for sfdp
+///
+/// To match `QuadTree_new_from_point_list` exactly, the build replays the order
+/// in which `QuadTree_add` inserts points into each cell. A cell receives its
+/// points in some sequence s₀, s₁, …. When s₁ arrives the cell splits: s₁ goes
+/// down first, then s₀ leaves the cell, then the rest follow in order. So the
+/// children of a cell see s₁, s₀, s₂, s₃, … and the build partitions each cell
+/// in that order. Cells at `max_level` keep their points in a list that
+/// `QuadTree_add` prepends to, so they are walked last point first.
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <sched.h>
+#include <sparse/flat_quadtree.h>
+#include <sparse/general.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/parallel.h>
+
+/// cells of a tree, or of one subtree during a parallel build, breadth-first
+typedef struct {
+  int n_cells;
+  int capacity;
+  double *center;  ///< `dim` per cell
+  double *average; ///< `dim` per cell
+  double *width;
+  double *weight;
+  int *start;      ///< first point of the cell in `ids`
+  int *count;
+  int *level;
+  int *child;      ///< `n_children` per cell, -1 where a quadrant is empty
+  int *bucket;     ///< per-quadrant counts, then offsets
+} cells_t;
+
+/// one call of `repulsive_force_interact` in a parallel force pass
+typedef struct {
+  int c1, c2;
+  /// how many earlier tasks touch the owners of `c1` and `c2`
+  int seq1, seq2;
+} task_t;
+
+struct flat_quadtree_s {
+  int dim;
+  int n_children; ///< 2^dim
+  int max_level;
+  int threads;    ///< requested thread count, 0 for the default
+
+  // points, in cell order
+  int n;
+  int point_capacity;
+  int *ids;        ///< point ids; each cell owns a range in insertion order
+  double *coord;   ///< copy of the coordinates, in the same order as `ids`
+  int *scratch;    ///< partition buffer, indexed like `ids`
+  int *quadrant;   ///< quadrant of each point of a cell being split, ditto
+  double *bounds;  ///< bounding box of the points, `dim` minima then maxima
+
+  cells_t cells;
+  int extra_capacity;
+  double *force;   ///< `dim` per cell, filled by the repulsive force pass
+  int *owner;      ///< owner of each cell, when built in parallel
+
+  // parallel builds hand each subtree below `frontier` to its own thread
+  int frontier;    ///< first cell with level `cut`, or `n_cells` if serial
+  int n_owners;    ///< end of the cells at level `cut`, 0 if serial
+  cells_t *subtrees;
+  int subtree_capacity;
+  int *subtree_base; ///< where the cells below each subtree root are copied
+
+  // parallel force pass
+  task_t *tasks;
+  int n_tasks;
+  int task_capacity;
+  int *next_seq;      ///< per owner, while planning
+  atomic_int *done;   ///< per owner, tasks finished so far
+  double *owner_counts; ///< per owner, 3 work counters
+  int owner_capacity;
+};
+
+/// trees over fewer points are built and queried on the calling thread
+enum { PARALLEL_MIN_POINTS = 4096 };
+
+/// subtrees per thread in parallel builds, for load balance
+enum { SUBTREES_PER_THREAD = 16 };
+
+flat_quadtree_t *flat_quadtree_new(int dim) {
+  assert(dim > 0);
+  flat_quadtree_t *qt = gv_alloc(sizeof(flat_quadtree_t));
+  qt->dim = dim;
+  qt->n_children = 1 << dim;
+  qt->bounds = gv_calloc(2 * (size_t)dim, sizeof(double));
+  return qt;
+}
+
+static void cells_free(cells_t *cells) {
+  free(cells->center);
+  free(cells->average);
+  free(cells->width);
+  free(cells->weight);
+  free(cells->start);
+  free(cells->count);
+  free(cells->level);
+  free(cells->child);
+  free(cells->bucket);
+}
+
+void flat_quadtree_free(flat_quadtree_t *qt) {
+  if (qt == NULL) {
+    return;
+  }
+  free(qt->ids);
+  free(qt->coord);
+  free(qt->scratch);
+  free(qt->quadrant);
+  free(qt->bounds);
+  cells_free(&qt->cells);
+  free(qt->force);
+  free(qt->owner);
+  for (int i = 0; i < qt->subtree_capacity; i++) {
+    cells_free(&qt->subtrees[i]);
+  }
+  free(qt->subtrees);
+  free(qt->subtree_base);
+  free(qt->tasks);
+  free(qt->next_seq);
+  free(qt->done);
+  free(qt->owner_counts);
+  free(qt);
+}
+
+void flat_quadtree_set_threads(flat_quadtree_t *qt, int threads) {
+  qt->threads = threads > 0 ? threads : 0;
+}
+
+/// threads to use for a tree over `n` points
+static int threads_for(const flat_quadtree_t *qt, int n) {
+  if (n < PARALLEL_MIN_POINTS) {
+    return 1;
+  }
+  return qt->threads > 0 ? qt->threads : gv_parallel_threads();
+}
+
+static void reserve_points(flat_quadtree_t *qt, int n) {
+  if (n <= qt->point_capacity) {
+    return;
+  }
+  const size_t old = (size_t)qt->point_capacity;
+  const size_t dim = (size_t)qt->dim;
+  qt->ids = gv_recalloc(qt->ids, old, (size_t)n, sizeof(int));
+  qt->coord = gv_recalloc(qt->coord, old * dim, (size_t)n * dim, sizeof(double));
+  qt->scratch = gv_recalloc(qt->scratch, old, (size_t)n, sizeof(int));
+  qt->quadrant = gv_recalloc(qt->quadrant, old, (size_t)n, sizeof(int));
+  qt->point_capacity = n;
+}
+
+static void reserve_cells(const flat_quadtree_t *qt, cells_t *cells, int n) {
+  if (cells->bucket == NULL) {
+    cells->bucket = gv_calloc((size_t)qt->n_children + 1, sizeof(int));
+  }
+  if (n <= cells->capacity) {
+    return;
+  }
+  const size_t old = (size_t)cells->capacity;
+  size_t cap = old == 0 ? 64 : 2 * old;
+  if (cap < (size_t)n) {
+    cap = (size_t)n;
+  }
+  const size_t dim = (size_t)qt->dim;
+  const size_t nc = (size_t)qt->n_children;
+  cells->center = gv_recalloc(cells->center, old * dim, cap * dim, sizeof(double));
+  cells->average = gv_recalloc(cells->average, old * dim, cap * dim, sizeof(double));
+  cells->width = gv_recalloc(cells->width, old, cap, sizeof(double));
+  cells->weight = gv_recalloc(cells->weight, old, cap, sizeof(double));
+  cells->start = gv_recalloc(cells->start, old, cap, sizeof(int));
+  cells->count = gv_recalloc(cells->count, old, cap, sizeof(int));
+  cells->level = gv_recalloc(cells->level, old, cap, sizeof(int));
+  cells->child = gv_recalloc(cells->child, old * nc, cap * nc, sizeof(int));
+  cells->capacity = (int)cap;
+}
+
+/// append a cell and return its index
+static int add_cell(const flat_quadtree_t *qt, cells_t *cells, int level,
+                    double width, int start, int count) {
+  reserve_cells(qt, cells, cells->n_cells + 1);
+  const int c = cells->n_cells++;
+  cells->level[c] = level;
+  cells->width[c] = width;
+  cells->start[c] = start;
+  cells->count[c] = count;
+  cells->weight[c] = count;
+  for (int i = 0; i < qt->n_children; i++) {
+    cells->child[(size_t)c * qt->n_children + i] = -1;
+  }
+  return c;
+}
+
+static bool is_leaf(const flat_quadtree_t *qt, const cells_t *cells, int c) {
+  return cells->count[c] == 1 || cells->level[c] >= qt->max_level;
+}
+
+/// the running mean `QuadTree_add` keeps for a cell, in its insertion order
+static void set_average(const flat_quadtree_t *qt, cells_t *cells, int c,
+                        const double *coord) {
+  const int dim = qt->dim;
+  const int *ids = qt->ids + cells->start[c];
+  double *avg = cells->average + (size_t)c * dim;
+  const bool splits = cells->level[c] < qt->max_level;
+  for (int k = 0; k < dim; k++) {
+    avg[k] = coord[(size_t)ids[0] * dim + k];
+  }
+  for (int j = 1; j < cells->count[c]; j++) {
+    const double *x = coord + (size_t)ids[j] * dim;
+    // cells at the last level count the new point before averaging it in
+    const double n = splits ? j : j + 1;
+    for (int k = 0; k < dim; k++) {
+      avg[k] = (avg[k] * n + x[k]) / (n + 1);
+    }
+  }
+}
+
+static int quadrant_of(int dim, const double *center, const double *coord) {
+  int d = 0;
+  for (int i = dim - 1; i >= 0; i--) {
+    d = coord[i] - center[i] < 0 ? 2 * d : 2 * d + 1;
+  }
+  return d;
+}
+
+/// partition the points of cell `c` into new child cells
+///
+/// Only touches the cell's own range of the point buffers, so subtrees over
+/// disjoint ranges can be split concurrently.
+static void split(const flat_quadtree_t *qt, cells_t *cells, int c,
+                  const double *coord) {
+  const int dim = qt->dim;
+  const int nc = qt->n_children;
+  const int start = cells->start[c];
+  const int count = cells->count[c];
+  int *ids = qt->ids + start;
+  int *quadrant = qt->quadrant + start;
+  int *scratch = qt->scratch + start;
+
+  // the second point goes down before the first one
+  const int first = ids[0];
+  ids[0] = ids[1];
+  ids[1] = first;
+
+  int *bucket = cells->bucket;
+  memset(bucket, 0, sizeof(int) * ((size_t)nc + 1));
+  const double *center = cells->center + (size_t)c * dim;
+  for (int j = 0; j < count; j++) {
+    const int q = quadrant_of(dim, center, coord + (size_t)ids[j] * dim);
+    quadrant[j] = q;
+    bucket[q + 1]++;
+  }
+  for (int q = 0; q < nc; q++) {
+    bucket[q + 1] += bucket[q];
+  }
+  for (int j = 0; j < count; j++) {
+    scratch[bucket[quadrant[j]]++] = ids[j];
+  }
+  memcpy(ids, scratch, sizeof(int) * (size_t)count);
+
+  // `bucket[q]` is now the end of quadrant q
+  const double width = cells->width[c] / 2;
+  int begin = 0;
+  for (int q = 0; q < nc; q++) {
+    const int end = bucket[q];
+    if (end == begin) {
+      continue;
+    }
+    const int d = add_cell(qt, cells, cells->level[c] + 1, width, start + begin,
+                           end - begin);
+    cells->child[(size_t)c * nc + q] = d;
+    double *child_center = cells->center + (size_t)d * dim;
+    const double *parent_center = cells->center + (size_t)c * dim;
+    for (int k = 0, i = q; k < dim; k++, i /= 2) {
+      child_center[k] = i % 2 == 0 ? parent_center[k] - width
+                                   : parent_center[k] + width;
+    }
+    begin = end;
+  }
+}
+
+/// process cells breadth-first from `c` until none are left to split
+static void build_from(const flat_quadtree_t *qt, cells_t *cells, int c,
+                       const double *coord) {
+  // cells are appended behind the one being processed, so this is breadth-first
+  for (; c < cells->n_cells; c++) {
+    set_average(qt, cells, c, coord);
+    if (!is_leaf(qt, cells, c)) {
+      split(qt, cells, c, coord);
+    }
+  }
+}
+
+typedef struct {
+  flat_quadtree_t *qt;
+  const double *coord;
+} build_job_t;
+
+/// build the subtrees below cells `[frontier + begin, frontier + end)`
+static void build_subtrees(void *ctx, size_t begin, size_t end) {
+  const build_job_t *job = ctx;
+  const flat_quadtree_t *qt = job->qt;
+  const cells_t *cells = &qt->cells;
+  const int dim = qt->dim;
+  for (size_t i = begin; i < end; i++) {
+    const int f = qt->frontier + (int)i;
+    cells_t *sub = &qt->subtrees[i];
+    sub->n_cells = 0;
+    const int root = add_cell(qt, sub, cells->level[f], cells->width[f],
+                              cells->start[f], cells->count[f]);
+    memcpy(sub->center + (size_t)root * dim, cells->center + (size_t)f * dim,
+           sizeof(double) * (size_t)dim);
+    build_from(qt, sub, root, job->coord);
+  }
+}
+
+/// copy the subtrees into the tree, below their roots in `[frontier, n_owners)`
+static void merge_subtrees(void *ctx, size_t begin, size_t end) {
+  flat_quadtree_t *qt = ctx;
+  cells_t *cells = &qt->cells;
+  const size_t dim = (size_t)qt->dim;
+  const size_t nc = (size_t)qt->n_children;
+  for (size_t i = begin; i < end; i++) {
+    const int f = qt->frontier + (int)i;
+    const cells_t *sub = &qt->subtrees[i];
+    const int base = qt->subtree_base[i];
+    // subtree cell l > 0 lands at base + l - 1, its root is f
+    for (int l = 0; l < sub->n_cells; l++) {
+      const int c = l == 0 ? f : base + l - 1;
+      memcpy(cells->center + c * dim, sub->center + l * dim,
+             sizeof(double) * dim);
+      memcpy(cells->average + c * dim, sub->average + l * dim,
+             sizeof(double) * dim);
+      cells->width[c] = sub->width[l];
+      cells->weight[c] = sub->weight[l];
+      cells->start[c] = sub->start[l];
+      cells->count[c] = sub->count[l];
+      cells->level[c] = sub->level[l];
+      for (size_t q = 0; q < nc; q++) {
+        const int d = sub->child[l * nc + q];
+        cells->child[c * nc + q] = d < 0 ? -1 : base + d - 1;
+      }
+      qt->owner[c] = f;
+    }
+  }
+}
+
+static void reserve_extras(flat_quadtree_t *qt) {
+  const int n = qt->cells.n_cells;
+  if (n <= qt->extra_capacity) {
+    return;
+  }
+  const size_t old = (size_t)qt->extra_capacity;
+  const size_t dim = (size_t)qt->dim;
+  qt->force = gv_recalloc(qt->force, old * dim, (size_t)n * dim, sizeof(double));
+  qt->owner = gv_recalloc(qt->owner, old, (size_t)n, sizeof(int));
+  qt->extra_capacity = n;
+}
+
+/// hand the subtrees below cells `[frontier, n_cells)` to `threads` threads
+static void build_parallel(flat_quadtree_t *qt, int threads,
+                           const double *coord) {
+  cells_t *cells = &qt->cells;
+  const int n_subtrees = cells->n_cells - qt->frontier;
+  if (n_subtrees > qt->subtree_capacity) {
+    qt->subtrees = gv_recalloc(qt->subtrees, (size_t)qt->subtree_capacity,
+                               (size_t)n_subtrees, sizeof(cells_t));
+    qt->subtree_base = gv_recalloc(qt->subtree_base,
+                                   (size_t)qt->subtree_capacity,
+                                   (size_t)n_subtrees, sizeof(int));
+    qt->subtree_capacity = n_subtrees;
+  }
+  qt->n_owners = cells->n_cells;
+
+  build_job_t job = {.qt = qt, .coord = coord};
+  gv_parallel_for_threads(threads, (size_t)n_subtrees, 1, build_subtrees, &job);
+
+  int total = cells->n_cells;
+  for (int i = 0; i < n_subtrees; i++) {
+    qt->subtree_base[i] = total;
+    total += qt->subtrees[i].n_cells - 1;
+  }
+  reserve_cells(qt, cells, total);
+  cells->n_cells = total;
+  reserve_extras(qt);
+  for (int c = 0; c < qt->frontier; c++) {
+    qt->owner[c] = c;
+  }
+  gv_parallel_for_threads(threads, (size_t)n_subtrees, 1, merge_subtrees, qt);
+}
+
+void flat_quadtree_build(flat_quadtree_t *qt, int n, int max_level,
+                         const double *coord) {
+  const int dim = qt->dim;
+  cells_t *cells = &qt->cells;
+  qt->n = n;
+  qt->max_level = max_level;
+  cells->n_cells = 0;
+  qt->frontier = 0;
+  qt->n_owners = 0;
+  if (n <= 0) {
+    return;
+  }
+  reserve_points(qt, n);
+
+  // same bounding box as `QuadTree_new_from_point_list`
+  double *xmin = qt->bounds, *xmax = qt->bounds + dim;
+  for (int k = 0; k < dim; k++) {
+    xmin[k] = xmax[k] = coord[k];
+  }
+  for (int i = 1; i < n; i++) {
+    for (int k = 0; k < dim; k++) {
+      xmin[k] = fmin(xmin[k], coord[(size_t)i * dim + k]);
+      xmax[k] = fmax(xmax[k], coord[(size_t)i * dim + k]);
+    }
+  }
+  double width = xmax[0] - xmin[0];
+  for (int k = 0; k < dim; k++) {
+    width = fmax(width, xmax[k] - xmin[k]);
+  }
+  width = fmax(width, 0.00001); // if we only have one point, width = 0!
+  width *= 0.52;
+  const int root = add_cell(qt, cells, 0, width, 0, n);
+  for (int k = 0; k < dim; k++) {
+    cells->center[(size_t)root * dim + k] = (xmin[k] + xmax[k]) * 0.5;
+  }
+
+  for (int i = 0; i < n; i++) {
+    qt->ids[i] = i;
+  }
+
+  // Split level by level until one level has enough cells to keep every thread
+  // busy, then build the subtrees below those cells concurrently. The cells end
+  // up in a different order than a breadth-first build, but with the same
+  // children, so every traversal visits the same cells in the same order.
+  const int threads = threads_for(qt, n);
+  const int wanted = threads > 1 ? SUBTREES_PER_THREAD * threads : INT_MAX;
+  int c = root;
+  for (; c < cells->n_cells; c++) {
+    const bool level_start = c == root || cells->level[c] != cells->level[c - 1];
+    if (level_start && cells->n_cells - c >= wanted) {
+      break;
+    }
+    set_average(qt, cells, c, coord);
+    if (!is_leaf(qt, cells, c)) {
+      split(qt, cells, c, coord);
+    }
+  }
+  qt->frontier = c;
+  if (c < cells->n_cells) {
+    build_parallel(qt, threads, coord);
+  } else {
+    reserve_extras(qt);
+  }
+
+  for (int j = 0; j < n; j++) {
+    memcpy(qt->coord + (size_t)j * dim, coord + (size_t)qt->ids[j] * dim,
+           sizeof(double) * (size_t)dim);
+  }
+}
+
+static double pair_force(double KP, double p, double diff, double dist) {
+  if (p == -1) {
+    return KP * diff / (dist * dist);
+  }
+  return KP * diff / pow(dist, 1. - p);
+}
+
+static void repulsive_force_interact(flat_quadtree_t *qt, int c1, int c2,
+                                     double *x, double *force, double bh,
+                                     double p, double KP, double *counts) {
+  const cells_t *cells = &qt->cells;
+  const int dim = qt->dim;
+  const int nc = qt->n_children;
+  const double *avg1 = cells->average + (size_t)c1 * dim;
+  const double *avg2 = cells->average + (size_t)c2 * dim;
+
+  // far enough, calculate repulsive force between the cells
+  double dist = point_distance((double *)avg1, (double *)avg2, dim);
+  if (cells->width[c1] + cells->width[c2] < bh * dist) {
+    counts[0]++;
+    const double w = cells->weight[c1] * cells->weight[c2] * KP;
+    double *f1 = qt->force + (size_t)c1 * dim;
+    double *f2 = qt->force + (size_t)c2 * dim;
+    assert(dist > 0);
+    for (int k = 0; k < dim; k++) {
+      const double f = pair_force(w, p, avg1[k] - avg2[k], dist);
+      f1[k] += f;
+      f2[k] -= f;
+    }
+    return;
+  }
+
+  const bool leaf1 = is_leaf(qt, cells, c1);
+  const bool leaf2 = is_leaf(qt, cells, c2);
+
+  // both at leaves, calculate repulsive force between their points
+  if (leaf1 && leaf2) {
+    const int begin1 = cells->start[c1], begin2 = cells->start[c2];
+    for (int s1 = begin1 + cells->count[c1] - 1; s1 >= begin1; s1--) {
+      const int i1 = qt->ids[s1];
+      const double *x1 = qt->coord + (size_t)s1 * dim;
+      double *f1 = force + (size_t)i1 * dim;
+      for (int s2 = begin2 + cells->count[c2] - 1; s2 >= begin2; s2--) {
+        const int i2 = qt->ids[s2];
+        if ((c1 == c2 && i2 < i1) || i1 == i2) {
+          continue;
+        }
+        counts[1]++;
+        const double *x2 = qt->coord + (size_t)s2 * dim;
+        double *f2 = force + (size_t)i2 * dim;
+        dist = distance_cropped(x, dim, i1, i2);
+        for (int k = 0; k < dim; k++) {
+          const double f = pair_force(KP, p, x1[k] - x2[k], dist);
+          f1[k] += f;
+          f2[k] -= f;
+        }
+      }
+    }
+    return;
+  }
+
+  const int *children1 = cells->child + (size_t)c1 * nc;
+  const int *children2 = cells->child + (size_t)c2 * nc;
+
+  // identical, split one
+  if (c1 == c2) {
+    for (int i = 0; i < nc; i++) {
+      if (children1[i] < 0) {
+        continue;
+      }
+      for (int j = i; j < nc; j++) {
+        if (children1[j] >= 0) {
+          repulsive_force_interact(qt, children1[i], children1[j], x, force, bh,
+                                   p, KP, counts);
+        }
+      }
+    }
+    return;
+  }
+
+  // split the one with the bigger box, or the one not at the last level
+  const int *children;
+  int other;
+  if (cells->width[c1] > cells->width[c2] && !leaf1) {
+    children = children1, other = c2;
+  } else if (cells->width[c2] > cells->width[c1] && !leaf2) {
+    children = children2, other = c1;
+  } else if (!leaf1) {
+    children = children1, other = c2;
+  } else {
+    assert(!leaf2);
+    children = children2, other = c1;
+  }
+  for (int i = 0; i < nc; i++) {
+    if (children[i] >= 0) {
+      repulsive_force_interact(qt, children[i], other, x, force, bh, p, KP,
+                               counts);
+    }
+  }
+}
+
+/// push the force on cell `c` down to its child `d`
+static void push_force(flat_quadtree_t *qt, int c, int d) {
+  const int dim = qt->dim;
+  const double *f = qt->force + (size_t)c * dim;
+  double *f2 = qt->force + (size_t)d * dim;
+  const double wgt2 = qt->cells.weight[d] / qt->cells.weight[c];
+  for (int k = 0; k < dim; k++) {
+    f2[k] += wgt2 * f[k];
+  }
+}
+
+/// push the forces on cells down to their points
+///
+/// Stops above cells from `stop` onwards, which are left for the caller.
+static void repulsive_force_accumulate(flat_quadtree_t *qt, int c, int stop,
+                                       double *force, double *counts) {
+  const cells_t *cells = &qt->cells;
+  const int dim = qt->dim;
+  const int nc = qt->n_children;
+  const double wgt = cells->weight[c];
+  const double *f = qt->force + (size_t)c * dim;
+  assert(wgt > 0);
+  counts[2]++;
+
+  if (is_leaf(qt, cells, c)) {
+    const int begin = cells->start[c];
+    for (int s = begin + cells->count[c] - 1; s >= begin; s--) {
+      double *f2 = force + (size_t)qt->ids[s] * dim;
+      const double wgt2 = 1. / wgt;
+      for (int k = 0; k < dim; k++) {
+        f2[k] += wgt2 * f[k];
+      }
+    }
+    return;
+  }
+
+  for (int i = 0; i < nc; i++) {
+    const int d = cells->child[(size_t)c * nc + i];
+    if (d < 0) {
+      continue;
+    }
+    push_force(qt, c, d);
+    if (d < stop) {
+      repulsive_force_accumulate(qt, d, stop, force, counts);
+    }
+  }
+}
+
+// Parallel force pass
+//
+// In a tree built in parallel, every cell at or below the frontier belongs to
+// the subtree root above it, and every cell above the frontier to itself. A
+// call of `repulsive_force_interact` on two cells only writes the forces of
+// cells and points that belong to the owners of those two cells.
+//
+// The serial recursion is replayed down to pairs of cells that need no more
+// splitting above the frontier, recording each pair as a task. Tasks run
+// concurrently, but each waits until all earlier tasks on its owners are
+// done, so every force is summed in the same order as by a serial pass and
+// the result does not depend on the thread count. Tasks are claimed in
+// order, so the earliest unfinished task can always run.
+
+/// whether a pair involving `c` needs no splitting above the frontier
+static bool is_cut(const flat_quadtree_t *qt, int c) {
+  return c >= qt->frontier || is_leaf(qt, &qt->cells, c);
+}
+
+static int owner_of(const flat_quadtree_t *qt, int c) {
+  return qt->owner[c];
+}
+
+static void add_task(flat_quadtree_t *qt, int c1, int c2) {
+  if (qt->n_tasks == qt->task_capacity) {
+    const size_t old = (size_t)qt->task_capacity;
+    const size_t cap = old == 0 ? 256 : 2 * old;
+    qt->tasks = gv_recalloc(qt->tasks, old, cap, sizeof(task_t));
+    qt->task_capacity = (int)cap;
+  }
+  const int o1 = owner_of(qt, c1), o2 = owner_of(qt, c2);
+  task_t *task = &qt->tasks[qt->n_tasks++];
+  task->c1 = c1;
+  task->c2 = c2;
+  task->seq1 = qt->next_seq[o1]++;
+  task->seq2 = o2 == o1 ? task->seq1 : qt->next_seq[o2]++;
+}
+
+/// `repulsive_force_interact`, recording tasks instead of computing forces
+static void plan_interact(flat_quadtree_t *qt, int c1, int c2, double bh) {
+  const cells_t *cells = &qt->cells;
+  const int dim = qt->dim;
+  const int nc = qt->n_children;
+
+  const double dist = point_distance(cells->average + (size_t)c1 * dim,
+                                     cells->average + (size_t)c2 * dim, dim);
+  if (cells->width[c1] + cells->width[c2] < bh * dist ||
+      (is_cut(qt, c1) && is_cut(qt, c2))) {
+    add_task(qt, c1, c2);
+    return;
+  }
+
+  const bool leaf1 = is_leaf(qt, cells, c1);
+  const bool leaf2 = is_leaf(qt, cells, c2);
+  const int *children1 = cells->child + (size_t)c1 * nc;
+  const int *children2 = cells->child + (size_t)c2 * nc;
+
+  if (c1 == c2) {
+    for (int i = 0; i < nc; i++) {
+      if (children1[i] < 0) {
+        continue;
+      }
+      for (int j = i; j < nc; j++) {
+        if (children1[j] >= 0) {
+          plan_interact(qt, children1[i], children1[j], bh);
+        }
+      }
+    }
+    return;
+  }
+
+  const int *children;
+  int other;
+  if (cells->width[c1] > cells->width[c2] && !leaf1) {
+    children = children1, other = c2;
+  } else if (cells->width[c2] > cells->width[c1] && !leaf2) {
+    children = children2, other = c1;
+  } else if (!leaf1) {
+    children = children1, other = c2;
+  } else {
+    children = children2, other = c1;
+  }
+  for (int i = 0; i < nc; i++) {
+    if (children[i] >= 0) {
+      plan_interact(qt, children[i], other, bh);
+    }
+  }
+}
+
+typedef struct {
+  flat_quadtree_t *qt;
+  double *force;
+  double *x;
+  double bh, p, KP;
+} force_job_t;
+
+static void wait_for(atomic_int *done, int seq) {
+  while (atomic_load_explicit(done, memory_order_acquire) != seq) {
+    sched_yield();
+  }
+}
+
+static void run_tasks(void *ctx, size_t begin, size_t end) {
+  const force_job_t *job = ctx;
+  flat_quadtree_t *qt = job->qt;
+  for (size_t t = begin; t < end; t++) {
+    const task_t *task = &qt->tasks[t];
+    const int o1 = owner_of(qt, task->c1), o2 = owner_of(qt, task->c2);
+    wait_for(&qt->done[o1], task->seq1);
+    if (o2 != o1) {
+      wait_for(&qt->done[o2], task->seq2);
+    }
+    // tasks on the same owner never overlap, so neither do their counters
+    repulsive_force_interact(qt, task->c1, task->c2, job->x, job->force,
+                             job->bh, job->p, job->KP,
+                             qt->owner_counts + 3 * (size_t)o1);
+    atomic_fetch_add_explicit(&qt->done[o1], 1, memory_order_release);
+    if (o2 != o1) {
+      atomic_fetch_add_explicit(&qt->done[o2], 1, memory_order_release);
+    }
+  }
+}
+
+static void accumulate_subtrees(void *ctx, size_t begin, size_t end) {
+  const force_job_t *job = ctx;
+  flat_quadtree_t *qt = job->qt;
+  for (size_t i = begin; i < end; i++) {
+    const int f = qt->frontier + (int)i;
+    repulsive_force_accumulate(qt, f, INT_MAX, job->force,
+                               qt->owner_counts + 3 * (size_t)f);
+  }
+}
+
+static void repulsive_force_parallel(flat_quadtree_t *qt, double *force,
+                                     double *x, double bh, double p, double KP,
+                                     double *counts) {
+  const int n_owners = qt->n_owners;
+  if (n_owners > qt->owner_capacity) {
+    const size_t old = (size_t)qt->owner_capacity;
+    qt->next_seq = gv_recalloc(qt->next_seq, old, (size_t)n_owners, sizeof(int));
+    qt->done = gv_recalloc(qt->done, old, (size_t)n_owners, sizeof(atomic_int));
+    qt->owner_counts = gv_recalloc(qt->owner_counts, 3 * old,
+                                   3 * (size_t)n_owners, sizeof(double));
+    qt->owner_capacity = n_owners;
+  }
+  for (int o = 0; o < n_owners; o++) {
+    qt->next_seq[o] = 0;
+    atomic_init(&qt->done[o], 0);
+  }
+  memset(qt->owner_counts, 0, sizeof(double) * 3 * (size_t)n_owners);
+
+  qt->n_tasks = 0;
+  plan_interact(qt, 0, 0, bh);
+
+  const int threads = threads_for(qt, qt->n);
+  force_job_t job = {
+      .qt = qt, .force = force, .x = x, .bh = bh, .p = p, .KP = KP};
+  // a few tasks per chunk keeps the claiming cheap; a chunk's tasks run in
+  // order, so the earliest unfinished task is still always runnable
+  size_t grain = (size_t)qt->n_tasks / ((size_t)threads * 64);
+  if (grain < 1) {
+    grain = 1;
+  }
+  gv_parallel_for_threads(threads, (size_t)qt->n_tasks, grain, run_tasks, &job);
+
+  repulsive_force_accumulate(qt, 0, qt->frontier, force, counts);
+  gv_parallel_for_threads(threads, (size_t)(n_owners - qt->frontier), 1,
+                          accumulate_subtrees, &job);
+
+  for (int o = 0; o < n_owners; o++) {
+    for (int i = 0; i < 3; i++) {
+      counts[i] += qt->owner_counts[3 * (size_t)o + i];
+    }
+  }
+}
+
+void flat_quadtree_get_repulsive_force(flat_quadtree_t *qt, double *force,
+                                       double *x, double bh, double p,
+                                       double KP, double *counts) {
+  const int n = qt->n, dim = qt->dim;
+
+  for (int i = 0; i < 4; i++) {
+    counts[i] = 0;
+  }
+  memset(force, 0, sizeof(double) * (size_t)dim * (size_t)n);
+  if (n <= 0) {
+    return;
+  }
+  memset(qt->force, 0, sizeof(double) * (size_t)dim * (size_t)qt->cells.n_cells);
+
+  if (qt->n_owners > 0) {
+    repulsive_force_parallel(qt, force, x, bh, p, KP, counts);
+  } else {
+    repulsive_force_interact(qt, 0, 0, x, force, bh, p, KP, counts);
+    repulsive_force_accumulate(qt, 0, INT_MAX, force, counts);
+  }
+  for (int i = 0; i < 4; i++) {
+    counts[i] /= n;
+  }
+}
+
+static void check_or_realloc_arrays(int dim, int *nsuper, int *nsupermax,
+                                    double **center, double **supernode_wgts,
+                                    double **distances) {
+  if (*nsuper >= *nsupermax) {
+    const int new_nsupermax = *nsuper + 10;
+    *center = gv_recalloc(*center, dim * *nsupermax, dim * new_nsupermax,
+                          sizeof(double));
+    *supernode_wgts = gv_recalloc(*supernode_wgts, *nsupermax, new_nsupermax,
+                                  sizeof(double));
+    *distances =
+        gv_recalloc(*distances, *nsupermax, new_nsupermax, sizeof(double));
+    *nsupermax = new_nsupermax;
+  }
+}
+
+static void get_supernodes_internal(const flat_quadtree_t *qt, int c, double bh,
+                                    double *pt, int nodeid, int *nsuper,
+                                    int *nsupermax, double **center,
+                                    double **supernode_wgts, double **distances,
+                                    double *counts) {
+  const cells_t *cells = &qt->cells;
+  const int dim = qt->dim;
+  const int nc = qt->n_children;
+
+  (*counts)++;
+
+  if (is_leaf(qt, cells, c)) {
+    const int begin = cells->start[c];
+    for (int s = begin + cells->count[c] - 1; s >= begin; s--) {
+      check_or_realloc_arrays(dim, nsuper, nsupermax, center, supernode_wgts,
+                              distances);
+      if (qt->ids[s] == nodeid) {
+        continue;
+      }
+      double *coord = qt->coord + (size_t)s * dim;
+      memcpy(*center + (size_t)dim * *nsuper, coord, sizeof(double) * (size_t)dim);
+      (*supernode_wgts)[*nsuper] = 1;
+      (*distances)[*nsuper] = point_distance(pt, coord, dim);
+      (*nsuper)++;
+    }
+    return;
+  }
+
+  const double dist = point_distance(cells->center + (size_t)c * dim, pt, dim);
+  if (cells->width[c] < bh * dist) {
+    check_or_realloc_arrays(dim, nsuper, nsupermax, center, supernode_wgts,
+                            distances);
+    double *avg = cells->average + (size_t)c * dim;
+    memcpy(*center + (size_t)dim * *nsuper, avg, sizeof(double) * (size_t)dim);
+    (*supernode_wgts)[*nsuper] = cells->weight[c];
+    (*distances)[*nsuper] = point_distance(avg, pt, dim);
+    (*nsuper)++;
+    return;
+  }
+  for (int i = 0; i < nc; i++) {
+    const int d = cells->child[(size_t)c * nc + i];
+    if (d < 0) {
+      (*counts)++; // an empty quadrant is still a visit
+      continue;
+    }
+    get_supernodes_internal(qt, d, bh, pt, nodeid, nsuper, nsupermax, center,
+                            supernode_wgts, distances, counts);
+  }
+}
+
+void flat_quadtree_get_supernodes(const flat_quadtree_t *qt, double bh,
+                                  double *pt, int nodeid, int *nsuper,
+                                  int *nsupermax, double **center,
+                                  double **supernode_wgts, double **distances,
+                                  double *counts) {
+  const int dim = qt->dim;
+
+  *counts = 0;
+  *nsuper = 0;
+  *nsupermax = 10;
+  if (!*center) *center = gv_calloc(*nsupermax * dim, sizeof(double));
+  if (!*supernode_wgts) *supernode_wgts = gv_calloc(*nsupermax, sizeof(double));
+  if (!*distances) *distances = gv_calloc(*nsupermax, sizeof(double));
+  if (qt->cells.n_cells == 0) {
+    (*counts)++;
+    return;
+  }
+  get_supernodes_internal(qt, 0, bh, pt, nodeid, nsuper, nsupermax, center,
+                          supernode_wgts, distances, counts);
+}
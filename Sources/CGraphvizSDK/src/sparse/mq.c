@@ -457,8 +457,8 @@ static Multilevel_MQ_Clustering Multilevel_MQ_Clustering_establish(Multilevel_MQ
     }
     R = SparseMatrix_from_coordinate_format(R0);
     SparseMatrix_delete(R0);
-    P = SparseMatrix_transpose(R);
-    B = SparseMatrix_multiply(R, A);
+    P = SparseMatrix_transpose(R, 1);
+    B = SparseMatrix_multiply(R, A, 1);
     SparseMatrix_delete(R);
     if (!B) {
         free(deg_intra_new);
@@ -466,7 +466,7 @@ static Multilevel_MQ_Clustering Multilevel_MQ_Clustering_establish(Multilevel_MQ
         free(dout_new);
         goto RETURN;
     }
-    cA = SparseMatrix_multiply(B, P); 
+    cA = SparseMatrix_multiply(B, P, 1); 
     SparseMatrix_delete(B);
     if (!cA) {
         free(deg_intra_new);
@@ -560,7 +560,7 @@ static void hierachical_mq_clustering(SparseMatrix A, int maxcluster,
   while (cgrid->prev){
     double *v = NULL;
     P = cgrid->prev->P;
-    SparseMatrix_multiply_vector(P, u, &v);
+    SparseMatrix_multiply_vector(P, u, &v, 1);
     free(u);
     u = v;
     cgrid = cgrid->prev;
@@ -0,0 +1,92 @@
+/// @file
+/// @brief Implementation of fork/join parallel loops
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <util/alloc.h>
+#include <util/parallel.h>
+
+/// explicitly configured thread count, 0 if unset
+static atomic_int configured_threads;
+
+int gv_parallel_threads(void) {
+  const int configured = atomic_load(&configured_threads);
+  if (configured > 0) {
+    return configured;
+  }
+  const long online = sysconf(_SC_NPROCESSORS_ONLN);
+  return online > 0 ? (int)online : 1;
+}
+
+void gv_parallel_set_threads(int threads) {
+  atomic_store(&configured_threads, threads > 0 ? threads : 0);
+}
+
+/// state shared by all threads of one `gv_parallel_for` call
+typedef struct {
+  atomic_size_t next; ///< first index not yet claimed
+  size_t n;
+  size_t grain;
+  gv_parallel_body_t body;
+  void *ctx;
+} loop_t;
+
+static void *run_chunks(void *arg) {
+  loop_t *loop = arg;
+  for (;;) {
+    const size_t begin = atomic_fetch_add(&loop->next, loop->grain);
+    if (begin >= loop->n) {
+      break;
+    }
+    const size_t end =
+        loop->n - begin < loop->grain ? loop->n : begin + loop->grain;
+    loop->body(loop->ctx, begin, end);
+  }
+  return NULL;
+}
+
+void gv_parallel_for(size_t n, size_t grain, gv_parallel_body_t body,
+                     void *ctx) {
+  gv_parallel_for_threads(0, n, grain, body, ctx);
+}
+
+void gv_parallel_for_threads(int threads_requested, size_t n, size_t grain,
+                             gv_parallel_body_t body, void *ctx) {
+  assert(grain > 0);
+  assert(body != NULL);
+
+  if (n == 0) {
+    return;
+  }
+  const size_t chunks = (n - 1) / grain + 1;
+  size_t threads = threads_requested > 0 ? (size_t)threads_requested
+                                          : (size_t)gv_parallel_threads();
+  if (threads > chunks) {
+    threads = chunks;
+  }
+  if (threads <= 1) {
+    body(ctx, 0, n);
+    return;
+  }
+
+  loop_t loop = {.n = n, .grain = grain, .body = body, .ctx = ctx};
+  atomic_init(&loop.next, 0);
+
+  pthread_t *workers = gv_calloc(threads - 1, sizeof(pthread_t));
+  size_t started = 0;
+  for (; started < threads - 1; ++started) {
+    // if the system refuses more threads, the ones we have share the work
+    if (pthread_create(&workers[started], NULL, run_chunks, &loop) != 0) {
+      break;
+    }
+  }
+  run_chunks(&loop);
+  for (size_t i = 0; i < started; ++i) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+}
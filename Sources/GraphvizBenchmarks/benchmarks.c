@@ -0,0 +1,611 @@
+//
+//  benchmarks.c
+//  GraphvizBenchmarks
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+
+#include "benchmarks.h"
+#include <cgraph/cgraph.h>
+#include <graphviz_wrapper.h>
+#include <common/render.h>
+#include <common/types.h>
+#include <neatogen/matrix_ops.h>
+#include <neatogen/simd.h>
+#include <neatogen/stress.h>
+#include <sfdpgen/Multilevel.h>
+#include <sfdpgen/spring_electrical.h>
+#include <sparse/QuadTree.h>
+#include <sparse/flat_quadtree.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <util/agxbuf.h>
+#include <util/alloc.h>
+#include <util/parallel.h>
+
+static double seconds_since(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (double)(end.tv_sec - start->tv_sec) + (double)(end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/// Seconds spent in the all-pairs shortest paths step of stress majorization
+/// (`compute_apsp_packed`) on a square grid of about `nodes` nodes, using
+/// `threads` threads. The previous thread setting is restored afterwards.
+double apsp_benchmark(int nodes, int threads) {
+    int side = 1;
+    while (side * side < nodes) {
+        side++;
+    }
+    const int n = side * side;
+
+    vtx_data *graph = gv_calloc(n, sizeof(vtx_data));
+    int *edges = gv_calloc(5 * (size_t)n, sizeof(int));
+    for (int i = 0; i < n; i++) {
+        const int x = i % side;
+        const int y = i / side;
+        int *adj = edges + 5 * (size_t)i;
+        size_t count = 0;
+        adj[count++] = i;
+        if (x > 0) adj[count++] = i - 1;
+        if (x < side - 1) adj[count++] = i + 1;
+        if (y > 0) adj[count++] = i - side;
+        if (y < side - 1) adj[count++] = i + side;
+        graph[i].nedges = count;
+        graph[i].edges = adj;
+    }
+
+    const int previous = gv_parallel_threads();
+    gv_parallel_set_threads(threads);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    float *Dij = compute_apsp_packed(graph, n);
+    const double seconds = seconds_since(&start);
+    gv_parallel_set_threads(previous);
+
+    free(Dij);
+    free(edges);
+    free(graph);
+    return seconds;
+}
+
+/// Seconds spent in the dense float kernels of neatogen (inner product,
+/// scaled addition and the packed symmetric matrix-vector product of the
+/// conjugate gradient solver) over vectors of `elements` floats, with the
+/// vectorized kernels on or off. Small sizes are repeated so every call does
+/// about the same amount of work. The previous SIMD setting is restored
+/// afterwards.
+double dense_kernels_benchmark(int elements, bool simd) {
+    const int n = elements > 0 ? elements : 1;
+    int dim = 1;
+    while ((size_t)dim * (dim + 1) / 2 < (size_t)n) {
+        dim++;
+    }
+    const int reps = n < (1 << 24) ? (1 << 24) / n : 1;
+
+    float *x = gv_calloc(n, sizeof(float));
+    float *y = gv_calloc(n, sizeof(float));
+    float *packed = gv_calloc((size_t)dim * (dim + 1) / 2, sizeof(float));
+    float *result = gv_calloc(dim, sizeof(float));
+    for (int i = 0; i < n; i++) {
+        x[i] = (float)(i % 17) / 17.0f;
+        y[i] = (float)(i % 13) / 13.0f;
+    }
+    for (size_t i = 0; i < (size_t)dim * (dim + 1) / 2; i++) {
+        packed[i] = (float)(i % 7) / 7.0f;
+    }
+
+    const bool previous = simd_enabled();
+    simd_set_enabled(simd);
+    volatile double sink = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < reps; r++) {
+        sink += vectors_inner_productf(n, x, y);
+        vectors_mult_additionf(n, y, 1e-6f, x);
+        right_mult_with_vector_ff(packed, dim, x, result);
+    }
+    const double seconds = seconds_since(&start);
+    simd_set_enabled(previous);
+    (void)sink;
+
+    free(result);
+    free(packed);
+    free(y);
+    free(x);
+    return seconds;
+}
+
+/// `n` pseudo-random points in the square [0, 100)²
+static double *benchmark_points(int n) {
+    double *x = gv_calloc((size_t)n * 2, sizeof(double));
+    uint64_t state = 0x9e3779b97f4a7c15;
+    for (int i = 0; i < n * 2; i++) {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        x[i] = (double)(state >> 11) / (double)(UINT64_C(1) << 53) * 100;
+    }
+    return x;
+}
+
+/// Seconds per sfdp repulsive force pass (tree build plus
+/// `get_repulsive_force`) over `points` random points in the plane, with the
+/// pointer-based `QuadTree` or with `flat_quadtree_t`, whose buffers are reused
+/// from one pass to the next as sfdp does.
+double quadtree_benchmark(int points, bool flat) {
+    const int n = points > 1 ? points : 2;
+    const int dim = 2;
+    const int max_level = 10;
+    const int reps = 5;
+
+    double *x = benchmark_points(n);
+    double *force = gv_calloc((size_t)n * dim, sizeof(double));
+
+    double counts[4];
+    flat_quadtree_t *tree = flat ? flat_quadtree_new(dim) : NULL;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < reps; r++) {
+        if (flat) {
+            flat_quadtree_build(tree, n, max_level, x);
+            flat_quadtree_get_repulsive_force(tree, force, x, 0.6, -1, 1, counts);
+        } else {
+            QuadTree qt = QuadTree_new_from_point_list(dim, n, max_level, x);
+            QuadTree_get_repulsive_force(qt, force, x, 0.6, -1, 1, counts);
+            QuadTree_delete(qt);
+        }
+    }
+    const double seconds = seconds_since(&start);
+    flat_quadtree_free(tree);
+
+    free(force);
+    free(x);
+    return seconds / reps;
+}
+
+/// Seconds per sfdp repulsive force pass over `points` random points with
+/// `flat_quadtree_t` on `threads` threads, as `quadtree_benchmark`.
+double sfdp_force_benchmark(int points, int threads) {
+    const int n = points > 1 ? points : 2;
+    const int dim = 2;
+    const int max_level = 10;
+    const int reps = 5;
+
+    double *x = benchmark_points(n);
+    double *force = gv_calloc((size_t)n * dim, sizeof(double));
+    double counts[4];
+    flat_quadtree_t *tree = flat_quadtree_new(dim);
+    flat_quadtree_set_threads(tree, threads);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < reps; r++) {
+        flat_quadtree_build(tree, n, max_level, x);
+        flat_quadtree_get_repulsive_force(tree, force, x, 0.6, -1, 1, counts);
+    }
+    const double seconds = seconds_since(&start);
+    flat_quadtree_free(tree);
+
+    free(force);
+    free(x);
+    return seconds / reps;
+}
+
+/// A grid of `n` nodes with a few long-range chords, in both directions.
+static SparseMatrix benchmark_mesh(int n) {
+    int width = 1;
+    while (width * width < n) {
+        width++;
+    }
+    const int chords = n / 50;
+    const int capacity = 4 * n + 2 * chords;
+    int *irn = gv_calloc((size_t)capacity, sizeof(int));
+    int *jcn = gv_calloc((size_t)capacity, sizeof(int));
+    double *val = gv_calloc((size_t)capacity, sizeof(double));
+    int nz = 0;
+    for (int i = 0; i < n; i++) {
+        const int neighbors[] = {i % width + 1 < width ? i + 1 : n, i + width};
+        for (size_t k = 0; k < sizeof(neighbors) / sizeof(neighbors[0]); k++) {
+            if (neighbors[k] < n) {
+                irn[nz] = i, jcn[nz] = neighbors[k], val[nz++] = 1;
+                irn[nz] = neighbors[k], jcn[nz] = i, val[nz++] = 1;
+            }
+        }
+    }
+    uint64_t state = 0x9e3779b97f4a7c15;
+    for (int c = 0; c < chords; c++) {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        const int i = (int)((state >> 33) % (uint64_t)n);
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        const int j = (int)((state >> 33) % (uint64_t)n);
+        if (i != j) {
+            irn[nz] = i, jcn[nz] = j, val[nz++] = 1;
+            irn[nz] = j, jcn[nz] = i, val[nz++] = 1;
+        }
+    }
+    SparseMatrix A = SparseMatrix_from_coordinate_arrays(nz, n, n, irn, jcn, val, MATRIX_TYPE_REAL, sizeof(double));
+    free(irn);
+    free(jcn);
+    free(val);
+    return A;
+}
+
+/// Times building the sfdp level hierarchy on its own, then a whole multilevel
+/// sfdp embedding with the fast force scheme. The embedding time is what the
+/// whole run took beyond building the hierarchy.
+multilevel_timing_t multilevel_benchmark(int nodes, int threads) {
+    const int n = nodes > 4 ? nodes : 4;
+    SparseMatrix A = benchmark_mesh(n);
+    multilevel_timing_t timing = {0};
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const Multilevel_control mctrl = {.maxlevel = INT_MAX, .threads = threads};
+    Multilevel grid = Multilevel_new(A, mctrl);
+    timing.hierarchy = seconds_since(&start);
+    Multilevel_delete(grid);
+
+    spring_electrical_control ctrl = spring_electrical_control_new();
+    ctrl->multilevels = INT_MAX;
+    ctrl->tscheme = QUAD_TREE_FAST;
+    ctrl->threads = threads;
+    double *x = gv_calloc((size_t)n * 2, sizeof(double));
+    int flag = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    multilevel_spring_electrical_embedding(2, A, ctrl, NULL, x, 0, NULL, &flag);
+    timing.embedding = seconds_since(&start) - timing.hierarchy;
+    if (timing.embedding < 0) {
+        timing.embedding = 0;
+    }
+
+    free(x);
+    spring_electrical_control_delete(ctrl);
+    SparseMatrix_delete(A);
+    return timing;
+}
+
+/// Adds a node to a graph built by hand for `rank2`.
+static node_t *ns_benchmark_node(graph_t *g, node_t **last) {
+    node_t *n = agnode(g, NULL, 1);
+    agbindrec(n, "Agnodeinfo_t", sizeof(Agnodeinfo_t), true);
+    alloc_elist(0, ND_in(n));
+    alloc_elist(0, ND_out(n));
+    if (*last) {
+        ND_next(*last) = n;
+    } else {
+        GD_nlist(g) = n;
+    }
+    *last = n;
+    return n;
+}
+
+static void ns_benchmark_edge(graph_t *g, node_t *t, node_t *h, int minlen, int weight) {
+    edge_t *e = agedge(g, t, h, NULL, 1);
+    agbindrec(e, "Agedgeinfo_t", sizeof(Agedgeinfo_t), true);
+    ED_minlen(e) = minlen;
+    ED_weight(e) = weight;
+    elist_append(e, ND_out(t));
+    elist_append(e, ND_in(h));
+}
+
+/// Seconds `rank2` takes on a graph shaped like the auxiliary graph of dot's
+/// x coordinate pass over about `nodes` nodes: ranks of nodes chained left to
+/// right by separation constraints, and for each edge between adjacent ranks
+/// a slack node pulling both ends together. `search_size` is the number of
+/// negative cut values looked at before picking the leaving edge (the
+/// `searchsize` attribute), or -1 for the default; `priority` picks the most
+/// negative one from a heap instead (the `nspriority` attribute). Also
+/// reports the cost of the ranking, which both ways should agree on.
+network_simplex_result_t network_simplex_benchmark(int nodes, int search_size, bool priority) {
+    const int n = nodes > 4 ? nodes : 4;
+    int width = 1;
+    while (width * width < n) {
+        width++;
+    }
+    const int ranks = (n + width - 1) / width;
+
+    graph_t *g = agopen("ns", Agstrictdirected, NULL);
+    agbindrec(g, "Agraphinfo_t", sizeof(Agraphinfo_t), true);
+    node_t *last = NULL;
+    node_t **v = gv_calloc((size_t)n, sizeof(node_t *));
+    for (int i = 0; i < n; i++) {
+        v[i] = ns_benchmark_node(g, &last);
+        if (i % width > 0) {
+            ns_benchmark_edge(g, v[i - 1], v[i], 10 + (i * 7) % 30, 0);
+        }
+    }
+    uint64_t state = 0x9e3779b97f4a7c15;
+    for (int r = 0; r + 1 < ranks; r++) {
+        for (int i = r * width; i < (r + 1) * width && i < n; i++) {
+            for (int k = 0; k < 2; k++) {
+                state = state * 6364136223846793005u + 1442695040888963407u;
+                const int j = (r + 1) * width + (int)((state >> 33) % (uint64_t)width);
+                if (j >= n) {
+                    continue;
+                }
+                node_t *slack = ns_benchmark_node(g, &last);
+                ns_benchmark_edge(g, slack, v[i], 0, 1 + k);
+                ns_benchmark_edge(g, slack, v[j], 0, 1 + k);
+            }
+        }
+    }
+
+    network_simplex_result_t result = {0};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rank2(g, 2, INT_MAX, search_size, priority);
+    result.seconds = seconds_since(&start);
+
+    for (node_t *u = agfstnode(g); u; u = agnxtnode(g, u)) {
+        for (edge_t *e = agfstout(g, u); e; e = agnxtout(g, e)) {
+            result.cost += (long long)ED_weight(e) * (ND_rank(aghead(e)) - ND_rank(agtail(e)));
+        }
+    }
+    for (node_t *u = agfstnode(g); u; u = agnxtnode(g, u)) {
+        free_list(ND_in(u));
+        free_list(ND_out(u));
+    }
+    agclose(g);
+    free(v);
+    return result;
+}
+
+/// A DOT text with a labelled edge to each of `edges` nodes from one a few
+/// steps back, and a few attributes per node.
+static char *benchmark_dot(int edges) {
+    agxbuf xb = {0};
+    agxbprint(&xb, "digraph G {\n  graph [rankdir=%s, label=\"%s\"];\n"
+                   "  node [shape=box, fontname=\"%s\"];\n",
+              "LR", "benchmark", "Helvetica");
+    for (int i = 0; i < edges; i++) {
+        agxbprint(&xb, "  n%d [label=\"node %d\", width=%.2f];\n", i, i, 0.5 + (i % 7) * 0.1);
+    }
+    for (int i = 1; i < edges; i++) {
+        agxbprint(&xb, "  n%d -> n%d [weight=%d, label=\"e%d\"];\n", i / 2 + i % 3, i, 1 + i % 5, i);
+    }
+    agxbput(&xb, "}\n");
+    return agxbdisown(&xb);
+}
+
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t cur;
+} line_reader_t;
+
+/// Copies up to and including the next newline, as `agmemread` fed the scanner
+/// before it scanned the whole string in one buffer.
+static int line_read(void *chan, char *buf, int bufsize) {
+    line_reader_t *r = chan;
+    int l = 0;
+    while (r->cur < r->len && l < bufsize) {
+        const char c = r->data[r->cur++];
+        buf[l++] = c;
+        if (c == '\n') {
+            break;
+        }
+    }
+    return l;
+}
+
+/// Megabytes per second `agmemread` parses from a generated DOT text with
+/// about `edges` edges, scanning the whole text in one buffer (`whole`) or
+/// through an I/O discipline that hands the scanner a line at a time.
+double dot_parse_benchmark(int edges, bool whole) {
+    char *text = benchmark_dot(edges > 1 ? edges : 2);
+    const size_t len = strlen(text);
+    const int reps = 3;
+
+    Agiodisc_t io = {line_read, AgIoDisc.putstr, AgIoDisc.flush};
+    Agdisc_t disc = {&AgIdDisc, &io, NULL};
+    double seconds = 0;
+    for (int r = 0; r < reps; r++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Agraph_t *g;
+        if (whole) {
+            g = agmemread_len(text, len);
+        } else {
+            line_reader_t reader = {text, len, 0};
+            g = agread(&reader, &disc);
+            agsetfile(NULL);
+        }
+        seconds += seconds_since(&start);
+        if (g) {
+            agclose(g);
+        }
+    }
+
+    free(text);
+    return seconds > 0 ? (double)len * reps / seconds / 1e6 : 0;
+}
+
+/// Megabytes per second `agwrite` writes the graph of `dot_parse_benchmark` as
+/// DOT, to a stdio stream or, with `memory`, into a string with `agwritemem`.
+/// The first of the writes canonicalizes each string, the others reuse that.
+double dot_write_benchmark(int edges, bool memory) {
+    char *text = benchmark_dot(edges > 1 ? edges : 2);
+    Agraph_t *g = agmemread(text);
+    free(text);
+    FILE *sink = memory ? NULL : fopen("/dev/null", "w");
+    if (g == NULL || (!memory && sink == NULL)) {
+        if (g) {
+            agclose(g);
+        }
+        return 0;
+    }
+    const int reps = 3;
+
+    double seconds = 0;
+    for (int r = 0; r < reps; r++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (memory) {
+            free(agwritemem(g, NULL));
+        } else {
+            agwrite(g, sink);
+        }
+        seconds += seconds_since(&start);
+    }
+
+    size_t len = 0;
+    free(agwritemem(g, &len));
+    if (sink) {
+        fclose(sink);
+    }
+    agclose(g);
+    return seconds > 0 ? (double)len * reps / seconds / 1e6 : 0;
+}
+
+/// Seconds to build a graph of `edges` nodes and `edges` edges, each with one
+/// attribute, with the bulk calls (`bulk`) or with one `agnode`, `agedge` and
+/// `agsafeset` per element. With `hub` set, two edges in three leave the same
+/// node.
+double graph_build_benchmark(int edges, bool bulk, bool hub) {
+    const size_t n = edges > 1 ? (size_t)edges : 2;
+    char **names = gv_calloc(n, sizeof(char *));
+    char **labels = gv_calloc(n, sizeof(char *));
+    size_t *tails = gv_calloc(n, sizeof(size_t));
+    size_t *heads = gv_calloc(n, sizeof(size_t));
+    Agnode_t **nodes = gv_calloc(n, sizeof(Agnode_t *));
+    Agedge_t **made = gv_calloc(n, sizeof(Agedge_t *));
+    char *colors[] = {"red", "blue", "black"};
+    char **edge_colors = gv_calloc(n, sizeof(char *));
+    uint64_t state = 0x9e3779b97f4a7c15;
+    for (size_t i = 0; i < n; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "n%zu", i);
+        names[i] = gv_strdup(name);
+        labels[i] = names[i];
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        tails[i] = hub && i % 3 ? 0 : (size_t)(state >> 33) % n;
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        heads[i] = (size_t)(state >> 33) % n;
+        edge_colors[i] = colors[i % 3];
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Agraph_t *g = agopen("bulk", Agdirected, NULL);
+    if (bulk) {
+        agnodes_bulk(g, n, names, nodes);
+        agsafeset_bulk(g, AGNODE, "label", "", n, (void **)nodes, labels);
+        agedges_bulk(g, n, nodes, n, tails, heads, made);
+        agsafeset_bulk(g, AGEDGE, "color", "", n, (void **)made, edge_colors);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            nodes[i] = agnode(g, names[i], 1);
+            agsafeset(nodes[i], "label", labels[i], "");
+        }
+        for (size_t i = 0; i < n; i++) {
+            made[i] = agedge(g, nodes[tails[i]], nodes[heads[i]], NULL, 1);
+            agsafeset(made[i], "color", edge_colors[i], "");
+        }
+    }
+    const double seconds = seconds_since(&start);
+    agclose(g);
+
+    for (size_t i = 0; i < n; i++) {
+        free(names[i]);
+    }
+    free(edge_colors);
+    free(made);
+    free(nodes);
+    free(heads);
+    free(tails);
+    free(labels);
+    free(names);
+    return seconds;
+}
+
+/// Seconds to parse, lay out with dot and close `graphs` graphs of about
+/// `edges` edges each, with their objects in an arena (`arena`) or allocated
+/// one at a time. Puts the allocation count and peak bytes of the last graph in
+/// `stats` when it is not NULL.
+double graph_lifecycle_benchmark(int graphs, int edges, bool arena, Agmemstats_t *stats) {
+    char *text = benchmark_dot(edges > 1 ? edges : 2);
+    const size_t len = strlen(text);
+    GVC_t *gvc = loadGraphvizLibraries();
+
+    Agiodisc_t io = {line_read, AgIoDisc.putstr, AgIoDisc.flush};
+    Agdisc_t disc = {&AgIdDisc, &io, arena ? &AgArenaDisc : &AgMemDisc};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < graphs; i++) {
+        line_reader_t reader = {text, len, 0};
+        Agraph_t *g = agread(&reader, &disc);
+        agsetfile(NULL);
+        if (g == NULL) {
+            break;
+        }
+        gvLayout(gvc, g, "dot");
+        gvFreeLayout(gvc, g);
+        if (stats && i == graphs - 1) {
+            *stats = agmemstats(g);
+        }
+        agclose(g);
+    }
+    const double seconds = seconds_since(&start);
+
+    gvFreeContext(gvc);
+    free(text);
+    return seconds;
+}
+
+/// Times adding and then finding the edges of `hubs` nodes with `degree`
+/// neighbours each, half of the edges leaving the hub and half entering it.
+/// Lookups go in random order, by tail and head alone and by their ID.
+edge_index_timing_t edge_index_benchmark(int degree, int hubs) {
+    const size_t d = degree > 0 ? (size_t)degree : 1;
+    const size_t k = hubs > 0 ? (size_t)hubs : 1;
+    Agnode_t **leaves = gv_calloc(d, sizeof(Agnode_t *));
+    Agnode_t **hub = gv_calloc(k, sizeof(Agnode_t *));
+    Agedge_t **made = gv_calloc(d * k, sizeof(Agedge_t *));
+    edge_index_timing_t timing = {0};
+
+    Agraph_t *g = agopen("hubs", Agdirected, NULL);
+    for (size_t i = 0; i < k; i++) {
+        hub[i] = agnode(g, NULL, 1);
+    }
+    for (size_t i = 0; i < d; i++) {
+        leaves[i] = agnode(g, NULL, 1);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t j = 0; j < k; j++) {
+        for (size_t i = 0; i < d; i++) {
+            made[j * d + i] = i % 2 ? agedge(g, hub[j], leaves[i], NULL, 1)
+                                    : agedge(g, leaves[i], hub[j], NULL, 1);
+        }
+    }
+    timing.insert = seconds_since(&start);
+
+    uint64_t state = 0x853c49e6748fea9b;
+    for (size_t i = d * k - 1; i > 0; i--) {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        const size_t r = (size_t)(state >> 33) % (i + 1);
+        Agedge_t *const e = made[i];
+        made[i] = made[r];
+        made[r] = e;
+    }
+    size_t found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < d * k; i++) {
+        Agedge_t *const e = made[i];
+        found += agedge(g, agtail(e), aghead(e), NULL, 0) != NULL;
+        found += agidedge(g, agtail(e), aghead(e), AGID(e), 0) != NULL;
+    }
+    timing.lookup = seconds_since(&start);
+    if (found != 2 * d * k) {
+        timing.lookup = -1;
+    }
+
+    agclose(g);
+    free(made);
+    free(hub);
+    free(leaves);
+    return timing;
+}
@@ -0,0 +1,38 @@
+//
+//  benchmarks.h
+//  GraphvizBenchmarks
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+
+#ifndef benchmarks_h
+#define benchmarks_h
+
+#include <cgraph/cgraph.h>
+#include <stdbool.h>
+
+double apsp_benchmark(int nodes, int threads);
+double dense_kernels_benchmark(int elements, bool simd);
+double quadtree_benchmark(int points, bool flat);
+double sfdp_force_benchmark(int points, int threads);
+typedef struct {
+    double hierarchy;
+    double embedding;
+} multilevel_timing_t;
+multilevel_timing_t multilevel_benchmark(int nodes, int threads);
+typedef struct {
+    double seconds;
+    long long cost;
+} network_simplex_result_t;
+network_simplex_result_t network_simplex_benchmark(int nodes, int search_size, bool priority);
+double dot_parse_benchmark(int edges, bool whole);
+double dot_write_benchmark(int edges, bool memory);
+double graph_build_benchmark(int edges, bool bulk, bool hub);
+double graph_lifecycle_benchmark(int graphs, int edges, bool arena, Agmemstats_t *stats);
+typedef struct {
+    double insert;
+    double lookup;
+} edge_index_timing_t;
+edge_index_timing_t edge_index_benchmark(int degree, int hubs);
+
+#endif /* benchmarks_h */
@@ -0,0 +1,193 @@
+//
+//  main.c
+//  GraphvizBenchmarks
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+//  Runs the benchmarks named on the command line, or all of them, and prints
+//  one line per size. Build with -c release: the timings of a debug build say
+//  little about the library.
+//
+
+#include "benchmarks.h"
+#include <limits.h>
+#include <neatogen/simd.h>
+#include <stdio.h>
+#include <string.h>
+
+static void run_apsp(void) {
+    const int threads[] = {1, 2, 4, 8};
+    const int nodes[] = {500, 1000, 2000, 4000};
+    printf("APSP nodes");
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        printf("  %d thr", threads[t]);
+    }
+    printf("\n");
+    for (size_t i = 0; i < sizeof(nodes) / sizeof(nodes[0]); i++) {
+        printf("APSP %d", nodes[i]);
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            printf("  %.3fs", apsp_benchmark(nodes[i], threads[t]));
+        }
+        printf("\n");
+    }
+}
+
+static void run_dense_kernels(void) {
+    const int elements[] = {1000, 10000, 100000, 1000000};
+    simd_set_enabled(true);
+    printf("dense kernels (%s)\n", simd_isa());
+    for (size_t i = 0; i < sizeof(elements) / sizeof(elements[0]); i++) {
+        const double scalar = dense_kernels_benchmark(elements[i], false);
+        const double simd = dense_kernels_benchmark(elements[i], true);
+        printf("dense %d scalar %.4fs simd %.4fs x%.2f\n", elements[i], scalar, simd, scalar / simd);
+    }
+}
+
+static void run_quadtree(void) {
+    const int points[] = {1000, 10000, 100000, 1000000};
+    for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++) {
+        const double pointer = quadtree_benchmark(points[i], false);
+        const double flat = quadtree_benchmark(points[i], true);
+        printf("quadtree %d pointer %.4fs flat %.4fs x%.2f\n", points[i], pointer, flat, pointer / flat);
+    }
+}
+
+static void run_sfdp_force(void) {
+    const int threads[] = {1, 2, 4, 8};
+    const int points[] = {10000, 100000, 1000000};
+    printf("sfdp force points");
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        printf("  %d thr", threads[t]);
+    }
+    printf("\n");
+    for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++) {
+        printf("sfdp force %d", points[i]);
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            printf("  %.4fs", sfdp_force_benchmark(points[i], threads[t]));
+        }
+        printf("\n");
+    }
+}
+
+static void run_multilevel(void) {
+    const int threads[] = {1, 2, 4, 8};
+    const int nodes[] = {10000, 100000, 1000000};
+    for (size_t i = 0; i < sizeof(nodes) / sizeof(nodes[0]); i++) {
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            const multilevel_timing_t timing = multilevel_benchmark(nodes[i], threads[t]);
+            printf("multilevel %d nodes %d thr hierarchy %.3fs embedding %.3fs\n", nodes[i], threads[t],
+                   timing.hierarchy, timing.embedding);
+        }
+    }
+}
+
+static void run_network_simplex(void) {
+    const int nodes[] = {2500, 5000, 10000};
+    for (size_t i = 0; i < sizeof(nodes) / sizeof(nodes[0]); i++) {
+        const network_simplex_result_t block = network_simplex_benchmark(nodes[i], -1, false);
+        const network_simplex_result_t full = network_simplex_benchmark(nodes[i], INT_MAX, false);
+        const network_simplex_result_t heap = network_simplex_benchmark(nodes[i], -1, true);
+        printf("network simplex %d searchsize 30 %.3fs full %.3fs priority %.3fs x%.2f%s\n", nodes[i],
+               block.seconds, full.seconds, heap.seconds, block.seconds / heap.seconds,
+               block.cost == full.cost && block.cost == heap.cost ? "" : " COST MISMATCH");
+    }
+}
+
+static void run_dot_parse(void) {
+    const int edges[] = {1000, 10000, 100000};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        const double lines = dot_parse_benchmark(edges[i], false);
+        const double whole = dot_parse_benchmark(edges[i], true);
+        printf("parse %d lines %.1f MB/s whole %.1f MB/s x%.2f\n", edges[i], lines, whole, whole / lines);
+    }
+}
+
+static void run_dot_write(void) {
+    const int edges[] = {1000, 10000, 100000};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        const double stream = dot_write_benchmark(edges[i], false);
+        const double memory = dot_write_benchmark(edges[i], true);
+        printf("write %d stdio %.1f MB/s memory %.1f MB/s x%.2f\n", edges[i], stream, memory, memory / stream);
+    }
+}
+
+static void run_graph_build(void) {
+    const int edges[] = {10000, 100000, 1000000};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        for (int hub = 0; hub < 2; hub++) {
+            const double single = graph_build_benchmark(edges[i], false, hub);
+            const double bulk = graph_build_benchmark(edges[i], true, hub);
+            printf("build %d%s single %.3fs bulk %.3fs x%.2f\n", edges[i], hub ? " hub" : "", single, bulk,
+                   single / bulk);
+        }
+    }
+}
+
+static void run_graph_lifecycle(void) {
+    const int sizes[][2] = {{200, 100}, {10, 5000}};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Agmemstats_t stats = {0};
+        const double malloced = graph_lifecycle_benchmark(sizes[i][0], sizes[i][1], false, NULL);
+        const double pooled = graph_lifecycle_benchmark(sizes[i][0], sizes[i][1], true, &stats);
+        printf("lifecycle %dx%d malloc %.3fs arena %.3fs x%.2f allocations %zu peak %zu chunks %zu\n", sizes[i][0],
+               sizes[i][1], malloced, pooled, malloced / pooled, stats.allocations, stats.peak_bytes, stats.chunks);
+    }
+}
+
+static void run_edge_index(void) {
+    const int sizes[][2] = {{100000, 1}, {20000, 10}, {10, 20000}};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        const edge_index_timing_t timing = edge_index_benchmark(sizes[i][0], sizes[i][1]);
+        printf("edge index %dx%d insert %.3fs lookup %.3fs%s\n", sizes[i][1], sizes[i][0], timing.insert,
+               timing.lookup, timing.lookup < 0 ? " LOOKUP FAILED" : "");
+    }
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} benchmark_t;
+
+static const benchmark_t benchmarks[] = {
+    {"apsp", run_apsp},
+    {"dense", run_dense_kernels},
+    {"quadtree", run_quadtree},
+    {"sfdp", run_sfdp_force},
+    {"multilevel", run_multilevel},
+    {"ns", run_network_simplex},
+    {"parse", run_dot_parse},
+    {"write", run_dot_write},
+    {"build", run_graph_build},
+    {"lifecycle", run_graph_lifecycle},
+    {"edges", run_edge_index},
+};
+
+enum { BENCHMARKS = sizeof(benchmarks) / sizeof(benchmarks[0]) };
+
+int main(int argc, char **argv) {
+    for (int a = 1; a < argc; a++) {
+        size_t b = 0;
+        while (b < BENCHMARKS && strcmp(argv[a], benchmarks[b].name) != 0) {
+            b++;
+        }
+        if (b == BENCHMARKS) {
+            fprintf(stderr, "unknown benchmark %s; known:", argv[a]);
+            for (b = 0; b < BENCHMARKS; b++) {
+                fprintf(stderr, " %s", benchmarks[b].name);
+            }
+            fprintf(stderr, "\n");
+            return 1;
+        }
+    }
+    for (size_t b = 0; b < BENCHMARKS; b++) {
+        bool selected = argc == 1;
+        for (int a = 1; a < argc && !selected; a++) {
+            selected = strcmp(argv[a], benchmarks[b].name) == 0;
+        }
+        if (selected) {
+            benchmarks[b].run();
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -11,25 +11,22 @@ import Foundation
 public typealias GVGraph = UnsafeMutablePointer<Agraph_t>
 
 struct AGWriteWrongEncoding: Error { }
-struct CannotOpenFileDescriptor: Error { }
 
 extension UnsafeMutablePointer where Pointee == Agraph_t {
     
-    /// adapted from: https://stackoverflow.com/questions/59653517/how-to-use-file-descriptor-to-divert-write-to-file-in-swift/59654364#59654364
+    /// The graph as DOT, written by `agwritemem` straight into memory.
     var asString: String? {
-        let pipe = Pipe()
-        do {
-            try use(fileDescriptor: pipe.fileHandleForWriting.fileDescriptor, mode: "w") { filePointer in
-                agwrite(self, filePointer)
-            }
-            let data = pipe.fileHandleForReading.readDataToEndOfFile()
-            guard let output = String(data: data, encoding: .utf8) else {
-                return nil
-            }
-            return output
-        } catch {
+        var length = 0
+        guard let data = agwritemem(self, &length) else {
             return nil
         }
+        defer {
+            free(data)
+        }
+        return String(
+            bytes: UnsafeRawBufferPointer(start: data, count: length),
+            encoding: .utf8
+        )
     }
     
     var boundingBox: boxf {
@@ -52,19 +49,3 @@ extension UnsafeMutablePointer where Pointee == Agraph_t {
         agUnflatten(self,doFan ? 1 : 0, maxMinlen ,chainLimit )
     }
 }
-
-@discardableResult
-fileprivate func use<R>(
-    fileDescriptor: Int32,
-    mode: UnsafePointer<Int8>!,
-    closure: (UnsafeMutablePointer<FILE>) throws -> R
-) throws -> R {
-    // Should prob remove this `!`, but IDK what a sensible recovery mechanism would be.
-    guard let filePointer = fdopen(fileDescriptor, mode) else {
-        throw CannotOpenFileDescriptor()
-    }
-    defer {
-        fclose(filePointer)
-    }
-    return try closure(filePointer)
-}
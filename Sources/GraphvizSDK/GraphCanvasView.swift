@@ -39,6 +39,9 @@ public struct GraphCanvasView: View {
     @State private var zoomInitialScale: CGFloat = 1.0
     @State private var zoomAnchor: CGPoint? = nil
     
+    /// Запас вокруг видимой области в точках экрана
+    private static let cullingMargin: CGFloat = 16
+    
     public init(
         graph: GraphUI,
         tapNode: ((NodeUI) -> ())? = nil
@@ -50,10 +53,21 @@ public struct GraphCanvasView: View {
     public var body: some View {
         ZStack {
             Canvas { context, size in
+                let scale = currentZoom + totalZoom
                 context.translateBy(x: location.x, y: location.y)
-                context.scaleBy(x: currentZoom + totalZoom, y: currentZoom + totalZoom)
+                context.scaleBy(x: scale, y: scale)
+                
+                // Рисуем только то, что попадает в видимую область (с запасом на обводку и подписи)
+                let margin = Self.cullingMargin / scale
+                let viewport = CGRect(
+                    x: -location.x / scale,
+                    y: -location.y / scale,
+                    width: size.width / scale,
+                    height: size.height / scale
+                ).insetBy(dx: -margin, dy: -margin)
+                let visible = graph.elements(in: viewport)
                 
-                for node in graph.nodes {
+                for node in visible.nodes {
                     let frame = node.frame
                     context.translateBy(
                         x: frame.origin.x,
@@ -82,7 +96,7 @@ public struct GraphCanvasView: View {
                     )
                 }
                 
-                for edge in graph.edges {
+                for edge in visible.edges {
                     let edgeWidth = edge.width
                     
                     let path = edge.body
@@ -161,13 +175,14 @@ public struct GraphCanvasView: View {
             }
         }
         .onTapGesture { tapLocation in
-            let globalOffset = CGAffineTransform(translationX: location.x, y: location.y)
-                .scaledBy(x: currentZoom + totalZoom, y: currentZoom + totalZoom)
-            for node in graph.nodes {
-                let frame = node.frame.applying(globalOffset)
-                if frame.contains(tapLocation) {
-                    self.onTapNode?(node)
-                }
+            // Переводим точку касания в координаты графа и ищем узлы по индексу
+            let scale = currentZoom + totalZoom
+            let point = CGPoint(
+                x: (tapLocation.x - location.x) / scale,
+                y: (tapLocation.y - location.y) / scale
+            )
+            for node in graph.nodes(at: point) {
+                self.onTapNode?(node)
             }
         }
     }
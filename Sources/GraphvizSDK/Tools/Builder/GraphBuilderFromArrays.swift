@@ -0,0 +1,85 @@
+//
+//  GraphBuilderFromArrays.swift
+//  GraphvizSDK
+//
+
+import Foundation
+@preconcurrency import CGraphvizSDK
+
+/// Builds a graph from arrays in a few bulk calls instead of one `agnode` /
+/// `agedge` per element: nodes by name, edges as pairs of indices into the
+/// names, and attributes by column, with one value (or `nil`) per node or edge.
+public final class GraphBuilderFromArrays {
+    public enum GraphBuilderError: Error {
+        case edgeOutOfRange
+        case attributeCountMismatch
+    }
+
+    public static func build(
+        type: GVGraphType = .nonStrictDirected,
+        nodes names: [String],
+        edges: [(tail: Int, head: Int)],
+        nodeAttributes: [String: [String?]] = [:],
+        edgeAttributes: [String: [String?]] = [:]
+    ) throws -> Graph {
+        guard edges.allSatisfy({ names.indices.contains($0.tail) && names.indices.contains($0.head) }) else {
+            throw GraphBuilderError.edgeOutOfRange
+        }
+        guard nodeAttributes.values.allSatisfy({ $0.count == names.count }),
+              edgeAttributes.values.allSatisfy({ $0.count == edges.count }) else {
+            throw GraphBuilderError.attributeCountMismatch
+        }
+
+        let graph = try Graph(name: "graph_\(arc4random())", type: type)
+        let gvGraph = graph.graph
+
+        var gvNodes = [GVNode?](repeating: nil, count: names.count)
+        withCStrings(names) { _ = agnodes_bulk(gvGraph, names.count, $0, &gvNodes) }
+
+        let tails = edges.map(\.tail)
+        let heads = edges.map(\.head)
+        var gvEdges = [GVEdge?](repeating: nil, count: edges.count)
+        _ = agedges_bulk(gvGraph, gvNodes.count, &gvNodes, edges.count, tails, heads, &gvEdges)
+
+        setColumns(nodeAttributes, kind: AGNODE, graph: gvGraph, objects: gvNodes.map { $0.map { UnsafeMutableRawPointer($0) } })
+        setColumns(edgeAttributes, kind: AGEDGE, graph: gvGraph, objects: gvEdges.map { $0.map { UnsafeMutableRawPointer($0) } })
+
+        // a repeated name gives the same node again
+        var seen = Set<GVNode>()
+        for (gvNode, name) in zip(gvNodes, names) {
+            if let gvNode, seen.insert(gvNode).inserted {
+                graph.append(Node(node: gvNode, name: name))
+            }
+        }
+        for gvEdge in gvEdges {
+            if let gvEdge {
+                graph.append(Edge(edge: gvEdge))
+            }
+        }
+        return graph
+    }
+
+    private static func setColumns(
+        _ columns: [String: [String?]],
+        kind: Int,
+        graph: GVGraph,
+        objects: [UnsafeMutableRawPointer?]
+    ) {
+        var objects = objects
+        for (name, values) in columns {
+            withCStrings(values) { cValues in
+                _ = agsafeset_bulk(graph, Int32(kind), cString(name), "", objects.count, &objects, cValues)
+            }
+        }
+    }
+
+    /// Calls `body` with C copies of `strings`, freed afterwards.
+    private static func withCStrings<R>(
+        _ strings: [String?],
+        _ body: (UnsafeMutablePointer<UnsafeMutablePointer<CChar>?>?) -> R
+    ) -> R {
+        var pointers = strings.map { $0.flatMap { strdup($0) } }
+        defer { pointers.forEach { free($0) } }
+        return pointers.withUnsafeMutableBufferPointer { body($0.baseAddress) }
+    }
+}
@@ -17,7 +17,11 @@ public final class GraphBuilderFromString {
     }
     
     public static func build(str: String) throws -> Graph {
-        guard let gvGraph = agmemread(str) else {
+        var source = str
+        let parsed = source.withUTF8 { utf8 in
+            utf8.withMemoryRebound(to: CChar.self) { agmemread_len($0.baseAddress, $0.count) }
+        }
+        guard let gvGraph = parsed else {
             throw GraphBuilderError.invalidGraphString
         }
         
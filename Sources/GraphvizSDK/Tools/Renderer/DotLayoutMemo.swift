@@ -0,0 +1,32 @@
+//
+//  DotLayoutMemo.swift
+//  GraphvizSDK
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+
+@preconcurrency import CGraphvizSDK
+import Foundation
+
+/// Ranks, order, positions and splines of a dot layout, kept so that the
+/// layout of the edited graph can start from them.
+final class DotLayoutMemo: @unchecked Sendable {
+    private let memo: OpaquePointer
+
+    init(_ memo: OpaquePointer) {
+        self.memo = memo
+    }
+
+    deinit {
+        dot_layout_memo_free(memo)
+    }
+
+    /// Edges whose spline was copied from the previous layout instead of routed.
+    var reusedSplines: Int {
+        dot_layout_memo_reused_splines(memo)
+    }
+
+    func withPointer<T>(_ body: (OpaquePointer) throws -> T) rethrows -> T {
+        try withExtendedLifetime(self) { try body(memo) }
+    }
+}
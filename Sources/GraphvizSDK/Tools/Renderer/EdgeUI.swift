@@ -21,9 +21,22 @@ public struct EdgeUI: Sendable, Identifiable, Equatable {
 }
 
 extension Edge {
+    /// The spline the layout routed for the edge and its arrow tips.
+    var geometry: LayoutGeometry.EdgeGeometry {
+        LayoutGeometry.EdgeGeometry(
+            points: edge.getPath() ?? [],
+            arrowHead: edge.arrowHead,
+            arrowTail: edge.arrowTail
+        )
+    }
+    
     func create(graphHeight: CGFloat) -> EdgeUI? {
-        guard let pathPoints = edge.getPath(),
-              !pathPoints.isEmpty else {
+        create(geometry: geometry, graphHeight: graphHeight)
+    }
+    
+    func create(geometry: LayoutGeometry.EdgeGeometry, graphHeight: CGFloat) -> EdgeUI? {
+        let pathPoints = geometry.points
+        guard !pathPoints.isEmpty else {
             return nil
         }
         
@@ -40,7 +53,7 @@ extension Edge {
         
         // Create arrows only if style is not .none
         let headArrow: CGPath?
-        if let arrowHead = edge.arrowHead?.convertFromGraphviz(graphHeight: graphHeight) {
+        if let arrowHead = geometry.arrowHead?.convertFromGraphviz(graphHeight: graphHeight) {
             let arrowHead2 = cgPath[cgPath.count - 1]
             let headPath = definePath(pos: arrowHead, type: arrowheadType, otherPoint: arrowHead2)
             headArrow = headPath
@@ -49,7 +62,7 @@ extension Edge {
         }
         
         let tailArrow: CGPath?
-        if let arrowTail = edge.arrowTail?.convertFromGraphviz(graphHeight: graphHeight) {
+        if let arrowTail = geometry.arrowTail?.convertFromGraphviz(graphHeight: graphHeight) {
             let arrowTail2 = cgPath[0]
             let tailPath = definePath(pos: arrowTail, type: arrowtailType, otherPoint: arrowTail2)
             tailArrow = tailPath
@@ -0,0 +1,136 @@
+//
+//  GVContextPool.swift
+//  GraphvizSDK
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+
+@preconcurrency import CGraphvizSDK
+import Foundation
+
+/// Pool of long-lived Graphviz contexts.
+///
+/// Creating a `GVC_t` registers the core, dot_layout and neato_layout plugins and
+/// opens the text font dictionary. That setup is much more expensive than laying out
+/// a small graph, so renderers borrow an already loaded context from the pool and
+/// give it back when they are done instead of creating and freeing one per render.
+public final class GVContextPool: @unchecked Sendable {
+    public struct Metrics: Equatable, Sendable {
+        /// Contexts created by `loadGraphvizLibraries()`.
+        public var created: Int = 0
+        /// Acquisitions served by an idle context.
+        public var reused: Int = 0
+        /// Total number of acquisitions.
+        public var acquired: Int = 0
+        /// Contexts freed because the pool was full or drained.
+        public var freed: Int = 0
+        /// Contexts currently handed out.
+        public var inUse: Int = 0
+        /// Highest `inUse` value seen so far.
+        public var peakInUse: Int = 0
+        /// Contexts waiting in the pool.
+        public var idle: Int = 0
+
+        /// Fraction of acquisitions that did not need a new context.
+        public var reuseRatio: Double {
+            acquired == 0 ? 0 : Double(reused) / Double(acquired)
+        }
+    }
+
+    public static let shared = GVContextPool()
+
+    /// Maximum number of idle contexts kept alive between renders.
+    public let capacity: Int
+
+    private let lock = NSLock()
+    private var idleContexts: [GVGlobalContextPointer] = []
+    private var counters = Metrics()
+
+    public init(capacity: Int = ProcessInfo.processInfo.activeProcessorCount) {
+        self.capacity = max(1, capacity)
+    }
+
+    deinit {
+        idleContexts.forEach { gvFreeContext($0) }
+    }
+
+    public var metrics: Metrics {
+        lock.lock()
+        defer { lock.unlock() }
+        var metrics = counters
+        metrics.idle = idleContexts.count
+        return metrics
+    }
+
+    /// Creates contexts up front so the first renders do not pay for plugin loading.
+    public func preload(count: Int = 1) throws {
+        let missing = lock.withLock { min(count, capacity) - idleContexts.count }
+        guard missing > 0 else { return }
+        for _ in 0..<missing {
+            guard let context = loadGraphvizLibraries() else {
+                throw RendererError.createLayoutError
+            }
+            lock.withLock {
+                counters.created += 1
+                idleContexts.append(context)
+            }
+        }
+    }
+
+    /// Borrows a context for the duration of `body`.
+    ///
+    /// Concurrent callers get distinct contexts, so a context is never shared between threads.
+    public func withContext<R>(_ body: (GVGlobalContextPointer) throws -> R) throws -> R {
+        let context = try acquire()
+        defer { release(context) }
+        return try body(context)
+    }
+
+    /// Frees all idle contexts. Contexts in use are freed when they are returned.
+    public func drain() {
+        let contexts = lock.withLock {
+            let contexts = idleContexts
+            idleContexts.removeAll()
+            counters.freed += contexts.count
+            return contexts
+        }
+        contexts.forEach { gvFreeContext($0) }
+    }
+
+    private func acquire() throws -> GVGlobalContextPointer {
+        let pooled: GVGlobalContextPointer? = lock.withLock {
+            counters.acquired += 1
+            counters.inUse += 1
+            counters.peakInUse = max(counters.peakInUse, counters.inUse)
+            guard let context = idleContexts.popLast() else {
+                return nil
+            }
+            counters.reused += 1
+            return context
+        }
+        if let pooled {
+            return pooled
+        }
+        guard let context = loadGraphvizLibraries() else {
+            lock.withLock { counters.inUse -= 1 }
+            throw RendererError.createLayoutError
+        }
+        lock.withLock { counters.created += 1 }
+        return context
+    }
+
+    private func release(_ context: GVGlobalContextPointer) {
+        let keep = lock.withLock {
+            counters.inUse -= 1
+            guard idleContexts.count < capacity else {
+                counters.freed += 1
+                return false
+            }
+            idleContexts.append(context)
+            return true
+        }
+        if !keep {
+            gvFreeContext(context)
+        }
+    }
+}
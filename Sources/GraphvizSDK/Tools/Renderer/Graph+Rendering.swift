@@ -9,8 +9,15 @@ import Foundation
 import OSLog
 
 extension Graph {
-    public func render(using layout: GVLayout) throws -> GraphUI {
-        try RendererSwiftUI(layout: layout).layout(graph: self)
+    /// Renders the graph. Pass `updatable` to render it later with `render(using:updating:)`.
+    public func render(using layout: GVLayout, pool: GVContextPool = .shared, cache: LayoutCache? = nil, updatable: Bool = false) throws -> GraphUI {
+        try RendererSwiftUI(layout: layout, pool: pool, cache: cache).layout(graph: self, updatable: updatable)
+    }
+    
+    /// Renders the graph after an edit, keeping as much of `previous` as the edit allows.
+    /// `previous` should come from a render with `updatable`, or from this method.
+    public func render(using layout: GVLayout, updating previous: GraphUI, pool: GVContextPool = .shared) throws -> GraphUI {
+        try RendererSwiftUI(layout: layout, pool: pool).layout(graph: self, updating: previous)
     }
     
     private var userPath: String {
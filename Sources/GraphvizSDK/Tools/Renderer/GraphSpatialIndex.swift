@@ -0,0 +1,123 @@
+//
+//  GraphSpatialIndex.swift
+//  GraphvizSDK
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+
+@preconcurrency import CGraphvizSDK
+import Foundation
+import SwiftUI
+
+/// Packed R-tree over a laid out graph.
+///
+/// Entries `0..<nodeCount` are node frames and the rest are edge bounds, so the
+/// sorted positions a query returns list nodes first, each group in array order.
+final class GraphSpatialIndex: @unchecked Sendable {
+    let nodeCount: Int
+    private let tree: OpaquePointer
+
+    init(nodes: [NodeUI], edges: [EdgeUI]) {
+        let boxes = nodes.map { boxf(rect: $0.frame) } + edges.map { boxf(rect: $0.bounds) }
+        nodeCount = nodes.count
+        tree = packed_rtree_build(boxes, boxes.count)
+    }
+
+    deinit {
+        packed_rtree_free(tree)
+    }
+
+    func entries(in rect: CGRect) -> [Int] {
+        var hits: UnsafeMutablePointer<Int>?
+        let count = packed_rtree_query_rect(tree, boxf(rect: rect), &hits)
+        return collect(hits, count: count)
+    }
+
+    func entries(at point: CGPoint, tolerance: CGFloat) -> [Int] {
+        var hits: UnsafeMutablePointer<Int>?
+        let count = packed_rtree_query_point(
+            tree,
+            pointf(x: Double(point.x), y: Double(point.y)),
+            Double(tolerance),
+            &hits
+        )
+        return collect(hits, count: count)
+    }
+
+    private func collect(_ hits: UnsafeMutablePointer<Int>?, count: Int) -> [Int] {
+        defer { free(hits) }
+        return Array(UnsafeBufferPointer(start: hits, count: count))
+    }
+}
+
+/// Holds the `GraphSpatialIndex` of one version of a graph's nodes and edges,
+/// built by the first query.
+///
+/// `GraphUI` starts a new holder whenever its nodes or edges change, so copies
+/// of a graph that were edited apart never share an index.
+final class LazyGraphSpatialIndex: @unchecked Sendable {
+    private let lock = NSLock()
+    private var built: GraphSpatialIndex?
+
+    func index(nodes: [NodeUI], edges: [EdgeUI]) -> GraphSpatialIndex {
+        lock.lock()
+        defer { lock.unlock() }
+        if let built {
+            return built
+        }
+        let index = GraphSpatialIndex(nodes: nodes, edges: edges)
+        built = index
+        return index
+    }
+}
+
+extension GraphUI {
+    /// Nodes and edges whose bounds intersect `rect`, in their array order.
+    public func elements(in rect: CGRect) -> (nodes: [NodeUI], edges: [EdgeUI]) {
+        let index = self.index
+        let hits = index.entries(in: rect)
+        let split = hits.firstIndex { $0 >= index.nodeCount } ?? hits.endIndex
+        return (
+            hits[..<split].map { nodes[$0] },
+            hits[split...].map { edges[$0 - index.nodeCount] }
+        )
+    }
+
+    /// Nodes whose frame is at most `tolerance` away from `point`.
+    public func nodes(at point: CGPoint, tolerance: CGFloat = 0) -> [NodeUI] {
+        let index = self.index
+        return index.entries(at: point, tolerance: tolerance)
+            .prefix { $0 < index.nodeCount }
+            .map { nodes[$0] }
+    }
+
+    /// Edges whose bounds are at most `tolerance` away from `point`.
+    ///
+    /// Bounds enclose the whole curve, so callers that need an exact hit should
+    /// test the returned edges' paths themselves.
+    public func edges(at point: CGPoint, tolerance: CGFloat = 0) -> [EdgeUI] {
+        let index = self.index
+        return index.entries(at: point, tolerance: tolerance)
+            .drop { $0 < index.nodeCount }
+            .map { edges[$0 - index.nodeCount] }
+    }
+}
+
+extension EdgeUI {
+    /// Bounds of the stroked body and arrows.
+    var bounds: CGRect {
+        [headArrow, tailArrow]
+            .compactMap { $0?.boundingRect }
+            .reduce(body.boundingRect) { $0.union($1) }
+            .insetBy(dx: -width / 2, dy: -width / 2)
+    }
+}
+
+extension boxf {
+    init(rect: CGRect) {
+        self.init(
+            LL: pointf(x: Double(rect.minX), y: Double(rect.minY)),
+            UR: pointf(x: Double(rect.maxX), y: Double(rect.maxY))
+        )
+    }
+}
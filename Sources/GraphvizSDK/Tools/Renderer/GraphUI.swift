@@ -11,8 +11,17 @@ import SwiftUI
 
 public struct GraphUI {
     public let size: CGSize
-    public var nodes: [NodeUI]
-    public var edges: [EdgeUI]
+    public var nodes: [NodeUI] {
+        didSet { spatialIndex = LazyGraphSpatialIndex() }
+    }
+    public var edges: [EdgeUI] {
+        didSet { spatialIndex = LazyGraphSpatialIndex() }
+    }
+    /// Built on the first viewport or hit-test query after the nodes or edges
+    /// change, so a run of edits pays for one build.
+    private var spatialIndex = LazyGraphSpatialIndex()
+    /// Seeds the next dot layout of the same graph after an edit.
+    var dotLayout: DotLayoutMemo?
     
     public init(
         size: CGSize,
@@ -23,4 +32,9 @@ public struct GraphUI {
         self.nodes = nodes
         self.edges = edges
     }
+
+    /// Index for viewport culling and hit-testing.
+    var index: GraphSpatialIndex {
+        spatialIndex.index(nodes: nodes, edges: edges)
+    }
 }
@@ -0,0 +1,252 @@
+//
+//  LayoutCache.swift
+//  GraphvizSDK
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+
+@preconcurrency import CGraphvizSDK
+import Foundation
+
+/// Content-addressed cache of layout results.
+///
+/// Entries are keyed by `graph_layout_hash`, which covers the layout engine, the
+/// graph structure and every attribute that can move something. Colors, tooltips
+/// and the like are left out, so restyling a graph still hits the cache; the
+/// styling of the returned `GraphUI` always comes from the graph being rendered.
+/// So is the layout a renderer writes back into the graph, so laying out the
+/// same `Graph` again, or after `RendererString`, hits too.
+///
+/// The in-memory part is an LRU bounded by entry count and by bytes. When a
+/// directory is given, entries are also written there and survive the process;
+/// the directory is trimmed to `diskLimit` bytes, oldest files first.
+public final class LayoutCache: @unchecked Sendable {
+    public struct Key: Hashable, Sendable {
+        let lo: UInt64
+        let hi: UInt64
+
+        init(_ hash: graph_hash_t) {
+            lo = hash.lo
+            hi = hash.hi
+        }
+
+        var fileName: String {
+            String(format: "%016llx%016llx.layout", hi, lo)
+        }
+    }
+
+    public struct Limits: Equatable, Sendable {
+        /// Maximum number of layouts kept in memory.
+        public var entries: Int
+        /// Maximum approximate size of the layouts kept in memory.
+        public var bytes: Int
+        /// Maximum total size of the files in the cache directory.
+        public var diskBytes: Int
+
+        public init(entries: Int = 64, bytes: Int = 32 << 20, diskBytes: Int = 256 << 20) {
+            self.entries = max(1, entries)
+            self.bytes = max(0, bytes)
+            self.diskBytes = max(0, diskBytes)
+        }
+    }
+
+    public struct Metrics: Equatable, Sendable {
+        /// Lookups served from memory.
+        public var hits: Int = 0
+        /// Lookups served from the cache directory.
+        public var diskHits: Int = 0
+        /// Lookups that found nothing.
+        public var misses: Int = 0
+        /// Entries dropped from memory to stay within the limits.
+        public var evictions: Int = 0
+        /// Entries currently in memory.
+        public var entries: Int = 0
+        /// Approximate size of the entries in memory.
+        public var bytes: Int = 0
+
+        /// Fraction of lookups that did not need a layout.
+        public var hitRatio: Double {
+            let lookups = hits + diskHits + misses
+            return lookups == 0 ? 0 : Double(hits + diskHits) / Double(lookups)
+        }
+    }
+
+    private final class Entry {
+        let key: Key
+        let geometry: LayoutGeometry
+        let bytes: Int
+        var newer: Entry?
+        weak var older: Entry?
+
+        init(key: Key, geometry: LayoutGeometry) {
+            self.key = key
+            self.geometry = geometry
+            self.bytes = geometry.byteCount
+        }
+    }
+
+    public let limits: Limits
+    /// Where entries are persisted, or `nil` for a memory-only cache.
+    public let directory: URL?
+
+    private let lock = NSLock()
+    private var entries: [Key: Entry] = [:]
+    /// Least recently used entry; `newer` links lead to `newest`.
+    private var oldest: Entry?
+    private var newest: Entry?
+    private var counters = Metrics()
+
+    public init(limits: Limits = Limits(), directory: URL? = nil) {
+        self.limits = limits
+        self.directory = directory
+        if let directory {
+            try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        }
+    }
+
+    public var metrics: Metrics {
+        lock.withLock { counters }
+    }
+
+    /// Key of the layout of `graph` with `layout`.
+    public func key(for graph: Graph, layout: GVLayout) -> Key {
+        Key(graph_layout_hash(graph.graph, layout.rawValue))
+    }
+
+    /// Drops the entries in memory. Files in the cache directory are kept.
+    public func removeAll() {
+        lock.withLock {
+            entries.removeAll()
+            oldest = nil
+            newest = nil
+            counters.entries = 0
+            counters.bytes = 0
+        }
+    }
+
+    func geometry(for key: Key) -> LayoutGeometry? {
+        let cached: LayoutGeometry? = lock.withLock {
+            guard let entry = entries[key] else {
+                return nil
+            }
+            unlink(entry)
+            pushNewest(entry)
+            counters.hits += 1
+            return entry.geometry
+        }
+        if let cached {
+            return cached
+        }
+        guard let geometry = readFile(for: key) else {
+            lock.withLock { counters.misses += 1 }
+            return nil
+        }
+        lock.withLock {
+            counters.diskHits += 1
+            insert(Entry(key: key, geometry: geometry))
+        }
+        return geometry
+    }
+
+    func store(_ geometry: LayoutGeometry, for key: Key) {
+        lock.withLock {
+            insert(Entry(key: key, geometry: geometry))
+        }
+        writeFile(geometry, for: key)
+    }
+
+    // MARK: - Memory
+
+    private func insert(_ entry: Entry) {
+        if let previous = entries.removeValue(forKey: entry.key) {
+            unlink(previous)
+            counters.bytes -= previous.bytes
+        }
+        entries[entry.key] = entry
+        pushNewest(entry)
+        counters.bytes += entry.bytes
+        while entries.count > limits.entries || (counters.bytes > limits.bytes && entries.count > 1),
+              let victim = oldest {
+            unlink(victim)
+            entries.removeValue(forKey: victim.key)
+            counters.bytes -= victim.bytes
+            counters.evictions += 1
+        }
+        counters.entries = entries.count
+    }
+
+    private func unlink(_ entry: Entry) {
+        if let older = entry.older {
+            older.newer = entry.newer
+        } else {
+            oldest = entry.newer
+        }
+        if let newer = entry.newer {
+            newer.older = entry.older
+        } else {
+            newest = entry.older
+        }
+        entry.newer = nil
+        entry.older = nil
+    }
+
+    private func pushNewest(_ entry: Entry) {
+        entry.older = newest
+        newest?.newer = entry
+        newest = entry
+        if oldest == nil {
+            oldest = entry
+        }
+    }
+
+    // MARK: - Disk
+
+    private func readFile(for key: Key) -> LayoutGeometry? {
+        guard let url = directory?.appendingPathComponent(key.fileName),
+              let data = try? Data(contentsOf: url),
+              let geometry = LayoutGeometry(data: data) else {
+            return nil
+        }
+        // Keeps the modification dates ordered by use for `trimDirectory`.
+        try? FileManager.default.setAttributes([.modificationDate: Date()], ofItemAtPath: url.path)
+        return geometry
+    }
+
+    private func writeFile(_ geometry: LayoutGeometry, for key: Key) {
+        guard let directory else {
+            return
+        }
+        let url = directory.appendingPathComponent(key.fileName)
+        do {
+            try geometry.encoded().write(to: url, options: .atomic)
+        } catch {
+            return
+        }
+        trimDirectory(directory)
+    }
+
+    private func trimDirectory(_ directory: URL) {
+        let keys: [URLResourceKey] = [.contentModificationDateKey, .fileSizeKey]
+        guard let urls = try? FileManager.default.contentsOfDirectory(
+            at: directory,
+            includingPropertiesForKeys: keys
+        ) else {
+            return
+        }
+        var files = urls.filter { $0.pathExtension == "layout" }.compactMap { url -> (URL, Date, Int)? in
+            guard let values = try? url.resourceValues(forKeys: Set(keys)) else {
+                return nil
+            }
+            return (url, values.contentModificationDate ?? .distantPast, values.fileSize ?? 0)
+        }
+        var total = files.reduce(0) { $0 + $1.2 }
+        guard total > limits.diskBytes else {
+            return
+        }
+        files.sort { $0.1 < $1.1 }
+        for (url, _, size) in files where total > limits.diskBytes {
+            try? FileManager.default.removeItem(at: url)
+            total -= size
+        }
+    }
+}
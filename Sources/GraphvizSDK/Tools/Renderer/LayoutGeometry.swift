@@ -0,0 +1,287 @@
+//
+//  LayoutGeometry.swift
+//  GraphvizSDK
+//
+//  Created by Татьяна Макеева on 16.10.2026.
+//
+
+@preconcurrency import CGraphvizSDK
+import Foundation
+
+/// Everything a layout computed, in Graphviz coordinates and without styling.
+///
+/// Nodes are listed in cgraph order and edges in the order of their tails'
+/// out-edges, which is the order `graph_layout_hash` visits them, so the
+/// geometry of one graph can be applied to any graph with the same hash.
+struct LayoutGeometry: Sendable, Equatable {
+    struct NodeGeometry: Sendable, Equatable {
+        var center: CGPoint
+        var size: CGSize
+        /// Outline vertices relative to the node origin, `nil` for shapes without a polygon.
+        var outline: [CGPoint]?
+    }
+
+    struct EdgeGeometry: Sendable, Equatable {
+        /// Bezier control points, empty when the edge was not routed.
+        var points: [CGPoint]
+        var arrowHead: CGPoint?
+        var arrowTail: CGPoint?
+    }
+
+    var size: CGSize
+    var nodes: [NodeGeometry]
+    var edges: [EdgeGeometry]
+
+    /// Reads the geometry of `graph` after a layout.
+    init(graph: Graph) {
+        let nodesByPointer = Dictionary(
+            (graph.nodes + graph.subgraphs.flatMap(\.nodes)).map { ($0.node, $0) },
+            uniquingKeysWith: { first, _ in first }
+        )
+        let edgesByPointer = Dictionary(
+            (graph.edges + graph.subgraphs.flatMap(\.edges)).map { ($0.edge, $0) },
+            uniquingKeysWith: { first, _ in first }
+        )
+        let order = LayoutGeometry.order(of: graph.graph)
+        size = graph.size
+        nodes = order.nodes.map { node in
+            nodesByPointer[node]?.geometry ?? LayoutGeometry.NodeGeometry(
+                center: node.pos,
+                size: node.size,
+                outline: nil
+            )
+        }
+        edges = order.edges.map { edge in
+            edgesByPointer[edge]?.geometry ?? LayoutGeometry.EdgeGeometry(points: [])
+        }
+    }
+
+    init(size: CGSize, nodes: [NodeGeometry], edges: [EdgeGeometry]) {
+        self.size = size
+        self.nodes = nodes
+        self.edges = edges
+    }
+
+    /// Nodes and edges of `graph` in the order the geometry lists them.
+    static func order(of graph: GVGraph) -> (nodes: [GVNode], edges: [GVEdge]) {
+        var nodes: [GVNode] = []
+        var edges: [GVEdge] = []
+        var node = agfstnode(graph)
+        while let current = node {
+            nodes.append(current)
+            node = agnxtnode(graph, current)
+        }
+        for current in nodes {
+            var edge = agfstout(graph, current)
+            while let out = edge {
+                edges.append(out)
+                edge = agnxtout(graph, out)
+            }
+        }
+        return (nodes, edges)
+    }
+
+    /// Whether the geometry lists as many nodes and edges as `graph` has.
+    func fits(_ graph: GVGraph) -> Bool {
+        nodes.count == Int(agnnodes(graph)) && edges.count == Int(agnedges(graph))
+    }
+
+    /// Approximate memory footprint, used for the cache size limit.
+    var byteCount: Int {
+        let point = MemoryLayout<CGPoint>.stride
+        let nodeBytes = nodes.reduce(0) { $0 + MemoryLayout<NodeGeometry>.stride + ($1.outline?.count ?? 0) * point }
+        let edgeBytes = edges.reduce(0) { $0 + MemoryLayout<EdgeGeometry>.stride + $1.points.count * point }
+        return MemoryLayout<LayoutGeometry>.stride + nodeBytes + edgeBytes
+    }
+}
+
+// MARK: - Binary encoding
+
+extension LayoutGeometry {
+    private static let magic: UInt32 = 0x4356_4C47 // "GLVC"
+    private static let version: UInt32 = 1
+
+    /// Little-endian binary form used by the on-disk cache.
+    func encoded() -> Data {
+        var writer = Writer()
+        writer.append(Self.magic)
+        writer.append(Self.version)
+        writer.append(size.width)
+        writer.append(size.height)
+        writer.append(UInt32(nodes.count))
+        for node in nodes {
+            writer.append(node.center)
+            writer.append(node.size.width)
+            writer.append(node.size.height)
+            if let outline = node.outline {
+                writer.append(UInt32(1))
+                writer.append(outline)
+            } else {
+                writer.append(UInt32(0))
+            }
+        }
+        writer.append(UInt32(edges.count))
+        for edge in edges {
+            writer.append(edge.points)
+            writer.append(edge.arrowHead)
+            writer.append(edge.arrowTail)
+        }
+        return writer.data
+    }
+
+    /// Decodes `encoded()` output, or returns `nil` if `data` is truncated or
+    /// was written by another version.
+    init?(data: Data) {
+        var reader = Reader(data: data)
+        guard reader.uint32() == Self.magic,
+              reader.uint32() == Self.version,
+              let width = reader.double(),
+              let height = reader.double(),
+              let nodeCount = reader.count() else {
+            return nil
+        }
+        var nodes: [NodeGeometry] = []
+        nodes.reserveCapacity(nodeCount)
+        for _ in 0..<nodeCount {
+            guard let center = reader.point(),
+                  let nodeWidth = reader.double(),
+                  let nodeHeight = reader.double(),
+                  let hasOutline = reader.uint32() else {
+                return nil
+            }
+            var outline: [CGPoint]?
+            if hasOutline != 0 {
+                guard let points = reader.points() else {
+                    return nil
+                }
+                outline = points
+            }
+            nodes.append(NodeGeometry(center: center, size: CGSize(width: nodeWidth, height: nodeHeight), outline: outline))
+        }
+        guard let edgeCount = reader.count() else {
+            return nil
+        }
+        var edges: [EdgeGeometry] = []
+        edges.reserveCapacity(edgeCount)
+        for _ in 0..<edgeCount {
+            guard let points = reader.points(),
+                  let arrowHead = reader.optionalPoint(),
+                  let arrowTail = reader.optionalPoint() else {
+                return nil
+            }
+            edges.append(EdgeGeometry(points: points, arrowHead: arrowHead, arrowTail: arrowTail))
+        }
+        guard reader.isAtEnd else {
+            return nil
+        }
+        self.init(size: CGSize(width: width, height: height), nodes: nodes, edges: edges)
+    }
+}
+
+private struct Writer {
+    var data = Data()
+
+    mutating func append(_ value: UInt32) {
+        withUnsafeBytes(of: value.littleEndian) { data.append(contentsOf: $0) }
+    }
+
+    mutating func append(_ value: CGFloat) {
+        withUnsafeBytes(of: Double(value).bitPattern.littleEndian) { data.append(contentsOf: $0) }
+    }
+
+    mutating func append(_ point: CGPoint) {
+        append(point.x)
+        append(point.y)
+    }
+
+    mutating func append(_ points: [CGPoint]) {
+        append(UInt32(points.count))
+        points.forEach { append($0) }
+    }
+
+    mutating func append(_ point: CGPoint?) {
+        guard let point else {
+            append(UInt32(0))
+            return
+        }
+        append(UInt32(1))
+        append(point)
+    }
+}
+
+private struct Reader {
+    let data: Data
+    var offset: Int
+
+    init(data: Data) {
+        self.data = data
+        self.offset = data.startIndex
+    }
+
+    var isAtEnd: Bool {
+        offset == data.endIndex
+    }
+
+    private mutating func bytes<T: FixedWidthInteger>(_: T.Type) -> T? {
+        let size = MemoryLayout<T>.size
+        guard data.endIndex - offset >= size else {
+            return nil
+        }
+        var value: T = 0
+        withUnsafeMutableBytes(of: &value) { buffer in
+            data.copyBytes(to: buffer, from: offset..<(offset + size))
+        }
+        offset += size
+        return T(littleEndian: value)
+    }
+
+    mutating func uint32() -> UInt32? {
+        bytes(UInt32.self)
+    }
+
+    /// An element count, rejected when the remaining data cannot hold that many elements.
+    mutating func count() -> Int? {
+        guard let count = uint32(), Int(count) <= data.endIndex - offset else {
+            return nil
+        }
+        return Int(count)
+    }
+
+    mutating func double() -> CGFloat? {
+        bytes(UInt64.self).map { CGFloat(Double(bitPattern: $0)) }
+    }
+
+    mutating func point() -> CGPoint? {
+        guard let x = double(), let y = double() else {
+            return nil
+        }
+        return CGPoint(x: x, y: y)
+    }
+
+    mutating func points() -> [CGPoint]? {
+        guard let count = count() else {
+            return nil
+        }
+        var points: [CGPoint] = []
+        points.reserveCapacity(count)
+        for _ in 0..<count {
+            guard let point = point() else {
+                return nil
+            }
+            points.append(point)
+        }
+        return points
+    }
+
+    /// `.some(nil)` for an absent point, `nil` for malformed data.
+    mutating func optionalPoint() -> CGPoint?? {
+        switch uint32() {
+        case 0:
+            return .some(nil)
+        case 1:
+            return point().map { .some($0) }
+        default:
+            return nil
+        }
+    }
+}
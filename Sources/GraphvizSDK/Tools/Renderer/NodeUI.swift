@@ -26,20 +26,31 @@ public struct NodeUI: Sendable, Identifiable, Equatable {
 }
 
 extension Node {
-    func create(graphHeight: CGFloat) -> NodeUI {
-        // Get node dimensions
+    /// Where the layout placed the node and the outline of its shape.
+    var geometry: LayoutGeometry.NodeGeometry {
         let width = node.width
         let height = node.height
+        return LayoutGeometry.NodeGeometry(
+            center: CGPoint(gvPoint: nd_coord(node)),
+            size: CGSize(width: width, height: height),
+            outline: node.polygon.map { toPolygon($0, width: width, height: height) }
+        )
+    }
+    
+    func create(graphHeight: CGFloat) -> NodeUI {
+        create(geometry: geometry, graphHeight: graphHeight)
+    }
+    
+    func create(geometry: LayoutGeometry.NodeGeometry, graphHeight: CGFloat) -> NodeUI {
+        // Get node dimensions
+        let width = geometry.size.width
+        let height = geometry.size.height
         let path: CGPath
         
         // Get shape information
-        if let poly = node.polygon {
+        if let outline = geometry.outline {
             // Create path
-            let cgPath = toPath(
-                poly: poly,
-                width: width,
-                height: height
-            )
+            let cgPath = toPath(outline: outline)
             path = cgPath.rotate(degree: 180)
         } else {
             path = CGPath(rect: .zero, transform: nil)
@@ -47,8 +58,7 @@ extension Node {
         
         
         // Calculate coordinates
-        let coord = nd_coord(node)
-        let point = coord.toCGPoint(graphHeight: graphHeight)
+        let point = geometry.center.convertFromGraphviz(graphHeight: graphHeight)
         
         let origin = point.centerToOrigin(width: width, height: height)
         
@@ -110,11 +120,9 @@ private func toPolygon(_ poly: polygon_t, width: CGFloat, height: CGFloat) -> [C
 
 // MARK: - Path Conversion
 
-private func toPath(poly: polygon_t, width: CGFloat, height: CGFloat) -> CGPath {
-    var points = toPolygon(poly, width: width, height: height)
+private func toPath(outline: [CGPoint]) -> CGPath {
+    var points = outline
     if points.count == 2 {
-        let points = toPolygon(poly, width: width, height: height)
-        
         let p1 = points[0]
         let p2 = points[1]
         let rect = CGRect(origin: p1, size: CGSize(width: p2.x, height: p2.y))
@@ -16,28 +16,28 @@ public final class RendererString {
     }
     
     public let layout: GVLayout
+    public let pool: GVContextPool
     
-    init(layout: GVLayout) {
+    init(layout: GVLayout, pool: GVContextPool = .shared) {
         self.layout = layout
+        self.pool = pool
     }
     
     public func layout(graph: Graph) throws -> String {
-        guard let context = loadGraphvizLibraries() else {
-            throw RendererError.createLayoutError
+        try pool.withContext { context in
+            defer {
+                gvFreeLayout(context, graph.graph)
+            }
+            guard gvLayout(context, graph.graph, layout.rawValue) == 0 else {
+                throw Error.failedCreateContext
+            }
+            // DOT output is the graph with its layout attached, so it is
+            // written directly rather than through the render pipeline
+            attach_layout_attrs(graph.graph)
+            guard let data = graph.graph.asString else {
+                throw Error.failedRenderData
+            }
+            return data
         }
-        defer {
-            gvFreeLayout(context, graph.graph)
-            gvFreeContext(context)
-        }
-        guard gvLayout(context, graph.graph, layout.rawValue) == 0 else {
-            throw Error.failedCreateContext
-        }
-        var data: CHAR?
-        var len: size_t = 0
-        gvRenderData(context, graph.graph, layout.rawValue, &data, &len)
-        guard let data else {
-            throw Error.failedRenderData
-        }
-        return String(cString: data)
     }
 }
@@ -22,22 +22,89 @@ enum RendererError: LocalizedError {
 
 public final class RendererSwiftUI {
     public let layout: GVLayout
+    public let pool: GVContextPool
+    /// Layouts already computed for graphs with the same content, or `nil` to always lay out.
+    public let cache: LayoutCache?
     
-    init(layout: GVLayout) {
+    init(layout: GVLayout, pool: GVContextPool = .shared, cache: LayoutCache? = nil) {
         self.layout = layout
+        self.pool = pool
+        self.cache = cache
     }
     
-    public func layout(graph: Graph) throws -> GraphUI {
-        guard let context = loadGraphvizLibraries() else {
-            throw RendererError.createLayoutError
+    /// Lays out `graph`. Pass `updatable` to lay it out again later with
+    /// `layout(graph:updating:)`, which with dot keeps the memo of this layout;
+    /// such layouts bypass the cache.
+    public func layout(graph: Graph, updatable: Bool = false) throws -> GraphUI {
+        guard !updatable else {
+            return try layout(graph: graph, updating: nil)
         }
-        defer {
-            gvFreeLayout(context, graph.graph)
-            gvFreeContext(context)
+        guard let cache else {
+            return try pool.withContext { context in
+                defer {
+                    gvFreeLayout(context, graph.graph)
+                }
+                guard gvLayout(context, graph.graph, layout.rawValue) == 0 else {
+                    throw RendererError.createLayoutError
+                }
+                return makeGraphUI(graph: graph)
+            }
+        }
+        let key = cache.key(for: graph, layout: layout)
+        if let geometry = cache.geometry(for: key), geometry.fits(graph.graph) {
+            return makeGraphUI(graph: graph, geometry: geometry)
+        }
+        return try pool.withContext { context in
+            defer {
+                gvFreeLayout(context, graph.graph)
+            }
+            guard gvLayout(context, graph.graph, layout.rawValue) == 0 else {
+                throw RendererError.createLayoutError
+            }
+            let geometry = LayoutGeometry(graph: graph)
+            cache.store(geometry, for: key)
+            return makeGraphUI(graph: graph, geometry: geometry)
+        }
+    }
+    
+    /// Lays out `graph` again after an edit, starting from `previous`.
+    ///
+    /// With dot, nodes are matched to `previous` by name and edges by their ends
+    /// and key. They keep their ranks and order where the edit allows, and edges
+    /// whose surroundings only moved keep their splines. Other layouts ignore
+    /// `previous`. The result can be updated again in turn.
+    public func layout(graph: Graph, updating previous: GraphUI?) throws -> GraphUI {
+        try pool.withContext { context in
+            defer {
+                gvFreeLayout(context, graph.graph)
+            }
+            guard layout == .dot else {
+                guard gvLayout(context, graph.graph, layout.rawValue) == 0 else {
+                    throw RendererError.createLayoutError
+                }
+                return makeGraphUI(graph: graph)
+            }
+            var memo: OpaquePointer?
+            let result = withPrevious(previous?.dotLayout) { previous in
+                dot_layout_incremental(context, graph.graph, previous, &memo)
+            }
+            guard result == 0, let memo else {
+                throw RendererError.createLayoutError
+            }
+            var graphUI = makeGraphUI(graph: graph)
+            graphUI.dotLayout = DotLayoutMemo(memo)
+            return graphUI
         }
-        guard gvLayout(context, graph.graph, layout.rawValue) == 0 else {
-            throw RendererError.createLayoutError
+    }
+    
+    private func withPrevious<T>(_ memo: DotLayoutMemo?, _ body: (OpaquePointer?) -> T) -> T {
+        guard let memo else {
+            return body(nil)
         }
+        return memo.withPointer { body($0) }
+    }
+    
+    private func makeGraphUI(graph: Graph) -> GraphUI {
         let graphHeight = graph.size.height
         let nodes = graph.nodes.map {
             $0.create(graphHeight: graphHeight)
@@ -61,4 +128,26 @@ public final class RendererSwiftUI {
             edges: edges + subgraphsEdges
         )
     }
+    
+    /// Same as `makeGraphUI(graph:)`, but places nodes and edges from `geometry`
+    /// instead of reading the positions of a layout from the graph.
+    private func makeGraphUI(graph: Graph, geometry: LayoutGeometry) -> GraphUI {
+        let order = LayoutGeometry.order(of: graph.graph)
+        let nodeIndexes = Dictionary(uniqueKeysWithValues: order.nodes.enumerated().map { ($1, $0) })
+        let edgeIndexes = Dictionary(uniqueKeysWithValues: order.edges.enumerated().map { ($1, $0) })
+        let graphHeight = geometry.size.height
+        let allNodes = graph.nodes + graph.subgraphs.flatMap(\.nodes)
+        let allEdges = graph.edges + graph.subgraphs.flatMap(\.edges)
+        let nodes = allNodes.compactMap { node in
+            nodeIndexes[node.node].map { node.create(geometry: geometry.nodes[$0], graphHeight: graphHeight) }
+        }
+        let edges = allEdges.compactMap { edge in
+            edgeIndexes[edge.edge].flatMap { edge.create(geometry: geometry.edges[$0], graphHeight: graphHeight) }
+        }
+        return GraphUI(
+            size: geometry.size,
+            nodes: nodes,
+            edges: edges
+        )
+    }
 }
@@ -1,5 +1,7 @@
+import Foundation
 import Testing
 @testable import GraphvizSDK
+import CGraphvizSDK
 #if canImport(SwiftUI)
 import SwiftUI
 #endif
@@ -76,3 +78,1194 @@ import SwiftUI
     #expect(edge.penwidth == 1.0)
     #expect(edge.fontsize == 14.0)
 }
+
+// Тест: повторное использование контекстов из пула
+@Test func testContextPoolReusesContexts() async throws {
+    let pool = GVContextPool(capacity: 2)
+    try pool.preload()
+    let graph = try GraphBuilder().build()
+    let renderer = RendererSwiftUI(layout: .dot, pool: pool)
+    _ = try renderer.layout(graph: graph)
+    _ = try renderer.layout(graph: graph)
+    let metrics = pool.metrics
+    #expect(metrics.created == 1)
+    #expect(metrics.acquired == 2)
+    #expect(metrics.reused == 2)
+    #expect(metrics.inUse == 0)
+    #expect(metrics.idle == 1)
+    pool.drain()
+    #expect(pool.metrics.idle == 0)
+}
+
+// Тест: параллельная раскладка независимых графов совпадает с последовательной
+@Test func testConcurrentLayoutsMatchSerial() async throws {
+    let sources = (0..<16).map { index in
+        var dot = "digraph G\(index) {\n"
+        for cluster in 0..<3 {
+            dot += "subgraph cluster_\(cluster) { label=\"c\(cluster)\"; "
+            dot += (0..<6).map { "n\(cluster)_\($0)" }.joined(separator: "; ")
+            dot += " }\n"
+        }
+        for edge in 0..<(20 + index) {
+            let tail = (edge * 7 + index) % 18
+            let head = (edge * 11 + index * 3 + 1) % 18
+            dot += "n\(tail / 6)_\(tail % 6) -> n\(head / 6)_\(head % 6) [label=\"e\(edge)\"]\n"
+        }
+        return dot + "}"
+    }
+    let renderer = RendererString(layout: .dot, pool: GVContextPool(capacity: 4))
+    let serial = try sources.map { try renderer.layout(graph: GraphBuilderFromString.build(str: $0)) }
+
+    // графы читаются последовательно: парсер cgraph не реентерабелен
+    let graphs = try sources.map { try GraphBuilderFromString.build(str: $0) }
+    for _ in 0..<4 {
+        var concurrent = [String](repeating: "", count: graphs.count)
+        concurrent.withUnsafeMutableBufferPointer { results in
+            DispatchQueue.concurrentPerform(iterations: graphs.count) { index in
+                results[index] = (try? renderer.layout(graph: graphs[index])) ?? ""
+            }
+        }
+        #expect(concurrent == serial)
+    }
+}
+
+// Тест: разреженная модель SGD даёт stress не больше чем в полтора раза выше точной,
+// в том числе с закреплёнными вершинами и с несколькими компонентами
+@Test func testSparseSGDLayout() async throws {
+    func stressRatio(sparse: String, _ graph: (String) -> String) throws -> Double {
+        try layoutStress(graph("mode=\"sgd:\(sparse)\";")) / layoutStress(graph("mode=sgd;"))
+    }
+    #expect(try stressRatio(sparse: "sparse10") { gridGraph(side: 12, attributes: $0) } < 1.5)
+
+    // закреплённые вершины двигают только другие концы своих слагаемых
+    let corners = "n0 [pos=\"0,0!\"]; n11 [pos=\"11,0!\"]; n132 [pos=\"0,11!\"]; n143 [pos=\"11,11!\"];"
+    #expect(try stressRatio(sparse: "sparse10") {
+        "graph G { \($0)\n" + gridEdges(side: 12, prefix: "n") + corners + "}"
+    } < 1.5)
+
+    // компоненты с закреплёнными вершинами раскладываются вместе: опорные вершины
+    // выбираются в каждой компоненте, и каждая область остаётся в своей
+    #expect(try stressRatio(sparse: "sparse30") {
+        "graph G { \($0)\n" + gridEdges(side: 12, prefix: "n") + gridEdges(side: 8, prefix: "m")
+            + "n0 [pos=\"0,0!\"]; m63 [pos=\"20,20!\"]; }"
+    } < 1.5)
+}
+
+// Тест: SGD раскладывает решётку одинаково на 1 и 4 потоках, а hogwild сходится к тому же stress
+@Test func testHogwildSGDLayout() async throws {
+    // точные слагаемые считаются поисками Дейкстры от каждой вершины, поделёнными между потоками
+    let serial = try layoutPositions(gridGraph(side: 12, attributes: "mode=sgd; threads=1;"), layout: .neato)
+    #expect(try layoutPositions(gridGraph(side: 12, attributes: "mode=sgd; threads=4;"), layout: .neato) == serial)
+
+    // hogwild меняет порядок обновлений, поэтому сравнивается только итоговый stress
+    let serialStress = try layoutStress(gridGraph(side: 12, attributes: "mode=sgd; threads=1;"))
+    let hogwildStress = try layoutStress(gridGraph(side: 12, attributes: "mode=\"sgd:hogwild\"; threads=4;"))
+    #expect(abs(hogwildStress - serialStress) < 0.1 * serialStress)
+}
+
+/// Решётка side×side с атрибутами графа `attributes`
+private func gridGraph(side: Int, attributes: String) -> String {
+    "graph G { \(attributes)\n" + gridEdges(side: side, prefix: "n") + "}"
+}
+
+/// Рёбра решётки side×side между вершинами prefix0, prefix1, …
+private func gridEdges(side: Int, prefix: String) -> String {
+    var edges = ""
+    for y in 0..<side {
+        for x in 0..<side {
+            let index = y * side + x
+            if x < side - 1 { edges += "\(prefix)\(index) -- \(prefix)\(index + 1);\n" }
+            if y < side - 1 { edges += "\(prefix)\(index) -- \(prefix)\(index + side);\n" }
+        }
+    }
+    return edges
+}
+
+/// Нормированный stress раскладки: расстояние между вершинами — число рёбер кратчайшего пути,
+/// раскладка берётся в наилучшем масштабе, пары из разных компонент не учитываются
+private func layoutStress(_ dot: String, layout: GVLayout = .neato) throws -> Double {
+    let graph = try GraphBuilderFromString.build(str: dot)
+    _ = try RendererString(layout: layout, pool: GVContextPool(capacity: 1)).layout(graph: graph)
+    var index: [UnsafeMutablePointer<Agnode_t>: Int] = [:]
+    var points: [(x: Double, y: Double)] = []
+    var node = agfstnode(graph.graph)
+    while let current = node {
+        let pos = String(cString: agget(UnsafeMutableRawPointer(current), "pos")).split(separator: ",")
+        let x = try #require(Double(pos[0]))
+        let y = try #require(Double(pos[1]))
+        index[current] = points.count
+        points.append((x, y))
+        node = agnxtnode(graph.graph, current)
+    }
+    var neighbours = [[Int]](repeating: [], count: points.count)
+    for (current, tail) in index {
+        var edge = agfstout(graph.graph, current)
+        while let out = edge {
+            let head = index[aghead(out)!]!
+            neighbours[tail].append(head)
+            neighbours[head].append(tail)
+            edge = agnxtout(graph.graph, out)
+        }
+    }
+
+    // (расстояние в раскладке, расстояние в графе) для каждой связной пары
+    var pairs: [(length: Double, distance: Double)] = []
+    for source in points.indices {
+        var distance = [Int](repeating: -1, count: points.count)
+        distance[source] = 0
+        var queue = [source]
+        var head = 0
+        while head < queue.count {
+            let current = queue[head]
+            head += 1
+            for next in neighbours[current] where distance[next] < 0 {
+                distance[next] = distance[current] + 1
+                queue.append(next)
+            }
+        }
+        for target in (source + 1)..<points.count where distance[target] > 0 {
+            let length = hypot(points[source].x - points[target].x, points[source].y - points[target].y)
+            pairs.append((length, Double(distance[target])))
+        }
+    }
+    let scale = pairs.reduce(0) { $0 + $1.length / $1.distance }
+        / pairs.reduce(0) { $0 + $1.length * $1.length / ($1.distance * $1.distance) }
+    let stress = pairs.reduce(0) { sum, pair in
+        let error = (scale * pair.length - pair.distance) / pair.distance
+        return sum + error * error
+    }
+    return stress / Double(pairs.count)
+}
+
+// Тест: модель stress с опорными вершинами (model=landmark) почти не уступает полной матрице расстояний
+// и раскладывает одинаково на любом числе потоков
+@Test func testLandmarkStressLayout() async throws {
+    // 400 вершин: шаг по всем вершинам делится на два куска по 256
+    let landmark = try layoutStress(gridGraph(side: 20, attributes: "model=landmark;"))
+    let shortpath = try layoutStress(gridGraph(side: 20, attributes: "model=shortpath;"))
+    #expect(landmark < 1.1 * shortpath)
+
+    let serial = try layoutPositions(gridGraph(side: 20, attributes: "model=landmark; threads=1;"), layout: .neato)
+    #expect(try layoutPositions(gridGraph(side: 20, attributes: "model=landmark; threads=4;"), layout: .neato) == serial)
+}
+
+// Тест: кратчайшие пути stress majorization, посчитанные по строкам на всех потоках, совпадают с последовательным compute_apsp
+@Test func testPackedAPSPMatchesSerial() async throws {
+    let side = 30
+    let n = side * side
+    // решётка с хордами, чтобы кратчайшие пути не сводились к манхэттенским
+    var adjacency = (0..<n).map { [Int32($0)] }
+    for index in 0..<n {
+        var neighbors = [Int]()
+        if index % side < side - 1 { neighbors.append(index + 1) }
+        if index + side < n { neighbors.append(index + side) }
+        if index % 37 == 0 { neighbors.append((index * 7919 + 13) % n) }
+        for neighbor in neighbors where neighbor != index {
+            adjacency[index].append(Int32(neighbor))
+            adjacency[neighbor].append(Int32(index))
+        }
+    }
+    var edges = adjacency.flatMap { $0 }
+    var graph = [vtx_data](repeating: vtx_data(), count: n)
+    let (packed, full) = edges.withUnsafeMutableBufferPointer { edgeBuffer in
+        var offset = 0
+        for index in 0..<n {
+            graph[index].nedges = adjacency[index].count
+            graph[index].edges = edgeBuffer.baseAddress! + offset
+            offset += adjacency[index].count
+        }
+        return graph.withUnsafeMutableBufferPointer { vertices in
+            (compute_apsp_packed(vertices.baseAddress, Int32(n)), compute_apsp(vertices.baseAddress, Int32(n)))
+        }
+    }
+    let packedRows = try #require(packed)
+    let rows = try #require(full)
+    defer {
+        free(packedRows)
+        free(rows[0])
+        free(rows)
+    }
+    var mismatches = 0
+    var offset = 0
+    for i in 0..<n {
+        for j in i..<n {
+            if packedRows[offset] != Float(rows[i]![j]) {
+                mismatches += 1
+            }
+            offset += 1
+        }
+    }
+    #expect(offset == n * (n + 1) / 2)
+    #expect(mismatches == 0)
+}
+
+// Тест: векторные ядра neatogen (SSE2/AVX2, на arm64 — NEON) совпадают со скалярными циклами
+@Test func testDenseKernelsMatchScalar() async throws {
+    guard simd_available() else { return }
+    for n in [0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1000, 4099] {
+        let a = (0..<n).map { _ in Float.random(in: -1...1) }
+        let b = (0..<n).map { _ in Float.random(in: -1...1) }
+        let d = (0..<n).map { _ in Double.random(in: -1...1) }
+        let alpha = Float.random(in: -2...2)
+
+        var y = b
+        simd_axpyf(Int32(n), &y, alpha, a)
+        var yd = d
+        simd_axpy_fd(Int32(n), &yd, Double(alpha), a)
+        var result = b
+        let row = simd_packed_row(Int32(n), a, b, alpha, &result)
+
+        // суммы складываются в другом порядке, поэтому допуск берётся от суммы модулей слагаемых
+        var dot = 0.0, dotScale = 0.0, dotFD = 0.0, dotFDScale = 0.0
+        var rowSum: Float = 0, rowScale: Float = 0
+        var mismatches = 0
+        for i in 0..<n {
+            let product: Float = a[i] * b[i]
+            dot += Double(product)
+            dotScale += abs(Double(product))
+            rowSum += product
+            rowScale += abs(product)
+            let productFD: Double = Double(a[i]) * d[i]
+            dotFD += productFD
+            dotFDScale += abs(productFD)
+
+            let scaled: Float = alpha * a[i]
+            if abs(y[i] - (b[i] + scaled)) > 1e-6 * (abs(b[i]) + abs(scaled)) {
+                mismatches += 1
+            }
+            if abs(result[i] - (b[i] + scaled)) > 1e-6 * (abs(b[i]) + abs(scaled)) {
+                mismatches += 1
+            }
+            let scaledFD: Double = Double(alpha) * Double(a[i])
+            if abs(yd[i] - (d[i] + scaledFD)) > 1e-14 * (abs(d[i]) + abs(scaledFD)) {
+                mismatches += 1
+            }
+        }
+        #expect(mismatches == 0)
+        #expect(abs(simd_dotf(Int32(n), a, b) - dot) <= 1e-12 * dotScale)
+        #expect(abs(simd_dot_fd(Int32(n), a, d) - dotFD) <= 1e-12 * dotFDScale)
+        #expect(abs(row - rowSum) <= Float(n) * Float.ulpOfOne * rowScale)
+    }
+}
+
+// Тест: плоское дерево sfdp даёт те же силы отталкивания, что и дерево на указателях
+@Test func testFlatQuadTreeMatchesPointerTree() async throws {
+    let n = 5_000
+    var x = randomPoints(n)
+    var pointerForce = [Double](repeating: 0, count: 2 * n)
+    var flatForce = pointerForce
+    var counts = [Double](repeating: 0, count: 4)
+
+    let pointerTree = try #require(QuadTree_new_from_point_list(2, Int32(n), 10, &x))
+    QuadTree_get_repulsive_force(pointerTree, &pointerForce, &x, 0.6, -1, 1, &counts)
+    QuadTree_delete(pointerTree)
+    let flatTree = flat_quadtree_new(2)
+    flat_quadtree_build(flatTree, Int32(n), 10, x)
+    flat_quadtree_get_repulsive_force(flatTree, &flatForce, &x, 0.6, -1, 1, &counts)
+    flat_quadtree_free(flatTree)
+
+    #expect(flatForce.contains { $0 != 0 })
+    #expect(flatForce == pointerForce)
+}
+
+/// `n` точек в квадрате [0, 100)², одних и тех же от запуска к запуску
+private func randomPoints(_ n: Int) -> [Double] {
+    var state: UInt64 = 0x9e3779b97f4a7c15
+    return (0..<2 * n).map { _ in
+        state = state &* 6364136223846793005 &+ 1442695040888963407
+        return Double(state >> 11) / Double(UInt64(1) << 53) * 100
+    }
+}
+
+// Тест: плоское дерево sfdp, построенное и обойдённое на нескольких потоках, даёт те же силы, что и на одном
+@Test func testFlatQuadTreeThreadsMatchSerial() async throws {
+    let n = 5_000
+    var x = randomPoints(n)
+    var counts = [Double](repeating: 0, count: 4)
+    func forces(threads: Int32) -> [Double] {
+        var force = [Double](repeating: 0, count: 2 * n)
+        let tree = flat_quadtree_new(2)
+        flat_quadtree_set_threads(tree, threads)
+        flat_quadtree_build(tree, Int32(n), 10, x)
+        flat_quadtree_get_repulsive_force(tree, &force, &x, 0.6, -1, 1, &counts)
+        flat_quadtree_free(tree)
+        return force
+    }
+    let serial = forces(threads: 1)
+    #expect(forces(threads: 4) == serial)
+    #expect(forces(threads: 7) == serial)
+}
+
+// Тест: иерархия уровней sfdp, огрублённая на нескольких потоках, совпадает с огрублённой на одном
+@Test func testMultilevelThreadsMatchSerial() async throws {
+    // решётка больше порога, с которого уровни огрубляются параллельно (50 000 узлов)
+    let side = 230
+    let n = side * side
+    var rows = [Int32](), columns = [Int32]()
+    for index in 0..<n {
+        for neighbor in [index % side < side - 1 ? index + 1 : n, index + side] where neighbor < n {
+            rows += [Int32(index), Int32(neighbor)]
+            columns += [Int32(neighbor), Int32(index)]
+        }
+    }
+    var values = [Double](repeating: 1, count: rows.count)
+    let matrix = try #require(SparseMatrix_from_coordinate_arrays(Int32(rows.count), Int32(n), Int32(n), &rows, &columns, &values, Int32(MATRIX_TYPE_REAL), MemoryLayout<Double>.size))
+    defer {
+        SparseMatrix_delete(matrix)
+    }
+
+    struct Level: Equatable {
+        let ia: [Int32]
+        let ja: [Int32]
+        let a: [Double]
+    }
+    func hierarchy(threads: Int32) -> [Level] {
+        // огрубление перемешивает узлы через rand()
+        srand(1)
+        let grid = Multilevel_new(matrix, Multilevel_control(maxlevel: .max, threads: threads))
+        defer {
+            Multilevel_delete(grid)
+        }
+        var levels = [Level]()
+        var level = grid
+        while let current = level {
+            let A = current.pointee.A!.pointee
+            levels.append(Level(
+                ia: Array(UnsafeBufferPointer(start: A.ia, count: Int(A.m) + 1)),
+                ja: Array(UnsafeBufferPointer(start: A.ja, count: Int(A.nz))),
+                a: Array(UnsafeBufferPointer(start: A.a!.assumingMemoryBound(to: Double.self), count: Int(A.nz)))
+            ))
+            level = current.pointee.next
+        }
+        return levels
+    }
+    let serial = hierarchy(threads: 1)
+    #expect(serial.count > 2)
+    #expect(hierarchy(threads: 4) == serial)
+}
+
+// Тест: сложение, умножение, транспонирование и умножение на вектор разреженных матриц на нескольких потоках совпадают с последовательными
+@Test func testSparseKernelsThreadsMatchSerial() async throws {
+    // больше порога в 100 000 элементов, с которого ядра делятся между потоками
+    let n = 40_000
+    var state: UInt64 = 0x9e3779b97f4a7c15
+    func next(_ bound: Int) -> Int {
+        state = state &* 6364136223846793005 &+ 1442695040888963407
+        return Int(state >> 33) % bound
+    }
+    func randomMatrix(entries: Int) throws -> SparseMatrix {
+        var rows = (0..<entries).map { _ in Int32(next(n)) }
+        var columns = (0..<entries).map { _ in Int32(next(n)) }
+        var values = (0..<entries).map { _ in Double(next(1000)) / 100 - 5 }
+        return try #require(SparseMatrix_from_coordinate_arrays(Int32(entries), Int32(n), Int32(n), &rows, &columns, &values, Int32(MATRIX_TYPE_REAL), MemoryLayout<Double>.size))
+    }
+    struct CSR: Equatable {
+        let ia: [Int32]
+        let ja: [Int32]
+        let a: [Double]
+    }
+    func csr(_ result: SparseMatrix?) throws -> CSR {
+        let matrix = try #require(result)
+        defer {
+            SparseMatrix_delete(matrix)
+        }
+        let A = matrix.pointee
+        return CSR(
+            ia: Array(UnsafeBufferPointer(start: A.ia, count: Int(A.m) + 1)),
+            ja: Array(UnsafeBufferPointer(start: A.ja, count: Int(A.nz))),
+            a: Array(UnsafeBufferPointer(start: A.a!.assumingMemoryBound(to: Double.self), count: Int(A.nz)))
+        )
+    }
+
+    let A = try randomMatrix(entries: 160_000)
+    let B = try randomMatrix(entries: 160_000)
+    defer {
+        SparseMatrix_delete(A)
+        SparseMatrix_delete(B)
+    }
+    #expect(try csr(SparseMatrix_add(A, B, 4)) == csr(SparseMatrix_add(A, B, 1)))
+    #expect(try csr(SparseMatrix_multiply(A, B, 4)) == csr(SparseMatrix_multiply(A, B, 1)))
+    #expect(try csr(SparseMatrix_transpose(A, 4)) == csr(SparseMatrix_transpose(A, 1)))
+
+    var v = (0..<2 * n).map { _ in Double(next(1000)) / 100 }
+    func product(threads: Int32) -> [Double] {
+        var result: UnsafeMutablePointer<Double>?
+        SparseMatrix_multiply_vector(A, &v, &result, threads)
+        defer {
+            free(result)
+        }
+        return Array(UnsafeBufferPointer(start: result, count: n))
+    }
+    #expect(product(threads: 4) == product(threads: 1))
+    func denseProduct(threads: Int32) -> [Double] {
+        var result = [Double](repeating: 0, count: 2 * n)
+        SparseMatrix_multiply_dense(A, v, &result, 2, threads)
+        return result
+    }
+    #expect(denseProduct(threads: 4) == denseProduct(threads: 1))
+}
+
+// Тест: network simplex с выбором ребра по наименьшему срезу (nspriority) находит ранжирование той же стоимости, что и поиск блоками
+@Test func testNetworkSimplexPriorityMatchesBlockSearch() async throws {
+    var state: UInt64 = 0x9e3779b97f4a7c15
+    func next(_ bound: Int) -> Int {
+        state = state &* 6364136223846793005 &+ 1442695040888963407
+        return Int(state >> 33) % bound
+    }
+    var edges = ""
+    for index in 1..<300 {
+        edges += "n\(next(index)) -> n\(index) [weight=\(1 + next(5))];\n"
+    }
+    for _ in 0..<300 {
+        let tail = next(299)
+        edges += "n\(tail) -> n\(tail + 1 + next(299 - tail)) [weight=\(1 + next(5))];\n"
+    }
+
+    // ранги восстанавливаются по различным y узлов: при minlen=1 пустых рангов нет
+    func rankingCost(priority: Bool) throws -> Int {
+        let graph = try GraphBuilderFromString.build(str: "digraph G { nspriority=\(priority);\n" + edges + "}")
+        _ = try RendererString(layout: .dot, pool: GVContextPool(capacity: 1)).layout(graph: graph)
+        var y: [UnsafeMutablePointer<Agnode_t>: Double] = [:]
+        var node = agfstnode(graph.graph)
+        while let current = node {
+            let pos = String(cString: agget(UnsafeMutableRawPointer(current), "pos"))
+            y[current] = try #require(Double(pos.split(separator: ",")[1]))
+            node = agnxtnode(graph.graph, current)
+        }
+        let levels = Set(y.values).sorted(by: >)
+        let rank = y.mapValues { levels.firstIndex(of: $0)! }
+        var cost = 0
+        node = agfstnode(graph.graph)
+        while let current = node {
+            var edge = agfstout(graph.graph, current)
+            while let out = edge {
+                let length = rank[aghead(out)!]! - rank[agtail(out)!]!
+                #expect(length >= 1)
+                cost += Int(String(cString: agget(UnsafeMutableRawPointer(out), "weight")))! * length
+                edge = agnxtout(graph.graph, out)
+            }
+            node = agnxtnode(graph.graph, current)
+        }
+        return cost
+    }
+
+    #expect(try rankingCost(priority: true) == rankingCost(priority: false))
+}
+
+// Тест: agmemread_len читает граф из буфера без завершающего нуля
+@Test func testMemReadWithLength() async throws {
+    let source = "digraph G { a -> b; b -> c }"
+    let bytes = Array((source + "}}{").utf8).map { CChar(bitPattern: $0) }
+    let graph = bytes.withUnsafeBufferPointer { agmemread_len($0.baseAddress, source.utf8.count) }
+    #expect(graph != nil)
+    if let graph {
+        #expect(agnnodes(graph) == 3)
+        #expect(agnedges(graph) == 2)
+        agclose(graph)
+    }
+    #expect(try GraphBuilderFromString.build(str: source).nodes.count == 3)
+}
+
+// Тест: agmemread, сканирующий весь буфер сразу, разбирает DOT так же, как agread из потока
+@Test func testMemReadMatchesStreamRead() async throws {
+    var dot = "digraph G {\n  graph [rankdir=LR, label=\"multi\\\nline\"];\n  // comment\n  node [shape=box];\n"
+    for index in 1..<2_000 {
+        dot += "  n\(index / 2 + index % 3) -> n\(index) [weight=\(1 + index % 5), label=\"e\(index)\"];\n"
+    }
+    dot += "  a [label=<<b>html</b>>]; /* block\n comment */ b -> a;\n  c [label=\"split \" + \"string\"];\n}\n"
+
+    let whole = try #require(agmemread(dot))
+    defer {
+        agclose(whole)
+    }
+    var bytes = Array(dot.utf8)
+    let streamed = try bytes.withUnsafeMutableBytes { buffer -> String in
+        let file = try #require(fmemopen(buffer.baseAddress, buffer.count, "r"))
+        defer {
+            fclose(file)
+        }
+        let graph = try #require(agread(file, nil))
+        defer {
+            agclose(graph)
+        }
+        return try #require(graph.asString)
+    }
+    #expect(agnedges(whole) == 2_000)
+    #expect(whole.asString == streamed)
+}
+
+// Тест: запись DOT в память без канала; строки в кавычках не меняются от записи к записи
+@Test func testGraphAsString() async throws {
+    let graph = try GraphBuilderFromString.build(str: "digraph G { a [label=\"node a\"]; a -> \"b c\" [label=<<b>e</b>>]; \"node\" -> b }")
+    let first = try #require(graph.graph.asString)
+    #expect(first.contains("label=\"node a\""))
+    #expect(first.contains("a -> \"b c\""))
+    #expect(first.contains("label=<<b>e</b>>"))
+    #expect(first.contains("\"node\" -> b"))
+    #expect(graph.graph.asString == first)
+}
+
+// Тест: agwritemem пишет тот же DOT, что и agwrite в поток stdio, и после правки графа
+@Test func testWriteMemMatchesStreamWrite() async throws {
+    let dot = #"""
+    strict digraph "my graph" {
+      graph [label=<<b>bold</b> &amp; text>, fontsize=12];
+      node [shape=box, color="#ff0000"];
+      edge [arrowhead=vee];
+      "a b" -> "c\"d" [label="quote \" inside", weight=2];
+      subgraph cluster_x { label="x"; node [color=blue]; e; f -> g; }
+      subgraph { rank=same; h; i; }
+      "node" -> "edge"; "graph" -> "strict";
+      узел -> e [label="multi\nline"];
+      -1.5 -> 2;
+    }
+    """#
+    let g = try #require(agmemread(dot))
+    defer {
+        agclose(g)
+    }
+    func streamed() throws -> String {
+        let file = try #require(tmpfile())
+        defer {
+            fclose(file)
+        }
+        #expect(agwrite(g, file) == 0)
+        var bytes = [UInt8](repeating: 0, count: ftell(file))
+        rewind(file)
+        #expect(fread(&bytes, 1, bytes.count, file) == bytes.count)
+        return String(decoding: bytes, as: UTF8.self)
+    }
+
+    let first = try streamed()
+    #expect(first.contains("узел -> e"))
+    #expect(g.asString == first)
+    // вторая запись берёт канонические строки из кэша
+    #expect(g.asString == first)
+
+    let added = try #require(agnode(g, cString("new node"), 1))
+    agsafeset(UnsafeMutableRawPointer(added), cString("label"), cString("fresh \"one\""), "")
+    agsafeset(UnsafeMutableRawPointer(agfstnode(g)), cString("label"), cString("node"), "")
+    let edited = try streamed()
+    #expect(edited != first)
+    #expect(g.asString == edited)
+}
+
+// Тест: пакетное построение графа из массивов имён, пар индексов и столбцов атрибутов
+@Test func testGraphBuilderFromArrays() async throws {
+    let names = ["a", "b", "c", "a"]
+    let graph = try GraphBuilderFromArrays.build(
+        nodes: names,
+        edges: [(0, 1), (1, 2), (3, 2), (2, 2)],
+        nodeAttributes: ["label": ["A", nil, "C", nil]],
+        edgeAttributes: ["color": ["red", nil, "blue", nil]]
+    )
+    #expect(graph.nodes.count == 3)
+    #expect(graph.edges.count == 4)
+    #expect(graph.nodes.map(\.label) == ["A", "", "C"])
+    #expect(agnnodes(graph.graph) == 3)
+    #expect(agnedges(graph.graph) == 4)
+    #expect(throws: GraphBuilderFromArrays.GraphBuilderError.edgeOutOfRange) {
+        try GraphBuilderFromArrays.build(nodes: names, edges: [(0, 4)])
+    }
+}
+
+// Тест: пакетное построение графа даёт тот же DOT, что и agnode/agedge/agsafeset по одному
+@Test func testGraphBuilderFromArraysMatchesSingleCalls() async throws {
+    var state: UInt64 = 0x9e3779b97f4a7c15
+    func next(_ bound: Int) -> Int {
+        state = state &* 6364136223846793005 &+ 1442695040888963407
+        return Int(state >> 33) % bound
+    }
+    // повторяющиеся имена, петли, кратные рёбра и пропущенные значения атрибутов
+    let names = (0..<3_000).map { "n\(next(2_500))" }
+    let edges = (0..<6_000).map { index in
+        (tail: index % 3 == 0 ? 0 : next(names.count), head: next(names.count))
+    }
+    let labels = names.indices.map { $0 % 4 == 0 ? nil : "label \($0)" }
+    let colors = edges.indices.map { $0 % 5 == 0 ? nil : ["red", "blue", "black"][$0 % 3] }
+    let bulk = try GraphBuilderFromArrays.build(
+        nodes: names,
+        edges: edges,
+        nodeAttributes: ["label": labels],
+        edgeAttributes: ["color": colors]
+    )
+
+    let single = try Graph(name: String(cString: agnameof(UnsafeMutableRawPointer(bulk.graph))), type: .nonStrictDirected)
+    let nodes = try names.map { try Node(parent: single.graph, name: $0) }
+    for (node, label) in zip(nodes, labels) {
+        if let label {
+            agsafeset(UnsafeMutableRawPointer(node.node), cString("label"), cString(label), "")
+        }
+    }
+    for (edge, color) in zip(edges, colors) {
+        let made = try Edge(parent: single.graph, from: nodes[edge.tail], to: nodes[edge.head])
+        if let color {
+            agsafeset(UnsafeMutableRawPointer(made.edge), cString("color"), cString(color), "")
+        }
+    }
+
+    #expect(agnnodes(bulk.graph) == agnnodes(single.graph))
+    #expect(agnedges(bulk.graph) == 6_000)
+    #expect(bulk.graph.asString == single.graph.asString)
+}
+
+// Тест: граф с объектами в арене (AgArenaDisc) разбирается и укладывается dot так же, как с malloc
+@Test func testArenaGraphMatchesMalloc() async throws {
+    var dot = "digraph G {\n  node [shape=box];\n"
+    for index in 1..<600 {
+        dot += "  n\(index / 2 + index % 3) -> n\(index) [weight=\(1 + index % 5), label=\"e\(index)\"];\n"
+    }
+    dot += "}\n"
+    let pool = GVContextPool(capacity: 1)
+    func layout(memory: UnsafeMutablePointer<Agmemdisc_t>) throws -> (dot: String, stats: Agmemstats_t) {
+        var bytes = Array(dot.utf8)
+        return try bytes.withUnsafeMutableBytes { buffer in
+            let file = try #require(fmemopen(buffer.baseAddress, buffer.count, "r"))
+            defer {
+                fclose(file)
+            }
+            // сканер agread читает через disc->io, поэтому берутся стандартные дисциплины
+            var disc = AgDefaultDisc
+            disc.mem = memory
+            let graph = try #require(agread(file, &disc))
+            defer {
+                agclose(graph)
+            }
+            let text = try pool.withContext { context in
+                defer {
+                    gvFreeLayout(context, graph)
+                }
+                #expect(gvLayout(context, graph, "dot") == 0)
+                attach_attrs(graph)
+                return try #require(graph.asString)
+            }
+            return (text, agmemstats(graph))
+        }
+    }
+
+    let heap = try withUnsafeMutablePointer(to: &AgMemDisc) { try layout(memory: $0) }
+    let arena = try withUnsafeMutablePointer(to: &AgArenaDisc) { try layout(memory: $0) }
+    #expect(arena.dot == heap.dot)
+    #expect(arena.stats.allocations == heap.stats.allocations)
+    #expect(heap.stats.peak_bytes == 0)
+    #expect(arena.stats.peak_bytes >= arena.stats.bytes)
+    #expect(arena.stats.chunk_bytes >= arena.stats.peak_bytes)
+}
+
+/// ID ребра: поиск может вернуть входящую половину ребра вместо исходящей, но ID у них общий
+private func edgeID(_ edge: UnsafeMutablePointer<Agedge_t>?) -> IDTYPE? {
+    edge?.pointee.base.tag.id
+}
+
+/// Имена узлов графа `g` в прямом и обратном порядке обхода
+private func nodeOrder(_ g: GVGraph) -> (forward: [String], backward: [String]) {
+    var forward: [String] = []
+    var node = agfstnode(g)
+    while let current = node {
+        forward.append(String(cString: agnameof(UnsafeMutableRawPointer(current))))
+        node = agnxtnode(g, current)
+    }
+    var backward: [String] = []
+    node = aglstnode(g)
+    while let current = node {
+        backward.append(String(cString: agnameof(UnsafeMutableRawPointer(current))))
+        node = agprvnode(g, current)
+    }
+    return (forward, backward)
+}
+
+// Тест: кратные рёбра; после удаления самого раннего поиск по концам находит следующее
+@Test func testParallelEdgesPromoteNextOnDelete() async throws {
+    let g = try #require(agopen(cString("g"), GVGraphType.nonStrictDirected.graphvizValue, nil))
+    defer {
+        agclose(g)
+    }
+    let a = try #require(agnode(g, cString("a"), 1))
+    let b = try #require(agnode(g, cString("b"), 1))
+    let edges = try (0..<3).map { _ in try #require(agedge(g, a, b, nil, 1)) }
+    #expect(Set(edges.map(edgeID)).count == 3)
+    #expect(agnedges(g) == 3)
+
+    let sub = try #require(agsubg(g, cString("s"), 1))
+    agsubedge(sub, edges[2], 1)
+    agsubedge(sub, edges[1], 1)
+
+    agdeledge(g, edges[0])
+    #expect(agnedges(g) == 2)
+    #expect(edgeID(agedge(g, a, b, nil, 0)) == edgeID(edges[1]))
+    #expect(edgeID(agidedge(g, a, b, edgeID(edges[2])!, 0)) == edgeID(edges[2]))
+    agdeledge(g, edges[1])
+    #expect(edgeID(agedge(g, a, b, nil, 0)) == edgeID(edges[2]))
+    #expect(edgeID(agedge(sub, a, b, nil, 0)) == edgeID(edges[2]))
+    agdeledge(g, edges[2])
+    #expect(agedge(g, a, b, nil, 0) == nil)
+    #expect(agnedges(sub) == 0)
+}
+
+// Тест: agidedge находит не первое из кратных рёбер, в том числе в подграфе
+@Test func testIdEdgeFindsLaterParallelEdge() async throws {
+    let g = try #require(agopen(cString("g"), GVGraphType.nonStrictDirected.graphvizValue, nil))
+    defer {
+        agclose(g)
+    }
+    let a = try #require(agnode(g, cString("a"), 1))
+    let b = try #require(agnode(g, cString("b"), 1))
+    let edges = try (0..<5).map { _ in try #require(agedge(g, a, b, nil, 1)) }
+    for edge in edges {
+        #expect(edgeID(agidedge(g, a, b, edgeID(edge)!, 0)) == edgeID(edge))
+    }
+    // у ребра b -> a нет ни одного из этих ID
+    #expect(agidedge(g, b, a, edgeID(edges[3])!, 0) == nil)
+
+    let sub = try #require(agsubg(g, cString("s"), 1))
+    agsubedge(sub, edges[3], 1)
+    #expect(edgeID(agidedge(sub, a, b, edgeID(edges[3])!, 0)) == edgeID(edges[3]))
+    #expect(agidedge(sub, a, b, edgeID(edges[1])!, 0) == nil)
+}
+
+// Тест: agedge(g, t, h, NULL, 0) возвращает самое раннее из рёбер между t и h
+@Test func testEdgeLookupReturnsEarliest() async throws {
+    let g = try #require(agopen(cString("g"), GVGraphType.nonStrictDirected.graphvizValue, nil))
+    defer {
+        agclose(g)
+    }
+    let a = try #require(agnode(g, cString("a"), 1))
+    let b = try #require(agnode(g, cString("b"), 1))
+    let named = try #require(agedge(g, a, b, cString("first"), 1))
+    let later = try (0..<4).map { _ in try #require(agedge(g, a, b, nil, 1)) }
+    #expect(edgeID(agedge(g, a, b, nil, 0)) == edgeID(named))
+    #expect(agedge(g, b, a, nil, 0) == nil)
+
+    // в подграфе самое раннее среди его собственных рёбер
+    let sub = try #require(agsubg(g, cString("s"), 1))
+    agsubedge(sub, later[3], 1)
+    agsubedge(sub, later[1], 1)
+    #expect(edgeID(agedge(sub, a, b, nil, 0)) == edgeID(later[1]))
+}
+
+// Тест: agnodebefore переставляет узлы; agfstnode/agnxtnode/agprvnode обходят новый порядок в графе и подграфе
+@Test func testNodeBeforeReordersIteration() async throws {
+    let g = try #require(agopen(cString("g"), GVGraphType.nonStrictDirected.graphvizValue, nil))
+    defer {
+        agclose(g)
+    }
+    let sub = try #require(agsubg(g, cString("s"), 1))
+    let nodes = try (0..<10).map { try #require(agnode(g, cString("n\($0)"), 1)) }
+    for index in [0, 2, 4, 6, 7, 8] {
+        agsubnode(sub, nodes[index], 1)
+    }
+
+    agnodebefore(nodes[2], nodes[7])
+    agnodebefore(nodes[0], nodes[9])
+    let root = ["n9", "n0", "n1", "n7", "n2", "n3", "n4", "n5", "n6", "n8"]
+    let subgraph = ["n0", "n7", "n2", "n4", "n6", "n8"]
+    #expect(nodeOrder(g).forward == root)
+    #expect(nodeOrder(g).backward == root.reversed())
+    #expect(nodeOrder(sub).forward == subgraph)
+    #expect(nodeOrder(sub).backward == subgraph.reversed())
+
+    // новые узлы идут после переставленных
+    agnode(g, cString("m"), 1)
+    #expect(nodeOrder(g).forward == root + ["m"])
+}
+
+// Тест: удаление узлов во время обхода графа и подграфа
+@Test func testDeleteNodesWhileIterating() async throws {
+    let g = try #require(agopen(cString("g"), GVGraphType.nonStrictDirected.graphvizValue, nil))
+    defer {
+        agclose(g)
+    }
+    let sub = try #require(agsubg(g, cString("s"), 1))
+    let nodes = try (0..<12).map { try #require(agnode(g, cString("n\($0)"), 1)) }
+    for index in nodes.indices {
+        agsubnode(sub, nodes[index], 1)
+        agedge(g, nodes[index], nodes[(index + 1) % nodes.count], nil, 1)
+    }
+
+    func deleting(from graph: GVGraph, where shouldDelete: (Int) -> Bool) {
+        var node = agfstnode(graph)
+        while let current = node {
+            node = agnxtnode(graph, current)
+            let name = String(cString: agnameof(UnsafeMutableRawPointer(current)))
+            if shouldDelete(Int(name.dropFirst())!) {
+                agdelnode(graph, current)
+            }
+        }
+    }
+
+    // из подграфа узлы уходят, а в корне остаются
+    deleting(from: sub) { $0 % 2 == 1 }
+    #expect(nodeOrder(sub).forward == ["n0", "n2", "n4", "n6", "n8", "n10"])
+    #expect(nodeOrder(sub).backward == ["n10", "n8", "n6", "n4", "n2", "n0"])
+    #expect(agnnodes(g) == 12)
+
+    deleting(from: g) { $0 % 3 == 0 }
+    #expect(nodeOrder(g).forward == ["n1", "n2", "n4", "n5", "n7", "n8", "n10", "n11"])
+    #expect(nodeOrder(g).backward == ["n11", "n10", "n8", "n7", "n5", "n4", "n2", "n1"])
+    #expect(nodeOrder(sub).forward == ["n2", "n4", "n8", "n10"])
+    #expect(agnedges(g) == 4)
+}
+
+// Тест: раскладка sfdp не зависит от числа потоков (атрибут threads)
+@Test func testSfdpThreadsMatchSerial() async throws {
+    func source(threads: Int) -> String {
+        var dot = "graph G { threads=\(threads); quadtree=fast;\n"
+        // случайное связное дерево с добавочными рёбрами, одинаковое для обеих раскладок
+        var state: UInt64 = 0x2545f4914f6cdd1d
+        func next(_ bound: Int) -> Int {
+            state = state &* 6364136223846793005 &+ 1442695040888963407
+            return Int(state >> 33) % bound
+        }
+        for index in 1..<5000 {
+            dot += "n\(next(index)) -- n\(index);\n"
+            if index % 4 == 0 {
+                dot += "n\(next(index)) -- n\(next(index));\n"
+            }
+        }
+        return dot + "}"
+    }
+    let renderer = RendererSwiftUI(layout: .sfdp, pool: GVContextPool(capacity: 1))
+    let serial = try renderer.layout(graph: GraphBuilderFromString.build(str: source(threads: 1)))
+    let parallel = try renderer.layout(graph: GraphBuilderFromString.build(str: source(threads: 4)))
+    #expect(parallel.size == serial.size)
+    #expect(parallel.nodes.map(\.frame) == serial.nodes.map(\.frame))
+}
+
+// Тест: предобуславливатели сглаживания sfdp (атрибут smoothing_precon) дают ту же раскладку, что и Якоби,
+// а сопряжённым градиентам с ними нужно не больше итераций
+@Test func testSfdpSmoothingPreconditioners() async throws {
+    let renderer = RendererSwiftUI(layout: .sfdp, pool: GVContextPool(capacity: 1))
+    func centers(precon: String) throws -> [CGPoint] {
+        let dot = gridGraph(side: 40, attributes: "smoothing=avg_dist; smoothing_precon=\(precon);")
+        return try renderer.layout(graph: GraphBuilderFromString.build(str: dot)).nodes.map {
+            CGPoint(x: $0.frame.midX, y: $0.frame.midY)
+        }
+    }
+    let jacobi = try centers(precon: "jacobi")
+    #expect(jacobi.count == 1600)
+    let size = max(
+        jacobi.map(\.x).max()! - jacobi.map(\.x).min()!,
+        jacobi.map(\.y).max()! - jacobi.map(\.y).min()!
+    )
+    for precon in ["ic0", "amg"] {
+        let points = try centers(precon: precon)
+        #expect(points.count == jacobi.count)
+        let deviation = zip(points, jacobi).map { max(abs($0.x - $1.x), abs($0.y - $1.y)) }.max() ?? 0
+        #expect(deviation < 0.001 * size)
+    }
+
+    // система того же вида, что при сглаживании: взвешенный лапласиан решётки, здесь со сдвигом диагонали
+    let side = 40
+    let n = side * side
+    var rows = [Int32](), columns = [Int32](), values = [Double]()
+    var adjacencyRows = [Int32](), adjacencyColumns = [Int32]()
+    for index in 0..<n {
+        for neighbor in [index % side < side - 1 ? index + 1 : n, index + side] where neighbor < n {
+            let weight = Double(1 + (index * 7 + neighbor) % 5)
+            rows += [Int32(index), Int32(neighbor), Int32(index), Int32(neighbor)]
+            columns += [Int32(neighbor), Int32(index), Int32(index), Int32(neighbor)]
+            values += [-weight, -weight, weight, weight]
+            adjacencyRows += [Int32(index), Int32(neighbor)]
+            adjacencyColumns += [Int32(neighbor), Int32(index)]
+        }
+        rows.append(Int32(index))
+        columns.append(Int32(index))
+        values.append(0.01)
+    }
+    var ones = [Double](repeating: 1, count: adjacencyRows.count)
+    let laplacian = try #require(SparseMatrix_from_coordinate_arrays(Int32(rows.count), Int32(n), Int32(n), &rows, &columns, &values, Int32(MATRIX_TYPE_REAL), MemoryLayout<Double>.size))
+    let adjacency = try #require(SparseMatrix_from_coordinate_arrays(Int32(adjacencyRows.count), Int32(n), Int32(n), &adjacencyRows, &adjacencyColumns, &ones, Int32(MATRIX_TYPE_REAL), MemoryLayout<Double>.size))
+    // уровни AMG берутся из многоуровневого огрубления графа, которое перемешивает узлы через rand()
+    srand(1)
+    let grid = Multilevel_new(adjacency, Multilevel_control(maxlevel: .max, threads: 1))
+    defer {
+        Multilevel_delete(grid)
+        SparseMatrix_delete(adjacency)
+        SparseMatrix_delete(laplacian)
+    }
+
+    var state: UInt64 = 0x9e3779b97f4a7c15
+    let rhs = (0..<2 * n).map { _ in
+        state = state &* 6364136223846793005 &+ 1442695040888963407
+        return Double(state >> 33) / Double(1 << 31) - 0.5
+    }
+    func solve(precon: Int32) throws -> (x: [Double], precon: Int32, iterations: Int32) {
+        let solver = try #require(SparseSolver_new(laplacian, precon, grid, 1))
+        defer {
+            SparseSolver_delete(solver)
+        }
+        var x0 = [Double](repeating: 0, count: 2 * n)
+        var x = rhs
+        _ = SparseSolver_solve(solver, 2, &x0, &x, 1e-8, 1000)
+        return (x, solver.pointee.precon, solver.pointee.iterations)
+    }
+    let reference = try solve(precon: Int32(PRECON_JACOBI))
+    for precon in [Int32(PRECON_IC0), Int32(PRECON_AMG)] {
+        let solved = try solve(precon: precon)
+        #expect(solved.precon == precon)
+        #expect(zip(solved.x, reference.x).allSatisfy { abs($0 - $1) < 1e-6 })
+        #expect(solved.iterations <= reference.iterations)
+    }
+}
+
+// Тест: запросы к упакованному R-дереву совпадают с полным перебором
+@Test func testPackedRTreeQueries() async throws {
+    for count in [0, 1, 15, 16, 17, 300, 5000] {
+        let boxes = (0..<count).map { _ in
+            let x = Double.random(in: 0..<1000)
+            let y = Double.random(in: 0..<1000)
+            return boxf(
+                LL: pointf(x: x, y: y),
+                UR: pointf(x: x + Double.random(in: 0..<30), y: y + Double.random(in: 0..<30))
+            )
+        }
+        let tree = packed_rtree_build(boxes, boxes.count)
+        defer { packed_rtree_free(tree) }
+        #expect(packed_rtree_size(tree) == count)
+
+        for _ in 0..<20 {
+            let x = Double.random(in: 0..<1000)
+            let y = Double.random(in: 0..<1000)
+            let side = Double.random(in: 0..<200)
+            var hits: UnsafeMutablePointer<Int>?
+            let rectCount = packed_rtree_query_rect(
+                tree,
+                boxf(LL: pointf(x: x, y: y), UR: pointf(x: x + side, y: y + side)),
+                &hits
+            )
+            let rectHits = Array(UnsafeBufferPointer(start: hits, count: rectCount))
+            free(hits)
+            let rectExpected = boxes.indices.filter {
+                boxes[$0].LL.x <= x + side && x <= boxes[$0].UR.x &&
+                boxes[$0].LL.y <= y + side && y <= boxes[$0].UR.y
+            }
+            #expect(rectHits == rectExpected)
+
+            let tolerance = Double.random(in: 0..<20)
+            let pointCount = packed_rtree_query_point(tree, pointf(x: x, y: y), tolerance, &hits)
+            let pointHits = Array(UnsafeBufferPointer(start: hits, count: pointCount))
+            free(hits)
+            let pointExpected = boxes.indices.filter {
+                let dx = max(boxes[$0].LL.x - x, x - boxes[$0].UR.x, 0)
+                let dy = max(boxes[$0].LL.y - y, y - boxes[$0].UR.y, 0)
+                return dx * dx + dy * dy <= tolerance * tolerance
+            }
+            #expect(pointHits == pointExpected)
+        }
+    }
+}
+
+// Тест: отсечение по видимой области и поиск узла по точке в GraphUI
+@Test func testGraphUISpatialQueries() async throws {
+    var dot = "digraph G {\n"
+    for index in 0..<200 {
+        dot += "n\(index) -> n\((index * 7 + 3) % 200);\n"
+    }
+    dot += "}"
+    let graph = try GraphBuilderFromString.build(str: dot)
+    let layout = try RendererSwiftUI(layout: .dot, pool: GVContextPool(capacity: 1)).layout(graph: graph)
+
+    let viewport = CGRect(x: layout.size.width / 4, y: layout.size.height / 4,
+                          width: layout.size.width / 3, height: layout.size.height / 3)
+    // касание границы тоже считается пересечением
+    let touches = { (rect: CGRect) in
+        rect.minX <= viewport.maxX && viewport.minX <= rect.maxX &&
+        rect.minY <= viewport.maxY && viewport.minY <= rect.maxY
+    }
+    let visible = layout.elements(in: viewport)
+    #expect(visible.nodes == layout.nodes.filter { touches($0.frame) })
+    #expect(visible.edges == layout.edges.filter { touches($0.bounds) })
+    #expect(visible.nodes.count < layout.nodes.count)
+
+    for node in layout.nodes.prefix(20) {
+        let center = CGPoint(x: node.frame.midX, y: node.frame.midY)
+        #expect(layout.nodes(at: center).contains(node))
+    }
+    #expect(layout.nodes(at: CGPoint(x: -1000, y: -1000)).isEmpty)
+
+    // после правки массива индекс строится заново при следующем запросе, у копии он прежний
+    var edited = layout
+    edited.nodes.removeFirst(10)
+    for node in edited.nodes.prefix(20) {
+        let center = CGPoint(x: node.frame.midX, y: node.frame.midY)
+        #expect(edited.nodes(at: center).contains(node))
+    }
+    let everything = CGRect(origin: .zero, size: layout.size).insetBy(dx: -100, dy: -100)
+    #expect(edited.elements(in: everything).nodes == edited.nodes)
+    #expect(layout.elements(in: everything).nodes == layout.nodes)
+}
+
+// Тест: повторная раскладка dot после правки начинается с предыдущей
+@Test func testIncrementalDotLayout() async throws {
+    var dot = "digraph G {\n"
+    for index in 1..<120 {
+        dot += "n\((index - 1) / 3) -> n\(index);\n"
+    }
+    dot += "}"
+    let graph = try GraphBuilderFromString.build(str: dot)
+    let renderer = RendererSwiftUI(layout: .dot, pool: GVContextPool(capacity: 1))
+    #expect(try renderer.layout(graph: graph).dotLayout == nil)
+    let first = try renderer.layout(graph: graph, updatable: true)
+    #expect(first.dotLayout != nil)
+
+    let leaf = try Node(parent: graph.graph, name: "added")
+    graph.append(leaf)
+    let parent = try #require(graph.nodes.first { String(cString: agnameof(UnsafeMutableRawPointer($0.node))) == "n39" })
+    graph.append(try Edge(parent: graph.graph, from: parent, to: leaf))
+    let second = try renderer.layout(graph: graph, updating: first)
+
+    #expect(second.nodes.count == first.nodes.count + 1)
+    #expect(second.edges.count == first.edges.count + 1)
+    let reused = try #require(second.dotLayout).reusedSplines
+    #expect(reused > 0)
+    #expect(reused < second.edges.count)
+}
+
+// Тест: упорядочивание dot с бюджетом времени (атрибут mclimit_ms) укладывает граф в срок
+@Test func testDotMincrossTimeBudget() async throws {
+    var dot = "digraph G { mclimit_ms=200;\n"
+    for component in 0..<6 {
+        dot += "subgraph cluster_\(component) { c\(component)_0; c\(component)_1; }\n"
+        for index in 0..<60 {
+            dot += "c\(component)_\(index % 17) -> c\(component)_\((index * 7 + 3) % 23);\n"
+        }
+    }
+    dot += "}"
+    let renderer = RendererSwiftUI(layout: .dot, pool: GVContextPool(capacity: 1))
+    let start = Date()
+    let graph = try renderer.layout(graph: GraphBuilderFromString.build(str: dot))
+    #expect(Date().timeIntervalSince(start) < 5)
+    #expect(graph.nodes.count == 6 * 23)
+    #expect(graph.nodes.allSatisfy { $0.frame.midX.isFinite && $0.frame.midY.isFinite })
+}
+
+// Тест: упорядочивание компонент связности dot на нескольких потоках совпадает с последовательным
+@Test func testDotComponentsThreadsMatchSerial() async throws {
+    let serial = try layoutPositions(layeredComponents(threads: 1, clusters: false))
+    #expect(try layoutPositions(layeredComponents(threads: 4, clusters: false)) == serial)
+}
+
+// Тест: подсчёт пересечений деревом накопления на нескольких потоках при повторном упорядочивании кластеров совпадает с последовательным
+@Test func testDotCrossingCountThreadsMatchSerial() async throws {
+    // после кластеров весь граф упорядочивается заново, и ncross делит ранги между потоками
+    // dot сливает кратные рёбра, поэтому порог NCROSS_PARALLEL_EDGES (20 000) сравнивается с числом различных пар
+    let fixture = try GraphBuilderFromString.build(str: layeredComponents(threads: 1, clusters: true))
+    var pairs = Set<String>()
+    var node = agfstnode(fixture.graph)
+    while let current = node {
+        var edge = agfstout(fixture.graph, current)
+        while let out = edge {
+            let tail = String(cString: agnameof(UnsafeMutableRawPointer(agtail(out)!)))
+            let head = String(cString: agnameof(UnsafeMutableRawPointer(aghead(out)!)))
+            pairs.insert(tail + "->" + head)
+            edge = agnxtout(fixture.graph, out)
+        }
+        node = agnxtnode(fixture.graph, current)
+    }
+    #expect(pairs.count > 20_000)
+
+    let serial = try layoutPositions(layeredComponents(threads: 1, clusters: true))
+    #expect(try layoutPositions(layeredComponents(threads: 4, clusters: true)) == serial)
+}
+
+/// Атрибуты `pos` узлов и рёбер после раскладки, в порядке обхода графа
+private func layoutPositions(_ dot: String, layout: GVLayout = .dot) throws -> [String] {
+    let graph = try GraphBuilderFromString.build(str: dot)
+    _ = try RendererString(layout: layout, pool: GVContextPool(capacity: 1)).layout(graph: graph)
+    var positions: [String] = []
+    var node = agfstnode(graph.graph)
+    while let current = node {
+        positions.append(String(cString: agget(UnsafeMutableRawPointer(current), "pos")))
+        var edge = agfstout(graph.graph, current)
+        while let out = edge {
+            positions.append(String(cString: agget(UnsafeMutableRawPointer(out), "pos")))
+            edge = agnxtout(graph.graph, out)
+        }
+        node = agnxtnode(graph.graph, current)
+    }
+    return positions
+}
+
+/// Восемь компонент по 10 рангов и ~3000 рёбер: всего больше 20 000 различных рёбер, с которых `ncross` считает на нескольких потоках
+private func layeredComponents(threads: Int, clusters: Bool) -> String {
+    var state: UInt64 = 0x9e3779b97f4a7c15
+    func next(_ bound: Int) -> Int {
+        state = state &* 6364136223846793005 &+ 1442695040888963407
+        return Int(state >> 33) % bound
+    }
+    let (components, ranks, width) = (8, 10, 40)
+    var dot = "digraph G { threads=\(threads); splines=false; mclimit=0.25;\n"
+    for component in 0..<components {
+        if clusters {
+            dot += "subgraph cluster_\(component) { c\(component)_2_0; c\(component)_3_1; }\n"
+        }
+        for rank in 1..<ranks {
+            for index in 0..<width {
+                dot += "c\(component)_\(rank - 1)_\(next(width)) -> c\(component)_\(rank)_\(index);\n"
+            }
+        }
+        for _ in 0..<2_700 {
+            let rank = next(ranks - 1)
+            dot += "c\(component)_\(rank)_\(next(width)) -> c\(component)_\(rank + 1)_\(next(width));\n"
+        }
+    }
+    return dot + "}"
+}
+
+// Тест: кэш раскладок отдаёт результат для графа с тем же содержимым
+@Test func testLayoutCache() async throws {
+    let dot = "digraph G { a -> b; b -> c; a -> c; c -> d [color=red]; }"
+    let directory = FileManager.default.temporaryDirectory
+        .appendingPathComponent("layout-cache-\(UUID().uuidString)")
+    defer { try? FileManager.default.removeItem(at: directory) }
+    let cache = LayoutCache(limits: LayoutCache.Limits(entries: 2), directory: directory)
+    let renderer = RendererSwiftUI(layout: .dot, pool: GVContextPool(capacity: 1), cache: cache)
+
+    let first = try renderer.layout(graph: GraphBuilderFromString.build(str: dot))
+    let second = try renderer.layout(graph: GraphBuilderFromString.build(str: dot.replacingOccurrences(of: "red", with: "blue")))
+    #expect(cache.metrics.misses == 1)
+    #expect(cache.metrics.hits == 1)
+    #expect(second.size == first.size)
+    #expect(second.nodes.map(\.frame) == first.nodes.map(\.frame))
+    #expect(second.edges.map(\.bounds) == first.edges.map(\.bounds))
+
+    _ = try renderer.layout(graph: GraphBuilderFromString.build(str: "digraph { x -> y }"))
+    _ = try renderer.layout(graph: GraphBuilderFromString.build(str: "digraph { x -> z }"))
+    #expect(cache.metrics.evictions == 1)
+    #expect(cache.metrics.entries == 2)
+
+    // Новый кэш над тем же каталогом читает раскладку с диска
+    let reopened = LayoutCache(directory: directory)
+    let fromDisk = try RendererSwiftUI(layout: .dot, pool: GVContextPool(capacity: 1), cache: reopened)
+        .layout(graph: GraphBuilderFromString.build(str: dot))
+    #expect(reopened.metrics.diskHits == 1)
+    #expect(fromDisk.nodes.map(\.frame) == first.nodes.map(\.frame))
+}
+
+// Тест: раскладка, записанная в сам граф, не меняет его ключ в кэше
+@Test func testLayoutCacheSameGraphAgain() async throws {
+    let cache = LayoutCache()
+    let pool = GVContextPool(capacity: 1)
+    let renderer = RendererSwiftUI(layout: .dot, pool: pool, cache: cache)
+    let graph = try GraphBuilderFromString.build(
+        str: "digraph G { subgraph cluster_x { a; b [label=\"long label\"]; } a -> b; b -> c [label=e]; a -> c; }"
+    )
+    let key = cache.key(for: graph, layout: .dot)
+
+    // gvLayout оставляет в графе bb
+    let first = try renderer.layout(graph: graph)
+    let second = try renderer.layout(graph: graph)
+    #expect(cache.metrics.misses == 1)
+    #expect(cache.metrics.hits == 1)
+    #expect(second.nodes.map(\.frame) == first.nodes.map(\.frame))
+
+    // RendererString дописывает pos, width, height и lp
+    _ = try RendererString(layout: .dot, pool: pool).layout(graph: graph)
+    #expect(cache.key(for: graph, layout: .dot) == key)
+    _ = try renderer.layout(graph: graph)
+    #expect(cache.metrics.hits == 2)
+
+    // ширина, заданная после раскладки, снова входит в ключ
+    agsafeset(UnsafeMutableRawPointer(agfstnode(graph.graph)), cString("width"), cString("2"), "")
+    #expect(cache.key(for: graph, layout: .dot) != key)
+}